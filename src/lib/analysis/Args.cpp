@@ -102,6 +102,7 @@ Args::Ctor()
   doNormalizeTy = true;
 
   prof_metrics = Analysis::Args::MetricFlg_NULL;
+  prof_oocDir  = "";
 
   profflat_computeFinalMetricValues = true;
 
@@ -113,8 +114,12 @@ Args::Ctor()
   out_db_csv        = "";
   db_dir            = Analysis_DB_DIR_pfx "-" Analysis_DB_DIR_nm;
   db_copySrcFiles   = true;
+  db_srcLink        = SrcLink_Copy;
+  db_srcCache       = "";
+  db_traceContainer = false;
   out_db_config     = "";
   db_makeMetricDB   = false;
+  db_metricDBLayout = MetricDBLayout_Row;
   db_addStructId    = false;
 
   out_txt           = Analysis_OUT_TXT;
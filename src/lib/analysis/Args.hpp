@@ -178,6 +178,10 @@ public:
 
   uint prof_metrics;
 
+  // keep CCT metric values in a file in this directory (cf.
+  // Prof::Metric::IDataStore)
+  std::string prof_oocDir;       // disable: ""
+
   // TODO: Currently this is always true even though we only need to
   // compute final metric values for (1) hpcproftt (flat) and (2)
   // hpcprof-flat when it computes derived metrics.  However, at the
@@ -202,9 +206,30 @@ public:
   std::string db_dir;            // disable: ""
   bool db_copySrcFiles;
 
+  // how source files are placed in the database
+  enum SrcLink {
+    SrcLink_Copy = 0,
+    SrcLink_Hard,    // hard link, else copy
+    SrcLink_Reflink  // copy-on-write clone, else copy
+  };
+
+  int/*SrcLink*/ db_srcLink;
+  std::string db_srcCache;       // disable: ""
+
+  bool db_traceContainer;        // trace files as one container
+
   std::string out_db_config;     // disable: "", stdout: "-"
 
   bool db_makeMetricDB;
+
+  // how values are placed in a metric-db file
+  enum MetricDBLayout {
+    MetricDBLayout_Row = 0, // node by node (as hpcviewer reads)
+    MetricDBLayout_Blocked  // metric by metric, in blocks of nodes
+  };
+
+  int/*MetricDBLayout*/ db_metricDBLayout;
+
   bool db_addStructId;
 
   // -------------------------------------------------------
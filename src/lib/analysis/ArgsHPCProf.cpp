@@ -135,6 +135,19 @@ Options: Source Code and Static Structure:\n\
                        for which <old-path> is a prefix.  Use '\\' to escape\n\
                        instances of '=' within a path. May pass multiple\n\
                        times.\n\
+  --source-link <copy|hard|reflink>\n\
+                       Place source files in the database by copying them,\n\
+                       by hard linking them, or by cloning them (reflink).\n\
+                       Falls back to copying when a file cannot be linked,\n\
+                       e.g., across file systems. {copy}\n\
+  --source-cache <file>\n\
+                       Remember where source files were found in <file> and\n\
+                       reuse it in later runs with the same -I paths.\n\
+                       Files that are no longer there are looked up again.\n\
+  --trace-container    Pack the database's trace files into one file,\n\
+                       experiment.hpccontainer, which hpcserver reads in\n\
+                       place, instead of one file per thread.  (hpcprof-mpi\n\
+                       writes one container per rank.)\n\
 \n\
 Options: Metrics:\n\
   -M <metric>, --metric <metric>\n\
@@ -148,6 +161,9 @@ Options: Metrics:\n\
                        hpcprof-mpi does not compute 'thread'.\n\
   --force-metric       Force hpcprof to show all thread-level metrics,\n\
                        regardless of their number.\n\
+  --out-of-core <dir>  Keep the calling context tree's metric values in a\n\
+                       temporary file in <dir> rather than in memory, for\n\
+                       profiles whose merged tree does not fit in memory.\n\
 \n\
 Options: Output:\n\
   -o <db-path>, --db <db-path>, --output <db-path>\n\
@@ -156,6 +172,11 @@ Options: Output:\n\
   --metric-db <yes|no>\n\
                        Control whether to generate a thread-level metric\n\
                        value database for hpcviewer scatter plots. {no}\n\
+  --metric-db-layout <row|blocked>\n\
+                       Write metric-db files node by node ('row'), as\n\
+                       hpcviewer expects, or metric by metric in blocks of\n\
+                       nodes ('blocked'), so that tools can read one\n\
+                       metric across many threads cheaply. {row}\n\
   --remove-redundancy \n\
                        Eliminate procedure name redundancy in experiment.xml\n\
   --struct-id          Add 'str=nnn' field to profile data with the hpcstruct\n\
@@ -189,6 +210,13 @@ CmdLineParser::OptArgDesc Analysis::ArgsHPCProf::optArgs[] = {
   { 'R', "replace-path",    CLP::ARG_REQ,  CLP::DUPOPT_CAT,  CLP_SEPARATOR,
      NULL},
 
+  {  0 , "source-link",     CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
+     NULL },
+  {  0 , "source-cache",    CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
+     NULL },
+  {  0 , "trace-container", CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL,
+     NULL },
+
   { 'N', "normalize",       CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
      NULL },
 
@@ -197,6 +225,8 @@ CmdLineParser::OptArgDesc Analysis::ArgsHPCProf::optArgs[] = {
      NULL },
   {  0 , "force-metric",    CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL,
      NULL },
+  {  0 , "out-of-core",     CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
+     NULL },
 
   // Output options
   { 'o', "output",          CLP::ARG_REQ , CLP::DUPOPT_CLOB, NULL,
@@ -205,6 +235,8 @@ CmdLineParser::OptArgDesc Analysis::ArgsHPCProf::optArgs[] = {
      NULL },
   {  0 , "metric-db",       CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
      NULL },
+  {  0 , "metric-db-layout", CLP::ARG_REQ, CLP::DUPOPT_CLOB, NULL,
+     NULL },
   {  0 , "struct-id",       CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL,
      NULL },
 
@@ -426,6 +458,9 @@ ArgsHPCProf::parse(int argc, const char* const argv[])
       }
     }
     // N.B.: hpcprof checks for "force-metric": src/tool/hpcprof/Args.cpp
+    if (parser.isOpt("out-of-core")) {
+      prof_oocDir = parser.getOptArg("out-of-core");
+    }
     
     // Check for other options: Output options
     bool isDbDirSet = false;
@@ -441,9 +476,42 @@ ArgsHPCProf::parse(int argc, const char* const argv[])
       const string& arg = parser.getOptArg("metric-db");
       db_makeMetricDB = CmdLineParser::parseArg_bool(arg, "--metric-db option");
     }
+    if (parser.isOpt("metric-db-layout")) {
+      const string& arg = parser.getOptArg("metric-db-layout");
+      if (arg == "row") {
+	db_metricDBLayout = MetricDBLayout_Row;
+      }
+      else if (arg == "blocked") {
+	db_metricDBLayout = MetricDBLayout_Blocked;
+      }
+      else {
+	ARG_ERROR("Unexpected option argument '" << arg << "' for --metric-db-layout");
+      }
+    }
     if (parser.isOpt("struct-id")) {
       db_addStructId = true;
     }
+    if (parser.isOpt("source-link")) {
+      const string& arg = parser.getOptArg("source-link");
+      if (arg == "copy") {
+	db_srcLink = SrcLink_Copy;
+      }
+      else if (arg == "hard") {
+	db_srcLink = SrcLink_Hard;
+      }
+      else if (arg == "reflink") {
+	db_srcLink = SrcLink_Reflink;
+      }
+      else {
+	ARG_ERROR("Unexpected option argument '" << arg << "' for --source-link");
+      }
+    }
+    if (parser.isOpt("source-cache")) {
+      db_srcCache = parser.getOptArg("source-cache");
+    }
+    if (parser.isOpt("trace-container")) {
+      db_traceContainer = true;
+    }
 
     // Check for required arguments
     uint numArgs = parser.getNumArgs();
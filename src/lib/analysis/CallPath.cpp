@@ -64,10 +64,13 @@ using std::hex;
 using std::dec;
 
 #include <fstream>
+#include <iomanip>
+#include <sstream>
 
 #include <string>
 using std::string;
 
+#include <algorithm>
 #include <climits>
 #include <cstring>
 #include <map>
@@ -76,6 +79,7 @@ using std::string;
 #include <typeinfo>
 
 #include <sys/stat.h>
+#include <sys/time.h>
 
 //*************************** User Include Files ****************************
 
@@ -95,6 +99,7 @@ using std::string;
 #include <lib/profxml/XercesUtil.hpp>
 #include <lib/profxml/PGMReader.hpp>
 
+#include <lib/prof-lean/hpcrun-fmt.h>
 #include <lib/prof-lean/hpcrun-metric.h>
 
 #include <lib/binutils/LM.hpp>
@@ -127,6 +132,13 @@ std::ostream* Analysis::CallPath::dbgOs = NULL; // for parallel debugging
 static void
 coalesceStmts(Prof::Struct::Tree& structure);
 
+static Prof::CallPath::Profile*
+readProfile(const char* prof_fnm, uint groupId, uint rFlags,
+	    uint64_t& nBytes, double& secs);
+
+static string
+throughputStr(uint64_t nBytes, double secs);
+
 static bool
 isVDSOLoadModule(string name) {  
   // vdso load module name is in the following format:
@@ -154,15 +166,24 @@ read(const Util::StringVec& profileFiles, const Util::UIntVec* groupMap,
   }
   
   // General case
+  uint64_t nBytes = 0, nBytesAll = 0;
+  double secs = 0.0, secsAll = 0.0;
+
   uint groupId = (groupMap) ? (*groupMap)[0] : 0;
-  Prof::CallPath::Profile* prof = read(profileFiles[0], groupId, rFlags);
+  Prof::CallPath::Profile* prof =
+    readProfile(profileFiles[0].c_str(), groupId, rFlags, nBytes, secs);
+  nBytesAll += nBytes;
+  secsAll += secs;
 
   // add the directory into the set of directories
   prof->addDirectory(profileFiles[0]);
 
   for (uint i = 1; i < profileFiles.size(); ++i) {
     groupId = (groupMap) ? (*groupMap)[i] : 0;
-    Prof::CallPath::Profile* p = read(profileFiles[i], groupId, rFlags);
+    Prof::CallPath::Profile* p =
+      readProfile(profileFiles[i].c_str(), groupId, rFlags, nBytes, secs);
+    nBytesAll += nBytes;
+    secsAll += secs;
     prof->merge(*p, mergeTy, mrgFlags);
 
     prof->metricMgr()->mergePerfEventStatistics(p->metricMgr());
@@ -172,6 +193,9 @@ read(const Util::StringVec& profileFiles, const Util::UIntVec* groupMap,
     prof->addDirectory(profileFiles[i]);
   }
   prof->metricMgr()->mergePerfEventStatistics_finalize(profileFiles.size());
+
+  DIAG_Msg(1, "Read " << profileFiles.size() << " profile files: "
+	   << throughputStr(nBytesAll, secsAll));
   
   return prof;
 }
@@ -180,34 +204,9 @@ read(const Util::StringVec& profileFiles, const Util::UIntVec* groupMap,
 Prof::CallPath::Profile*
 read(const char* prof_fnm, uint groupId, uint rFlags)
 {
-  // -------------------------------------------------------
-  // 
-  // -------------------------------------------------------
-
-  Prof::CallPath::Profile* prof = NULL;
-  try {
-    DIAG_MsgIf(0, "Reading: '" << prof_fnm << "'");
-    prof = Prof::CallPath::Profile::make(prof_fnm, rFlags, /*outfs*/ NULL);
-  }
-  catch (...) {
-    DIAG_EMsg("While reading profile '" << prof_fnm << "'...");
-    throw;
-  }
-
-  // -------------------------------------------------------
-  // Potentially update the profile's metrics
-  // -------------------------------------------------------
-
-  if (groupId > 0) {
-    Prof::Metric::Mgr* metricMgr = prof->metricMgr();
-    for (uint i = 0; i < metricMgr->size(); ++i) {
-      Prof::Metric::ADesc* m = metricMgr->metric(i);
-      m->namePfx(StrUtil::toStr(groupId));
-    }
-    metricMgr->recomputeMaps();
-  }
-
-  return prof;
+  uint64_t nBytes = 0;
+  double secs = 0.0;
+  return readProfile(prof_fnm, groupId, rFlags, nBytes, secs);
 }
 
 
@@ -251,6 +250,74 @@ readStructure(Prof::Struct::Tree* structure, const Analysis::Args& args)
 } // namespace Analysis
 
 
+//****************************************************************************
+
+static double
+wallSecs()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+
+// Read one profile file, returning in 'nBytes' and 'secs' how much was
+// read and how long that took.
+static Prof::CallPath::Profile*
+readProfile(const char* prof_fnm, uint groupId, uint rFlags,
+	    uint64_t& nBytes, double& secs)
+{
+  // -------------------------------------------------------
+  // 
+  // -------------------------------------------------------
+
+  Prof::CallPath::Profile* prof = NULL;
+  double beg = wallSecs();
+  nBytes = 0;
+  try {
+    DIAG_MsgIf(0, "Reading: '" << prof_fnm << "'");
+    prof = Prof::CallPath::Profile::make(prof_fnm, rFlags, /*outfs*/ NULL,
+					 &nBytes);
+  }
+  catch (...) {
+    DIAG_EMsg("While reading profile '" << prof_fnm << "'...");
+    throw;
+  }
+  secs = wallSecs() - beg;
+
+  DIAG_Msg(2, "Read '" << prof_fnm << "': " << throughputStr(nBytes, secs));
+
+  // -------------------------------------------------------
+  // Potentially update the profile's metrics
+  // -------------------------------------------------------
+
+  if (groupId > 0) {
+    Prof::Metric::Mgr* metricMgr = prof->metricMgr();
+    for (uint i = 0; i < metricMgr->size(); ++i) {
+      Prof::Metric::ADesc* m = metricMgr->metric(i);
+      m->namePfx(StrUtil::toStr(groupId));
+    }
+    metricMgr->recomputeMaps();
+  }
+
+  return prof;
+}
+
+
+static string
+throughputStr(uint64_t nBytes, double secs)
+{
+  double mb = nBytes / (1024.0 * 1024.0);
+  std::ostringstream os;
+  os << std::fixed << std::setprecision(2) << mb << " MB in "
+     << std::setprecision(3) << secs << " s";
+  if (secs > 0.0) {
+    os << " (" << std::setprecision(1) << (mb / secs) << " MB/s)";
+  }
+  return os.str();
+}
+
+
 //****************************************************************************
 
 
@@ -388,11 +455,28 @@ precomputeStructSimple(Prof::Struct::LM * lmStruct,
     return;
   }
 
-  for (uint i = 0; i < vmaVec->size(); i++) {
-    VMA vma = (*vmaVec)[i];
+  // Look up the file and line of every vma in one merge join over
+  // the module's line table.  If the module has none, fall back to
+  // per-vma lookups.
+  std::vector<VMA> vmas(*vmaVec);
+  std::sort(vmas.begin(), vmas.end());
+  vmas.erase(std::unique(vmas.begin(), vmas.end()), vmas.end());
+
+  std::vector<const std::string*> files;
+  std::vector<SrcFile::ln> lines;
+  bool batched = lm->findSrcLines(vmas, files, lines);
+
+  for (uint i = 0; i < vmas.size(); i++) {
+    VMA vma = vmas[i];
 
     if (lmStruct->findStmt(vma) == NULL) {
-      BAnal::Struct::makeStructureSimple(lmStruct, lm, vma);
+      if (batched) {
+	BAnal::Struct::makeStructureSimple(lmStruct, lm, vma,
+					   files[i], lines[i]);
+      }
+      else {
+	BAnal::Struct::makeStructureSimple(lmStruct, lm, vma);
+      }
     }
   }
 
@@ -1239,10 +1323,16 @@ makeDatabase(Prof::CallPath::Profile& prof, const Analysis::Args& args)
   // 1. Copy source files.  
   //    NOTE: makes file names in 'prof.structure' relative to database
   Analysis::Util::copySourceFiles(prof.structure()->root(),
-				  args.searchPathTpls, db_dir);
+				  args.searchPathTpls, db_dir,
+				  args.db_srcLink, args.db_srcCache);
 
   // 2. Copy trace files (if necessary)
-  Analysis::Util::copyTraceFiles(db_dir, prof.traceFileNameSet());
+  string traceContainer;
+  if (args.db_traceContainer) {
+    traceContainer = string("experiment.") + HPCRUN_ContainerFnmSfx;
+  }
+  Analysis::Util::copyTraceFiles(db_dir, prof.traceFileNameSet(),
+				  prof.traceCpIdMaps(), traceContainer);
 
   // 3. Create 'experiment.xml' file
   string experiment_fnm = db_dir + "/" + args.out_db_experiment;
@@ -154,7 +154,8 @@ Driver::run()
     DIAG_Msg(1, "Copying source files reached by PATH/REPLACE options to " << db_dir);
     // NOTE: makes file names in m_structure relative to database
     Analysis::Util::copySourceFiles(m_structure.root(), m_args.searchPathTpls,
-				    db_dir);
+				    db_dir, m_args.db_srcLink,
+				    m_args.db_srcCache);
   }
 
   const string out_path = (db_use) ? (db_dir + "/") : "";
@@ -63,6 +63,8 @@
 #include <string>
 using std::string;
 
+#include <vector>
+
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 
@@ -72,6 +74,7 @@ using std::string;
 #include "Util.hpp"
 
 #include <lib/prof/CallPath-Profile.hpp>
+#include <lib/prof/CallPath-MetricDB.hpp>
 #include <lib/prof/Flat-ProfileData.hpp>
 
 #include <lib/prof-lean/hpcio.h>
@@ -82,22 +85,32 @@ using std::string;
 
 //*************************** Forward Declarations ***************************
 
+static int
+writeAsText_callpathEpoch(FILE* fs, const hpcrun_fmt_hdr_t& hdr,
+			  const Analysis::Raw::Filter& filter);
+
+static void
+writeAsText_metricDBRow(Prof::CallPath::MetricDB& db, uint nodeId,
+			std::vector<double>& row,
+			const Analysis::Raw::Filter& filter);
+
 //****************************************************************************
 
 void 
-Analysis::Raw::writeAsText(/*destination,*/ const char* filenm)
+Analysis::Raw::writeAsText(/*destination,*/ const char* filenm,
+			   const Filter& filter)
 {
   using namespace Analysis::Util;
 
   ProfType_t ty = getProfileType(filenm);
   if (ty == ProfType_Callpath) {
-    writeAsText_callpath(filenm);
+    writeAsText_callpath(filenm, filter);
   }
   else if (ty == ProfType_CallpathMetricDB) {
-    writeAsText_callpathMetricDB(filenm);
+    writeAsText_callpathMetricDB(filenm, filter);
   }
   else if (ty == ProfType_CallpathTrace) {
-    writeAsText_callpathTrace(filenm);
+    writeAsText_callpathTrace(filenm, filter);
   }
   else if (ty == ProfType_Flat) {
     writeAsText_flat(filenm);
@@ -109,55 +122,190 @@ Analysis::Raw::writeAsText(/*destination,*/ const char* filenm)
 
 
 void
-Analysis::Raw::writeAsText_callpath(const char* filenm)
+Analysis::Raw::writeAsText_callpath(const char* filenm, const Filter& filter)
 {
   if (!filenm) { return; }
 
-  Prof::CallPath::Profile* prof = NULL;
+  // N.B.: Rather than building a Prof::CallPath::Profile, decode and
+  // print one record at a time so that huge profiles can be dumped.
   try {
-    prof = Prof::CallPath::Profile::make(filenm, 0/*rFlags*/, stdout);
+    FILE* fs = hpcio_fopen_r(filenm);
+    if (!fs) {
+      DIAG_Throw("error opening profile file '" << filenm << "'");
+    }
+
+    char* fsBuf = new char[HPCIO_RWBufferSz];
+    int ret = setvbuf(fs, fsBuf, _IOFBF, HPCIO_RWBufferSz);
+    DIAG_AssertWarn(ret == 0, "Raw::writeAsText_callpath: setvbuf!");
+
+    hpcrun_fmt_hdr_t hdr;
+    ret = hpcrun_fmt_hdr_fread(&hdr, fs, malloc);
+    if (ret != HPCFMT_OK) {
+      DIAG_Throw("error reading 'fmt-hdr': either the file is not a profile "
+		 "or it is corrupted");
+    }
+    if ( !(hdr.version >= HPCRUN_FMT_Version_20) ) {
+      DIAG_Throw("unsupported file version '" << hdr.versionStr << "'");
+    }
+
+    hpcrun_fmt_hdr_fprint(&hdr, stdout);
+
+    uint numEpochs = 0;
+    while ( !feof(fs) ) {
+      ret = writeAsText_callpathEpoch(fs, hdr, filter);
+      if (ret == HPCFMT_EOF) {
+	break;
+      }
+      numEpochs++;
+    }
+
+    fprintf(stdout, "\n[You look fine today! (num-epochs: %u)]\n", numEpochs);
+
+    hpcrun_fmt_hdr_free(&hdr, free);
+    hpcio_fclose(fs);
+    delete[] fsBuf;
   }
   catch (...) {
     DIAG_EMsg("While reading '" << filenm << "'...");
     throw;
   }
-  delete prof;
 }
 
 
-void
-Analysis::Raw::writeAsText_callpathMetricDB(const char* filenm)
+// Prints one epoch of an hpcrun profile, keeping only the current CCT
+// node in memory.  Returns HPCFMT_EOF if there are no more epochs.
+static int
+writeAsText_callpathEpoch(FILE* fs, const hpcrun_fmt_hdr_t& hdr,
+			  const Analysis::Raw::Filter& filter)
 {
-  if (!filenm) { return; }
+  hpcrun_fmt_epochHdr_t ehdr;
+  int ret = hpcrun_fmt_epochHdr_fread(&ehdr, fs, malloc);
+  if (ret == HPCFMT_EOF) {
+    return HPCFMT_EOF;
+  }
+  if (ret != HPCFMT_OK) {
+    DIAG_Throw("error reading 'epoch-hdr'");
+  }
+  hpcrun_fmt_epochHdr_fprint(&ehdr, stdout);
+
+  metric_tbl_t metricTbl;
+  metric_aux_info_t* aux_info = NULL;
+  ret = hpcrun_fmt_metricTbl_fread(&metricTbl, &aux_info, fs, hdr.version,
+				   malloc);
+  if (ret != HPCFMT_OK) {
+    DIAG_Throw("error reading 'metric-tbl'");
+  }
+  hpcrun_fmt_metricTbl_fprint(&metricTbl, aux_info, stdout);
 
-  try {
-    FILE* fs = hpcio_fopen_r(filenm);
-    if (!fs) {
-      DIAG_Throw("error opening metric-db file '" << filenm << "'");
+  loadmap_t loadmap_tbl;
+  ret = hpcrun_fmt_loadmap_fread(&loadmap_tbl, fs, malloc);
+  if (ret != HPCFMT_OK) {
+    DIAG_Throw("error reading 'loadmap'");
+  }
+  hpcrun_fmt_loadmap_fprint(&loadmap_tbl, stdout);
+  hpcrun_fmt_loadmap_free(&loadmap_tbl, free);
+
+  // ------------------------------------------------------------
+  // The metrics to print, and a metric table with just those so that
+  // each value is printed in its own format
+  // ------------------------------------------------------------
+  std::vector<uint> shownIds;
+  std::vector<metric_desc_t> shownDescs;
+  for (uint i = 0; i < metricTbl.len; ++i) {
+    if (filter.isMetricShown(i)) {
+      shownIds.push_back(i);
+      shownDescs.push_back(metricTbl.lst[i]);
     }
+  }
+  metric_tbl_t shownTbl;
+  shownTbl.len = shownDescs.size();
+  shownTbl.lst = shownDescs.empty() ? NULL : &shownDescs[0];
+
+  // ------------------------------------------------------------
+  // cct
+  // ------------------------------------------------------------
+  uint64_t numNodes = 0;
+  ret = hpcfmt_int8_fread(&numNodes, fs);
+  if (ret != HPCFMT_OK) {
+    DIAG_Throw("error reading 'cct'");
+  }
+  fprintf(stdout, "[cct: (num-nodes: %" PRIu64 ")\n", numNodes);
+
+  std::vector<hpcrun_metricVal_t> metrics(metricTbl.len);
+  std::vector<hpcrun_metricVal_t> shownMetrics(shownIds.size());
 
-    hpcmetricDB_fmt_hdr_t hdr;
-    int ret = hpcmetricDB_fmt_hdr_fread(&hdr, fs);
+  hpcrun_fmt_cct_node_t nodeFmt;
+  hpcrun_fmt_cct_node_init(&nodeFmt);
+  nodeFmt.num_metrics = metricTbl.len;
+  nodeFmt.metrics = metrics.empty() ? NULL : &metrics[0];
+
+  hpcrun_fmt_cct_prev_t prev;
+  hpcrun_fmt_cct_prev_init(&prev);
+
+  for (uint64_t i = 0; i < numNodes; ++i) {
+    ret = hpcrun_fmt_cct_node_fread(&nodeFmt, ehdr.flags, &prev, fs);
     if (ret != HPCFMT_OK) {
-      DIAG_Throw("error reading metric-db file '" << filenm << "'");
+      DIAG_Throw("error reading CCT node " << nodeFmt.id);
+    }
+    if (!filter.isNodeShown((int)nodeFmt.id)) {
+      continue;
+    }
+
+    hpcrun_fmt_cct_node_t shownFmt = nodeFmt;
+    for (uint j = 0; j < shownIds.size(); ++j) {
+      shownMetrics[j] = metrics[shownIds[j]];
     }
+    shownFmt.num_metrics = shownIds.size();
+    shownFmt.metrics = shownMetrics.empty() ? NULL : &shownMetrics[0];
+
+    hpcrun_fmt_cct_node_fprint(&shownFmt, stdout, ehdr.flags, &shownTbl, "  ");
+  }
+
+  fprintf(stdout, "]\n");
+
+  hpcrun_fmt_epochHdr_free(&ehdr, free);
+  hpcrun_fmt_metricTbl_free(&metricTbl, free);
+  free(aux_info);
 
+  return HPCFMT_OK;
+}
+
+
+void
+Analysis::Raw::writeAsText_callpathMetricDB(const char* filenm,
+					    const Filter& filter)
+{
+  if (!filenm) { return; }
+
+  try {
+    // Either layout; rows are read in place, so selected nodes cost
+    // only their own pages
+    Prof::CallPath::MetricDB db(filenm);
+
+    hpcmetricDB_fmt_hdr_t hdr = db.hdr();
     hpcmetricDB_fmt_hdr_fprint(&hdr, stdout);
 
-    for (uint nodeId = 1; nodeId < hdr.numNodes + 1; ++nodeId) {
-      fprintf(stdout, "(%6u: ", nodeId);
-      for (uint mId = 0; mId < hdr.numMetrics; ++mId) {
-	double mval = 0;
-	ret = hpcfmt_real8_fread(&mval, fs);
-	if (ret != HPCFMT_OK) {
-	  DIAG_Throw("error reading trace file '" << filenm << "'");
+    std::vector<double> row(hdr.numMetrics);
+
+    if (filter.nodeIds.empty()) {
+      const uint chunk = HPCMETRICDB_FMT_BlockNodes;
+      for (uint nodeId = 1; nodeId < hdr.numNodes + 1; ++nodeId) {
+	if ((nodeId - 1) % chunk == 0) {
+	  db.prefetchRows(nodeId, nodeId + chunk);
 	}
-	fprintf(stdout, "%12g ", mval);
+	writeAsText_metricDBRow(db, nodeId, row, filter);
+      }
+    }
+    else {
+      std::set<uint>::const_iterator it;
+      for (it = filter.nodeIds.begin(); it != filter.nodeIds.end(); ++it) {
+	uint nodeId = *it;
+	if (nodeId < 1 || nodeId > hdr.numNodes) {
+	  continue;
+	}
+	writeAsText_metricDBRow(db, nodeId, row, filter);
       }
-      fprintf(stdout, ")\n");
     }
-
-    hpcio_fclose(fs);
   }
   catch (...) {
     DIAG_EMsg("While reading '" << filenm << "'...");
@@ -166,8 +314,30 @@ Analysis::Raw::writeAsText_callpathMetricDB(const char* filenm)
 }
 
 
+// Reads the metric values of 'nodeId' into 'row' and prints the ones
+// 'filter' lets through
+static void
+writeAsText_metricDBRow(Prof::CallPath::MetricDB& db, uint nodeId,
+			std::vector<double>& row,
+			const Analysis::Raw::Filter& filter)
+{
+  if (!row.empty()) {
+    db.fetchRow(nodeId, &row[0]);
+  }
+
+  fprintf(stdout, "(%6u: ", nodeId);
+  for (uint mId = 0; mId < row.size(); ++mId) {
+    if (filter.isMetricShown(mId)) {
+      fprintf(stdout, "%12g ", row[mId]);
+    }
+  }
+  fprintf(stdout, ")\n");
+}
+
+
 void
-Analysis::Raw::writeAsText_callpathTrace(const char* filenm)
+Analysis::Raw::writeAsText_callpathTrace(const char* filenm,
+					 const Filter& filter)
 {
   if (!filenm) { return; }
 
@@ -197,7 +367,10 @@ Analysis::Raw::writeAsText_callpathTrace(const char* filenm)
 	DIAG_Throw("error reading trace file '" << filenm << "'");
       }
 
-      hpctrace_fmt_datum_fprint(&datum, hdr.flags, stdout);
+      if (filter.isNodeShown((int)datum.cpId)
+	  && filter.isMetricShown(datum.metricId)) {
+	hpctrace_fmt_datum_fprint(&datum, hdr.flags, stdout);
+      }
     }
 
     hpcio_fclose(fs);
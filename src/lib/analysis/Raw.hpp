@@ -62,6 +62,7 @@
 
 //************************* System Include Files ****************************
 
+#include <set>
 #include <string>
 
 //*************************** User Include Files ****************************
@@ -76,21 +77,51 @@ namespace Analysis {
 
 namespace Raw {
 
+// Limits a dump to some CCT nodes and some metrics; an empty set means
+// everything.  Node ids are compared without the leaf flag, i.e., node
+// -5 is node 5.  Trace records are matched by call path and metric id.
+class Filter {
+public:
+  std::set<uint> nodeIds;
+  std::set<uint> metricIds;
+
+  bool
+  isNodeShown(int nodeId) const
+  {
+    uint id = (nodeId < 0) ? -nodeId : nodeId;
+    return nodeIds.empty() || nodeIds.find(id) != nodeIds.end();
+  }
+
+  bool
+  isMetricShown(uint metricId) const
+  {
+    return metricIds.empty() || metricIds.find(metricId) != metricIds.end();
+  }
+};
+
+
+// Each writer prints records as it decodes them, so memory use does not
+// depend on the size of the file.
 void 
-writeAsText(/*destination,*/ const char* filenm);
+writeAsText(/*destination,*/ const char* filenm,
+	    const Filter& filter = Filter());
 
 static inline void 
-writeAsText(/*destination,*/ const std::string& filenm)
-{ writeAsText(filenm.c_str()); }
+writeAsText(/*destination,*/ const std::string& filenm,
+	    const Filter& filter = Filter())
+{ writeAsText(filenm.c_str(), filter); }
 
 void
-writeAsText_callpath(/*destination,*/ const char* filenm);
+writeAsText_callpath(/*destination,*/ const char* filenm,
+		     const Filter& filter = Filter());
 
 void
-writeAsText_callpathMetricDB(/*destination,*/ const char* filenm);
+writeAsText_callpathMetricDB(/*destination,*/ const char* filenm,
+			     const Filter& filter = Filter());
 
 void
-writeAsText_callpathTrace(/*destination,*/ const char* filenm);
+writeAsText_callpathTrace(/*destination,*/ const char* filenm,
+			  const Filter& filter = Filter());
 
 void
 writeAsText_flat(/*destination,*/ const char* filenm);
@@ -60,33 +60,47 @@
 //************************* System Include Files ****************************
 
 #include <iostream>
+#include <fstream>
 
 #include <string>
 using std::string;
 
+#include <map>
+
 #include <algorithm>
 #include <typeinfo>
 
 #include <cstring> // strlen()
+#include <cerrno>
 
 #include <dirent.h> // scandir()
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 //*************************** User Include Files ****************************
 
 #include <include/gcc-attr.h>
+#include <include/hpctoolkit-config.h>
 #include <include/uint.h>
 
 #include "Util.hpp"
 
 #include <lib/banal/StructSimple.hpp>
 
+#include <lib/prof/FileError.hpp>
+
 #include <lib/prof-lean/hpcio.h>
 #include <lib/prof-lean/hpcfmt.h>
+#include <lib/prof-lean/hpcrun-container.h>
 #include <lib/prof-lean/hpcrun-fmt.h>
 #include <lib/prof-lean/hpcrunflat-fmt.h>
 
 #include <lib/support/PathFindMgr.hpp>
 #include <lib/support/PathReplacementMgr.hpp>
+#include <lib/support/FileUtil.hpp>
+#include <lib/support/StrUtil.hpp>
 #include <lib/support/diagnostics.h>
 #include <lib/support/dictionary.h>
 #include <lib/support/realpath.h>
@@ -119,6 +133,47 @@ hpcrunFileFilter(const struct dirent* entry)
 }
 
 
+static int
+hpccontainerFileFilter(const struct dirent* entry)
+{
+  static const string ext = string(".") + HPCRUN_ContainerFnmSfx;
+  static const uint extLen = ext.length();
+
+  return fileExtensionFilter(entry, ext, extLen);
+}
+
+
+// containerProfilePaths: Append the profile streams of the per-process
+// container 'fnm' to 'paths', named '<fnm>/<stream>' so that
+// hpcio_fopen_r can open them.  An incomplete container (its process
+// did not exit normally) has no index and is skipped with a warning.
+static void
+containerProfilePaths(const string& fnm, std::vector<string>& paths)
+{
+  hpccont_t* c = hpccont_open(fnm.c_str());
+  if (!c) {
+    DIAG_WMsg(1, "skipping unreadable or incomplete container '" << fnm
+	      << "': " << strerror(errno));
+    return;
+  }
+  for (uint i = 0; i < c->n_streams; ++i) {
+    if (c->streams[i].kind == HPCCONT_STREAM_PROFILE) {
+      paths.push_back(fnm + "/" + c->streams[i].name);
+    }
+  }
+  hpccont_close(c);
+}
+
+
+static bool
+isContainerFile(const string& fnm)
+{
+  static const string ext = string(".") + HPCRUN_ContainerFnmSfx;
+  return (fnm.length() > ext.length()
+	  && fnm.compare(fnm.length() - ext.length(), ext.length(), ext) == 0);
+}
+
+
 #if 0
 static int 
 hpctraceFileFilter(const struct dirent* entry)
@@ -144,9 +199,16 @@ getProfileType(const std::string& filenm)
   static const int bufSZ = 32;
   char buf[bufSZ] = { '\0' };
 
-  std::istream* is = IOUtil::OpenIStream(filenm.c_str());
-  is->read(buf, bufSZ);
-  IOUtil::CloseStream(is);
+  // N.B.: hpcio_fopen_r also opens streams in a container
+  FILE* fs = hpcio_fopen_r(filenm.c_str());
+  if (!fs) {
+    DIAG_Throw("'" << filenm << "' could not be opened.");
+  }
+  size_t nRead = fread(buf, 1, bufSZ, fs);
+  hpcio_fclose(fs);
+  if (nRead < (size_t)bufSZ) {
+    buf[nRead] = '\0';
+  }
   
   ProfType_t ty = ProfType_NULL;
   if (strncmp(buf, HPCRUN_FMT_Magic, HPCRUN_FMT_MagicLen) == 0) {
@@ -196,24 +258,48 @@ normalizeProfileArgs(const StringVec& inPaths)
       if (dirEntriesSz < 0) {
         DIAG_Throw("could not read directory: " << path);
       }
-      else {
-        out.groupMax++; // obtain next group;
-        for (int i = 0; i < dirEntriesSz; ++i) {
-          string nm = path + dirEntries[i]->d_name;
-          free(dirEntries[i]);
-          out.paths->push_back(nm);
-          out.pathLenMax = std::max(out.pathLenMax, (uint)nm.length());
-          out.groupMap->push_back(out.groupMax);
-        }
-        free(dirEntries);
+
+      std::vector<string> nms;
+      for (int i = 0; i < dirEntriesSz; ++i) {
+        nms.push_back(path + dirEntries[i]->d_name);
+        free(dirEntries[i]);
+      }
+      free(dirEntries);
+
+      // profiles of processes measured in container mode
+      dirEntries = NULL;
+      dirEntriesSz = scandir(path.c_str(), &dirEntries,
+          hpccontainerFileFilter, alphasort);
+      for (int i = 0; i < dirEntriesSz; ++i) {
+        containerProfilePaths(path + dirEntries[i]->d_name, nms);
+        free(dirEntries[i]);
+      }
+      free(dirEntries);
+      std::sort(nms.begin(), nms.end());
+
+      out.groupMax++; // obtain next group;
+      for (uint i = 0; i < nms.size(); ++i) {
+        out.paths->push_back(nms[i]);
+        out.pathLenMax = std::max(out.pathLenMax, (uint)nms[i].length());
+        out.groupMap->push_back(out.groupMax);
       }
       // TODO: collect group
     }
     else {
+      std::vector<string> nms;
+      if (isContainerFile(path)) {
+        containerProfilePaths(path, nms);
+      }
+      else {
+        nms.push_back(path);
+      }
+
       out.groupMax++; // obtain next group;
-      out.paths->push_back(path);
-      out.pathLenMax = std::max(out.pathLenMax, (uint)path.length());
-      out.groupMap->push_back(out.groupMax);
+      for (uint i = 0; i < nms.size(); ++i) {
+        out.paths->push_back(nms[i]);
+        out.pathLenMax = std::max(out.pathLenMax, (uint)nms[i].length());
+        out.groupMap->push_back(out.groupMax);
+      }
     }
   }
 
@@ -365,11 +451,46 @@ demandStructure(VMA vma, Prof::Struct::LM* lmStruct,
 // 
 //***************************************************************************
 
+// A source file name found in the structure, and where it was found
+struct SrcFileInfo {
+  SrcFileInfo(const string& x)
+    : fnm_orig(x), tplIdx(SrcTpl_Lost), isCached(false)
+  { }
+
+  enum { SrcTpl_Lost = -1, SrcTpl_Default = -2 };
+
+  string fnm_orig; // name in the structure
+  int tplIdx;      // index of the reaching PathTuple, or SrcTpl_*
+  string fnm_fnd;  // real path of the found file
+  bool isCached;   // found through the source cache
+};
+
+// fnm_orig -> <tplIdx, fnm_fnd>
+typedef std::map<string, std::pair<int, string> > SrcPathCache;
+
+
+static const string&
+srcFileName(Prof::Struct::ANode* strct);
+
+static void
+resolveSourceFile(SrcFileInfo& file, const Analysis::PathTupleVec& pathVec,
+		  const std::vector<string>& realPaths,
+		  const SrcPathCache& cache);
+
 static string
-copySourceFileMain(const string& fnm_orig,
-		   std::map<string, string>& processedFiles,
-		   const Analysis::PathTupleVec& pathVec,
-		   const string& dstDir);
+srcFileDBName(const string& fnm_fnd, const string& dstDir,
+	      const Analysis::PathTuple& pathTpl, string& fnm_to);
+
+static void
+copySourceFile(const string& fnm_fnd, const string& fnm_to, int linkMode);
+
+static void
+readSrcPathCache(const string& fnm, const Analysis::PathTupleVec& pathVec,
+		 SrcPathCache& cache);
+
+static void
+writeSrcPathCache(const string& fnm, const Analysis::PathTupleVec& pathVec,
+		  const SrcPathCache& cache);
 
 static bool 
 Flat_Filter(const Prof::Struct::ANode& x, long GCC_ATTR_UNUSED type)
@@ -387,13 +508,22 @@ namespace Util {
 // Prof::Struct::Alien x in 'structure' that can be reached with paths
 // in 'pathVec', copy x to its appropriate viewname path and update
 // x's path to be relative to this location.
+//
+// Each distinct file name is resolved once and each found file is
+// copied once.  Both steps run in parallel when OpenMP is available;
+// only lookups in the (shared) PathFindMgr are serialized.  If
+// 'cacheFnm' is given, resolutions are loaded from and saved to it.
 void
 copySourceFiles(Prof::Struct::Root* structure, 
 		const Analysis::PathTupleVec& pathVec,
-		const string& dstDir)
+		const string& dstDir, int linkMode, const string& cacheFnm)
 {
-  // Prevent multiple copies of the same file (Alien scopes)
-  std::map<string, string> processedFiles;
+  // ------------------------------------------------------
+  // Collect distinct file names (Alien scopes repeat them)
+  // ------------------------------------------------------
+  std::vector<SrcFileInfo> files;
+  std::vector<std::pair<Prof::Struct::ANode*, uint> > strctFiles;
+  std::map<string, uint> fileIdx;
 
   Prof::Struct::ANodeFilter filter(Flat_Filter, "Flat_Filter", 0);
   for (Prof::Struct::ANodeIterator it(structure, &filter); it.Current(); ++it) {
@@ -401,34 +531,121 @@ copySourceFiles(Prof::Struct::Root* structure,
 
     // Note: 'fnm_orig' will be not be absolute if it is not possible
     // to resolve it on the current filesystem. (cf. RealPathMgr)
+    const string& fnm_orig = srcFileName(strct);
 
-    // DIAG_Assert( , DIAG_UnexpectedInput);
-    const string& fnm_orig = 
-      ((typeid(*strct) == typeid(Prof::Struct::Alien)) ?
-       dynamic_cast<Prof::Struct::Alien*>(strct)->fileName() : 
-       ((typeid(*strct) == typeid(Prof::Struct::Loop)) ? 
-	dynamic_cast<Prof::Struct::Loop*>(strct)->fileName() : 
-	strct->name()));
-    
-    // ------------------------------------------------------
-    // Given fnm_orig, attempt to find and copy fnm_new
-    // ------------------------------------------------------
-    string fnm_new =
-      copySourceFileMain(fnm_orig, processedFiles, pathVec, dstDir);
-    
-    // ------------------------------------------------------
-    // Update static structure
-    // ------------------------------------------------------
-    if (!fnm_new.empty()) {
+    std::map<string, uint>::iterator fit = fileIdx.find(fnm_orig);
+    if (fit == fileIdx.end()) {
+      fit = fileIdx.insert(make_pair(fnm_orig, (uint)files.size())).first;
+      files.push_back(SrcFileInfo(fnm_orig));
+    }
+    strctFiles.push_back(std::make_pair(strct, fit->second));
+  }
+
+  // ------------------------------------------------------
+  // Find each file
+  // ------------------------------------------------------
+  SrcPathCache cache;
+  if (!cacheFnm.empty()) {
+    readSrcPathCache(cacheFnm, pathVec, cache);
+  }
+
+  // the absolute form of each search path
+  std::vector<string> realPaths(pathVec.size());
+  for (uint i = 0; i < pathVec.size(); ++i) {
+    string realPath(pathVec[i].first);
+    if (PathFindMgr::isRecursivePath(realPath.c_str())) {
+      realPath.resize(realPath.length() - PathFindMgr::RecursivePathSfxLn);
+    }
+    realPaths[i] = RealPath(realPath.c_str());
+  }
+
+  long numFiles = files.size();
+
+#ifdef ENABLE_OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif
+  for (long i = 0; i < numFiles; ++i) {
+    resolveSourceFile(files[i], pathVec, realPaths, cache);
+  }
+
+  // ------------------------------------------------------
+  // Copy each found file once
+  // ------------------------------------------------------
+  static const Analysis::PathTuple 
+    defaultTpl("/", Analysis::DefaultPathTupleTarget);
+
+  std::vector<string> fnm_new(numFiles);
+  std::vector<long> copies; // index into 'files'
+  std::set<string> fnm_tos;
+  uint numCached = 0;
+
+  for (long i = 0; i < numFiles; ++i) {
+    SrcFileInfo& x = files[i];
+    if (x.tplIdx == SrcFileInfo::SrcTpl_Lost) {
+      DIAG_WMsg(2, "lost: " << x.fnm_orig);
+      continue;
+    }
+
+    const Analysis::PathTuple& tpl =
+      (x.tplIdx >= 0) ? pathVec[x.tplIdx] : defaultTpl;
+    string fnm_to;
+    fnm_new[i] = srcFileDBName(x.fnm_fnd, dstDir, tpl, fnm_to);
+    if (fnm_tos.insert(fnm_to).second) {
+      copies.push_back(i);
+    }
+    numCached += x.isCached;
+    DIAG_Msg(2, "  cp:" << x.fnm_orig << " -> " << fnm_new[i]);
+  }
+
+  long numCopies = copies.size();
+
+#ifdef ENABLE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+  for (long j = 0; j < numCopies; ++j) {
+    const SrcFileInfo& x = files[copies[j]];
+    const Analysis::PathTuple& tpl =
+      (x.tplIdx >= 0) ? pathVec[x.tplIdx] : defaultTpl;
+    string fnm_to;
+    srcFileDBName(x.fnm_fnd, dstDir, tpl, fnm_to);
+    copySourceFile(x.fnm_fnd, fnm_to, linkMode);
+  }
+
+  DIAG_Msg(2, "Source files: " << numFiles << " names, " << numCopies
+	   << " copied, " << numCached << " found in cache");
+
+  // ------------------------------------------------------
+  // Update static structure
+  // ------------------------------------------------------
+  for (uint i = 0; i < strctFiles.size(); ++i) {
+    Prof::Struct::ANode* strct = strctFiles[i].first;
+    const string& fnm = fnm_new[strctFiles[i].second];
+    if (!fnm.empty()) {
       if (typeid(*strct) == typeid(Prof::Struct::Alien)) {
-	dynamic_cast<Prof::Struct::Alien*>(strct)->fileName(fnm_new);
+	dynamic_cast<Prof::Struct::Alien*>(strct)->fileName(fnm);
       } else if (typeid(*strct) == typeid(Prof::Struct::Loop)) {
-	dynamic_cast<Prof::Struct::Loop*>(strct)->fileName(fnm_new);
+	dynamic_cast<Prof::Struct::Loop*>(strct)->fileName(fnm);
       } else {
-	dynamic_cast<Prof::Struct::File*>(strct)->name(fnm_new);
+	dynamic_cast<Prof::Struct::File*>(strct)->name(fnm);
       }
     }
   }
+
+  // ------------------------------------------------------
+  // Save resolutions for the next run
+  // ------------------------------------------------------
+  if (!cacheFnm.empty()) {
+    for (long i = 0; i < numFiles; ++i) {
+      const SrcFileInfo& x = files[i];
+      if (x.tplIdx == SrcFileInfo::SrcTpl_Lost) {
+	cache.erase(x.fnm_orig);
+      }
+      else {
+	cache[x.fnm_orig] = make_pair(x.tplIdx, x.fnm_fnd);
+      }
+    }
+    writeSrcPathCache(cacheFnm, pathVec, cache);
+  }
 }
 
 } // end of Util namespace
@@ -436,63 +653,73 @@ copySourceFiles(Prof::Struct::Root* structure,
 
 
 
+static const string&
+srcFileName(Prof::Struct::ANode* strct)
+{
+  if (typeid(*strct) == typeid(Prof::Struct::Alien)) {
+    return dynamic_cast<Prof::Struct::Alien*>(strct)->fileName();
+  }
+  else if (typeid(*strct) == typeid(Prof::Struct::Loop)) {
+    return dynamic_cast<Prof::Struct::Loop*>(strct)->fileName();
+  }
+  return strct->name();
+}
+
+
 static std::pair<int, string>
-matchFileWithPath(const string& filenm, const Analysis::PathTupleVec& pathVec);
+matchFileWithPath(const string& filenm, const Analysis::PathTupleVec& pathVec,
+		  const std::vector<string>& realPaths);
 
-static string
-copySourceFile(const string& filenm, const string& dstDir, 
-	       const Analysis::PathTuple& pathTpl);
 
-static string
-copySourceFileMain(const string& fnm_orig,
-		   std::map<string, string>& processedFiles,
-		   const Analysis::PathTupleVec& pathVec,
-		   const string& dstDir)
+// resolveSourceFile: Set where 'file' is found, using a still valid
+// 'cache' entry if there is one.  May run concurrently.
+static void
+resolveSourceFile(SrcFileInfo& file, const Analysis::PathTupleVec& pathVec,
+		  const std::vector<string>& realPaths,
+		  const SrcPathCache& cache)
 {
-  string fnm_new;
-  
-  std::map<string, string>::iterator it = processedFiles.find(fnm_orig);
-  if (it != processedFiles.end()) {
-    fnm_new = it->second;
-  }
-  else {
-    std::pair<int, string> fnd = matchFileWithPath(fnm_orig, pathVec);
-    int idx = fnd.first;
-    if (idx >= 0) {
-      // fnm_orig explicitly matches a <search-path, path-view> tuple
-      fnm_new = copySourceFile(fnd.second, dstDir, pathVec[idx]);
-    }
-    else if (fnm_orig[0] == '/' && FileUtil::isReadable(fnm_orig.c_str())) {
-      // fnm_orig does not match a pathVec tuple; but if it is an
-      // absolute path that is readable, use the default <search-path,
-      // path-view> tuple.
-      static const Analysis::PathTuple 
-	defaultTpl("/", Analysis::DefaultPathTupleTarget);
-      fnm_new = copySourceFile(fnm_orig, dstDir, defaultTpl);
+  SrcPathCache::const_iterator it = cache.find(file.fnm_orig);
+  if (it != cache.end()) {
+    int tplIdx = it->second.first;
+    const string& fnm_fnd = it->second.second;
+    if ((tplIdx == SrcFileInfo::SrcTpl_Default || tplIdx >= 0)
+	&& tplIdx < (int)pathVec.size()
+	&& FileUtil::isReadable(fnm_fnd)) {
+      file.tplIdx = tplIdx;
+      file.fnm_fnd = fnm_fnd;
+      file.isCached = true;
+      return;
     }
+  }
 
-    if (fnm_new.empty()) {
-      DIAG_WMsg(2, "lost: " << fnm_orig);
-    }
-    else {
-      DIAG_Msg(2, "  cp:" << fnm_orig << " -> " << fnm_new);
-    }
-    processedFiles.insert(make_pair(fnm_orig, fnm_new));
+  const string& fnm_orig = file.fnm_orig;
+  std::pair<int, string> fnd = matchFileWithPath(fnm_orig, pathVec, realPaths);
+  if (fnd.first >= 0) {
+    // fnm_orig explicitly matches a <search-path, path-view> tuple
+    file.tplIdx = fnd.first;
+    file.fnm_fnd = fnd.second;
+  }
+  else if (fnm_orig[0] == '/' && FileUtil::isReadable(fnm_orig.c_str())) {
+    // fnm_orig does not match a pathVec tuple; but if it is an
+    // absolute path that is readable, use the default <search-path,
+    // path-view> tuple.
+    file.tplIdx = SrcFileInfo::SrcTpl_Default;
+    file.fnm_fnd = fnm_orig;
   }
-  
-  return fnm_new;
 }
 
 
 //***************************************************************************
 
 // matchFileWithPath: Given a file name 'filenm' and a vector of paths
-// 'pathVec', use 'pathfind_r' to determine which path in 'pathVec',
-// if any, reaches 'filenm'.  Returns an index and string pair.  If a
-// match is found, the index is an index in pathVec; otherwise it is
-// negative.  If a match is found, the string is the found file name.
+// 'pathVec' (with absolute forms 'realPaths'), use 'pathfind_r' to
+// determine which path in 'pathVec', if any, reaches 'filenm'.
+// Returns an index and string pair.  If a match is found, the index
+// is an index in pathVec; otherwise it is negative.  If a match is
+// found, the string is the found file name.
 static std::pair<int, string>
-matchFileWithPath(const string& filenm, const Analysis::PathTupleVec& pathVec)
+matchFileWithPath(const string& filenm, const Analysis::PathTupleVec& pathVec,
+		  const std::vector<string>& realPaths)
 {
   // Find the index to the path that reaches 'filenm'.
   // It is possible that more than one path could reach the same
@@ -505,19 +732,13 @@ matchFileWithPath(const string& filenm, const Analysis::PathTupleVec& pathVec)
   string foundFnm; 
 
   for (uint i = 0; i < pathVec.size(); i++) {
-    // find the absolute form of 'curPath'
     const string& curPath = pathVec[i].first;
-    string realPath(curPath);
-    if (PathFindMgr::isRecursivePath(curPath.c_str())) {
-      realPath[realPath.length() - PathFindMgr::RecursivePathSfxLn] = '\0';
-    }
-    realPath = RealPath(realPath.c_str());
+    const string& realPath = realPaths[i];
     int realPathLn = realPath.length();
        
     // 'filenm' should be relative as input for pathfind_r.  If 'filenm'
     // is absolute and 'realPath' is a prefix, make it relative. 
-    string tmpFile(filenm);
-    char* curFile = const_cast<char*>(tmpFile.c_str());
+    const char* curFile = filenm.c_str();
     if (filenm[0] == '/') { // is 'filenm' absolute?
       if (strncmp(curFile, realPath.c_str(), realPathLn) == 0) {
 	curFile = &curFile[realPathLn];
@@ -527,23 +748,26 @@ matchFileWithPath(const string& filenm, const Analysis::PathTupleVec& pathVec)
 	continue; // pathfind_r can't posibly find anything
       }
     }
-    
-    const char* fnd_fnm = PathFindMgr::singleton().pathfind(curPath.c_str(),
-							    curFile, "r");
 
-    if (fnd_fnm) {
-      bool update = false;
-      if (foundIndex < 0) {
-	update = true;
-      }
-      else if ((foundIndex >= 0) && (realPathLn > foundPathLn)) {
-	update = true;
+    // PathFindMgr caches directory scans and returns its answer in a
+    // shared buffer
+    string fnd_fnm;
+#ifdef ENABLE_OPENMP
+#pragma omp critical (PathFindMgr)
+#endif
+    {
+      const char* x = PathFindMgr::singleton().pathfind(curPath.c_str(),
+							curFile, "r");
+      if (x) {
+	fnd_fnm = x;
       }
-      
-      if (update) {
+    }
+
+    if (!fnd_fnm.empty()) {
+      if (foundIndex < 0 || realPathLn > foundPathLn) {
 	foundIndex = i;
 	foundPathLn = realPathLn;
-	foundFnm = RealPath(fnd_fnm);
+	foundFnm = RealPath(fnd_fnm.c_str());
       }
     }
   }
@@ -551,40 +775,145 @@ matchFileWithPath(const string& filenm, const Analysis::PathTupleVec& pathVec)
 }
 
 
-// Given a file 'filenm' a destination directory 'dstDir' and a
-// PathTuple, form a database file name, copy 'filenm' into the
-// database and return the database file name.
-// NOTE: assume filenm is already a 'real path'
+// Given a found file 'fnm_fnd', a destination directory 'dstDir' and
+// a PathTuple, form and return the database file name; 'fnm_to' is
+// set to the name of the copy.
 static string
-copySourceFile(const string& filenm, const string& dstDir, 
-	       const Analysis::PathTuple& pathTpl)
+srcFileDBName(const string& fnm_fnd, const string& dstDir,
+	      const Analysis::PathTuple& pathTpl, string& fnm_to)
 {
-  const string& fnm_fnd = filenm;
   const string& viewnm = pathTpl.second;
 
-  // Create new file name and copy commands
-  string fnm_new = "./" + viewnm + fnm_fnd;
-	
-  string fnm_to;
+  fnm_to = "";
   if (dstDir[0]  != '/') {
     fnm_to = "./";
   }
   fnm_to = fnm_to + dstDir + "/" + viewnm + fnm_fnd;
+
+  return "./" + viewnm + fnm_fnd;
+}
+
+
+// Copy 'fnm_fnd' to 'fnm_to', or link it there according to
+// 'linkMode' (an Analysis::Args::SrcLink).  May run concurrently.
+// NOTE: assume fnm_fnd is already a 'real path'
+static void
+copySourceFile(const string& fnm_fnd, const string& fnm_to, int linkMode)
+{
   string dir_to(fnm_to); // need to strip off ending filename to 
   uint end;              // get full path for 'fnm_to'
   for (end = dir_to.length() - 1; dir_to[end] != '/'; end--) { }
-  dir_to[end] = '\0';    // should not end with '/'
+  dir_to.resize(end);    // should not end with '/'
 	
   try {
     FileUtil::mkdir(dir_to);
-    FileUtil::copy(fnm_to, fnm_fnd);
+
+    bool isDone = false;
+    if (linkMode == Analysis::Args::SrcLink_Hard) {
+      isDone = FileUtil::link(fnm_to, fnm_fnd);
+    }
+    else if (linkMode == Analysis::Args::SrcLink_Reflink) {
+      isDone = FileUtil::clone(fnm_to, fnm_fnd);
+    }
+    if (!isDone) {
+      FileUtil::copy(fnm_to, fnm_fnd);
+    }
     DIAG_DevMsgIf(0, "cp " << fnm_to);
   }
   catch (const Diagnostics::Exception& x) {
     DIAG_EMsg(x.message());
   }
-  
-  return fnm_new;
+}
+
+
+//***************************************************************************
+
+// The source cache is a text file:
+//   path <tab> <search-path> <tab> <path-view>       (one per PathTuple)
+//   file <tab> <name> <tab> <tuple-index> <tab> <found-name>
+// File entries are only used if the paths match 'pathVec' exactly.
+static const char* SrcPathCacheHdr = "#HPCToolkit source cache 1.0";
+
+// readSrcPathCache: Load 'cache' from 'fnm', if it exists and was
+// made with the same search paths.
+static void
+readSrcPathCache(const string& fnm, const Analysis::PathTupleVec& pathVec,
+		 SrcPathCache& cache)
+{
+  std::ifstream is(fnm.c_str());
+  if (!is) {
+    return; // first use
+  }
+
+  string line;
+  if (!std::getline(is, line) || line != SrcPathCacheHdr) {
+    DIAG_WMsg(1, "ignoring source cache '" << fnm << "': unknown format");
+    return;
+  }
+
+  uint numPaths = 0;
+  std::vector<string> fields;
+  while (std::getline(is, line)) {
+    fields.clear();
+    StrUtil::tokenize_char(line, "\t", fields);
+
+    if (fields.size() == 3 && fields[0] == "path") {
+      if (!(numPaths < pathVec.size()
+	    && pathVec[numPaths].first == fields[1]
+	    && pathVec[numPaths].second == fields[2])) {
+	break;
+      }
+      numPaths++;
+    }
+    else if (fields.size() == 4 && fields[0] == "file") {
+      if (numPaths != pathVec.size()) {
+	break;
+      }
+      int tplIdx = (int)StrUtil::toLong(fields[2]);
+      cache[fields[1]] = make_pair(tplIdx, fields[3]);
+    }
+  }
+
+  if (numPaths != pathVec.size()) {
+    DIAG_Msg(1, "Source cache '" << fnm << "' is for other search paths; "
+	     "not using it");
+    cache.clear();
+  }
+}
+
+
+// writeSrcPathCache: Replace 'fnm' with 'cache'
+static void
+writeSrcPathCache(const string& fnm, const Analysis::PathTupleVec& pathVec,
+		  const SrcPathCache& cache)
+{
+  const string tmpFnm = fnm + "." + StrUtil::toStr(getpid());
+  std::ofstream os(tmpFnm.c_str());
+  if (!os) {
+    DIAG_WMsg(1, "could not write source cache '" << fnm << "'");
+    return;
+  }
+
+  os << SrcPathCacheHdr << "\n";
+  for (uint i = 0; i < pathVec.size(); ++i) {
+    os << "path\t" << pathVec[i].first << "\t" << pathVec[i].second << "\n";
+  }
+  for (SrcPathCache::const_iterator it = cache.begin(); it != cache.end();
+       ++it) {
+    const string& nm = it->first;
+    const string& fnd = it->second.second;
+    if (nm.find_first_of("\t\n") != string::npos
+	|| fnd.find_first_of("\t\n") != string::npos) {
+      continue; // cannot be represented
+    }
+    os << "file\t" << nm << "\t" << it->second.first << "\t" << fnd << "\n";
+  }
+  os.close();
+
+  if (!os || rename(tmpFnm.c_str(), fnm.c_str()) != 0) {
+    DIAG_WMsg(1, "could not write source cache '" << fnm << "'");
+    unlink(tmpFnm.c_str());
+  }
 }
 
 
@@ -595,64 +924,266 @@ copySourceFile(const string& filenm, const string& dstDir,
 namespace Analysis {
 namespace Util {
 
-// copyTraceFiles:
-void
-copyTraceFiles(const std::string& dstDir, const std::set<string>& srcFiles)
+// remapTraceFile: Write a copy of the trace file 'srcFnm' to 'dstFnm',
+// translating each record's call path id through 'cpIdMap'.  The
+// source is mapped into memory (or read, for a stream in a container)
+// and translated in large blocks; the copy is written to a temporary
+// file that is renamed when complete.  If 'dstStream' is given, the
+// copy is appended to that container stream instead, one block of
+// whole records per write, so that hpcserver can map its extents in
+// place.  Returns false if the trace file could not be translated.
+static bool
+remapTraceFile(const string& srcFnm, const string& dstFnm,
+	       const std::vector<uint>& cpIdMap,
+	       hpccont_stream_t* dstStream = NULL)
 {
-  bool tryMove = true;
+  static const size_t blockSz = HPCIO_RWBufferSz;
+
+  FILE* infs = hpcio_fopen_r(srcFnm.c_str());
+  if (!infs) {
+    std::string errorString;
+    hpcrun_getFileErrorString(srcFnm, errorString);
+    DIAG_EMsg("failed to open trace file " << errorString << "; skip this one.");
+    return false;
+  }
 
-  for (std::set<string>::iterator it = srcFiles.begin();
-       it != srcFiles.end(); ++it) {
+  hpctrace_fmt_hdr_t hdr;
+  if (hpctrace_fmt_hdr_fread(&hdr, infs) != HPCFMT_OK) {
+    DIAG_EMsg("failed reading header from trace measurement file "
+	      << srcFnm << "; skip this one.");
+    hpcio_fclose(infs);
+    return false;
+  }
+  size_t dataBeg = ftell(infs);
 
-    const string& x = *it;
+  struct stat st;
+  int fd = fileno(infs);
+  size_t fileSz = 0;
+  if (fd >= 0) {
+    fileSz = (fstat(fd, &st) == 0) ? st.st_size : 0;
+  }
+  else if (fseek(infs, 0, SEEK_END) == 0) {
+    // a container stream has no descriptor to map
+    fileSz = ftell(infs);
+    fseek(infs, dataBeg, SEEK_SET);
+  }
+  size_t dataSz = (fileSz > dataBeg) ? fileSz - dataBeg : 0;
+
+  const char* data = NULL;
+  if (dataSz > 0 && fd >= 0) {
+    void* addr = mmap(NULL, fileSz, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      DIAG_EMsg("failed mapping trace measurement file " << srcFnm
+		<< ": " << strerror(errno) << "; skip this one.");
+      hpcio_fclose(infs);
+      return false;
+    }
+    madvise(addr, fileSz, MADV_SEQUENTIAL);
+    data = (const char*)addr + dataBeg;
+  }
 
-    const string  srcFnm1 = x + "." + HPCPROF_TmpFnmSfx;
-    const string& srcFnm2 = x;
-    const string  dstFnm = dstDir + "/" + FileUtil::basename(x);
+  // record: time (8 bytes), cpId (4 bytes), [metricId (4 bytes)]
+  const size_t cpIdOff = sizeof(uint64_t);
+  size_t recSz = cpIdOff + sizeof(uint32_t);
+  if (HPCTRACE_HDR_FLAGS_GET_BIT(hdr.flags,
+				 HPCTRACE_HDR_FLAGS_DATA_CENTRIC_BIT_POS)) {
+    recSz += sizeof(uint32_t);
+  }
+  if (dataSz % recSz != 0) {
+    DIAG_WMsg(1, srcFnm << ": ignoring incomplete trace record at end of file");
+  }
+  size_t numRecs = dataSz / recSz;
+
+  const string tmpFnm = dstFnm + "." + HPCPROF_TmpFnmSfx;
+  char hdrBuf[64];
+  FILE* outfs = (dstStream) ? fmemopen(hdrBuf, sizeof(hdrBuf), "w")
+    : hpcio_fopen_w(tmpFnm.c_str(), 1/*overwrite*/);
+  if (!outfs) {
+    std::string errorString;
+    hpcrun_getFileErrorString(tmpFnm, errorString);
+    DIAG_EMsg("failed opening trace result file " << errorString <<
+	      "when processing trace measurement file " << srcFnm << "; skip this one.");
+    if (data) {
+      munmap((void*)(data - dataBeg), fileSz);
+    }
+    hpcio_fclose(infs);
+    return false;
+  }
 
-    // Note: the source and destination directories may be on
-    // different mount points.  For the trace.tmp files, we try move
-    // first (faster), if that fails, try copy and delete.  If any
-    // move fails, then always copy (so only one failed move).
-
-    if (FileUtil::isReadable(srcFnm1)) {
-      // trace.tmp exists: try move, then copy and delete
-      bool copyDone = false;
-      if (tryMove) {
-	try {
-	  DIAG_Msg(2, "trace (mv): '" << srcFnm1 << "' -> '" << dstFnm << "'");
-	  FileUtil::move(dstFnm, srcFnm1);
-	  copyDone = true;
-	}
-	catch (const Diagnostics::Exception& ex) {
-	  DIAG_Msg(2, "trace mv failed, trying cp");
-	  tryMove = false;
-	}
+  bool ok = (hpctrace_fmt_hdr_fwrite(hdr.flags, outfs) == HPCFMT_OK);
+  if (dstStream) {
+    // the header was formatted into 'hdrBuf'
+    size_t hdrSz = ftell(outfs);
+    ok = (hpcio_fclose(outfs) == 0) && ok
+      && hpccont_stream_write(dstStream, hdrBuf, hdrSz) == (ssize_t)hdrSz;
+    outfs = NULL;
+  }
+
+  // translate in blocks of whole records
+  size_t blockRecs = std::max((size_t)1, blockSz / recSz);
+  char* block = new char[blockRecs * recSz];
+  for (size_t rec = 0; ok && rec < numRecs; rec += blockRecs) {
+    size_t n = std::min(blockRecs, numRecs - rec);
+    if (data) {
+      memcpy(block, data + rec * recSz, n * recSz);
+    }
+    else if (fread(block, recSz, n, infs) != n) {
+      ok = false;
+      break;
+    }
+
+    for (char* r = block; r < block + n * recSz; r += recSz) {
+      unsigned char* b = (unsigned char*)(r + cpIdOff);
+      uint cpId = ((uint)b[0] << 24) | ((uint)b[1] << 16)
+	| ((uint)b[2] << 8) | (uint)b[3];
+      if (cpId < cpIdMap.size()) {
+	cpId = cpIdMap[cpId];
+	b[0] = (cpId >> 24) & 0xff;
+	b[1] = (cpId >> 16) & 0xff;
+	b[2] = (cpId >> 8) & 0xff;
+	b[3] = cpId & 0xff;
       }
-      if (! copyDone) {
-	try {
-	  DIAG_Msg(2, "trace (cp): '" << srcFnm1 << "' -> '" << dstFnm << "'");
-	  FileUtil::copy(dstFnm, srcFnm1);
-	  FileUtil::remove(srcFnm1.c_str());
-	}
-	catch (const Diagnostics::Exception& ex) {
-	  DIAG_EMsg("While copying trace files ['"
-		    << srcFnm1 << "' -> '" << dstFnm << "']:" << ex.message());
-	}
+    }
+    if (dstStream) {
+      ok = (hpccont_stream_write(dstStream, block, n * recSz)
+	    == (ssize_t)(n * recSz));
+    }
+    else {
+      ok = (fwrite(block, recSz, n, outfs) == n);
+    }
+  }
+  delete[] block;
+
+  if (data) {
+    munmap((void*)(data - dataBeg), fileSz);
+  }
+  hpcio_fclose(infs);
+
+  if (dstStream) {
+    ok = (hpccont_stream_close(dstStream) == 0) && ok;
+    if (!ok) {
+      DIAG_EMsg("failed writing trace stream " << dstFnm << "; skip this one.");
+    }
+    return ok;
+  }
+
+  ok = (hpcio_fclose(outfs) == 0) && ok;
+  if (!ok || rename(tmpFnm.c_str(), dstFnm.c_str()) != 0) {
+    std::string errorString;
+    hpcrun_getFileErrorString(dstFnm, errorString);
+    DIAG_EMsg("failed writing trace result file " << errorString << "; skip this one.");
+    unlink(tmpFnm.c_str()); // delete incomplete output file
+    return false;
+  }
+  return true;
+}
+
+
+// Names the trace streams of a database container: a stream's
+// "thread" is the index of its trace file in 'files'; streams that
+// could not be written are left out.
+struct TraceStreamNames {
+  const std::vector<string>* files;
+  std::vector<char> ok;
+};
+
+
+static int
+traceStreamName(void* arg, int GCC_ATTR_UNUSED kind, int thread,
+		char* buf, size_t len)
+{
+  TraceStreamNames* nms = (TraceStreamNames*)arg;
+  if (!nms->ok[thread]) {
+    return -1;
+  }
+  string nm = FileUtil::basename((*nms->files)[thread]);
+  if (nm.length() >= len) {
+    return -1;
+  }
+  strcpy(buf, nm.c_str());
+  return 0;
+}
+
+
+// copyTraceFiles: Copy the trace files 'srcFiles' into 'dstDir'.  A
+// file with an entry in 'cpIdMaps' has its call path ids translated on
+// the way; the original trace files are never modified.  Streams in a
+// container are extracted into ordinary files of the same name, so
+// that the database looks the same as without containers.  If
+// 'containerFnm' is given, the copies instead become the streams of a
+// new container in 'dstDir' with that name.  Files are processed in
+// parallel when OpenMP is available.
+void
+copyTraceFiles(const std::string& dstDir, const std::set<string>& srcFiles,
+	       const Prof::CallPath::Profile::TraceCpIdMaps& cpIdMaps,
+	       const std::string& containerFnm)
+{
+  std::vector<string> files(srcFiles.begin(), srcFiles.end());
+  long numFiles = files.size();
+
+  hpccont_writer_t* container = NULL;
+  TraceStreamNames nms;
+  nms.files = &files;
+  nms.ok.resize(numFiles, 0);
+
+  string contFnm = dstDir + "/" + containerFnm;
+  if (!containerFnm.empty() && numFiles > 0) {
+    int fd = open(contFnm.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    container = hpccont_writer_attach(fd, malloc);
+    if (!container) {
+      DIAG_EMsg("failed creating trace container " << contFnm << ": "
+		<< strerror(errno) << "; writing trace files instead.");
+      if (fd >= 0) {
+	close(fd);
       }
     }
+  }
+
+#ifdef ENABLE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+  for (long i = 0; i < numFiles; ++i) {
+    const string& x = files[i];
+    const string  dstFnm = dstDir + "/" + FileUtil::basename(x);
+
+    Prof::CallPath::Profile::TraceCpIdMaps::const_iterator it =
+      cpIdMaps.find(x);
+    static const std::vector<uint> noCpIdMap;
+    const std::vector<uint>& cpIdMap =
+      (it != cpIdMaps.end()) ? it->second : noCpIdMap;
+
+    if (container) {
+      DIAG_Msg(2, "trace (pack): '" << x << "' -> '" << contFnm << "'");
+      hpccont_stream_t* stream =
+	hpccont_stream_open(container, HPCCONT_STREAM_TRACE, i);
+      nms.ok[i] = (stream && remapTraceFile(x, dstFnm, cpIdMap, stream));
+    }
+    else if (it != cpIdMaps.end()) {
+      DIAG_Msg(2, "trace (remap): '" << x << "' -> '" << dstFnm << "'");
+      remapTraceFile(x, dstFnm, cpIdMap);
+    }
+    else if (isContainerFile(FileUtil::dirname(x))) {
+      // no translation, but not a file that FileUtil::copy can read
+      DIAG_Msg(2, "trace (extract): '" << x << "' -> '" << dstFnm << "'");
+      remapTraceFile(x, dstFnm, cpIdMap);
+    }
     else {
-      // no trace.tmp file: always copy (keep original)
+      // no translation: always copy (keep original)
       try {
-	DIAG_Msg(2, "trace (cp): '" << srcFnm2 << "' -> '" << dstFnm << "'");
-	FileUtil::copy(dstFnm, srcFnm2);
+	DIAG_Msg(2, "trace (cp): '" << x << "' -> '" << dstFnm << "'");
+	FileUtil::copy(dstFnm, x);
       }
       catch (const Diagnostics::Exception& ex) {
 	DIAG_EMsg("While copying trace files ['"
-		  << srcFnm2 << "' -> '" << dstFnm << "']:" << ex.message());
+		  << x << "' -> '" << dstFnm << "']:" << ex.message());
       }
     }
   }
+
+  if (container
+      && hpccont_writer_finish(container, traceStreamName, &nms) != 0) {
+    DIAG_EMsg("failed writing the index of trace container " << contFnm);
+  }
 }
 
 
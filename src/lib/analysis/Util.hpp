@@ -167,11 +167,15 @@ demandStructure(VMA vma, Prof::Struct::LM* lmStrct, BinUtil::LM* lm,
 void 
 copySourceFiles(Prof::Struct::Root* structure,
 		const Analysis::PathTupleVec& pathVec,
-		const std::string& dstDir);
+		const std::string& dstDir,
+		int/*Args::SrcLink*/ linkMode = Analysis::Args::SrcLink_Copy,
+		const std::string& cacheFnm = "");
 
 void
 copyTraceFiles(const std::string& dstDir,
-	       const std::set<std::string>& srcFiles);
+	       const std::set<std::string>& srcFiles,
+	       const Prof::CallPath::Profile::TraceCpIdMaps& cpIdMaps,
+	       const std::string& containerFnm = "");
 
 
 } // namespace Util
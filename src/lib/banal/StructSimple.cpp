@@ -82,6 +82,23 @@ using namespace std;
 Prof::Struct::Stmt *
 BAnal::Struct::makeStructureSimple(Prof::Struct::LM * lmStruct,
 				   BinUtil::LM * lm, VMA vma)
+{
+  string stmt_filenm;
+  SrcFile::ln stmt_line = 0;
+
+  lm->findSrcLine(vma, 0, stmt_filenm, stmt_line);
+
+  return makeStructureSimple(lmStruct, lm, vma,
+			     stmt_filenm.empty() ? NULL : &stmt_filenm,
+			     stmt_line);
+}
+
+
+Prof::Struct::Stmt *
+BAnal::Struct::makeStructureSimple(Prof::Struct::LM * lmStruct,
+				   BinUtil::LM * lm, VMA vma,
+				   const string * stmt_filenm,
+				   SrcFile::ln stmt_line)
 {
   //
   // begin address for proc containing vma, and proc and file name
@@ -122,14 +139,10 @@ BAnal::Struct::makeStructureSimple(Prof::Struct::LM * lmStruct,
     Prof::Struct::Proc::demand(fileStruct, prettynm, linknm, proc_line, proc_line);
 
   //
-  // file and line for vma (stmt), and end vma
+  // end vma for stmt
   //
-  string stmt_procnm, stmt_filenm;
-  SrcFile::ln stmt_line = 0;
   VMA end_vma = vma + 1;
 
-  lm->findSrcCodeInfo(vma, 0, stmt_procnm, stmt_filenm, stmt_line);
-
   BinUtil::Insn * insn = lm->findInsn(vma, 0);
   if (insn) {
     end_vma = insn->endVMA();
@@ -139,10 +152,11 @@ BAnal::Struct::makeStructureSimple(Prof::Struct::LM * lmStruct,
 
   // stmts with known file and line that differs from proc need a
   // guard alien
-  if ((! stmt_filenm.empty()) && stmt_line != 0
-      && (stmt_filenm != proc_filenm || stmt_line < proc_line))
+  if (stmt_filenm != NULL && (! stmt_filenm->empty()) && stmt_line != 0
+      && (*stmt_filenm != proc_filenm || stmt_line < proc_line))
   {
-    Prof::Struct::Alien * alien = procStruct->demandGuardAlien(stmt_filenm, stmt_line);
+    string alien_filenm = *stmt_filenm;
+    Prof::Struct::Alien * alien = procStruct->demandGuardAlien(alien_filenm, stmt_line);
     stmt = alien->demandStmt(stmt_line, vma, end_vma);
   }
   else {
@@ -153,7 +167,7 @@ BAnal::Struct::makeStructureSimple(Prof::Struct::LM * lmStruct,
   cout << "------------------------------------------------------------\n"
        << "0x" << hex << vma << "--0x" << end_vma << dec << "  (struct simple)\n"
        << "line:  " << stmt_line << "\n"
-       << "file:  " << stmt_filenm << "\n"
+       << "file:  " << (stmt_filenm ? *stmt_filenm : "") << "\n"
        << "name:  " << linknm << "\n\n";
 
   stmt->dumpmePath(cout, 0, "");
@@ -62,6 +62,8 @@
 
 //************************* System Include Files ****************************
 
+#include <string>
+
 //*************************** User Include Files ****************************
 
 #include <include/uint.h> 
@@ -86,6 +88,13 @@ namespace Struct {
   Prof::Struct::Stmt*
   makeStructureSimple(Prof::Struct::LM* lmStrct, BinUtil::LM* lm, VMA vma);
 
+  // As above, with the statement's file and line already looked up
+  // (e.g., by BinUtil::LM::findSrcLines()).  A NULL 'stmt_filenm'
+  // means unknown.
+  Prof::Struct::Stmt*
+  makeStructureSimple(Prof::Struct::LM* lmStrct, BinUtil::LM* lm, VMA vma,
+		      const std::string* stmt_filenm, SrcFile::ln stmt_line);
+
 } // namespace Struct
 
 } // namespace BAnal
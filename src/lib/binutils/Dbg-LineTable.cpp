@@ -0,0 +1,955 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   A load module's DWARF line program, decoded once into a compact,
+//   sorted VMA -> (file, line) table.
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+//************************* System Include Files ****************************
+
+#include <string>
+using std::string;
+
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include <stdlib.h>
+#include <string.h>
+
+//*************************** User Include Files ****************************
+
+#include <include/hpctoolkit-config.h>
+
+#include "Dbg-LineTable.hpp"
+
+#include <lib/support/diagnostics.h>
+
+//*************************** Forward Declarations **************************
+
+// DWARF constants used below (cf. dwarf.h)
+
+#define DW_TAG_compile_unit    0x11
+#define DW_TAG_partial_unit    0x3c
+#define DW_AT_stmt_list        0x10
+#define DW_AT_comp_dir         0x1b
+
+#define DW_UT_skeleton         0x04
+#define DW_UT_split_compile    0x05
+#define DW_UT_type             0x02
+#define DW_UT_split_type       0x06
+
+#define DW_FORM_addr           0x01
+#define DW_FORM_block2         0x03
+#define DW_FORM_block4         0x04
+#define DW_FORM_data2          0x05
+#define DW_FORM_data4          0x06
+#define DW_FORM_data8          0x07
+#define DW_FORM_string         0x08
+#define DW_FORM_block          0x09
+#define DW_FORM_block1         0x0a
+#define DW_FORM_data1          0x0b
+#define DW_FORM_flag           0x0c
+#define DW_FORM_sdata          0x0d
+#define DW_FORM_strp           0x0e
+#define DW_FORM_udata          0x0f
+#define DW_FORM_ref_addr       0x10
+#define DW_FORM_ref1           0x11
+#define DW_FORM_ref2           0x12
+#define DW_FORM_ref4           0x13
+#define DW_FORM_ref8           0x14
+#define DW_FORM_ref_udata      0x15
+#define DW_FORM_indirect       0x16
+#define DW_FORM_sec_offset     0x17
+#define DW_FORM_exprloc        0x18
+#define DW_FORM_flag_present   0x19
+#define DW_FORM_strx           0x1a
+#define DW_FORM_addrx          0x1b
+#define DW_FORM_ref_sup4       0x1c
+#define DW_FORM_strp_sup       0x1d
+#define DW_FORM_data16         0x1e
+#define DW_FORM_line_strp      0x1f
+#define DW_FORM_ref_sig8       0x20
+#define DW_FORM_implicit_const 0x21
+#define DW_FORM_loclistx       0x22
+#define DW_FORM_rnglistx       0x23
+#define DW_FORM_ref_sup8       0x24
+#define DW_FORM_strx1          0x25
+#define DW_FORM_strx2          0x26
+#define DW_FORM_strx3          0x27
+#define DW_FORM_strx4          0x28
+#define DW_FORM_addrx1         0x29
+#define DW_FORM_addrx2         0x2a
+#define DW_FORM_addrx3         0x2b
+#define DW_FORM_addrx4         0x2c
+#define DW_FORM_GNU_addr_index 0x1f01
+#define DW_FORM_GNU_str_index  0x1f02
+#define DW_FORM_GNU_ref_alt    0x1f20
+#define DW_FORM_GNU_strp_alt   0x1f21
+
+#define DW_LNCT_path           0x1
+#define DW_LNCT_directory_index 0x2
+
+#define DW_LNS_copy            0x01
+#define DW_LNS_advance_pc      0x02
+#define DW_LNS_advance_line    0x03
+#define DW_LNS_set_file        0x04
+#define DW_LNS_const_add_pc    0x08
+#define DW_LNS_fixed_advance_pc 0x09
+
+#define DW_LNE_end_sequence    0x01
+#define DW_LNE_set_address     0x02
+#define DW_LNE_define_file     0x03
+
+//***************************************************************************
+// Cursor: bounds-checked reads from a DWARF section
+//***************************************************************************
+
+// Reads past the end set 'bad' and return 0, so that decoding code
+// can check once per unit instead of after every read.
+class BinUtil::Dbg::LineTable::Cursor {
+public:
+  Cursor(const unsigned char* beg, const unsigned char* end, bool bigEndian)
+    : p(beg), end(end), bad(false), big(bigEndian)
+  { }
+
+  bool
+  has(size_t n) const
+  { return (size_t)(end - p) >= n; }
+
+  void
+  skip(uint64_t n)
+  {
+    if (has(n)) { p += n; } else { p = end; bad = true; }
+  }
+
+  uint64_t
+  fixed(uint n)
+  {
+    if (!has(n)) { p = end; bad = true; return 0; }
+    uint64_t x = 0;
+    for (uint i = 0; i < n; i++) {
+      uint64_t b = p[big ? i : (n - 1 - i)];
+      x = (x << 8) | b;
+    }
+    p += n;
+    return x;
+  }
+
+  uint64_t
+  u8()
+  { return fixed(1); }
+
+  uint64_t
+  u16()
+  { return fixed(2); }
+
+  uint64_t
+  u32()
+  { return fixed(4); }
+
+  uint64_t
+  u64()
+  { return fixed(8); }
+
+  uint64_t
+  uleb()
+  {
+    uint64_t x = 0;
+    uint shift = 0;
+    while (p < end) {
+      unsigned char b = *p++;
+      if (shift < 64) { x |= ((uint64_t)(b & 0x7f)) << shift; }
+      shift += 7;
+      if (!(b & 0x80)) { return x; }
+    }
+    bad = true;
+    return 0;
+  }
+
+  int64_t
+  sleb()
+  {
+    int64_t x = 0;
+    uint shift = 0;
+    while (p < end) {
+      unsigned char b = *p++;
+      if (shift < 64) { x |= ((int64_t)(b & 0x7f)) << shift; }
+      shift += 7;
+      if (!(b & 0x80)) {
+	if (shift < 64 && (b & 0x40)) { x |= -(((int64_t)1) << shift); }
+	return x;
+      }
+    }
+    bad = true;
+    return 0;
+  }
+
+  const char*
+  cstr()
+  {
+    const unsigned char* s = p;
+    const unsigned char* nul =
+      (const unsigned char*)memchr(p, '\0', end - p);
+    if (!nul) { p = end; bad = true; return ""; }
+    p = nul + 1;
+    return (const char*)s;
+  }
+
+  // an offset into another section, 4 or 8 bytes by DWARF format
+  uint64_t
+  offset(bool is64)
+  { return is64 ? u64() : u32(); }
+
+  const unsigned char* p;
+  const unsigned char* end;
+  bool bad;
+  bool big;
+};
+
+
+// the string at 'off' in 'sec', or NULL
+static const char*
+sectionStr(const unsigned char* sec, size_t secSz, uint64_t off)
+{
+  if (!sec || off >= secSz || !memchr(sec + off, '\0', secSz - off)) {
+    return NULL;
+  }
+  return (const char*)(sec + off);
+}
+
+
+//***************************************************************************
+// LineTable
+//***************************************************************************
+
+const uint BinUtil::Dbg::LineTable::NoFile;
+
+
+BinUtil::Dbg::LineTable::LineTable()
+{
+}
+
+
+BinUtil::Dbg::LineTable::~LineTable()
+{
+  clear();
+}
+
+
+void
+BinUtil::Dbg::LineTable::clear()
+{
+  m_rows.clear();
+  m_files.clear();
+  m_fileIds.clear();
+}
+
+
+// Load a section's contents, decompressing if needed.
+static unsigned char*
+getSection(bfd* abfd, const char* name, size_t& size)
+{
+  size = 0;
+  asection* sec = bfd_get_section_by_name(abfd, name);
+  if (!sec || !(bfd_get_section_flags(abfd, sec) & SEC_HAS_CONTENTS)) {
+    return NULL;
+  }
+
+  // LM opens its bfd without BFD_DECOMPRESS, so compressed debug
+  // sections are set up for decompression here
+  if (bfd_is_section_compressed(abfd, sec)
+      && !bfd_init_section_decompress_status(abfd, sec)) {
+    return NULL;
+  }
+
+  bfd_byte* buf = NULL;
+  if (!bfd_malloc_and_get_section(abfd, sec, &buf)) {
+    free(buf);
+    return NULL;
+  }
+  size = bfd_section_size(abfd, sec);
+  return buf;
+}
+
+
+bool
+BinUtil::Dbg::LineTable::read(bfd* abfd)
+{
+  clear();
+
+  Sections secs;
+  unsigned char* line    = getSection(abfd, ".debug_line", secs.lineSz);
+  unsigned char* info    = NULL;
+  unsigned char* abbrev  = NULL;
+  unsigned char* str     = NULL;
+  unsigned char* lineStr = NULL;
+
+  if (line) {
+    info    = getSection(abfd, ".debug_info", secs.infoSz);
+    abbrev  = getSection(abfd, ".debug_abbrev", secs.abbrevSz);
+    str     = getSection(abfd, ".debug_str", secs.strSz);
+    lineStr = getSection(abfd, ".debug_line_str", secs.lineStrSz);
+
+    secs.line      = line;
+    secs.info      = info;
+    secs.abbrev    = abbrev;
+    secs.str       = str;
+    secs.lineStr   = lineStr;
+    secs.bigEndian = bfd_big_endian(abfd);
+
+    decode(secs);
+  }
+
+  free(line);
+  free(info);
+  free(abbrev);
+  free(str);
+  free(lineStr);
+
+  return !empty();
+}
+
+
+bool
+BinUtil::Dbg::LineTable::decode(const Sections& secs)
+{
+  clear();
+  if (!secs.line) {
+    return false;
+  }
+
+  // DWARF 2-4 line programs leave the compilation directory (directory
+  // 0) out of the header; it is an attribute of the unit's DIE.
+  CompDirMap compDirs;
+  readCompDirs(secs, compDirs);
+
+  Cursor cur(secs.line, secs.line + secs.lineSz, secs.bigEndian);
+  while (cur.has(4)) {
+    const unsigned char* unitBeg = cur.p;
+    uint64_t len = cur.u32();
+    uint hdrSz = 4;
+    if (len == 0xffffffff) {
+      len = cur.u64();
+      hdrSz = 12;
+    }
+    if (len == 0 || cur.bad || !cur.has(len)) {
+      break;
+    }
+
+    Cursor unit(unitBeg, cur.p + len, secs.bigEndian);
+    if (!decodeUnit(secs, unit, compDirs)) {
+      DIAG_DevMsg(2, "LineTable: skipping line program at offset "
+		  << (unitBeg - secs.line));
+    }
+    cur.p = unitBeg + hdrSz + len;
+  }
+
+  sortRows();
+  return !empty();
+}
+
+
+bool
+BinUtil::Dbg::LineTable::find(VMA vma, uint& file, SrcFile::ln& line) const
+{
+  file = NoFile;
+  line = 0;
+
+  // the last row at or before 'vma'
+  uint lo = 0, hi = m_rows.size();
+  while (lo < hi) {
+    uint mid = lo + (hi - lo) / 2;
+    if (m_rows[mid].vma <= vma) { lo = mid + 1; } else { hi = mid; }
+  }
+  if (lo == 0 || m_rows[lo - 1].file == NoFile) {
+    return false;
+  }
+  file = m_rows[lo - 1].file;
+  line = m_rows[lo - 1].line;
+  return true;
+}
+
+
+uint
+BinUtil::Dbg::LineTable::find(const VMA* vmas, uint n, uint* files,
+			      SrcFile::ln* lines) const
+{
+  uint found = 0;
+  uint nrows = m_rows.size();
+  uint r = 0; // first row with vma > the previous query
+
+  for (uint i = 0; i < n; i++) {
+    VMA vma = vmas[i];
+
+    // Gallop forward from 'r', then binary search the last step.  For
+    // dense queries this is a linear merge; for sparse ones it skips
+    // ahead in logarithmic time.
+    uint lo = r, step = 1;
+    while (lo + step <= nrows && m_rows[lo + step - 1].vma <= vma) {
+      lo += step;
+      step *= 2;
+    }
+    uint hi = std::min(lo + step, nrows);
+    while (lo < hi) {
+      uint mid = lo + (hi - lo) / 2;
+      if (m_rows[mid].vma <= vma) { lo = mid + 1; } else { hi = mid; }
+    }
+    r = lo;
+
+    if (r == 0 || m_rows[r - 1].file == NoFile) {
+      files[i] = NoFile;
+      lines[i] = 0;
+    }
+    else {
+      files[i] = m_rows[r - 1].file;
+      lines[i] = m_rows[r - 1].line;
+      found++;
+    }
+  }
+  return found;
+}
+
+
+// Map each compilation unit's line program offset (DW_AT_stmt_list)
+// to its compilation directory (DW_AT_comp_dir).
+void
+BinUtil::Dbg::LineTable::readCompDirs(const Sections& secs,
+				      CompDirMap& compDirs)
+{
+  if (!secs.info || !secs.abbrev) {
+    return;
+  }
+
+  Cursor cur(secs.info, secs.info + secs.infoSz, secs.bigEndian);
+  while (cur.has(4)) {
+    uint64_t len = cur.u32();
+    bool is64 = false;
+    if (len == 0xffffffff) {
+      len = cur.u64();
+      is64 = true;
+    }
+    if (len == 0 || cur.bad || !cur.has(len)) {
+      break;
+    }
+    const unsigned char* unitEnd = cur.p + len;
+    Cursor unit(cur.p, unitEnd, secs.bigEndian);
+    cur.p = unitEnd;
+
+    int version = unit.u16();
+    uint64_t abbrevOff;
+    uint addrSz;
+    if (version >= 5) {
+      uint unitType = unit.u8();
+      addrSz = unit.u8();
+      abbrevOff = unit.offset(is64);
+      if (unitType == DW_UT_skeleton || unitType == DW_UT_split_compile) {
+	unit.skip(8);
+      }
+      else if (unitType == DW_UT_type || unitType == DW_UT_split_type) {
+	continue;
+      }
+    }
+    else {
+      abbrevOff = unit.offset(is64);
+      addrSz = unit.u8();
+    }
+    if (unit.bad || version < 2 || version > 5 || abbrevOff >= secs.abbrevSz) {
+      continue;
+    }
+
+    // Find the abbreviation of the unit's first DIE.
+    uint64_t code = unit.uleb();
+    Cursor abbr(secs.abbrev + abbrevOff, secs.abbrev + secs.abbrevSz,
+		secs.bigEndian);
+    bool found = false;
+    uint64_t tag = 0;
+    while (!abbr.bad && abbr.p < abbr.end) {
+      uint64_t c = abbr.uleb();
+      if (c == 0) {
+	break;
+      }
+      tag = abbr.uleb();
+      abbr.u8(); // children
+      if (c == code) {
+	found = true;
+	break;
+      }
+      // skip this abbreviation's attribute specs
+      for (;;) {
+	uint64_t at = abbr.uleb(), form = abbr.uleb();
+	if (form == DW_FORM_implicit_const) { abbr.sleb(); }
+	if ((at == 0 && form == 0) || abbr.bad) { break; }
+      }
+    }
+    if (!found || (tag != DW_TAG_compile_unit && tag != DW_TAG_partial_unit)) {
+      continue;
+    }
+
+    bool haveStmtList = false;
+    uint64_t stmtList = 0;
+    const char* compDir = NULL;
+    for (;;) {
+      uint64_t at = abbr.uleb(), form = abbr.uleb();
+      int64_t implicitConst = 0;
+      if (form == DW_FORM_implicit_const) { implicitConst = abbr.sleb(); }
+      if ((at == 0 && form == 0) || abbr.bad) {
+	break;
+      }
+
+      uint64_t val = 0;
+      const char* str = NULL;
+      if (!readForm(secs, unit, form, is64, addrSz, version, implicitConst,
+		    val, str) || unit.bad) {
+	break;
+      }
+      if (at == DW_AT_stmt_list) {
+	haveStmtList = true;
+	stmtList = val;
+      }
+      else if (at == DW_AT_comp_dir) {
+	compDir = str;
+      }
+    }
+    if (haveStmtList && compDir) {
+      compDirs[stmtList] = compDir;
+    }
+  }
+}
+
+
+// Decode one line program.  'cur' spans the unit, starting at its
+// unit_length field.
+bool
+BinUtil::Dbg::LineTable::decodeUnit(const Sections& secs, Cursor& cur,
+				    const CompDirMap& compDirs)
+{
+  uint64_t unitOff = cur.p - secs.line;
+
+  bool is64 = false;
+  if (cur.u32() == 0xffffffff) {
+    cur.u64();
+    is64 = true;
+  }
+
+  int version = cur.u16();
+  if (version < 2 || version > 5) {
+    return false;
+  }
+
+  uint addrSz = 0;
+  if (version >= 5) {
+    addrSz = cur.u8();
+    cur.u8(); // segment_selector_size
+  }
+  uint64_t hdrLen = cur.offset(is64);
+  if (cur.bad || !cur.has(hdrLen)) {
+    return false;
+  }
+  const unsigned char* progBeg = cur.p + hdrLen;
+
+  uint minInsnLen = cur.u8();
+  uint maxOps = (version >= 4) ? cur.u8() : 1;
+  cur.u8(); // default_is_stmt
+  int lineBase = (signed char)cur.u8();
+  uint lineRange = cur.u8();
+  uint opcodeBase = cur.u8();
+  if (cur.bad || lineRange == 0 || opcodeBase == 0) {
+    return false;
+  }
+  if (maxOps == 0) {
+    maxOps = 1;
+  }
+
+  std::vector<uint> opLens(opcodeBase, 0);
+  for (uint i = 1; i < opcodeBase; i++) {
+    opLens[i] = cur.u8();
+  }
+
+  // directories and file names, as full paths
+  CompDirMap::const_iterator cd = compDirs.find(unitOff);
+  string compDir = (cd != compDirs.end()) ? cd->second : string();
+
+  std::vector<string> dirs;
+  std::vector<string> names;
+  std::vector<uint64_t> nameDirs;
+
+  if (version <= 4) {
+    dirs.push_back(compDir);
+    for (;;) {
+      const char* d = cur.cstr();
+      if (cur.bad || *d == '\0') { break; }
+      dirs.push_back(d);
+    }
+    names.push_back(string()); // files are numbered from 1
+    nameDirs.push_back(0);
+    for (;;) {
+      const char* f = cur.cstr();
+      if (cur.bad || *f == '\0') { break; }
+      uint64_t d = cur.uleb();
+      cur.uleb(); // mtime
+      cur.uleb(); // length
+      names.push_back(f);
+      nameDirs.push_back(d);
+    }
+  }
+  else {
+    // directories, then files: each a list of entries whose fields
+    // are described by (content type, form) pairs
+    for (int list = 0; list < 2 && !cur.bad; list++) {
+      uint nfmt = cur.u8();
+      std::vector<uint64_t> fmt;
+      for (uint i = 0; i < nfmt; i++) {
+	fmt.push_back(cur.uleb());
+	fmt.push_back(cur.uleb());
+      }
+      uint64_t count = cur.uleb();
+      for (uint64_t e = 0; e < count && !cur.bad; e++) {
+	const char* path = NULL;
+	uint64_t dir = 0;
+	for (uint i = 0; i < nfmt; i++) {
+	  uint64_t val = 0;
+	  const char* str = NULL;
+	  if (!readForm(secs, cur, fmt[2 * i + 1], is64, addrSz, version, 0,
+			val, str)) {
+	    return false;
+	  }
+	  if (fmt[2 * i] == DW_LNCT_path) { path = str; }
+	  else if (fmt[2 * i] == DW_LNCT_directory_index) { dir = val; }
+	}
+	if (!path) {
+	  return false; // e.g., strx forms, which need .debug_str_offsets
+	}
+	if (list == 0) {
+	  dirs.push_back(path);
+	}
+	else {
+	  names.push_back(path);
+	  nameDirs.push_back(dir);
+	}
+      }
+    }
+    // directory 0 is the compilation directory
+    if (!dirs.empty() && compDir.empty()) {
+      compDir = dirs[0];
+    }
+  }
+  if (cur.bad) {
+    return false;
+  }
+
+  // intern the file names
+  std::vector<uint> fileIds;
+  for (uint i = 0; i < names.size(); i++) {
+    if (names[i].empty()) {
+      fileIds.push_back(NoFile);
+      continue;
+    }
+    string path = names[i];
+    if (path[0] != '/' && nameDirs[i] < dirs.size()) {
+      string dir = dirs[nameDirs[i]];
+      if (!dir.empty() && dir[0] != '/' && !compDir.empty() && nameDirs[i] != 0) {
+	dir = compDir + "/" + dir;
+      }
+      if (!dir.empty()) {
+	path = dir + "/" + path;
+      }
+    }
+    fileIds.push_back(intern(path));
+  }
+
+  // Run the line number state machine.  Rows are buffered per
+  // sequence so that sequences of discarded code, which the linker
+  // leaves at address 0 or a tombstone value, can be dropped whole.
+  cur.p = progBeg;
+
+  VMA tombstone = (addrSz == 4) ? (VMA)0xffffffff : (VMA)-1;
+
+  std::vector<Row> seq;
+  VMA addr = 0;
+  uint opIndex = 0;
+  uint64_t file = 1;
+  int64_t line = 1;
+
+  while (cur.p < cur.end && !cur.bad) {
+    uint op = cur.u8();
+    bool emit = false;
+    bool endSeq = false;
+    uint64_t advance = 0;
+
+    if (op >= opcodeBase) {
+      uint adj = op - opcodeBase;
+      advance = adj / lineRange;
+      line += lineBase + (int)(adj % lineRange);
+      emit = true;
+    }
+    else if (op == 0) {
+      uint64_t len = cur.uleb();
+      if (len == 0 || cur.bad || !cur.has(len)) {
+	break;
+      }
+      const unsigned char* next = cur.p + len;
+      uint sub = cur.u8();
+      if (sub == DW_LNE_end_sequence) {
+	emit = true;
+	endSeq = true;
+      }
+      else if (sub == DW_LNE_set_address) {
+	uint n = len - 1;
+	addr = (n == 1 || n == 2 || n == 4 || n == 8) ? cur.fixed(n) : 0;
+	if (addrSz == 0) { addrSz = n; }
+	opIndex = 0;
+      }
+      else if (sub == DW_LNE_define_file) {
+	string f = cur.cstr();
+	uint64_t d = cur.uleb();
+	if (!f.empty() && f[0] != '/' && d < dirs.size() && !dirs[d].empty()) {
+	  f = dirs[d] + "/" + f;
+	}
+	fileIds.push_back(intern(f));
+      }
+      cur.p = next;
+    }
+    else if (op == DW_LNS_copy) {
+      emit = true;
+    }
+    else if (op == DW_LNS_advance_pc) {
+      advance = cur.uleb();
+    }
+    else if (op == DW_LNS_advance_line) {
+      line += cur.sleb();
+    }
+    else if (op == DW_LNS_set_file) {
+      file = cur.uleb();
+    }
+    else if (op == DW_LNS_const_add_pc) {
+      advance = (255 - opcodeBase) / lineRange;
+    }
+    else if (op == DW_LNS_fixed_advance_pc) {
+      addr += cur.u16();
+      opIndex = 0;
+    }
+    else {
+      // other standard opcodes carry only uleb operands
+      for (uint i = 0; i < opLens[op]; i++) {
+	cur.uleb();
+      }
+    }
+
+    if (advance) {
+      if (maxOps == 1) {
+	addr += minInsnLen * advance;
+      }
+      else {
+	addr += minInsnLen * ((opIndex + advance) / maxOps);
+	opIndex = (opIndex + advance) % maxOps;
+      }
+    }
+
+    if (emit) {
+      Row row;
+      row.vma = addr;
+      row.file = endSeq ? NoFile
+	: ((file < fileIds.size()) ? fileIds[file] : NoFile);
+      row.line = (line > 0) ? (uint)line : 0;
+      seq.push_back(row);
+    }
+
+    if (endSeq) {
+      VMA beg = seq.front().vma;
+      if (beg != 0 && beg < tombstone - 1) {
+	m_rows.insert(m_rows.end(), seq.begin(), seq.end());
+      }
+      seq.clear();
+      addr = 0;
+      opIndex = 0;
+      file = 1;
+      line = 1;
+    }
+  }
+
+  return !cur.bad;
+}
+
+
+uint
+BinUtil::Dbg::LineTable::intern(const string& path)
+{
+  std::map<string, uint>::iterator it = m_fileIds.find(path);
+  if (it != m_fileIds.end()) {
+    return it->second;
+  }
+  uint id = m_files.size();
+  m_files.push_back(path);
+  m_fileIds.insert(std::make_pair(path, id));
+  return id;
+}
+
+
+// end-of-sequence rows sort before other rows at the same address, so
+// that a sequence starting where another ends wins
+static bool
+rowLess(const BinUtil::Dbg::LineTable::Row& a,
+	const BinUtil::Dbg::LineTable::Row& b)
+{
+  if (a.vma != b.vma) {
+    return a.vma < b.vma;
+  }
+  bool aEnd = (a.file == BinUtil::Dbg::LineTable::NoFile);
+  bool bEnd = (b.file == BinUtil::Dbg::LineTable::NoFile);
+  return aEnd && !bEnd;
+}
+
+
+void
+BinUtil::Dbg::LineTable::sortRows()
+{
+  std::stable_sort(m_rows.begin(), m_rows.end(), rowLess);
+
+  // Of several rows at one address the last one wins (the earlier ones
+  // cover no code); then merge rows that continue the previous one.
+  uint n = 0;
+  for (uint i = 0; i < m_rows.size(); i++) {
+    const Row& row = m_rows[i];
+    if (i + 1 < m_rows.size() && m_rows[i + 1].vma == row.vma) {
+      continue;
+    }
+    if (n > 0 && m_rows[n - 1].file == row.file
+	&& m_rows[n - 1].line == row.line) {
+      continue;
+    }
+    m_rows[n++] = row;
+  }
+  m_rows.resize(n);
+  std::vector<Row>(m_rows).swap(m_rows); // shrink to fit
+}
+
+
+// Read an attribute value of 'form'.  Constants are returned in 'val';
+// strings that can be resolved without string offset tables in 'str'.
+// Returns false for forms the decoder does not know.
+bool
+BinUtil::Dbg::LineTable::readForm(const Sections& secs, Cursor& cur,
+				  uint64_t form, bool is64, uint addrSz,
+				  int version, int64_t implicitConst,
+				  uint64_t& val, const char*& str)
+{
+  val = 0;
+  str = NULL;
+
+  switch (form) {
+    case DW_FORM_addr:           val = cur.fixed(addrSz); break;
+    case DW_FORM_data1:
+    case DW_FORM_ref1:
+    case DW_FORM_flag:
+    case DW_FORM_strx1:
+    case DW_FORM_addrx1:         val = cur.u8(); break;
+    case DW_FORM_data2:
+    case DW_FORM_ref2:
+    case DW_FORM_strx2:
+    case DW_FORM_addrx2:         val = cur.u16(); break;
+    case DW_FORM_strx3:
+    case DW_FORM_addrx3:         val = cur.fixed(3); break;
+    case DW_FORM_data4:
+    case DW_FORM_ref4:
+    case DW_FORM_ref_sup4:
+    case DW_FORM_strx4:
+    case DW_FORM_addrx4:         val = cur.u32(); break;
+    case DW_FORM_data8:
+    case DW_FORM_ref8:
+    case DW_FORM_ref_sig8:
+    case DW_FORM_ref_sup8:       val = cur.u64(); break;
+    case DW_FORM_data16:         cur.skip(16); break;
+    case DW_FORM_sdata:          val = (uint64_t)cur.sleb(); break;
+    case DW_FORM_udata:
+    case DW_FORM_ref_udata:
+    case DW_FORM_strx:
+    case DW_FORM_addrx:
+    case DW_FORM_loclistx:
+    case DW_FORM_rnglistx:
+    case DW_FORM_GNU_addr_index:
+    case DW_FORM_GNU_str_index:  val = cur.uleb(); break;
+    case DW_FORM_sec_offset:
+    case DW_FORM_strp_sup:
+    case DW_FORM_GNU_ref_alt:
+    case DW_FORM_GNU_strp_alt:   val = cur.offset(is64); break;
+    case DW_FORM_ref_addr:
+      val = (version <= 2) ? cur.fixed(addrSz) : cur.offset(is64);
+      break;
+    case DW_FORM_string:         str = cur.cstr(); break;
+    case DW_FORM_strp:
+      val = cur.offset(is64);
+      str = sectionStr(secs.str, secs.strSz, val);
+      break;
+    case DW_FORM_line_strp:
+      val = cur.offset(is64);
+      str = sectionStr(secs.lineStr, secs.lineStrSz, val);
+      break;
+    case DW_FORM_block1:         cur.skip(cur.u8()); break;
+    case DW_FORM_block2:         cur.skip(cur.u16()); break;
+    case DW_FORM_block4:         cur.skip(cur.u32()); break;
+    case DW_FORM_block:
+    case DW_FORM_exprloc:        cur.skip(cur.uleb()); break;
+    case DW_FORM_flag_present:   val = 1; break;
+    case DW_FORM_implicit_const: val = (uint64_t)implicitConst; break;
+    case DW_FORM_indirect:
+      return readForm(secs, cur, cur.uleb(), is64, addrSz, version,
+		      implicitConst, val, str);
+    default:
+      return false;
+  }
+  return !cur.bad;
+}
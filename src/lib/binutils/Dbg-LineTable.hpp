@@ -0,0 +1,210 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   A load module's DWARF line program, decoded once into a compact,
+//   sorted VMA -> (file, line) table.
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+#ifndef BinUtil_Dbg_LineTable_hpp
+#define BinUtil_Dbg_LineTable_hpp
+
+//************************* System Include Files ****************************
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <stddef.h>
+
+//*************************** User Include Files ****************************
+
+#include <include/uint.h>
+#include <include/gnu_bfd.h>
+
+#include <lib/isa/ISATypes.hpp>
+
+#include <lib/support/SrcFile.hpp>
+
+//*************************** Forward Declarations **************************
+
+//***************************************************************************
+// LineTable
+//***************************************************************************
+
+namespace BinUtil {
+
+namespace Dbg {
+
+// --------------------------------------------------------------------------
+// 'LineTable' holds the rows of every line program in .debug_line,
+// sorted by (unrelocated) VMA.  Row i covers [row[i].vma,
+// row[i+1].vma).  A row whose file is NoFile marks the end of a
+// sequence, i.e., a gap.  Adjacent rows with the same file and line
+// are merged.  File names are interned: each distinct path is stored
+// once, and rows refer to it by id.
+//
+// Supports DWARF 2-5 line programs.  Units that use forms the decoder
+// does not understand are skipped, not guessed at.
+// --------------------------------------------------------------------------
+
+class LineTable {
+public:
+  static const uint NoFile = (uint)-1;
+
+  struct Row {
+    VMA  vma;
+    uint file;
+    uint line;
+  };
+
+  // Raw (uncompressed) contents of the sections the decoder reads.
+  // Only 'line' is required; the others may be NULL.
+  struct Sections {
+    Sections()
+      : line(NULL), lineSz(0), info(NULL), infoSz(0),
+	abbrev(NULL), abbrevSz(0), str(NULL), strSz(0),
+	lineStr(NULL), lineStrSz(0), bigEndian(false)
+    { }
+
+    const unsigned char* line;    size_t lineSz;
+    const unsigned char* info;    size_t infoSz;
+    const unsigned char* abbrev;  size_t abbrevSz;
+    const unsigned char* str;     size_t strSz;
+    const unsigned char* lineStr; size_t lineStrSz;
+    bool bigEndian;
+  };
+
+  LineTable();
+  ~LineTable();
+
+  // Decode the line programs of 'abfd'.  Returns false if it has no
+  // .debug_line or no rows could be decoded.
+  bool
+  read(bfd* abfd);
+
+  bool
+  decode(const Sections& secs);
+
+  void
+  clear();
+
+  bool
+  empty() const
+  { return m_rows.empty(); }
+
+  uint
+  size() const
+  { return m_rows.size(); }
+
+  // Find the file and line of 'vma'.  Returns false if no row covers it.
+  bool
+  find(VMA vma, uint& file, SrcFile::ln& line) const;
+
+  // Batched find() for 'n' VMAs sorted in ascending order, done as a
+  // merge join with the rows.  'files' and 'lines' are parallel to
+  // 'vmas'; VMAs that no row covers get NoFile and 0.  Returns the
+  // number of VMAs found.
+  uint
+  find(const VMA* vmas, uint n, uint* files, SrcFile::ln* lines) const;
+
+  uint
+  numFiles() const
+  { return m_files.size(); }
+
+  const std::string&
+  file(uint id) const
+  { return m_files[id]; }
+
+private:
+  // Not implemented
+  LineTable(const LineTable&);
+  LineTable& operator=(const LineTable&);
+
+  class Cursor;
+
+  typedef std::map<uint64_t, std::string> CompDirMap;
+
+  void
+  readCompDirs(const Sections& secs, CompDirMap& compDirs);
+
+  bool
+  decodeUnit(const Sections& secs, Cursor& cur,
+	     const CompDirMap& compDirs);
+
+  static bool
+  readForm(const Sections& secs, Cursor& cur, uint64_t form, bool is64,
+	   uint addrSz, int version, int64_t implicitConst,
+	   uint64_t& val, const char*& str);
+
+  uint
+  intern(const std::string& path);
+
+  void
+  sortRows();
+
+private:
+  std::vector<Row> m_rows;
+  std::vector<std::string> m_files;
+  std::map<std::string, uint> m_fileIds;
+};
+
+} // namespace Dbg
+
+} // namespace BinUtil
+
+//***************************************************************************
+
+#endif // BinUtil_Dbg_LineTable_hpp
@@ -345,6 +345,7 @@ BinUtil::LM::LM(bool useBinutils)
   : m_type(TypeNULL), m_readFlags(ReadFlg_NULL),
     m_txtBeg(0), m_txtEnd(0), m_begVMA(0),
     m_textBegReloc(0), m_unrelocDelta(0),
+    m_lineTable(NULL), m_lineTableRead(false), m_srcMemoValid(false),
     m_bfd(NULL), m_bfdSymTab(NULL), 
     m_bfdDynSymTab(NULL), m_bfdSynthTab(NULL),
     m_bfdSymTabSort(NULL), m_bfdSymTabSz(0), m_bfdDynSymTabSz(0),
@@ -389,6 +390,9 @@ BinUtil::LM::~LM()
   m_bfdSymTabSortSz = 0;
   m_bfdSynthTabSz = 0;
   m_bfdDynSymTabSz = 0;
+
+  delete m_lineTable;
+  m_lineTable = NULL;
   
   // reset isa
   delete isa;
@@ -509,6 +513,7 @@ BinUtil::LM::relocate(VMA textBegReloc)
 {
   DIAG_Assert(m_txtBeg != 0, "LM::Relocate not supported!");
   m_textBegReloc = textBegReloc;
+  m_srcMemoValid = false;
   
   if (m_textBegReloc == 0) {
     m_unrelocDelta = 0;
@@ -551,6 +556,13 @@ BinUtil::LM::findSrcCodeInfo(VMA vma, ushort opIndex,
   if (m_bfdSymTabSortSz == 0) { 
     return STATUS; 
   }
+
+  if (m_srcMemoValid && m_srcMemoVMA == vma && m_srcMemoOpIndex == opIndex) {
+    func = m_srcMemoFunc;
+    file = m_srcMemoFile;
+    line = m_srcMemoLine;
+    return m_srcMemoStatus;
+  }
   
   VMA unrelocVMA = unrelocate(vma);
   VMA opVMA = isa->convertVMAToOpVMA(unrelocVMA, opIndex);
@@ -590,6 +602,14 @@ BinUtil::LM::findSrcCodeInfo(VMA vma, ushort opIndex,
     line = (SrcFile::ln)bfd_line;
   }
 
+  m_srcMemoValid = true;
+  m_srcMemoVMA = vma;
+  m_srcMemoOpIndex = opIndex;
+  m_srcMemoStatus = STATUS;
+  m_srcMemoFunc = func;
+  m_srcMemoFile = file;
+  m_srcMemoLine = line;
+
   return STATUS;
 }
 
@@ -670,6 +690,98 @@ BinUtil::LM::findSrcCodeInfo(VMA begVMA, ushort bOpIndex,
 }
 
 
+bool
+BinUtil::LM::findSrcLine(VMA vma, ushort opIndex,
+			 string& file, SrcFile::ln& line)
+{
+  const Dbg::LineTable* tbl = lineTable();
+  if (!tbl) {
+    string func;
+    return findSrcCodeInfo(vma, opIndex, func, file, line);
+  }
+
+  file = "";
+  line = 0;
+
+  VMA opVMA = isa->convertVMAToOpVMA(unrelocate(vma), opIndex);
+
+  uint fileId = Dbg::LineTable::NoFile;
+  if (tbl->find(opVMA, fileId, line)) {
+    file = lineFile(fileId);
+  }
+
+  return (!file.empty() && SrcFile::isValid(line));
+}
+
+
+bool
+BinUtil::LM::findSrcLines(const std::vector<VMA>& vmas,
+			  std::vector<const std::string*>& files,
+			  std::vector<SrcFile::ln>& lines)
+{
+  const Dbg::LineTable* tbl = lineTable();
+  if (!tbl) {
+    return false;
+  }
+
+  // Unrelocating shifts every VMA by the same delta, so 'opVMAs'
+  // stays sorted.
+  uint n = vmas.size();
+  std::vector<VMA> opVMAs(n);
+  for (uint i = 0; i < n; ++i) {
+    opVMAs[i] = isa->convertVMAToOpVMA(unrelocate(vmas[i]), 0);
+  }
+
+  std::vector<uint> fileIds(n);
+  lines.resize(n);
+  files.assign(n, NULL);
+
+  if (n > 0) {
+    tbl->find(&opVMAs[0], n, &fileIds[0], &lines[0]);
+  }
+  for (uint i = 0; i < n; ++i) {
+    if (fileIds[i] != Dbg::LineTable::NoFile) {
+      files[i] = &lineFile(fileIds[i]);
+    }
+  }
+
+  return true;
+}
+
+
+const BinUtil::Dbg::LineTable*
+BinUtil::LM::lineTable()
+{
+  if (!m_lineTableRead) {
+    m_lineTableRead = true;
+    if (m_bfd && !m_simpleSymbols) {
+      m_lineTable = new Dbg::LineTable;
+      if (m_lineTable->read(m_bfd)) {
+	m_lineFiles.resize(m_lineTable->numFiles());
+	m_lineFilesDone.assign(m_lineTable->numFiles(), false);
+      }
+      else {
+	delete m_lineTable;
+	m_lineTable = NULL;
+      }
+    }
+  }
+  return m_lineTable;
+}
+
+
+const std::string&
+BinUtil::LM::lineFile(uint id)
+{
+  if (!m_lineFilesDone[id]) {
+    m_lineFiles[id] = m_lineTable->file(id);
+    m_realpathMgr.realpath(m_lineFiles[id]);
+    m_lineFilesDone[id] = true;
+  }
+  return m_lineFiles[id];
+}
+
+
 bool 
 BinUtil::LM::findProcSrcCodeInfo(VMA vma, ushort opIndex, 
 				 SrcFile::ln &line) const
@@ -926,6 +1038,7 @@ BinUtil::LM::readSegs()
   // Pass symbol table and debug summary information for each section
   // into that section as it is created.
   m_dbgInfo.read(m_bfd, m_bfdSymTab);
+  m_srcMemoValid = false;
 
   // Process each section in the object file.
   for (asection* sec = m_bfd->sections; (sec); sec = sec->next) {
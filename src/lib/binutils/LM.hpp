@@ -65,6 +65,7 @@
 #include <string>
 #include <deque>
 #include <map>
+#include <vector>
 #include <iostream>
 
 #include <string.h>
@@ -76,6 +77,7 @@
 #include <include/gnu_bfd.h>
 
 #include "Dbg-LM.hpp"
+#include "Dbg-LineTable.hpp"
 #include "VMAInterval.hpp"
 #include "BinUtils.hpp"
 #include "SimpleSymbols.hpp"
@@ -413,6 +415,27 @@ public:
 		  SrcFile::ln& begLine, SrcFile::ln& endLine,
 		  unsigned flags = 1) /*const*/;
 
+  // -------------------------------------------------------
+  // findSrcLine: Find only the source file and line of 'vma + opIndex'.
+  // The module's DWARF line programs are decoded once, on first use,
+  // into a sorted Dbg::LineTable; modules without one fall back to
+  // findSrcCodeInfo().  Returns true if both file and line are found.
+  //
+  // findSrcLines: A batched findSrcLine() for the (relocated) VMAs in
+  // 'vmas', which must be sorted in ascending order.  'files' and
+  // 'lines' are parallel to 'vmas'; a 'files' entry is NULL when no
+  // line row covers its VMA.  Returns false, without touching 'files'
+  // or 'lines', if the module has no line table.
+  // -------------------------------------------------------
+  bool
+  findSrcLine(VMA vma, ushort opIndex,
+	      std::string& file, SrcFile::ln& line);
+
+  bool
+  findSrcLines(const std::vector<VMA>& vmas,
+	       std::vector<const std::string*>& files,
+	       std::vector<SrcFile::ln>& lines);
+
   // used for kernel symbols
   bool
   findSimpleFunction(VMA vma, std::string& func);
@@ -502,7 +525,8 @@ public:
 protected:
   // Should not be used
   LM(const LM& GCC_ATTR_UNUSED lm)
-    : m_realpathMgr(RealPathMgr::singleton())
+    : m_lineTable(NULL), m_lineTableRead(false), m_srcMemoValid(false),
+      m_realpathMgr(RealPathMgr::singleton())
   { }
   
   LM&
@@ -514,6 +538,14 @@ private:
   void
   readSymbolTables();
 
+  // Decode the line table on first use; NULL if there is none.
+  const Dbg::LineTable*
+  lineTable();
+
+  // Line table file name 'id', normalized with RealPathMgr on first use.
+  const std::string&
+  lineFile(uint id);
+
   void
   readSegs();
 
@@ -567,6 +599,21 @@ private:
   // symbolic info used in building procedures
   BinUtil::Dbg::LM m_dbgInfo;
 
+  // line table (see findSrcLine) and its normalized file names
+  Dbg::LineTable* m_lineTable;
+  bool m_lineTableRead;
+  std::vector<std::string> m_lineFiles;
+  std::vector<bool> m_lineFilesDone;
+
+  // one-entry memo for findSrcCodeInfo(), which callers tend to ask
+  // about the same procedure entry point many times in a row
+  bool m_srcMemoValid;
+  VMA m_srcMemoVMA;
+  ushort m_srcMemoOpIndex;
+  bool m_srcMemoStatus;
+  std::string m_srcMemoFunc, m_srcMemoFile;
+  SrcFile::ln m_srcMemoLine;
+
   // Note: the sorted table includes both regular and synthetic
   // symbols and thus may be larger than m_bfdSymTab.  Size is the
   // size of the sorted table.  Also, the synthetic table is an array
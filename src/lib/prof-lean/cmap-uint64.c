@@ -0,0 +1,681 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+
+//*****************************************************************************
+// Description:
+//
+//   each slot holds a key, a value, and a version that every update of
+//   the slot advances before changing the key or value. an insert
+//   publishes a slot's value before its key, and a lookup that matches a
+//   key re-reads the version after reading the value; if the version
+//   changed in between, the slot was deleted (and possibly reused, even
+//   by the same key) concurrently and the probe is retried. comparing
+//   versions rather than keys keeps a lookup from pairing a key with the
+//   value of an entry that briefly reused its slot.
+//
+//   deleted slots become tombstones, which later inserts reuse. rather
+//   than stopping only at an empty slot, probes stop after max_probe
+//   slots, the largest displacement of any key in the table, so lookups
+//   of absent ids stay short even when the table holds no empty slots.
+//
+//   tombstones count toward the load of the table. when live entries and
+//   tombstones fill three quarters of it, an insert purges the table in
+//   place: tombstones that lie on no live key's probe path become empty
+//   and max_probe is recomputed, which may shrink it. both changes are
+//   safe for concurrent lookups, which can only have needed a slot on a
+//   live key's path. if the tombstones that remain still fill more than
+//   half of the table, it grows.
+//
+//   a table replaced by growth is not reclaimed because concurrent
+//   lookups may still be probing it; since tables double, the space for
+//   all retired tables is bounded by that of the current table.
+//
+//*****************************************************************************
+
+
+
+//*****************************************************************************
+// global includes
+//*****************************************************************************
+
+#include <assert.h>
+#include <string.h>
+
+
+
+//*****************************************************************************
+// local includes
+//*****************************************************************************
+
+#include "cmap-uint64.h"
+
+
+
+//*****************************************************************************
+// macros
+//*****************************************************************************
+
+#define UNIT_TEST 0
+
+
+
+//*****************************************************************************
+// type declarations
+//*****************************************************************************
+
+typedef struct cmap_uint64_slot_t {
+  atomic_ullong version;   // advanced by each update of the slot
+  atomic_ullong key;
+  _Atomic(void *) value;
+} cmap_uint64_slot_t;
+
+
+struct cmap_uint64_table_t {
+  uint64_t capacity;       // a power of 2
+  uint64_t tombstones;     // deleted slots not yet reused or purged
+  atomic_ullong max_probe; // largest displacement of any key in the table
+  cmap_uint64_slot_t slots[];
+};
+
+
+
+//*****************************************************************************
+// private operations
+//*****************************************************************************
+
+static cmap_uint64_table_t *
+cmap_uint64_table_new
+(
+ cmap_uint64_t *map,
+ uint64_t capacity
+)
+{
+  cmap_uint64_table_t *table = (cmap_uint64_table_t *) 
+    map->alloc(sizeof(cmap_uint64_table_t) + 
+	       capacity * sizeof(cmap_uint64_slot_t));
+
+  table->capacity = capacity;
+  table->tombstones = 0;
+  atomic_init(&table->max_probe, 0);
+
+  uint64_t i;
+  for (i = 0; i < capacity; i++) {
+    atomic_init(&table->slots[i].version, 0);
+    atomic_init(&table->slots[i].key, CMAP_UINT64_EMPTY);
+    atomic_init(&table->slots[i].value, NULL);
+  }
+
+  return table;
+}
+
+
+static inline cmap_uint64_slot_t *
+cmap_uint64_table_slot
+(
+ cmap_uint64_table_t *table,
+ uint64_t key,
+ uint64_t probe
+)
+{
+  return &table->slots[(key + probe) & (table->capacity - 1)];
+}
+
+
+// begin an update of slot: a lookup that reads any store that follows
+// will also see the slot's new version. call with the map's lock held.
+static inline void
+cmap_uint64_slot_update
+(
+ cmap_uint64_slot_t *slot
+)
+{
+  uint64_t version = 
+    atomic_load_explicit(&slot->version, memory_order_relaxed);
+  atomic_store_explicit(&slot->version, version + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+}
+
+
+// find the slot holding key, if any. call with the map's lock held.
+static cmap_uint64_slot_t *
+cmap_uint64_table_find
+(
+ cmap_uint64_table_t *table,
+ uint64_t key
+)
+{
+  uint64_t max_probe = 
+    atomic_load_explicit(&table->max_probe, memory_order_relaxed);
+
+  uint64_t i;
+  for (i = 0; i <= max_probe; i++) {
+    cmap_uint64_slot_t *slot = cmap_uint64_table_slot(table, key, i);
+    uint64_t slot_key = 
+      atomic_load_explicit(&slot->key, memory_order_relaxed);
+    if (slot_key == key) return slot;
+    if (slot_key == CMAP_UINT64_EMPTY) break;
+  }
+
+  return NULL;
+}
+
+
+// place an absent key in table. call with the map's lock held.
+static void
+cmap_uint64_table_place
+(
+ cmap_uint64_table_t *table,
+ uint64_t key,
+ void *value
+)
+{
+  uint64_t i;
+  for (i = 0; i < table->capacity; i++) {
+    cmap_uint64_slot_t *slot = cmap_uint64_table_slot(table, key, i);
+    uint64_t slot_key = 
+      atomic_load_explicit(&slot->key, memory_order_relaxed);
+    if (slot_key == CMAP_UINT64_EMPTY || slot_key == CMAP_UINT64_TOMBSTONE) {
+      if (i > atomic_load_explicit(&table->max_probe, memory_order_relaxed)) {
+	atomic_store_explicit(&table->max_probe, i, memory_order_relaxed);
+      }
+
+      if (slot_key == CMAP_UINT64_TOMBSTONE) table->tombstones--;
+
+      // a lookup that matches key will see its value
+      cmap_uint64_slot_update(slot);
+      atomic_store_explicit(&slot->value, value, memory_order_relaxed);
+      atomic_store_explicit(&slot->key, key, memory_order_release);
+      return;
+    }
+  }
+
+  // growth keeps the table at most half full
+  assert(0);
+}
+
+
+// empty the tombstones of table that lie on no live key's probe path
+// and recompute its max_probe. call with the map's lock held.
+static void
+cmap_uint64_table_purge
+(
+ cmap_uint64_table_t *table
+)
+{
+  uint64_t mask = table->capacity - 1;
+  uint64_t max_probe = 0;
+
+  // number of slots, from the current one down, that lie between a live
+  // key and its home slot
+  uint64_t cover = 0;
+
+  // walk down twice around the table: the first lap only finds the
+  // probe paths that wrap around from slot 0 to the top
+  uint64_t j;
+  for (j = 2 * table->capacity; j-- > 0; ) {
+    cmap_uint64_slot_t *slot = &table->slots[j & mask];
+    uint64_t key = atomic_load_explicit(&slot->key, memory_order_relaxed);
+    uint64_t probe = 0;
+
+    if (key == CMAP_UINT64_TOMBSTONE) {
+      if (cover == 0 && j < table->capacity) {
+	atomic_store_explicit(&slot->key, CMAP_UINT64_EMPTY, 
+			      memory_order_relaxed);
+	table->tombstones--;
+      }
+    } else if (key != CMAP_UINT64_EMPTY) {
+      probe = (j - key) & mask;
+      if (probe > max_probe) max_probe = probe;
+    }
+
+    if (cover > 0) cover--;
+    if (probe > cover) cover = probe;
+  }
+
+  atomic_store_explicit(&table->max_probe, max_probe, memory_order_relaxed);
+}
+
+
+// replace the map's table with one twice as large. call with the map's
+// lock held.
+static cmap_uint64_table_t *
+cmap_uint64_grow
+(
+ cmap_uint64_t *map,
+ cmap_uint64_table_t *table
+)
+{
+  cmap_uint64_table_t *new_table = 
+    cmap_uint64_table_new(map, 2 * table->capacity);
+
+  uint64_t i;
+  for (i = 0; i < table->capacity; i++) {
+    cmap_uint64_slot_t *slot = &table->slots[i];
+    uint64_t key = atomic_load_explicit(&slot->key, memory_order_relaxed);
+    if (key != CMAP_UINT64_EMPTY && key != CMAP_UINT64_TOMBSTONE) {
+      void *value = atomic_load_explicit(&slot->value, memory_order_relaxed);
+      cmap_uint64_table_place(new_table, key, value);
+    }
+  }
+
+  // publish the new table after its contents
+  atomic_store_explicit(&map->table, new_table, memory_order_release);
+
+  return new_table;
+}
+
+
+
+//*****************************************************************************
+// interface operations
+//*****************************************************************************
+
+void
+cmap_uint64_init
+(
+ cmap_uint64_t *map,
+ allocator_t *alloc
+)
+{
+  atomic_init(&map->table, NULL);
+  atomic_init(&map->count, 0);
+  spinlock_init(&map->lock);
+  map->alloc = alloc;
+}
+
+
+void *
+cmap_uint64_lookup
+(
+ cmap_uint64_t *map,
+ uint64_t key
+)
+{
+  cmap_uint64_table_t *table = 
+    atomic_load_explicit(&map->table, memory_order_acquire);
+
+  if (table == NULL) return NULL;
+
+  uint64_t max_probe = 
+    atomic_load_explicit(&table->max_probe, memory_order_relaxed);
+
+  uint64_t i;
+  for (i = 0; i <= max_probe; i++) {
+    cmap_uint64_slot_t *slot = cmap_uint64_table_slot(table, key, i);
+    uint64_t version = 
+      atomic_load_explicit(&slot->version, memory_order_acquire);
+    uint64_t slot_key = atomic_load_explicit(&slot->key, memory_order_acquire);
+
+    if (slot_key == key) {
+      void *value = atomic_load_explicit(&slot->value, memory_order_relaxed);
+
+      // the value belongs to key only if the slot was not updated since
+      // its version was read
+      atomic_thread_fence(memory_order_acquire);
+      if (atomic_load_explicit(&slot->version, memory_order_relaxed) == 
+	  version) {
+	return value;
+      }
+
+      // slot was deleted concurrently; examine it again 
+      i--;
+      continue;
+    }
+
+    if (slot_key == CMAP_UINT64_EMPTY) break;
+  }
+
+  return NULL;
+}
+
+
+bool
+cmap_uint64_insert
+(
+ cmap_uint64_t *map,
+ uint64_t key,
+ void *value
+)
+{
+  assert(key != CMAP_UINT64_EMPTY && key != CMAP_UINT64_TOMBSTONE);
+  assert(value != NULL);
+
+  bool inserted = false;
+
+  spinlock_lock(&map->lock);
+
+  cmap_uint64_table_t *table = 
+    atomic_load_explicit(&map->table, memory_order_relaxed);
+
+  if (table == NULL) {
+    table = cmap_uint64_table_new(map, CMAP_UINT64_INITIAL_CAPACITY);
+    atomic_store_explicit(&map->table, table, memory_order_release);
+  }
+
+  if (cmap_uint64_table_find(table, key) == NULL) {
+    uint64_t count = atomic_load_explicit(&map->count, memory_order_relaxed);
+
+    if (2 * (count + 1) > table->capacity) {
+      table = cmap_uint64_grow(map, table);
+    } else if (4 * (count + table->tombstones + 1) > 3 * table->capacity) {
+      cmap_uint64_table_purge(table);
+      if (2 * (count + table->tombstones + 1) > table->capacity) {
+	table = cmap_uint64_grow(map, table);
+      }
+    }
+
+    cmap_uint64_table_place(table, key, value);
+    atomic_store_explicit(&map->count, count + 1, memory_order_relaxed);
+
+    inserted = true;
+  }
+
+  spinlock_unlock(&map->lock);
+
+  return inserted;
+}
+
+
+void *
+cmap_uint64_delete
+(
+ cmap_uint64_t *map,
+ uint64_t key
+)
+{
+  void *value = NULL;
+
+  spinlock_lock(&map->lock);
+
+  cmap_uint64_table_t *table = 
+    atomic_load_explicit(&map->table, memory_order_relaxed);
+
+  cmap_uint64_slot_t *slot = 
+    table ? cmap_uint64_table_find(table, key) : NULL;
+
+  if (slot) {
+    value = atomic_load_explicit(&slot->value, memory_order_relaxed);
+    cmap_uint64_slot_update(slot);
+    atomic_store_explicit(&slot->key, CMAP_UINT64_TOMBSTONE, 
+			  memory_order_relaxed);
+    table->tombstones++;
+    atomic_store_explicit(&map->count, 
+			  atomic_load_explicit(&map->count, 
+					       memory_order_relaxed) - 1,
+			  memory_order_relaxed);
+  }
+
+  spinlock_unlock(&map->lock);
+
+  return value;
+}
+
+
+void
+cmap_uint64_forall
+(
+ cmap_uint64_t *map,
+ cmap_uint64_fn_t fn,
+ void *arg
+)
+{
+  cmap_uint64_table_t *table = 
+    atomic_load_explicit(&map->table, memory_order_acquire);
+
+  if (table == NULL) return;
+
+  uint64_t i;
+  for (i = 0; i < table->capacity; i++) {
+    cmap_uint64_slot_t *slot = &table->slots[i];
+    uint64_t version = 
+      atomic_load_explicit(&slot->version, memory_order_acquire);
+    uint64_t key = atomic_load_explicit(&slot->key, memory_order_acquire);
+    if (key != CMAP_UINT64_EMPTY && key != CMAP_UINT64_TOMBSTONE) {
+      void *value = atomic_load_explicit(&slot->value, memory_order_relaxed);
+      atomic_thread_fence(memory_order_acquire);
+      if (atomic_load_explicit(&slot->version, memory_order_relaxed) == 
+	  version) {
+	fn(key, value, arg);
+      }
+    }
+  }
+}
+
+
+uint64_t
+cmap_uint64_count
+(
+ cmap_uint64_t *map
+)
+{
+  return atomic_load_explicit(&map->count, memory_order_relaxed);
+}
+
+
+
+//*****************************************************************************
+// unit test
+//*****************************************************************************
+
+#if UNIT_TEST
+
+// a microbenchmark that mimics gpu correlation: a producer thread inserts
+// dense, increasing ids, as application threads do when they launch gpu
+// operations, and a consumer thread looks each id up and deletes it, as
+// the monitoring thread does when it processes activities. the same
+// stream drives a splay tree serialized with a spin lock, which is how
+// the splay maps would have to be shared.
+//
+// build (from src/lib/prof-lean):
+//   cc -std=gnu99 -O2 cmap-uint64.c splay-uint64.c -lpthread
+//
+// after changing UNIT_TEST above to 1.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "splay-uint64.h"
+
+#define NIDS (4 * 1024 * 1024)
+
+// how far the producer may run ahead of the consumer
+#define WINDOW 4096
+
+typedef struct {
+  void (*insert)(uint64_t key);
+  bool (*lookup_delete)(uint64_t key);
+} test_map_ops_t;
+
+static cmap_uint64_t test_cmap = CMAP_UINT64_INITIALIZER(malloc);
+
+static splay_uint64_node_t *test_splay_root = NULL;
+
+static spinlock_t test_splay_lock = SPINLOCK_UNLOCKED;
+
+static splay_uint64_node_t test_splay_nodes[WINDOW];
+
+static atomic_ullong test_consumed;
+
+static test_map_ops_t *test_ops;
+
+
+static void
+cmap_test_insert
+(
+ uint64_t key
+)
+{
+  cmap_uint64_insert(&test_cmap, key, (void *) (uintptr_t) (key + 1));
+}
+
+
+static bool
+cmap_test_lookup_delete
+(
+ uint64_t key
+)
+{
+  void *value = cmap_uint64_lookup(&test_cmap, key);
+  if (value == NULL) return false;
+  assert(value == (void *) (uintptr_t) (key + 1));
+  cmap_uint64_delete(&test_cmap, key);
+  return true;
+}
+
+
+static void
+splay_test_insert
+(
+ uint64_t key
+)
+{
+  splay_uint64_node_t *node = &test_splay_nodes[key % WINDOW];
+  node->key = key;
+  spinlock_lock(&test_splay_lock);
+  splay_uint64_insert(&test_splay_root, node);
+  spinlock_unlock(&test_splay_lock);
+}
+
+
+static bool
+splay_test_lookup_delete
+(
+ uint64_t key
+)
+{
+  spinlock_lock(&test_splay_lock);
+  splay_uint64_node_t *node = splay_uint64_lookup(&test_splay_root, key);
+  if (node) splay_uint64_delete(&test_splay_root, key);
+  spinlock_unlock(&test_splay_lock);
+  return node != NULL;
+}
+
+
+static void *
+test_producer
+(
+ void *arg
+)
+{
+  uint64_t key;
+  for (key = 0; key < NIDS; key++) {
+    while (key - atomic_load(&test_consumed) >= WINDOW) sched_yield();
+    test_ops->insert(key);
+  }
+  return NULL;
+}
+
+
+static void *
+test_consumer
+(
+ void *arg
+)
+{
+  uint64_t key;
+  for (key = 0; key < NIDS; key++) {
+    while (!test_ops->lookup_delete(key)) sched_yield();
+    atomic_store(&test_consumed, key + 1);
+  }
+  return NULL;
+}
+
+
+static double
+test_run
+(
+ test_map_ops_t *ops
+)
+{
+  pthread_t producer, consumer;
+  struct timespec t0, t1;
+
+  test_ops = ops;
+  atomic_store(&test_consumed, 0);
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  pthread_create(&consumer, NULL, test_consumer, NULL);
+  pthread_create(&producer, NULL, test_producer, NULL);
+
+  pthread_join(producer, NULL);
+  pthread_join(consumer, NULL);
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+}
+
+
+int
+main
+(
+ int argc,
+ char **argv
+)
+{
+  test_map_ops_t cmap_ops = { cmap_test_insert, cmap_test_lookup_delete };
+  test_map_ops_t splay_ops = { splay_test_insert, splay_test_lookup_delete };
+
+  double splay_secs = test_run(&splay_ops);
+  double cmap_secs = test_run(&cmap_ops);
+
+  printf("splay + lock: %.1f M ids/s\n", NIDS / splay_secs * 1e-6);
+  printf("cmap:         %.1f M ids/s\n", NIDS / cmap_secs * 1e-6);
+
+  assert(cmap_uint64_count(&test_cmap) == 0);
+  assert(test_splay_root == NULL);
+
+  printf("passed\n");
+
+  return 0;
+}
+
+#endif
@@ -0,0 +1,190 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+
+//*****************************************************************************
+// Description:
+//
+//   a concurrent map from 64-bit unsigned ids to pointers, designed for
+//   dense, mostly increasing ids such as gpu correlation ids. 
+//
+//   the map is an open addressed table that is indexed directly by id
+//   modulo its capacity, so a window of live ids behaves like a ring.
+//   lookups are wait-free and may run concurrently with updates; updates
+//   (insert and delete) are serialized by a spin lock, which is
+//   uncontended when a single thread updates the map. the table doubles
+//   when it becomes half full of live entries; deleted entries leave
+//   tombstones, which are purged in place when they accumulate.
+//
+//   keys CMAP_UINT64_EMPTY and CMAP_UINT64_TOMBSTONE are reserved.
+//
+//*****************************************************************************
+
+#ifndef cmap_uint64_h
+#define cmap_uint64_h
+
+
+
+//*****************************************************************************
+// global includes
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+
+
+//*****************************************************************************
+// local includes
+//*****************************************************************************
+
+#include "allocator.h"
+#include "spinlock.h"
+#include "stdatomic.h"
+
+
+
+//*****************************************************************************
+// macros
+//*****************************************************************************
+
+#define CMAP_UINT64_EMPTY     (~(uint64_t) 0)
+#define CMAP_UINT64_TOMBSTONE (~(uint64_t) 1)
+
+// initial number of slots; must be a power of 2
+#define CMAP_UINT64_INITIAL_CAPACITY 1024
+
+// static initializer for a map whose table is allocated on first insert
+#define CMAP_UINT64_INITIALIZER(alloc_fn) \
+  { .table = ATOMIC_VAR_INIT(NULL), .count = ATOMIC_VAR_INIT(0), \
+    .lock = SPINLOCK_UNLOCKED, .alloc = alloc_fn }
+
+
+
+//*****************************************************************************
+// type declarations
+//*****************************************************************************
+
+typedef struct cmap_uint64_table_t cmap_uint64_table_t;
+
+
+typedef struct cmap_uint64_t {
+  _Atomic(cmap_uint64_table_t *) table;
+  atomic_ullong count;   // number of live entries
+  spinlock_t lock;       // serializes updates
+  allocator_t *alloc;    // allocator for tables
+} cmap_uint64_t;
+
+
+typedef void (*cmap_uint64_fn_t)
+(
+ uint64_t key,
+ void *value,
+ void *arg
+);
+
+
+
+//*****************************************************************************
+// interface operations
+//*****************************************************************************
+
+void
+cmap_uint64_init
+(
+ cmap_uint64_t *map,
+ allocator_t *alloc
+);
+
+
+// return the value associated with key, or NULL if key is absent
+void *
+cmap_uint64_lookup
+(
+ cmap_uint64_t *map,
+ uint64_t key
+);
+
+
+// associate a non-NULL value with key; return false if key was present
+bool
+cmap_uint64_insert
+(
+ cmap_uint64_t *map,
+ uint64_t key,
+ void *value
+);
+
+
+// remove key from the map and return its value, or NULL if key is absent
+void *
+cmap_uint64_delete
+(
+ cmap_uint64_t *map,
+ uint64_t key
+);
+
+
+// apply fn to each entry; entries updated concurrently may be missed
+void
+cmap_uint64_forall
+(
+ cmap_uint64_t *map,
+ cmap_uint64_fn_t fn,
+ void *arg
+);
+
+
+uint64_t
+cmap_uint64_count
+(
+ cmap_uint64_t *map
+);
+
+
+
+#endif
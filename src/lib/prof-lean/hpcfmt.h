@@ -257,6 +257,65 @@ hpcfmt_real8_fwrite(double val, FILE* outfs)
 }
 
 
+//***************************************************************************
+
+// hpcfmt_varint_fread/fwrite: Read or write 'val' as an unsigned LEB128
+// varint: 7 bits per byte, low-order group first, with the high bit of
+// each byte set if another byte follows.  Values below 128 take one
+// byte; a full 64-bit value takes 10.
+
+static inline int
+hpcfmt_varint_fread(uint64_t* val, FILE* infs)
+{
+  uint64_t v = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int c = getc(infs);
+    if (c == EOF) {
+      return (shift == 0 && feof(infs)) ? HPCFMT_EOF : HPCFMT_ERR;
+    }
+    v |= ((uint64_t)(c & 0x7f)) << shift;
+    if (!(c & 0x80)) {
+      *val = v;
+      return HPCFMT_OK;
+    }
+  }
+  return HPCFMT_ERR; // too long
+}
+
+
+static inline int
+hpcfmt_varint_fwrite(uint64_t val, FILE* outfs)
+{
+  while (val >= 0x80) {
+    if (putc((int)((val & 0x7f) | 0x80), outfs) == EOF) {
+      return HPCFMT_ERR;
+    }
+    val >>= 7;
+  }
+  if (putc((int)val, outfs) == EOF) {
+    return HPCFMT_ERR;
+  }
+  return HPCFMT_OK;
+}
+
+
+// hpcfmt_zigzag_encode/decode: Map signed values to unsigned ones so
+// that values of small magnitude, of either sign, make short varints.
+
+static inline uint64_t
+hpcfmt_zigzag_encode(int64_t val)
+{
+  return ((uint64_t)val << 1) ^ (uint64_t)(val >> 63);
+}
+
+
+static inline int64_t
+hpcfmt_zigzag_decode(uint64_t val)
+{
+  return (int64_t)(val >> 1) ^ -(int64_t)(val & 1);
+}
+
+
 //***************************************************************************
 // hpcfmt_str_t
 //***************************************************************************
@@ -105,6 +105,9 @@ typedef struct hpcio_outbuf_s {
   size_t buf_size;
   size_t in_use;
   int  fd;
+  hpcio_outbuf_write_fn_t *sink_write;
+  hpcio_outbuf_close_fn_t *sink_close;
+  void *sink_arg;
   int  flags;
   char use_lock;
   spinlock_t lock;
@@ -177,6 +180,17 @@ outbuf_flush_buffer(hpcio_outbuf_t *outbuf)
 {
   ssize_t amt_done, ret;
 
+  // a sink takes the whole buffer, so flushes keep their boundaries
+  if (outbuf->sink_write != NULL) {
+    if (outbuf->in_use > 0
+	&& outbuf->sink_write(outbuf->sink_arg, outbuf->buf_start,
+			      outbuf->in_use) != (ssize_t) outbuf->in_use) {
+      return HPCFMT_ERR;
+    }
+    outbuf->in_use = 0;
+    return HPCFMT_OK;
+  }
+
   amt_done = 0;
   while (amt_done < outbuf->in_use) {
     errno = 0;
@@ -241,6 +255,55 @@ hpcio_outbuf_attach
   outbuf->buf_size = buf_size;
   outbuf->in_use = 0;
   outbuf->fd = fd;
+  outbuf->sink_write = NULL;
+  outbuf->sink_close = NULL;
+  outbuf->sink_arg = NULL;
+  outbuf->flags = flags;
+  outbuf->use_lock = (flags & HPCIO_OUTBUF_LOCKED);
+  spinlock_unlock(&outbuf->lock);
+
+  *outbuf_ptr = outbuf;
+
+  return HPCFMT_OK;
+}
+
+
+// Like hpcio_outbuf_attach(), but the buffer is flushed by calling
+// 'write_fn' with the whole buffer contents (it must take all of
+// them) and closed by calling 'close_fn', instead of write() and
+// close() on a file descriptor.
+//
+// Returns: HPCFMT_OK on success, else HPCFMT_ERR.
+//
+int
+hpcio_outbuf_attach_sink
+(
+  hpcio_outbuf_t **outbuf_ptr /* out */,
+  hpcio_outbuf_write_fn_t *write_fn,
+  hpcio_outbuf_close_fn_t *close_fn,
+  void *arg,
+  void *buf_start,
+  size_t buf_size,
+  int flags,
+  allocator_t alloc
+)
+{
+  if (outbuf_ptr == NULL || write_fn == NULL || close_fn == NULL
+      || buf_start == NULL || buf_size == 0) {
+    return HPCFMT_ERR;
+  }
+
+  hpcio_outbuf_t *outbuf = outbuf_alloc(alloc);
+
+  outbuf->next = NULL;
+  outbuf->magic = HPCIO_OUTBUF_MAGIC;
+  outbuf->buf_start = buf_start;
+  outbuf->buf_size = buf_size;
+  outbuf->in_use = 0;
+  outbuf->fd = -1;
+  outbuf->sink_write = write_fn;
+  outbuf->sink_close = close_fn;
+  outbuf->sink_arg = arg;
   outbuf->flags = flags;
   outbuf->use_lock = (flags & HPCIO_OUTBUF_LOCKED);
   spinlock_unlock(&outbuf->lock);
@@ -336,10 +399,12 @@ hpcio_outbuf_close(hpcio_outbuf_t **outbuf_ptr)
   }
 
   if (outbuf_flush_buffer(outbuf) == HPCFMT_OK
-      && close(outbuf->fd) == 0) {
+      && (outbuf->sink_close != NULL
+	  ? outbuf->sink_close(outbuf->sink_arg) : close(outbuf->fd)) == 0) {
     // flush and close both succeed
     outbuf->magic = 0;
     outbuf->fd = -1;
+    outbuf->sink_close = NULL;
   }
   else {
     ret = HPCFMT_ERR;
@@ -57,6 +57,11 @@
 
 typedef struct hpcio_outbuf_s hpcio_outbuf_t;
 
+// sink callbacks for hpcio_outbuf_attach_sink()
+
+typedef ssize_t (hpcio_outbuf_write_fn_t)(void *arg, const void *data, size_t size);
+typedef int (hpcio_outbuf_close_fn_t)(void *arg);
+
 //***************************************************************************
 
 // Flags for hpcio_outbuf_attach().
@@ -80,6 +85,20 @@ hpcio_outbuf_attach
 );
 
 
+int
+hpcio_outbuf_attach_sink
+(
+  hpcio_outbuf_t **outbuf /* out */,
+  hpcio_outbuf_write_fn_t *write_fn,
+  hpcio_outbuf_close_fn_t *close_fn,
+  void *arg,
+  void *buf_start,
+  size_t buf_size,
+  int flags,
+  allocator_t alloc
+);
+
+
 ssize_t
 hpcio_outbuf_write
 (
@@ -91,6 +91,7 @@
 //*************************** User Include Files ****************************
 
 #include "hpcio.h"
+#include "hpcrun-container.h"
 
 
 
@@ -141,6 +142,10 @@ FILE*
 hpcio_fopen_r(const char* fnm)
 {
   FILE* fs = fopen(fnm, "r");
+  if (!fs && errno == ENOTDIR) {
+    // a path component is a file: possibly a container stream
+    fs = hpccont_fopen_r(fnm);
+  }
   return fs;
 }
 
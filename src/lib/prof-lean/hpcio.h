@@ -96,7 +96,9 @@ extern "C" {
 // 'overwrite' is 1 any existing file will be overwritten.  For
 // reading, it is an error if the file does not exist.  For any of
 // these errors, or other open errors, NULL is returned; otherwise a
-// non-null FILE pointer is returned.
+// non-null FILE pointer is returned.  hpcio_fopen_r also accepts a
+// stream in a per-process container, '<container>/<stream name>'
+// (see hpcrun-container.h).
 //
 // hpcio_close: Close the file stream.  Returns 0 upon success; 
 // non-zero on error.
@@ -171,6 +173,38 @@ size_t
 hpcio_beX_fwrite(uint8_t* val, size_t size, FILE* fs);
 
 
+//***************************************************************************
+
+// hpcio_beX_get: Returns the 'X'-byte big-endian value stored at
+// 'buf', which need not be aligned.  These are for decoding records
+// that were read in bulk; compilers turn them into a load and a byte
+// swap.
+
+static inline uint16_t
+hpcio_be2_get(const void* buf)
+{
+  const uint8_t* p = (const uint8_t*)buf;
+  return (uint16_t)(((uint16_t)p[0] << 8) | (uint16_t)p[1]);
+}
+
+
+static inline uint32_t
+hpcio_be4_get(const void* buf)
+{
+  const uint8_t* p = (const uint8_t*)buf;
+  return (((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16)
+	  | ((uint32_t)p[2] << 8) | (uint32_t)p[3]);
+}
+
+
+static inline uint64_t
+hpcio_be8_get(const void* buf)
+{
+  const uint8_t* p = (const uint8_t*)buf;
+  return (((uint64_t)hpcio_be4_get(p) << 32) | (uint64_t)hpcio_be4_get(p + 4));
+}
+
+
 //***************************************************************************
 
 #if defined(__cplusplus)
@@ -0,0 +1,856 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Writer and reader for per-process measurement containers.  See
+//   hpcrun-container.h for the file layout.
+//
+// Note: the writer functions run inside hpcrun, possibly from a
+// signal handler (trace flushes), so they use only pwrite() and the
+// client's allocator.  Each stream has a single writer at a time
+// (its thread); the lock only protects extent reservation and the
+// list of streams.
+//
+//***************************************************************************
+
+#define _GNU_SOURCE
+
+//************************* System Include Files ****************************
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+//*************************** User Include Files ****************************
+
+#include "hpcrun-container.h"
+#include "hpcrun-fmt.h"
+#include "spinlock.h"
+#include <include/min-max.h>
+
+
+//***************************************************************************
+// type declarations
+//***************************************************************************
+
+#define ALIGN_UP(x)  ((((x) + HPCCONT_ALIGN - 1) / HPCCONT_ALIGN) * HPCCONT_ALIGN)
+
+typedef struct hpccont_xtnt_s {
+  struct hpccont_xtnt_s *next;
+  uint64_t log_off;
+  uint64_t data_off;
+  uint64_t cap;
+  uint64_t len;
+} hpccont_xtnt_t;
+
+
+struct hpccont_stream_s {
+  struct hpccont_stream_s *next;
+  hpccont_writer_t *w;
+  uint32_t id;
+  int kind;
+  int thread;
+  int closed;
+  uint64_t size;  // logical size
+  uint64_t pos;   // stdio position (hpccont_stream_fopen_w)
+  uint64_t n_extents;
+  hpccont_xtnt_t *head;
+  hpccont_xtnt_t *tail;
+};
+
+
+struct hpccont_writer_s {
+  int fd;
+  allocator_t *alloc;
+  spinlock_t lock;
+  int finished;       // the index starts at next_off
+  uint64_t next_off;  // data offset of the next extent
+  uint32_t n_streams;
+  hpccont_stream_t *head;
+  hpccont_stream_t *tail;
+};
+
+
+//***************************************************************************
+// private operations
+//***************************************************************************
+
+// pwrite() all of 'size' bytes.  Returns: 0 on success.
+static int
+full_pwrite(int fd, const void *data, size_t size, uint64_t off)
+{
+  const char *p = (const char *) data;
+
+  while (size > 0) {
+    errno = 0;
+    ssize_t ret = pwrite(fd, p, size, off);
+    if (ret > 0) {
+      p += ret;
+      off += ret;
+      size -= ret;
+    }
+    else if (! (ret < 0 && errno == EINTR)) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+
+// pread() all of 'size' bytes.  Returns: 0 on success.
+static int
+full_pread(int fd, void *data, size_t size, uint64_t off)
+{
+  char *p = (char *) data;
+
+  while (size > 0) {
+    errno = 0;
+    ssize_t ret = pread(fd, p, size, off);
+    if (ret > 0) {
+      p += ret;
+      off += ret;
+      size -= ret;
+    }
+    else if (ret == 0) {
+      errno = EINVAL;
+      return -1;
+    }
+    else if (errno != EINTR) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+
+// Tag the extent with its final length.
+static int
+extent_finish(hpccont_stream_t *s, hpccont_xtnt_t *xt)
+{
+  hpccont_seg_hdr_t hdr;
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = HPCCONT_SEG_MAGIC;
+  hdr.stream_id = s->id;
+  hdr.log_off = xt->log_off;
+  hdr.length = xt->len;
+
+  return full_pwrite(s->w->fd, &hdr, sizeof(hdr),
+		     xt->data_off - sizeof(hdr));
+}
+
+
+// Reserve a new extent large enough for 'size' bytes and append it
+// to the stream.  The gap before each data offset always has room
+// for the extent's header (see hpccont_writer_attach).
+static hpccont_xtnt_t *
+extent_new(hpccont_stream_t *s, size_t size)
+{
+  hpccont_writer_t *w = s->w;
+  hpccont_xtnt_t *xt = (hpccont_xtnt_t *) w->alloc(sizeof(*xt));
+  if (xt == NULL) {
+    return NULL;
+  }
+
+  uint64_t cap = MAX(ALIGN_UP(size), HPCCONT_EXTENT_SZ);
+
+  spinlock_lock(&w->lock);
+  if (w->finished) {
+    spinlock_unlock(&w->lock);
+    return NULL;
+  }
+  xt->data_off = w->next_off;
+  w->next_off = ALIGN_UP(xt->data_off + cap + sizeof(hpccont_seg_hdr_t));
+  spinlock_unlock(&w->lock);
+
+  xt->next = NULL;
+  xt->log_off = s->size;
+  xt->cap = cap;
+  xt->len = 0;
+
+  if (s->tail) {
+    s->tail->next = xt;
+  }
+  else {
+    s->head = xt;
+  }
+  s->tail = xt;
+  s->n_extents++;
+
+  return xt;
+}
+
+
+//***************************************************************************
+// writer interface
+//***************************************************************************
+
+hpccont_writer_t *
+hpccont_writer_attach(int fd, allocator_t alloc)
+{
+  if (fd < 0 || alloc == NULL) {
+    return NULL;
+  }
+
+  hpccont_file_hdr_t hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, HPCCONT_MAGIC, HPCCONT_MAGIC_LEN);
+  hdr.version = HPCCONT_VERSION;
+  hdr.align = HPCCONT_ALIGN;
+
+  if (full_pwrite(fd, &hdr, sizeof(hdr), 0) != 0) {
+    return NULL;
+  }
+
+  hpccont_writer_t *w = (hpccont_writer_t *) alloc(sizeof(*w));
+  if (w == NULL) {
+    return NULL;
+  }
+  w->fd = fd;
+  w->alloc = alloc;
+  spinlock_init(&w->lock);
+  w->finished = 0;
+  // the first extent's header fits in the tail of the file header's
+  // block
+  w->next_off = HPCCONT_ALIGN;
+  w->n_streams = 0;
+  w->head = NULL;
+  w->tail = NULL;
+
+  return w;
+}
+
+
+hpccont_stream_t *
+hpccont_stream_open(hpccont_writer_t *w, int kind, int thread)
+{
+  if (w == NULL) {
+    return NULL;
+  }
+
+  hpccont_stream_t *s = (hpccont_stream_t *) w->alloc(sizeof(*s));
+  if (s == NULL) {
+    return NULL;
+  }
+  memset(s, 0, sizeof(*s));
+  s->w = w;
+  s->kind = kind;
+  s->thread = thread;
+
+  spinlock_lock(&w->lock);
+  if (w->finished) {
+    spinlock_unlock(&w->lock);
+    return NULL;
+  }
+  s->id = w->n_streams++;
+  if (w->tail) {
+    w->tail->next = s;
+  }
+  else {
+    w->head = s;
+  }
+  w->tail = s;
+  spinlock_unlock(&w->lock);
+
+  return s;
+}
+
+
+ssize_t
+hpccont_stream_write(hpccont_stream_t *s, const void *data, size_t size)
+{
+  if (s == NULL || s->closed) {
+    return -1;
+  }
+  if (size == 0) {
+    return 0;
+  }
+
+  // never split a write: a trace flush holds whole records and an
+  // extent must too
+  hpccont_xtnt_t *xt = s->tail;
+  if (xt == NULL || xt->len + size > xt->cap) {
+    if (xt != NULL && extent_finish(s, xt) != 0) {
+      return -1;
+    }
+    xt = extent_new(s, size);
+    if (xt == NULL) {
+      return -1;
+    }
+  }
+
+  if (full_pwrite(s->w->fd, data, size, xt->data_off + xt->len) != 0) {
+    return -1;
+  }
+  xt->len += size;
+  s->size += size;
+
+  return size;
+}
+
+
+ssize_t
+hpccont_stream_pwrite(hpccont_stream_t *s, const void *data, size_t size,
+		      uint64_t off)
+{
+  if (s == NULL || off + size > s->size) {
+    return -1;
+  }
+
+  const char *p = (const char *) data;
+  size_t done = 0;
+  hpccont_xtnt_t *xt;
+
+  for (xt = s->head; xt != NULL && done < size; xt = xt->next) {
+    uint64_t pos = off + done;
+    if (pos >= xt->log_off + xt->len) {
+      continue;
+    }
+    uint64_t amt = MIN(size - done, xt->log_off + xt->len - pos);
+    if (full_pwrite(s->w->fd, p + done, amt,
+		    xt->data_off + (pos - xt->log_off)) != 0) {
+      return -1;
+    }
+    done += amt;
+  }
+
+  return (done == size) ? (ssize_t) size : -1;
+}
+
+
+int
+hpccont_stream_close(hpccont_stream_t *s)
+{
+  if (s == NULL || s->closed) {
+    return -1;
+  }
+  s->closed = 1;
+
+  return (s->tail != NULL) ? extent_finish(s, s->tail) : 0;
+}
+
+
+static ssize_t
+stream_cookie_write(void *cookie, const char *buf, size_t size)
+{
+  hpccont_stream_t *s = (hpccont_stream_t *) cookie;
+
+  size_t over = MIN(size, s->size - s->pos);
+  if (over > 0 && hpccont_stream_pwrite(s, buf, over, s->pos) < 0) {
+    return 0;
+  }
+  if (size > over && hpccont_stream_write(s, buf + over, size - over) < 0) {
+    return 0;
+  }
+  s->pos += size;
+
+  return size;
+}
+
+
+static int
+stream_cookie_seek(void *cookie, off64_t *offset, int whence)
+{
+  hpccont_stream_t *s = (hpccont_stream_t *) cookie;
+  int64_t pos;
+
+  switch (whence) {
+  case SEEK_SET: pos = *offset; break;
+  case SEEK_CUR: pos = s->pos + *offset; break;
+  case SEEK_END: pos = s->size + *offset; break;
+  default: return -1;
+  }
+  // no holes: a stream is only extended by appending
+  if (pos < 0 || (uint64_t) pos > s->size) {
+    return -1;
+  }
+  s->pos = pos;
+  *offset = pos;
+
+  return 0;
+}
+
+
+static int
+stream_cookie_close(void *cookie)
+{
+  return hpccont_stream_close((hpccont_stream_t *) cookie);
+}
+
+
+FILE *
+hpccont_stream_fopen_w(hpccont_stream_t *s)
+{
+  cookie_io_functions_t io = {
+    .read  = NULL,
+    .write = stream_cookie_write,
+    .seek  = stream_cookie_seek,
+    .close = stream_cookie_close,
+  };
+
+  if (s == NULL) {
+    return NULL;
+  }
+  s->pos = s->size;
+
+  return fopencookie(s, "w", io);
+}
+
+
+int
+hpccont_writer_finish(hpccont_writer_t *w, hpccont_name_fn_t *name_fn,
+		      void *name_arg)
+{
+  if (w == NULL) {
+    return -1;
+  }
+
+  char name[PATH_MAX];
+  int ret = 0;
+
+  // take the streams and the index offset under the lock, then write
+  // the index without it: the stream list only grows at its tail, and
+  // no stream or extent can be added once the writer is finished
+  spinlock_lock(&w->lock);
+  w->finished = 1;
+  uint64_t index_off = w->next_off;
+  hpccont_stream_t *head = w->head;
+  hpccont_stream_t *tail = w->tail;
+  spinlock_unlock(&w->lock);
+
+  uint32_t n_streams = 0;
+  uint64_t off = index_off;
+  hpccont_stream_t *s;
+
+  for (s = head; s != NULL; s = (s == tail) ? NULL : s->next) {
+    if (! s->closed) {
+      // streams of threads that did not finish their own
+      s->closed = 1;
+      if (s->tail != NULL && extent_finish(s, s->tail) != 0) {
+	ret = -1;
+      }
+    }
+
+    if (name_fn(name_arg, s->kind, s->thread, name, sizeof(name)) != 0) {
+      continue;
+    }
+    n_streams++;
+
+    hpccont_stream_rec_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.stream_id = s->id;
+    rec.kind = s->kind;
+    rec.thread = s->thread;
+    rec.name_len = strlen(name);
+    rec.size = s->size;
+    rec.n_extents = s->n_extents;
+
+    if (full_pwrite(w->fd, &rec, sizeof(rec), off) != 0
+	|| full_pwrite(w->fd, name, rec.name_len, off + sizeof(rec)) != 0) {
+      ret = -1;
+      break;
+    }
+    off += sizeof(rec) + rec.name_len;
+
+    hpccont_xtnt_t *xt;
+    for (xt = s->head; xt != NULL; xt = xt->next) {
+      hpccont_extent_t ext = { xt->log_off, xt->data_off, xt->len };
+      if (full_pwrite(w->fd, &ext, sizeof(ext), off) != 0) {
+	ret = -1;
+	break;
+      }
+      off += sizeof(ext);
+    }
+  }
+
+  hpccont_trailer_t trl;
+  memset(&trl, 0, sizeof(trl));
+  trl.index_off = index_off;
+  trl.index_len = off - index_off;
+  trl.n_streams = n_streams;
+  trl.version = HPCCONT_VERSION;
+  memcpy(trl.magic, HPCCONT_MAGIC, HPCCONT_MAGIC_LEN);
+
+  // without a valid index, readers reject the file: write the
+  // trailer only if everything before it made it
+  if (ret == 0 && full_pwrite(w->fd, &trl, sizeof(trl), off) != 0) {
+    ret = -1;
+  }
+  if (close(w->fd) != 0) {
+    ret = -1;
+  }
+  w->fd = -1;
+
+  return ret;
+}
+
+
+//***************************************************************************
+// reader interface
+//***************************************************************************
+
+static int
+container_fail(hpccont_t *c, int err)
+{
+  hpccont_close(c);
+  errno = err;
+  return -1;
+}
+
+
+// Load and check the index.  Returns: 0 on success.
+static int
+container_load(hpccont_t *c)
+{
+  struct stat sb;
+  hpccont_file_hdr_t hdr;
+  hpccont_trailer_t trl;
+
+  if (fstat(c->fd, &sb) != 0 || sb.st_size < (off_t) sizeof(trl)
+      || full_pread(c->fd, &hdr, sizeof(hdr), 0) != 0
+      || full_pread(c->fd, &trl, sizeof(trl), sb.st_size - sizeof(trl)) != 0) {
+    return -1;
+  }
+  if (memcmp(hdr.magic, HPCCONT_MAGIC, HPCCONT_MAGIC_LEN) != 0
+      || hdr.version != HPCCONT_VERSION
+      || memcmp(trl.magic, HPCCONT_MAGIC, HPCCONT_MAGIC_LEN) != 0
+      || trl.version != HPCCONT_VERSION
+      || trl.index_off + trl.index_len + sizeof(trl) != (uint64_t) sb.st_size) {
+    // not a container, or the process did not finish it
+    errno = EINVAL;
+    return -1;
+  }
+
+  char *idx = (char *) malloc(trl.index_len);
+  c->streams = (hpccont_stream_info_t *)
+    calloc(trl.n_streams, sizeof(hpccont_stream_info_t));
+  if (idx == NULL || c->streams == NULL
+      || full_pread(c->fd, idx, trl.index_len, trl.index_off) != 0) {
+    free(idx);
+    return -1;
+  }
+
+  int ret = 0;
+  char *p = idx, *end = idx + trl.index_len;
+  uint32_t i;
+
+  for (i = 0; i < trl.n_streams && ret == 0; i++) {
+    hpccont_stream_rec_t rec;
+    if (p + sizeof(rec) > end) {
+      ret = -1;
+      break;
+    }
+    memcpy(&rec, p, sizeof(rec));
+    p += sizeof(rec);
+
+    uint64_t ext_len = rec.n_extents * sizeof(hpccont_extent_t);
+    if (rec.name_len > (uint64_t)(end - p)
+	|| ext_len > (uint64_t)(end - p - rec.name_len)) {
+      ret = -1;
+      break;
+    }
+
+    hpccont_stream_info_t *si = &c->streams[c->n_streams++];
+    si->name = strndup(p, rec.name_len);
+    si->kind = rec.kind;
+    si->thread = rec.thread;
+    si->size = rec.size;
+    si->n_extents = rec.n_extents;
+    si->extents = (hpccont_extent_t *) malloc(ext_len + 1);
+    if (si->name == NULL || si->extents == NULL) {
+      ret = -1;
+      break;
+    }
+    memcpy(si->extents, p + rec.name_len, ext_len);
+    p += rec.name_len + ext_len;
+
+    // extents must tile the stream and carry matching tags
+    uint64_t log_off = 0, k;
+    for (k = 0; k < si->n_extents && ret == 0; k++) {
+      hpccont_extent_t *e = &si->extents[k];
+      hpccont_seg_hdr_t seg;
+      if (e->log_off != log_off
+	  || e->data_off < sizeof(seg)
+	  || e->data_off + e->length > trl.index_off
+	  || full_pread(c->fd, &seg, sizeof(seg), e->data_off - sizeof(seg)) != 0
+	  || seg.magic != HPCCONT_SEG_MAGIC || seg.stream_id != rec.stream_id
+	  || seg.log_off != e->log_off || seg.length != e->length) {
+	ret = -1;
+      }
+      log_off += e->length;
+    }
+    if (ret == 0 && log_off != si->size) {
+      ret = -1;
+    }
+  }
+
+  free(idx);
+  if (ret != 0) {
+    errno = EINVAL;
+  }
+  return ret;
+}
+
+
+hpccont_t *
+hpccont_open(const char *fnm)
+{
+  hpccont_t *c = (hpccont_t *) calloc(1, sizeof(hpccont_t));
+  if (c == NULL) {
+    return NULL;
+  }
+
+  c->fd = open(fnm, O_RDONLY);
+  if (c->fd < 0 || container_load(c) != 0) {
+    container_fail(c, errno);
+    return NULL;
+  }
+  return c;
+}
+
+
+void
+hpccont_close(hpccont_t *c)
+{
+  if (c == NULL) {
+    return;
+  }
+  uint32_t i;
+  for (i = 0; i < c->n_streams; i++) {
+    free(c->streams[i].name);
+    free(c->streams[i].extents);
+  }
+  free(c->streams);
+  if (c->fd >= 0) {
+    close(c->fd);
+  }
+  free(c);
+}
+
+
+int
+hpccont_find(hpccont_t *c, const char *name)
+{
+  uint32_t i;
+  for (i = 0; i < c->n_streams; i++) {
+    if (strcmp(c->streams[i].name, name) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+
+ssize_t
+hpccont_pread(hpccont_t *c, int idx, void *buf, size_t size, uint64_t off)
+{
+  if (idx < 0 || (uint32_t) idx >= c->n_streams) {
+    errno = EINVAL;
+    return -1;
+  }
+  hpccont_stream_info_t *si = &c->streams[idx];
+  if (off >= si->size) {
+    return 0;
+  }
+  size = MIN(size, si->size - off);
+
+  // binary search for the extent holding 'off'
+  uint64_t lo = 0, hi = si->n_extents;
+  while (hi - lo > 1) {
+    uint64_t mid = (lo + hi) / 2;
+    if (si->extents[mid].log_off <= off) {
+      lo = mid;
+    }
+    else {
+      hi = mid;
+    }
+  }
+
+  char *p = (char *) buf;
+  size_t done = 0;
+  uint64_t k;
+  for (k = lo; k < si->n_extents && done < size; k++) {
+    hpccont_extent_t *e = &si->extents[k];
+    uint64_t pos = off + done;
+    uint64_t amt = MIN(size - done, e->log_off + e->length - pos);
+    if (full_pread(c->fd, p + done, amt, e->data_off + (pos - e->log_off)) != 0) {
+      return -1;
+    }
+    done += amt;
+  }
+
+  return done;
+}
+
+
+const char *
+hpccont_split_path(const char *path, char *cont, size_t cont_len)
+{
+  static const char *sfx = HPCRUN_ContainerFnmSfx;
+  size_t sfx_len = strlen(sfx);
+
+  const char *slash = strrchr(path, '/');
+  if (slash == NULL || slash[1] == '\0') {
+    return NULL;
+  }
+
+  size_t len = slash - path;
+  if (len < sfx_len + 1 || len >= cont_len
+      || path[len - sfx_len - 1] != '.'
+      || strncmp(path + len - sfx_len, sfx, sfx_len) != 0) {
+    return NULL;
+  }
+  memcpy(cont, path, len);
+  cont[len] = '\0';
+
+  return slash + 1;
+}
+
+
+typedef struct stream_reader_s {
+  hpccont_t *c;
+  int idx;
+  uint64_t pos;
+} stream_reader_t;
+
+
+static ssize_t
+reader_cookie_read(void *cookie, char *buf, size_t size)
+{
+  stream_reader_t *r = (stream_reader_t *) cookie;
+
+  ssize_t ret = hpccont_pread(r->c, r->idx, buf, size, r->pos);
+  if (ret > 0) {
+    r->pos += ret;
+  }
+  return ret;
+}
+
+
+static int
+reader_cookie_seek(void *cookie, off64_t *offset, int whence)
+{
+  stream_reader_t *r = (stream_reader_t *) cookie;
+  int64_t pos;
+
+  switch (whence) {
+  case SEEK_SET: pos = *offset; break;
+  case SEEK_CUR: pos = r->pos + *offset; break;
+  case SEEK_END: pos = r->c->streams[r->idx].size + *offset; break;
+  default: return -1;
+  }
+  if (pos < 0) {
+    return -1;
+  }
+  r->pos = pos;
+  *offset = pos;
+
+  return 0;
+}
+
+
+static int
+reader_cookie_close(void *cookie)
+{
+  stream_reader_t *r = (stream_reader_t *) cookie;
+
+  hpccont_close(r->c);
+  free(r);
+  return 0;
+}
+
+
+FILE *
+hpccont_fopen_r(const char *path)
+{
+  char cont[PATH_MAX];
+  const char *name = hpccont_split_path(path, cont, sizeof(cont));
+  if (name == NULL) {
+    errno = ENOENT;
+    return NULL;
+  }
+
+  hpccont_t *c = hpccont_open(cont);
+  if (c == NULL) {
+    return NULL;
+  }
+  int idx = hpccont_find(c, name);
+  stream_reader_t *r = (stream_reader_t *) malloc(sizeof(stream_reader_t));
+  if (idx < 0 || r == NULL) {
+    free(r);
+    hpccont_close(c);
+    errno = ENOENT;
+    return NULL;
+  }
+  r->c = c;
+  r->idx = idx;
+  r->pos = 0;
+
+  cookie_io_functions_t io = {
+    .read  = reader_cookie_read,
+    .write = NULL,
+    .seek  = reader_cookie_seek,
+    .close = reader_cookie_close,
+  };
+
+  FILE *fs = fopencookie(r, "r", io);
+  if (fs == NULL) {
+    reader_cookie_close(r);
+  }
+  return fs;
+}
@@ -0,0 +1,277 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   A per-process measurement container: one file into which all
+//   threads of a process append their profile and trace streams,
+//   instead of one .hpcrun and one .hpctrace file per thread.
+//
+// Description:
+//   The file is a sequence of aligned extents.  Each stream reserves
+//   extents of at least HPCCONT_EXTENT_SZ bytes and fills them with
+//   its own writes; a write is never split across two extents, so
+//   that a trace extent always holds whole records and can be mapped
+//   in place.  Each extent is preceded by a small tagged header
+//   (stream id, logical offset, length) in the tail of the previous
+//   alignment block.  When the process ends, an index of all streams
+//   (name, kind, thread, size, extents) is appended, followed by a
+//   fixed-size trailer that locates the index.
+//
+//     [file hdr ... seg hdr][extent data ... seg hdr][extent ...]
+//     ... [index][trailer]
+//
+//   A stream is named by the basename its per-thread file would have
+//   had, and readers address it as '<container>/<stream name>'.  All
+//   fields are written in the host byte order; readers reject files
+//   whose magic numbers do not match.
+//
+//   The writer half runs inside hpcrun: it must not use malloc or
+//   stdio (except hpccont_stream_fopen_w, which is only used where
+//   hpcrun already uses stdio) and takes a client allocator.  The
+//   reader half is for the analysis tools and uses malloc.
+//
+//***************************************************************************
+
+#ifndef prof_lean_hpcrun_container_h
+#define prof_lean_hpcrun_container_h
+
+//************************* System Include Files ****************************
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <stdio.h>
+
+//*************************** User Include Files ****************************
+
+#include "allocator.h"
+
+//*************************** Forward Declarations **************************
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+//***************************************************************************
+// format
+//***************************************************************************
+
+#define HPCCONT_MAGIC        "HPCCONT_"
+#define HPCCONT_MAGIC_LEN    8
+#define HPCCONT_VERSION      1
+
+#define HPCCONT_SEG_MAGIC    0x53454731   // 'SEG1'
+
+#define HPCCONT_ALIGN        65536  // the largest common page size
+#define HPCCONT_EXTENT_SZ    (4 * 1024 * 1024)
+
+typedef enum {
+  HPCCONT_STREAM_PROFILE = 1,
+  HPCCONT_STREAM_TRACE   = 2,
+} hpccont_kind_t;
+
+
+typedef struct hpccont_file_hdr_s {
+  char     magic[HPCCONT_MAGIC_LEN];
+  uint32_t version;
+  uint32_t align;
+} hpccont_file_hdr_t;
+
+
+// Written at (extent data offset - sizeof(hpccont_seg_hdr_t)).
+typedef struct hpccont_seg_hdr_s {
+  uint32_t magic;
+  uint32_t stream_id;
+  uint64_t log_off;
+  uint64_t length;
+  uint64_t reserved;
+} hpccont_seg_hdr_t;
+
+
+// Index, one per stream: this record, the name (name_len bytes, no
+// NUL), then n_extents hpccont_extent_t in logical order.
+typedef struct hpccont_stream_rec_s {
+  uint32_t stream_id;
+  uint32_t kind;
+  int32_t  thread;
+  uint32_t name_len;
+  uint64_t size;
+  uint64_t n_extents;
+} hpccont_stream_rec_t;
+
+
+typedef struct hpccont_extent_s {
+  uint64_t log_off;
+  uint64_t data_off;
+  uint64_t length;
+} hpccont_extent_t;
+
+
+// Last bytes of a finished container.
+typedef struct hpccont_trailer_s {
+  uint64_t index_off;
+  uint64_t index_len;
+  uint32_t n_streams;
+  uint32_t version;
+  char     magic[HPCCONT_MAGIC_LEN];
+} hpccont_trailer_t;
+
+
+//***************************************************************************
+// writer (hpcrun)
+//***************************************************************************
+
+typedef struct hpccont_writer_s hpccont_writer_t;
+typedef struct hpccont_stream_s hpccont_stream_t;
+
+// Formats the final name of a stream into 'buf' (at most 'len'
+// bytes, including the NUL).  Returns: 0 on success, else nonzero to
+// leave the stream out of the index.
+typedef int (hpccont_name_fn_t)(void *arg, int kind, int thread,
+				char *buf, size_t len);
+
+// Attach a writer to 'fd' (an empty file) and write the file header.
+// Returns: writer, or NULL on failure.
+hpccont_writer_t *
+hpccont_writer_attach(int fd, allocator_t alloc);
+
+// Start a new stream.  Returns: stream, or NULL on failure or if the
+// writer is finished.
+hpccont_stream_t *
+hpccont_stream_open(hpccont_writer_t *w, int kind, int thread);
+
+// Append to the stream.  Returns: 'size', or -1 on failure.
+ssize_t
+hpccont_stream_write(hpccont_stream_t *s, const void *data, size_t size);
+
+// Overwrite bytes that were already appended (e.g. patching a header
+// field).  Returns: 'size', or -1 on failure or if the range extends
+// past the end of the stream.
+ssize_t
+hpccont_stream_pwrite(hpccont_stream_t *s, const void *data, size_t size,
+		      uint64_t off);
+
+// Finish the current extent of the stream.  The stream stays in the
+// index; further writes are an error.  Returns: 0 on success.
+int
+hpccont_stream_close(hpccont_stream_t *s);
+
+// A write-only stdio stream on 's' (glibc fopencookie), with fseek
+// and ftell support so that callers can patch what they wrote.
+// fclose() closes 's'.
+FILE *
+hpccont_stream_fopen_w(hpccont_stream_t *s);
+
+// Finish all streams, append the index and trailer, and close the
+// file descriptor.  New streams and extents are refused from then on;
+// the index is written without holding the writer's lock.  Returns: 0
+// on success.
+int
+hpccont_writer_finish(hpccont_writer_t *w, hpccont_name_fn_t *name_fn,
+		      void *name_arg);
+
+
+//***************************************************************************
+// reader (hpcprof, hpcprof-mpi, hpcproftt, hpcserver)
+//***************************************************************************
+
+typedef struct hpccont_stream_info_s {
+  char *name;
+  int kind;
+  int thread;
+  uint64_t size;
+  uint64_t n_extents;
+  hpccont_extent_t *extents;
+} hpccont_stream_info_t;
+
+
+typedef struct hpccont_s {
+  int fd;
+  uint32_t n_streams;
+  hpccont_stream_info_t *streams;
+} hpccont_t;
+
+
+// Open a finished container and load its index.  Returns: container,
+// or NULL (with errno set) if 'fnm' cannot be read or is not a
+// complete container.
+hpccont_t *
+hpccont_open(const char *fnm);
+
+void
+hpccont_close(hpccont_t *c);
+
+// Returns: index of the stream named 'name', or -1.
+int
+hpccont_find(hpccont_t *c, const char *name);
+
+// Read from a stream at logical offset 'off'.  Returns: number of
+// bytes read (short at the end of the stream), or -1 on failure.
+ssize_t
+hpccont_pread(hpccont_t *c, int idx, void *buf, size_t size, uint64_t off);
+
+// Split a path of the form '<dir>/<name>.hpccontainer/<stream>' into
+// the container path (copied into 'cont') and the stream name.
+// Returns: the stream name (pointing into 'path'), or NULL if 'path'
+// does not name a stream in a container.
+const char *
+hpccont_split_path(const char *path, char *cont, size_t cont_len);
+
+// A read-only stdio stream on a stream path (see
+// hpccont_split_path).  Returns: stream, or NULL.
+FILE *
+hpccont_fopen_r(const char *path);
+
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // prof_lean_hpcrun_container_h
@@ -616,10 +616,136 @@ hpcrun_fmt_loadmapEntry_free(loadmap_entry_t* x, hpcfmt_free_fn dealloc)
 // cct
 //***************************************************************************
 
- int
-hpcrun_fmt_cct_node_fread(hpcrun_fmt_cct_node_t* x,
-			  epoch_flags_t flags, FILE* fs)
+// Compact records (epoch_flags_t.isCompactCCT) hold, in order:
+//   - the parent id, as a zigzag varint of its difference from the
+//     previous record's id
+//   - the id, as a varint of (zigzag(|id| - |id_parent|) << 1 | leaf),
+//     where 'leaf' is set for the negative ids of leaves
+//   - if logical unwinding: the assoc info, as a varint
+//   - the load module id, as a varint
+//   - the lm_ip, as a zigzag varint of its difference from the previous
+//     record's lm_ip
+//   - if logical unwinding: the lip, as in fixed-width records
+//   - a bitmap of the non-zero metrics, ceil(num_metrics / 8) bytes
+//     with metric i in bit (i % 8) of byte (i / 8), followed by each
+//     non-zero value as 8 big-endian bytes
+
+static int64_t
+cct_id_abs(int32_t id)
 {
+  return (id < 0) ? -(int64_t)id : (int64_t)id;
+}
+
+
+static int
+cct_node_fread_compact(hpcrun_fmt_cct_node_t* x, epoch_flags_t flags,
+		       hpcrun_fmt_cct_prev_t* prev, FILE* fs)
+{
+  uint64_t v;
+
+  HPCFMT_ThrowIfError(hpcfmt_varint_fread(&v, fs));
+  int64_t parent = (int64_t)(int32_t)prev->id + hpcfmt_zigzag_decode(v);
+  x->id_parent = (uint32_t)parent;
+
+  HPCFMT_ThrowIfError(hpcfmt_varint_fread(&v, fs));
+  int64_t id = cct_id_abs((int32_t)x->id_parent)
+    + hpcfmt_zigzag_decode(v >> 1);
+  x->id = (uint32_t)((v & 1) ? -id : id);
+
+  x->as_info = lush_assoc_info_NULL;
+  if (flags.fields.isLogicalUnwind) {
+    HPCFMT_ThrowIfError(hpcfmt_varint_fread(&v, fs));
+    x->as_info.bits = (uint32_t)v;
+  }
+
+  HPCFMT_ThrowIfError(hpcfmt_varint_fread(&v, fs));
+  x->lm_id = (uint16_t)v;
+
+  HPCFMT_ThrowIfError(hpcfmt_varint_fread(&v, fs));
+  x->lm_ip = prev->lm_ip + (uint64_t)hpcfmt_zigzag_decode(v);
+
+  lush_lip_init(&x->lip);
+  if (flags.fields.isLogicalUnwind) {
+    HPCFMT_ThrowIfError(hpcrun_fmt_lip_fread(&x->lip, fs));
+  }
+
+  int bitmapSz = (x->num_metrics + 7) / 8;
+  uint8_t bitmap[bitmapSz + 1];
+  if (bitmapSz > 0 && fread(bitmap, 1, bitmapSz, fs) != (size_t)bitmapSz) {
+    return HPCFMT_ERR;
+  }
+  for (int i = 0; i < x->num_metrics; ++i) {
+    x->metrics[i].bits = 0;
+    if (bitmap[i / 8] & (1 << (i % 8))) {
+      HPCFMT_ThrowIfError(hpcfmt_int8_fread(&x->metrics[i].bits, fs));
+    }
+  }
+
+  prev->id = x->id;
+  prev->lm_ip = x->lm_ip;
+
+  return HPCFMT_OK;
+}
+
+
+static int
+cct_node_fwrite_compact(hpcrun_fmt_cct_node_t* x, epoch_flags_t flags,
+			hpcrun_fmt_cct_prev_t* prev, FILE* fs)
+{
+  int64_t parent = (int64_t)(int32_t)x->id_parent;
+  int64_t dParent = parent - (int64_t)(int32_t)prev->id;
+  HPCFMT_ThrowIfError(hpcfmt_varint_fwrite(hpcfmt_zigzag_encode(dParent), fs));
+
+  int32_t id = (int32_t)x->id;
+  int64_t dId = cct_id_abs(id) - cct_id_abs((int32_t)parent);
+  uint64_t v = (hpcfmt_zigzag_encode(dId) << 1) | (id < 0 ? 1 : 0);
+  HPCFMT_ThrowIfError(hpcfmt_varint_fwrite(v, fs));
+
+  if (flags.fields.isLogicalUnwind) {
+    HPCFMT_ThrowIfError(hpcfmt_varint_fwrite(x->as_info.bits, fs));
+  }
+
+  HPCFMT_ThrowIfError(hpcfmt_varint_fwrite(x->lm_id, fs));
+
+  int64_t dIp = (int64_t)(x->lm_ip - prev->lm_ip);
+  HPCFMT_ThrowIfError(hpcfmt_varint_fwrite(hpcfmt_zigzag_encode(dIp), fs));
+
+  if (flags.fields.isLogicalUnwind) {
+    HPCFMT_ThrowIfError(hpcrun_fmt_lip_fwrite(&x->lip, fs));
+  }
+
+  int bitmapSz = (x->num_metrics + 7) / 8;
+  uint8_t bitmap[bitmapSz + 1];
+  memset(bitmap, 0, bitmapSz);
+  for (int i = 0; i < x->num_metrics; ++i) {
+    if (x->metrics[i].bits != 0) {
+      bitmap[i / 8] |= (uint8_t)(1 << (i % 8));
+    }
+  }
+  if (bitmapSz > 0 && fwrite(bitmap, 1, bitmapSz, fs) != (size_t)bitmapSz) {
+    return HPCFMT_ERR;
+  }
+  for (int i = 0; i < x->num_metrics; ++i) {
+    if (x->metrics[i].bits != 0) {
+      HPCFMT_ThrowIfError(hpcfmt_int8_fwrite(x->metrics[i].bits, fs));
+    }
+  }
+
+  prev->id = x->id;
+  prev->lm_ip = x->lm_ip;
+
+  return HPCFMT_OK;
+}
+
+
+int
+hpcrun_fmt_cct_node_fread(hpcrun_fmt_cct_node_t* x, epoch_flags_t flags,
+			  hpcrun_fmt_cct_prev_t* prev, FILE* fs)
+{
+  if (flags.fields.isCompactCCT) {
+    return cct_node_fread_compact(x, flags, prev, fs);
+  }
+
   HPCFMT_ThrowIfError(hpcfmt_int4_fread(&x->id, fs));
   HPCFMT_ThrowIfError(hpcfmt_int4_fread(&x->id_parent, fs));
 
@@ -645,9 +771,13 @@ hpcrun_fmt_cct_node_fread(hpcrun_fmt_cct_node_t* x,
 
 
 int
-hpcrun_fmt_cct_node_fwrite(hpcrun_fmt_cct_node_t* x,
-			   epoch_flags_t flags, FILE* fs)
+hpcrun_fmt_cct_node_fwrite(hpcrun_fmt_cct_node_t* x, epoch_flags_t flags,
+			   hpcrun_fmt_cct_prev_t* prev, FILE* fs)
 {
+  if (flags.fields.isCompactCCT) {
+    return cct_node_fwrite_compact(x, flags, prev, fs);
+  }
+
   HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(x->id, fs));
   HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(x->id_parent, fs));
 
@@ -670,6 +800,56 @@ hpcrun_fmt_cct_node_fwrite(hpcrun_fmt_cct_node_t* x,
 }
 
 
+size_t
+hpcrun_fmt_cct_node_sizeof(epoch_flags_t flags, int num_metrics)
+{
+  size_t sz = sizeof(uint32_t) + sizeof(uint32_t)   // id, id_parent
+    + sizeof(uint16_t) + sizeof(uint64_t)            // lm_id, lm_ip
+    + num_metrics * sizeof(uint64_t);
+
+  if (flags.fields.isLogicalUnwind) {
+    sz += sizeof(uint32_t) + LUSH_LIP_DATA8_SZ * sizeof(uint64_t);
+  }
+  return sz;
+}
+
+
+void
+hpcrun_fmt_cct_node_decode(hpcrun_fmt_cct_node_t* x,
+			   epoch_flags_t flags, const char* buf)
+{
+  x->id = hpcio_be4_get(buf);
+  buf += sizeof(uint32_t);
+  x->id_parent = hpcio_be4_get(buf);
+  buf += sizeof(uint32_t);
+
+  x->as_info = lush_assoc_info_NULL;
+  if (flags.fields.isLogicalUnwind) {
+    x->as_info.bits = hpcio_be4_get(buf);
+    buf += sizeof(uint32_t);
+  }
+
+  x->lm_id = hpcio_be2_get(buf);
+  buf += sizeof(uint16_t);
+  x->lm_ip = hpcio_be8_get(buf);
+  buf += sizeof(uint64_t);
+
+  lush_lip_init(&x->lip);
+  if (flags.fields.isLogicalUnwind) {
+    for (int i = 0; i < LUSH_LIP_DATA8_SZ; ++i) {
+      x->lip.data8[i] = hpcio_be8_get(buf);
+      buf += sizeof(uint64_t);
+    }
+  }
+
+  // a plain loop over the values so that the byte swaps vectorize
+  hpcrun_metricVal_t* metrics = x->metrics;
+  for (int i = 0; i < x->num_metrics; ++i) {
+    metrics[i].bits = hpcio_be8_get(buf + i * sizeof(uint64_t));
+  }
+}
+
+
 int
 hpcrun_fmt_cct_node_fprint(hpcrun_fmt_cct_node_t* x, FILE* fs,
 			   epoch_flags_t flags, const metric_tbl_t* metricTbl,
@@ -905,11 +1085,9 @@ hpctrace_fmt_datum_fread(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
 // Append the trace record to the outbuf.
 // Returns: HPCFMT_OK on success, else HPCFMT_ERR.
 int
-hpctrace_fmt_datum_outbuf(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
-			  hpcio_outbuf_t* outbuf)
+hpctrace_fmt_datum_encode(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
+			  unsigned char* buf)
 {
-  const int bufSZ = sizeof(hpctrace_fmt_datum_t);
-  unsigned char buf[bufSZ];
   int shift, k;
 
   k = 0;
@@ -933,6 +1111,18 @@ hpctrace_fmt_datum_outbuf(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
       k++;
     }
   }
+
+  return k;
+}
+
+
+int
+hpctrace_fmt_datum_outbuf(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
+			  hpcio_outbuf_t* outbuf)
+{
+  unsigned char buf[sizeof(hpctrace_fmt_datum_t)];
+
+  int k = hpctrace_fmt_datum_encode(x, flags, buf);
   
   if (hpcio_outbuf_write(outbuf, buf, k) != k) {
     return HPCFMT_ERR;
@@ -1002,16 +1192,30 @@ hpcmetricDB_fmt_hdr_fread(hpcmetricDB_fmt_hdr_t* hdr, FILE* infs)
   if (nr != HPCMETRICDB_FMT_VersionLen) {
     return HPCFMT_ERR;
   }
+  strcpy(hdr->versionStr, version);
   hdr->version = atof(hdr->versionStr);
 
   nr = fread(&endian, 1, HPCMETRICDB_FMT_EndianLen, infs);
   if (nr != HPCMETRICDB_FMT_EndianLen) {
     return HPCFMT_ERR;
   }
+  hdr->endian = endian[0];
 
   HPCFMT_ThrowIfError(hpcfmt_int4_fread(&(hdr->numNodes), infs));
   HPCFMT_ThrowIfError(hpcfmt_int4_fread(&(hdr->numMetrics), infs));
 
+  hdr->layout = HPCMETRICDB_Layout_Row;
+  hdr->blockNodes = 0;
+  if (strcmp(version, HPCMETRICDB_FMT_VersionBlocked) == 0) {
+    uint32_t reserved;
+    hdr->layout = HPCMETRICDB_Layout_Blocked;
+    HPCFMT_ThrowIfError(hpcfmt_int4_fread(&(hdr->blockNodes), infs));
+    HPCFMT_ThrowIfError(hpcfmt_int4_fread(&reserved, infs));
+    if (hdr->blockNodes == 0) {
+      return HPCFMT_ERR;
+    }
+  }
+
   return HPCFMT_OK;
 }
 
@@ -1024,7 +1228,11 @@ hpcmetricDB_fmt_hdr_fwrite(hpcmetricDB_fmt_hdr_t* hdr, FILE* outfs)
   nw = fwrite(HPCMETRICDB_FMT_Magic,   1, HPCMETRICDB_FMT_MagicLen, outfs);
   if (nw != HPCTRACE_FMT_MagicLen) return HPCFMT_ERR;
 
-  nw = fwrite(HPCMETRICDB_FMT_Version, 1, HPCMETRICDB_FMT_VersionLen, outfs);
+  int isBlocked = (hdr->layout == HPCMETRICDB_Layout_Blocked);
+  const char* version = (isBlocked) ? HPCMETRICDB_FMT_VersionBlocked
+                                    : HPCMETRICDB_FMT_Version;
+
+  nw = fwrite(version, 1, HPCMETRICDB_FMT_VersionLen, outfs);
   if (nw != HPCMETRICDB_FMT_VersionLen) return HPCFMT_ERR;
 
   nw = fwrite(HPCMETRICDB_FMT_Endian,  1, HPCMETRICDB_FMT_EndianLen, outfs);
@@ -1033,6 +1241,11 @@ hpcmetricDB_fmt_hdr_fwrite(hpcmetricDB_fmt_hdr_t* hdr, FILE* outfs)
   HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(hdr->numNodes, outfs));
   HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(hdr->numMetrics, outfs));
 
+  if (isBlocked) {
+    HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(hdr->blockNodes, outfs));
+    HPCFMT_ThrowIfError(hpcfmt_int4_fwrite(0, outfs)); // reserved
+  }
+
   return HPCFMT_OK;
 }
 
@@ -1045,7 +1258,168 @@ hpcmetricDB_fmt_hdr_fprint(hpcmetricDB_fmt_hdr_t* hdr, FILE* outfs)
 
   fprintf(outfs, "(num-nodes:   %u)\n", hdr->numNodes);
   fprintf(outfs, "(num-metrics: %u)\n", hdr->numMetrics);
+  if (hdr->layout == HPCMETRICDB_Layout_Blocked) {
+    fprintf(outfs, "(layout:      blocked, %u nodes/block)\n", hdr->blockNodes);
+  }
 
   return HPCFMT_OK;
 }
 
+
+
+//***************************************************************************
+// unit test
+//***************************************************************************
+
+#define UNIT_TEST 0
+
+#if UNIT_TEST
+
+// round trip of compact cct node records: write a sequence of records
+// that exercises the deltas and the metric bitmap, read it back, and
+// compare.
+//
+// build (from src, with include/hpctoolkit-config.h from a configured
+// tree) after changing UNIT_TEST above to 1:
+//
+//   cc -std=gnu99 -I. lib/prof-lean/hpcrun-fmt.c lib/prof-lean/hpcfmt.c
+//      lib/prof-lean/hpcio.c lib/prof-lean/hpcio-buffer.c
+//      lib/prof-lean/hpcrun-container.c lib/prof-lean/lush/lush-support.c
+
+#include <assert.h>
+
+#define TEST_NUM_METRICS 10
+
+typedef struct {
+  int32_t id;
+  int32_t id_parent;
+  uint16_t lm_id;
+  hpcfmt_vma_t lm_ip;
+  uint64_t metric0;
+  uint64_t metric9;
+} test_record_t;
+
+static const test_record_t test_records[] = {
+  // the synthetic roots, with all metrics zero
+  { 1, HPCRUN_FMT_CCTNodeId_NULL, HPCRUN_FMT_LMId_NULL,
+    HPCRUN_FMT_LMIp_NULL, 0, 0 },
+  { 2, HPCRUN_FMT_CCTNodeId_NULL, HPCRUN_FMT_LMId_NULL,
+    HPCRUN_FMT_LMIp_Flag1, 0, 0 },
+
+  // interior nodes, leaves with negative ids, and the metric bitmap
+  // split over two bytes
+  { 3, 1, 1, 0x400a10, 0, 0 },
+  { -4, 3, 1, 0x400a28, 7, 0 },
+  { -5, 3, 1, 0x4009f0, 0, 0x3ff0000000000000 },
+  { 6, 1, 2, 0x1000, 1, 1 },
+
+  // large deltas: ids near the ends of the 32-bit range, and load
+  // module offsets far apart in both directions
+  { 0x7ffffff0, 6, 2, 0xfffffffffffff000, 0, 0 },
+  { -0x7fffffff, 0x7ffffff0, 65535, 0x10, 0x8000000000000000, 0 },
+  { -8, 0x7ffffff0, 3, 0x7fffffffffffffff, 0, 0xffffffffffffffff },
+  { 9, 1, 3, 0x7fffffffffffffff, 0, 0 },
+};
+
+#define TEST_NUM_RECORDS (sizeof(test_records) / sizeof(test_records[0]))
+
+
+static void
+test_record_set(hpcrun_fmt_cct_node_t* x, const test_record_t* r,
+		hpcrun_metricVal_t* metrics, int num_metrics)
+{
+  hpcrun_fmt_cct_node_init(x);
+  x->id = (uint32_t)r->id;
+  x->id_parent = (uint32_t)r->id_parent;
+  x->as_info.bits = (uint32_t)r->id * 3;
+  x->lm_id = r->lm_id;
+  x->lm_ip = r->lm_ip;
+  x->lip.data8[0] = r->lm_ip;
+  x->lip.data8[1] = (uint64_t)r->id;
+  x->num_metrics = num_metrics;
+  x->metrics = metrics;
+  for (int i = 0; i < num_metrics; ++i) {
+    metrics[i].bits = 0;
+  }
+  if (num_metrics > 0) {
+    metrics[0].bits = r->metric0;
+    metrics[num_metrics - 1].bits = r->metric9;
+  }
+}
+
+
+static void
+test_round_trip(bool isLogicalUnwind, int num_metrics)
+{
+  epoch_flags_t flags;
+  flags.bits = 0;
+  flags.fields.isCompactCCT = true;
+  flags.fields.isLogicalUnwind = isLogicalUnwind;
+
+  FILE* fs = tmpfile();
+  assert(fs != NULL);
+
+  hpcrun_metricVal_t metrics[TEST_NUM_METRICS];
+  hpcrun_fmt_cct_node_t x;
+  hpcrun_fmt_cct_prev_t prev;
+
+  hpcrun_fmt_cct_prev_init(&prev);
+  for (int i = 0; i < TEST_NUM_RECORDS; ++i) {
+    test_record_set(&x, &test_records[i], metrics, num_metrics);
+    int ret = hpcrun_fmt_cct_node_fwrite(&x, flags, &prev, fs);
+    assert(ret == HPCFMT_OK);
+  }
+
+  long compactSz = ftell(fs);
+  rewind(fs);
+
+  hpcrun_metricVal_t expected[TEST_NUM_METRICS];
+  hpcrun_fmt_cct_node_t y;
+
+  hpcrun_fmt_cct_prev_init(&prev);
+  for (int i = 0; i < TEST_NUM_RECORDS; ++i) {
+    test_record_set(&x, &test_records[i], expected, num_metrics);
+
+    hpcrun_fmt_cct_node_init(&y);
+    y.num_metrics = num_metrics;
+    y.metrics = metrics;
+    int ret = hpcrun_fmt_cct_node_fread(&y, flags, &prev, fs);
+    assert(ret == HPCFMT_OK);
+
+    assert(y.id == x.id);
+    assert(y.id_parent == x.id_parent);
+    assert(y.lm_id == x.lm_id);
+    assert(y.lm_ip == x.lm_ip);
+    if (isLogicalUnwind) {
+      assert(y.as_info.bits == x.as_info.bits);
+      assert(lush_lip_eq(&y.lip, &x.lip));
+    }
+    for (int j = 0; j < num_metrics; ++j) {
+      assert(y.metrics[j].bits == x.metrics[j].bits);
+    }
+  }
+  assert(fgetc(fs) == EOF);
+  fclose(fs);
+
+  epoch_flags_t fixedFlags = flags;
+  fixedFlags.fields.isCompactCCT = false;
+  size_t fixedSz = TEST_NUM_RECORDS *
+    hpcrun_fmt_cct_node_sizeof(fixedFlags, num_metrics);
+  printf("logical unwind %d, %2d metrics: %4ld bytes (fixed width: %4zu)\n",
+	 isLogicalUnwind, num_metrics, compactSz, fixedSz);
+}
+
+
+int
+main(int argc, char* argv[])
+{
+  test_round_trip(false, 0);
+  test_round_trip(false, 1);
+  test_round_trip(false, TEST_NUM_METRICS);
+  test_round_trip(true, 0);
+  test_round_trip(true, TEST_NUM_METRICS);
+  printf("passed\n");
+  return 0;
+}
+
+#endif
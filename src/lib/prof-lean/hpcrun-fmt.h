@@ -98,6 +98,9 @@ static const char HPCRUN_TraceFnmSfx[] = "hpctrace";
 // hpcrun log filename suffix
 static const char HPCRUN_LogFnmSfx[] = "log";
 
+// hpcrun per-process container filename suffix (see hpcrun-container.h)
+static const char HPCRUN_ContainerFnmSfx[] = "hpccontainer";
+
 // hpcprof metric db filename suffix
 static const char HPCPROF_MetricDBSfx[] = "metric-db";
 
@@ -175,9 +178,12 @@ static const char HPCRUN_FMT_EpochTag[] = "EPOCH___";
 static const int  HPCRUN_FMT_EpochTagLen = (sizeof(HPCRUN_FMT_EpochTag) - 1);
 
 
+// isCompactCCT: CCT node records use the compact encoding (see
+// hpcrun_fmt_cct_node_fwrite) instead of fixed-width fields.
 typedef struct epoch_flags_bitfield {
   bool isLogicalUnwind : 1;
-  uint64_t unused      : 63;
+  bool isCompactCCT    : 1;
+  uint64_t unused      : 62;
 } epoch_flags_bitfield;
 
 
@@ -221,6 +227,18 @@ extern void
 hpcrun_fmt_epochHdr_free(hpcrun_fmt_epochHdr_t* ehdr, hpcfmt_free_fn dealloc);
 
 
+// hpcrun's own overhead for the thread, cumulative up to the point the
+// epoch was written.  'stats' is a list of "name=count" words; each
+// latency value is "count=N cycles=N hist=b0,b1,..." where bucket i
+// counts events that took [2^i, 2^(i+1)) cycles (bucket 0 also holds
+// 0).  Trailing empty buckets are omitted.
+#define HPCRUN_FMT_NV_stats          "hpcrun-stats"
+#define HPCRUN_FMT_NV_latHandler     "hpcrun-latency-handler"
+#define HPCRUN_FMT_NV_latUnwind      "hpcrun-latency-unwind"
+#define HPCRUN_FMT_NV_latCCTInsert   "hpcrun-latency-cct-insert"
+#define HPCRUN_FMT_NV_latTraceAppend "hpcrun-latency-trace-append"
+
+
 //***************************************************************************
 // metric-tbl
 //***************************************************************************
@@ -550,14 +568,48 @@ hpcrun_fmt_cct_node_init(hpcrun_fmt_cct_node_t* x)
 }
 
 
+// hpcrun_fmt_cct_prev_t: A compact CCT node record (see
+// epoch_flags_t) is encoded relative to the record before it in its
+// CCT section.  Readers and writers keep one of these per section,
+// initialized with hpcrun_fmt_cct_prev_init(), and pass it to every
+// hpcrun_fmt_cct_node_fread/fwrite.  It may be NULL for fixed-width
+// records.
+typedef struct hpcrun_fmt_cct_prev_t {
+  uint32_t id;
+  hpcfmt_vma_t lm_ip;
+} hpcrun_fmt_cct_prev_t;
+
+static inline void
+hpcrun_fmt_cct_prev_init(hpcrun_fmt_cct_prev_t* x)
+{
+  x->id = HPCRUN_FMT_CCTNodeId_NULL;
+  x->lm_ip = HPCRUN_FMT_LMIp_NULL;
+}
+
+
 // N.B.: assumes space for metrics has been allocated
 extern int
-hpcrun_fmt_cct_node_fread(hpcrun_fmt_cct_node_t* x,
-			  epoch_flags_t flags, FILE* fs);
+hpcrun_fmt_cct_node_fread(hpcrun_fmt_cct_node_t* x, epoch_flags_t flags,
+			  hpcrun_fmt_cct_prev_t* prev, FILE* fs);
 
 extern int
-hpcrun_fmt_cct_node_fwrite(hpcrun_fmt_cct_node_t* x,
-			   epoch_flags_t flags, FILE* fs);
+hpcrun_fmt_cct_node_fwrite(hpcrun_fmt_cct_node_t* x, epoch_flags_t flags,
+			   hpcrun_fmt_cct_prev_t* prev, FILE* fs);
+
+// hpcrun_fmt_cct_node_sizeof: Size in bytes of one fixed-width CCT
+// node record with 'num_metrics' metric values.  Records of an epoch
+// all have the same size, so a reader may read many of them with one
+// fread().  Not applicable to compact records.
+extern size_t
+hpcrun_fmt_cct_node_sizeof(epoch_flags_t flags, int num_metrics);
+
+// hpcrun_fmt_cct_node_decode: Like hpcrun_fmt_cct_node_fread(), but
+// decodes the record at 'buf', which holds
+// hpcrun_fmt_cct_node_sizeof(flags, x->num_metrics) bytes.
+// N.B.: assumes space for metrics has been allocated
+extern void
+hpcrun_fmt_cct_node_decode(hpcrun_fmt_cct_node_t* x,
+			   epoch_flags_t flags, const char* buf);
 
 extern int
 hpcrun_fmt_cct_node_fprint(hpcrun_fmt_cct_node_t* x, FILE* fs,
@@ -711,6 +763,12 @@ int
 hpctrace_fmt_datum_fread(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
 			 FILE* fs);
 
+// encode 'x' into 'buf' (at least sizeof(hpctrace_fmt_datum_t) bytes)
+// and return the number of bytes used.  N.B.: async safe.
+int
+hpctrace_fmt_datum_encode(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
+			  unsigned char* buf);
+
 int
 hpctrace_fmt_datum_outbuf(hpctrace_fmt_datum_t* x, hpctrace_hdr_flags_t flags,
 			  hpcio_outbuf_t* outbuf);
@@ -750,6 +808,28 @@ static const int HPCMETRICDB_FMT_HeaderLen =
    + HPCMETRICDB_FMT_EndianLenX);
 
 
+// A metric-db is a dense (node x metric) matrix of real8 values; node
+// ids start at 1.  The default (row) layout stores it node by node
+// right after the header, as hpcviewer expects.
+//
+// The blocked layout stores it metric by metric, each metric's column
+// cut into blocks of 'blockNodes' nodes.  It is marked by its own
+// version string and extends the header with
+//   int4 blockNodes, int4 reserved,
+//   int8 offset[numMetrics][numBlocks]  (file offset of each block)
+// followed by the blocks.  A block whose values are all zero is not
+// stored and has offset 0.  Reading one metric for a range of nodes
+// thus touches only the blocks that hold them.
+
+static const char HPCMETRICDB_FMT_VersionBlocked[] = "00.20";
+
+typedef enum {
+  HPCMETRICDB_Layout_Row = 0,
+  HPCMETRICDB_Layout_Blocked
+} hpcmetricDB_layout_t;
+
+#define HPCMETRICDB_FMT_BlockNodes (4096)
+
 
 typedef struct hpcmetricDB_fmt_hdr_t {
 
@@ -760,9 +840,37 @@ typedef struct hpcmetricDB_fmt_hdr_t {
   uint32_t numNodes;
   uint32_t numMetrics;
 
+  // layout == HPCMETRICDB_Layout_Blocked only
+  uint32_t layout;
+  uint32_t blockNodes;
+
 } hpcmetricDB_fmt_hdr_t;
 
 
+static inline uint32_t
+hpcmetricDB_fmt_numBlocks(const hpcmetricDB_fmt_hdr_t* hdr)
+{
+  if (hdr->layout != HPCMETRICDB_Layout_Blocked || hdr->blockNodes == 0) {
+    return 0;
+  }
+  return (hdr->numNodes + hdr->blockNodes - 1) / hdr->blockNodes;
+}
+
+
+// size of the header, including the block directory of a blocked db
+static inline uint64_t
+hpcmetricDB_fmt_hdr_size(const hpcmetricDB_fmt_hdr_t* hdr)
+{
+  uint64_t sz = HPCMETRICDB_FMT_HeaderLen + 2 * sizeof(uint32_t);
+  if (hdr->layout == HPCMETRICDB_Layout_Blocked) {
+    sz += 2 * sizeof(uint32_t);
+    sz += (uint64_t)hdr->numMetrics * hpcmetricDB_fmt_numBlocks(hdr)
+      * sizeof(uint64_t);
+  }
+  return sz;
+}
+
+
 int
 hpcmetricDB_fmt_hdr_fread(hpcmetricDB_fmt_hdr_t* hdr, FILE* infs);
 
@@ -0,0 +1,339 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Shared-memory sample rings between hpcrun and hpcrun-aggregate.
+//   See hpcrun-sample-ring.h for the layout.
+//
+// Note: the producer functions run inside hpcrun's sample handler, so
+// they use only the mapped memory and never block.  The producer
+// writes the header (magic last) before any consumer can trust the
+// ring, and publishes records with a release store of 'tail'.
+//
+//***************************************************************************
+
+#define _GNU_SOURCE
+
+//************************* System Include Files ****************************
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+
+//*************************** User Include Files ****************************
+
+#include "hpcrun-sample-ring.h"
+
+
+//***************************************************************************
+// private operations
+//***************************************************************************
+
+#define HPCSRING_MIN_CAPACITY  (64 * 1024)
+
+static uint64_t
+round_up_pow2(uint64_t x)
+{
+  uint64_t p = HPCSRING_MIN_CAPACITY;
+  while (p < x) {
+    p <<= 1;
+  }
+  return p;
+}
+
+
+//***************************************************************************
+// interface operations
+//***************************************************************************
+
+int
+hpcsring_name(char *buf, size_t len, const char *key, long pid, int thread)
+{
+  int n = snprintf(buf, len, "%s/%s%s.%ld.%d", HPCSRING_DIR,
+		   HPCSRING_PREFIX, key, pid, thread);
+  return (n < 0 || (size_t) n >= len);
+}
+
+
+//***************************************************************************
+// producer
+//***************************************************************************
+
+int
+hpcsring_create(hpcsring_t *r, const char *path, uint64_t capacity,
+		long pid, int thread, const char *prog)
+{
+  memset(r, 0, sizeof(*r));
+  capacity = round_up_pow2(capacity);
+
+  int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    return -1;
+  }
+
+  size_t map_len = HPCSRING_HDR_SZ + capacity;
+  if (ftruncate(fd, map_len) != 0) {
+    int err = errno;
+    close(fd);
+    unlink(path);
+    errno = err;
+    return -1;
+  }
+
+  void *addr = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED,
+		    fd, 0);
+  int err = errno;
+  close(fd);
+  if (addr == MAP_FAILED) {
+    unlink(path);
+    errno = err;
+    return -1;
+  }
+
+  // the file is zero-filled, so head, tail, dropped and closed start
+  // at zero
+  hpcsring_hdr_t *hdr = (hpcsring_hdr_t *) addr;
+  hdr->version  = HPCSRING_VERSION;
+  hdr->hdr_size = HPCSRING_HDR_SZ;
+  hdr->capacity = capacity;
+  hdr->pid      = pid;
+  hdr->thread   = thread;
+  if (prog != NULL) {
+    strncpy(hdr->prog, prog, HPCSRING_PROG_LEN - 1);
+  }
+  atomic_thread_fence(memory_order_release);
+  memcpy(hdr->magic, HPCSRING_MAGIC, HPCSRING_MAGIC_LEN);
+
+  r->hdr  = hdr;
+  r->data = (unsigned char *) addr + HPCSRING_HDR_SZ;
+  r->mask = capacity - 1;
+  r->map_len = map_len;
+
+  return 0;
+}
+
+
+void *
+hpcsring_reserve(hpcsring_t *r, uint32_t kind, uint32_t len)
+{
+  uint64_t cap  = r->mask + 1;
+  uint64_t need = HPCSRING_REC_SZ(len);
+  uint64_t tail = atomic_load_explicit(&r->hdr->tail, memory_order_relaxed);
+  uint64_t off  = tail & r->mask;
+  uint64_t pad  = (off + need > cap) ? cap - off : 0;
+
+  if (need > cap / 2) {
+    atomic_fetch_add_explicit(&r->hdr->dropped, 1, memory_order_relaxed);
+    return NULL;
+  }
+
+  if (tail + pad + need - r->head_cache > cap) {
+    r->head_cache = atomic_load_explicit(&r->hdr->head, memory_order_acquire);
+    if (tail + pad + need - r->head_cache > cap) {
+      atomic_fetch_add_explicit(&r->hdr->dropped, 1, memory_order_relaxed);
+      return NULL;
+    }
+  }
+
+  if (pad > 0) {
+    hpcsring_rec_t *p = (hpcsring_rec_t *) (r->data + off);
+    p->len  = pad - sizeof(hpcsring_rec_t);
+    p->kind = HPCSRING_REC_PAD;
+    tail += pad;
+    off = 0;
+  }
+
+  hpcsring_rec_t *rec = (hpcsring_rec_t *) (r->data + off);
+  rec->len  = len;
+  rec->kind = kind;
+
+  r->rsv_pos = tail;
+  r->rsv_len = need;
+
+  return rec + 1;
+}
+
+
+void
+hpcsring_commit(hpcsring_t *r)
+{
+  if (r->rsv_len == 0) {
+    return;
+  }
+  atomic_store_explicit(&r->hdr->tail, r->rsv_pos + r->rsv_len,
+			memory_order_release);
+  r->rsv_len = 0;
+}
+
+
+void
+hpcsring_close(hpcsring_t *r)
+{
+  if (r->hdr == NULL) {
+    return;
+  }
+  atomic_store_explicit(&r->hdr->closed, 1, memory_order_release);
+  munmap(r->hdr, r->map_len);
+  memset(r, 0, sizeof(*r));
+}
+
+
+//***************************************************************************
+// consumer
+//***************************************************************************
+
+int
+hpcsring_attach(hpcsring_t *r, const char *path)
+{
+  memset(r, 0, sizeof(*r));
+
+  int fd = open(path, O_RDWR);
+  if (fd < 0) {
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < HPCSRING_HDR_SZ) {
+    close(fd);
+    errno = EINVAL;
+    return -1;
+  }
+
+  void *addr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		    fd, 0);
+  int err = errno;
+  close(fd);
+  if (addr == MAP_FAILED) {
+    errno = err;
+    return -1;
+  }
+
+  hpcsring_hdr_t *hdr = (hpcsring_hdr_t *) addr;
+  if (memcmp(hdr->magic, HPCSRING_MAGIC, HPCSRING_MAGIC_LEN) != 0) {
+    munmap(addr, st.st_size);
+    errno = EINVAL;
+    return -1;
+  }
+  atomic_thread_fence(memory_order_acquire);
+
+  uint64_t cap = hdr->capacity;
+  if (hdr->version != HPCSRING_VERSION || hdr->hdr_size != HPCSRING_HDR_SZ
+      || cap == 0 || (cap & (cap - 1)) != 0
+      || (uint64_t) st.st_size != HPCSRING_HDR_SZ + cap) {
+    munmap(addr, st.st_size);
+    errno = EINVAL;
+    return -1;
+  }
+
+  r->hdr  = hdr;
+  r->data = (unsigned char *) addr + HPCSRING_HDR_SZ;
+  r->mask = cap - 1;
+  r->map_len = st.st_size;
+
+  return 0;
+}
+
+
+const hpcsring_rec_t *
+hpcsring_peek(hpcsring_t *r)
+{
+  uint64_t head = atomic_load_explicit(&r->hdr->head, memory_order_relaxed);
+  uint64_t tail = atomic_load_explicit(&r->hdr->tail, memory_order_acquire);
+
+  while (head < tail) {
+    const hpcsring_rec_t *rec =
+      (const hpcsring_rec_t *) (r->data + (head & r->mask));
+    uint64_t sz = HPCSRING_REC_SZ(rec->len);
+
+    // a record never extends past what was committed or past the end
+    // of the data area; anything else is a corrupt ring
+    if (sz > tail - head || (head & r->mask) + sz > r->mask + 1) {
+      return NULL;
+    }
+    if (rec->kind != HPCSRING_REC_PAD) {
+      return rec;
+    }
+    head += sz;
+    atomic_store_explicit(&r->hdr->head, head, memory_order_release);
+  }
+  return NULL;
+}
+
+
+void
+hpcsring_consume(hpcsring_t *r, const hpcsring_rec_t *rec)
+{
+  uint64_t head = atomic_load_explicit(&r->hdr->head, memory_order_relaxed);
+  atomic_store_explicit(&r->hdr->head, head + HPCSRING_REC_SZ(rec->len),
+			memory_order_release);
+}
+
+
+int
+hpcsring_is_closed(hpcsring_t *r)
+{
+  return atomic_load_explicit(&r->hdr->closed, memory_order_acquire) != 0;
+}
+
+
+void
+hpcsring_detach(hpcsring_t *r)
+{
+  if (r->hdr != NULL) {
+    munmap(r->hdr, r->map_len);
+  }
+  memset(r, 0, sizeof(*r));
+}
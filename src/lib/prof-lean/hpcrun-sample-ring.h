@@ -0,0 +1,262 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   A single-producer, single-consumer ring of sample records in a
+//   shared-memory file, through which one hpcrun thread streams its
+//   samples to the per-node aggregator (hpcrun-aggregate).
+//
+// Description:
+//   The ring lives in HPCSRING_DIR/HPCSRING_PREFIX<key>.<pid>.<thread>,
+//   where <key> names the measurement (all processes on a node that
+//   write into the same measurement directory share a key).  The file
+//   is a page-sized header followed by 'capacity' bytes of data
+//   (a power of 2).
+//
+//   'head' and 'tail' are byte counts that only grow; the producer
+//   owns 'tail', the consumer owns 'head'.  Records are 8-byte
+//   aligned, start with an hpcsring_rec_t and never wrap: a record
+//   that does not fit before the end of the data area is preceded by
+//   a PAD record that fills it.  When the ring is full, the producer
+//   drops the record and counts it in 'dropped'.
+//
+//   Payloads (all fields in host byte order):
+//     LOADMAP: hpcsring_loadmap_t, then the name
+//     METRIC:  hpcsring_metric_t, then the name, description, formula
+//              and format, each NUL-terminated
+//     SAMPLE:  hpcsring_sample_t, then 'nframes' hpcsring_frame_t from
+//              the root to the leaf
+//
+//   A LOADMAP or METRIC record is sent before the first SAMPLE that
+//   refers to its id.  The producer half runs inside hpcrun and
+//   neither allocates nor uses stdio.
+//
+//***************************************************************************
+
+#ifndef prof_lean_hpcrun_sample_ring_h
+#define prof_lean_hpcrun_sample_ring_h
+
+//************************* System Include Files ****************************
+
+#include <sys/types.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//*************************** User Include Files ****************************
+
+#include "stdatomic.h"
+
+//*************************** Forward Declarations **************************
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+//***************************************************************************
+// format
+//***************************************************************************
+
+#define HPCSRING_MAGIC       "HPCSRING"
+#define HPCSRING_MAGIC_LEN   8
+#define HPCSRING_VERSION     1
+
+#define HPCSRING_DIR         "/dev/shm"
+#define HPCSRING_PREFIX      "hpcrun-agg."
+
+#define HPCSRING_HDR_SZ      4096
+#define HPCSRING_ALIGN       8
+#define HPCSRING_PROG_LEN    256
+
+typedef enum {
+  HPCSRING_REC_PAD     = 0,
+  HPCSRING_REC_LOADMAP = 1,
+  HPCSRING_REC_METRIC  = 2,
+  HPCSRING_REC_SAMPLE  = 3,
+} hpcsring_kind_t;
+
+
+typedef struct hpcsring_hdr_s {
+  char     magic[HPCSRING_MAGIC_LEN];
+  uint32_t version;
+  uint32_t hdr_size;
+  uint64_t capacity;
+  int64_t  pid;
+  int32_t  thread;
+  int32_t  unused;
+  char     prog[HPCSRING_PROG_LEN];
+
+  // producer and consumer positions, on separate cache lines
+  atomic_ullong tail __attribute__((aligned(64)));
+  atomic_ullong dropped;
+  atomic_uint   closed;
+
+  atomic_ullong head __attribute__((aligned(64)));
+} hpcsring_hdr_t;
+
+
+// Header of every record.  'len' is the payload length; the record
+// occupies HPCSRING_REC_SZ(len) bytes.
+typedef struct hpcsring_rec_s {
+  uint32_t len;
+  uint32_t kind;
+} hpcsring_rec_t;
+
+#define HPCSRING_REC_SZ(len) \
+  ((sizeof(hpcsring_rec_t) + (len) + HPCSRING_ALIGN - 1) & ~(uint64_t)(HPCSRING_ALIGN - 1))
+
+
+typedef struct hpcsring_loadmap_s {
+  uint32_t id;
+  uint32_t name_len;  // including the NUL
+} hpcsring_loadmap_t;
+
+
+typedef struct hpcsring_metric_s {
+  uint32_t id;
+  uint32_t is_frequency_metric;
+  uint64_t flags[2];  // hpcrun_metricFlags_t
+  uint64_t period;
+} hpcsring_metric_t;
+
+
+typedef struct hpcsring_sample_s {
+  uint32_t metric_id;
+  uint32_t nframes;
+  uint64_t value;
+} hpcsring_sample_t;
+
+
+typedef struct hpcsring_frame_s {
+  uint64_t lm_ip;
+  uint32_t lm_id;
+  uint32_t unused;
+} hpcsring_frame_t;
+
+
+// A mapped ring.  Either side embeds one of these.
+typedef struct hpcsring_s {
+  hpcsring_hdr_t *hdr;
+  unsigned char *data;
+  uint64_t mask;
+  size_t map_len;
+
+  // producer: position of the record being written (0 if none), and
+  // the last head seen, so that most reservations do not touch the
+  // consumer's cache line
+  uint64_t rsv_pos;
+  uint64_t rsv_len;
+  uint64_t head_cache;
+} hpcsring_t;
+
+
+// Formats the file name of a ring into 'buf'.  Returns: 0 on success,
+// else nonzero if it does not fit.
+int
+hpcsring_name(char *buf, size_t len, const char *key, long pid, int thread);
+
+
+//***************************************************************************
+// producer (hpcrun)
+//***************************************************************************
+
+// Create and map a new ring file at 'path' with room for 'capacity'
+// bytes of records (rounded up to a power of 2).  Returns: 0 on
+// success, else -1 (with errno set).
+int
+hpcsring_create(hpcsring_t *r, const char *path, uint64_t capacity,
+		long pid, int thread, const char *prog);
+
+// Reserve a record of 'kind' with a 'len'-byte payload.  Returns: a
+// pointer to the payload, or NULL if the ring is full (the record is
+// counted as dropped).  At most one record may be reserved at a time.
+void *
+hpcsring_reserve(hpcsring_t *r, uint32_t kind, uint32_t len);
+
+// Publish the reserved record to the consumer.
+void
+hpcsring_commit(hpcsring_t *r);
+
+// Mark the ring finished and unmap it.  The consumer removes the
+// file once it has drained it.
+void
+hpcsring_close(hpcsring_t *r);
+
+
+//***************************************************************************
+// consumer (hpcrun-aggregate)
+//***************************************************************************
+
+// Map an existing ring.  Returns: 0 on success, else -1 (with errno
+// set, EINVAL if 'path' is not a ring).
+int
+hpcsring_attach(hpcsring_t *r, const char *path);
+
+// Returns: the next committed record (skipping padding), or NULL if
+// the ring is empty.  The record stays valid until hpcsring_consume().
+const hpcsring_rec_t *
+hpcsring_peek(hpcsring_t *r);
+
+// Release the record returned by the last hpcsring_peek().
+void
+hpcsring_consume(hpcsring_t *r, const hpcsring_rec_t *rec);
+
+// Returns: nonzero once the producer has closed the ring.
+int
+hpcsring_is_closed(hpcsring_t *r);
+
+void
+hpcsring_detach(hpcsring_t *r);
+
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // prof_lean_hpcrun_sample_ring_h
@@ -239,6 +239,37 @@ Tree::makeDensePreorderIds()
 }
 
 
+void
+Tree::clusterMetrics()
+{
+  if (!Metric::IDataStore::isEnabled() || !m_root) {
+    return;
+  }
+
+  std::vector<ANode*> nodes;
+  if (m_maxDenseId > 0) {
+    nodes.resize(m_maxDenseId + 1, NULL);
+  }
+  for (ANodeIterator it(m_root); it.Current(); ++it) {
+    ANode* n = it.current();
+    if (m_maxDenseId > 0 && n->id() <= m_maxDenseId && !nodes[n->id()]) {
+      nodes[n->id()] = n;
+    }
+    else {
+      nodes.push_back(n);
+    }
+  }
+
+  Metric::IDataStore::beginCluster();
+  for (uint i = 0; i < nodes.size(); ++i) {
+    if (nodes[i]) {
+      nodes[i]->relocateMetrics();
+    }
+  }
+  Metric::IDataStore::endCluster();
+}
+
+
 ANode*
 Tree::findNode(uint nodeId) const
 {
@@ -336,7 +367,7 @@ ANode::IntToANodeType(long i)
   return (ANodeTy)i;
 }
 
-uint ANode::s_nextUniqueId = 2;
+std::atomic<uint> ANode::s_nextUniqueId(2);
 
 
 //***************************************************************************
@@ -524,6 +555,47 @@ ANode::aggregateMetricsExcl(AProcNode* frame, const VMAIntervalSet& ivalset)
   // -------------------------------------------------------
   // Pre-order visit
   // -------------------------------------------------------
+  bool isLogicalProc = false, isExclSource = false;
+  exclAggregationRole(isLogicalProc, isExclSource);
+
+  AProcNode * frameNxt = (isLogicalProc) ? static_cast<AProcNode*>(n) : frame;
+
+  // -------------------------------------------------------
+  // Tree traversal
+  // -------------------------------------------------------
+  for (ANodeChildIterator it(n); it.Current(); ++it) {
+    ANode* x = it.current();
+    x->aggregateMetricsExcl(frameNxt, ivalset);
+  }
+
+  // -------------------------------------------------------
+  // Post-order visit
+  // -------------------------------------------------------
+  if (isExclSource) {
+    ANode* n_parent = n->parent();
+
+    for (VMAIntervalSet::const_iterator it = ivalset.begin();
+        it != ivalset.end(); ++it) {
+      const VMAInterval& ival = *it;
+      uint mBegId = (uint)ival.beg(), mEndId = (uint)ival.end();
+
+      for (uint mId = mBegId; mId < mEndId; ++mId) {
+        double mVal = n->demandMetric(mId, mEndId/*size*/);
+        n_parent->demandMetric(mId, mEndId/*size*/) += mVal;
+        if (frame && frame != n_parent) {
+          frame->demandMetric(mId, mEndId/*size*/) += mVal;
+        }
+      }
+    }
+  }
+}
+
+
+void
+ANode::exclAggregationRole(bool& isLogicalProc, bool& isExclSource) const
+{
+  const ANode* n = this;
+
   //
   // laks 2015.10.21: we don't want accumulate the exclusive cost of 
   // an inlined statement to the caller. Instead, we assume an inline
@@ -559,37 +631,56 @@ ANode::aggregateMetricsExcl(AProcNode* frame, const VMAIntervalSet& ivalset)
     isInlineMacro = !isInlineCall && myprocname.compare(GUARD_NAME) == 0;
   }
 
-  bool isLogicalProc   = isFrame || isInlineCall || isInlineMacro;
-  AProcNode * frameNxt = (isLogicalProc) ? static_cast<AProcNode*>(n) : frame;
+  isLogicalProc = isFrame || isInlineCall || isInlineMacro;
+  isExclSource  = (typeid(*n) == typeid(CCT::Stmt) || isInlineMacro);
+}
 
-  // -------------------------------------------------------
-  // Tree traversal
-  // -------------------------------------------------------
-  for (ANodeChildIterator it(n); it.Current(); ++it) {
-    ANode* x = it.current();
-    x->aggregateMetricsExcl(frameNxt, ivalset);
-  }
 
-  // -------------------------------------------------------
-  // Post-order visit
-  // -------------------------------------------------------
-  if (typeid(*n) == typeid(CCT::Stmt) || isInlineMacro) {
-    ANode* n_parent = n->parent();
+void
+ANode::makeAggregationMaps(std::vector<uint>& inclParent,
+			   std::vector<uint>& exclParent,
+			   std::vector<uint>& exclFrame) const
+{
+  makeAggregationMaps(NULL, inclParent, exclParent, exclFrame);
+}
 
-    for (VMAIntervalSet::const_iterator it = ivalset.begin();
-        it != ivalset.end(); ++it) {
-      const VMAInterval& ival = *it;
-      uint mBegId = (uint)ival.beg(), mEndId = (uint)ival.end();
 
-      for (uint mId = mBegId; mId < mEndId; ++mId) {
-        double mVal = n->demandMetric(mId, mEndId/*size*/);
-        n_parent->demandMetric(mId, mEndId/*size*/) += mVal;
-        if (frame && frame != n_parent) {
-          frame->demandMetric(mId, mEndId/*size*/) += mVal;
-        }
-      }
+void
+ANode::makeAggregationMaps(const AProcNode* frame,
+			   std::vector<uint>& inclParent,
+			   std::vector<uint>& exclParent,
+			   std::vector<uint>& exclFrame) const
+{
+  const ANode* n = this;
+  const ANode* n_parent = n->parent();
+
+  bool isLogicalProc = false, isExclSource = false;
+  exclAggregationRole(isLogicalProc, isExclSource);
+
+  const AProcNode* frameNxt =
+    (isLogicalProc) ? static_cast<const AProcNode*>(n) : frame;
+
+  uint id = n->id();
+  if (id >= inclParent.size()) {
+    inclParent.resize(id + 1, 0);
+    exclParent.resize(id + 1, 0);
+    exclFrame.resize(id + 1, 0);
+  }
+
+  inclParent[id] = (n_parent) ? n_parent->id() : 0;
+  exclParent[id] = 0;
+  exclFrame[id]  = 0;
+  if (isExclSource && n_parent) {
+    exclParent[id] = n_parent->id();
+    if (frame && frame != n_parent) {
+      exclFrame[id] = frame->id();
     }
   }
+
+  for (ANodeChildIterator it(n); it.Current(); ++it) {
+    const ANode* x = it.current();
+    x->makeAggregationMaps(frameNxt, inclParent, exclParent, exclFrame);
+  }
 }
 
 
@@ -62,6 +62,7 @@
 
 //************************* System Include Files ****************************
 
+#include <atomic>
 #include <iostream>
 
 #include <string>
@@ -187,6 +188,12 @@ public:
   uint
   makeDensePreorderIds();
   
+  // clusterMetrics: when metric values are kept out-of-core
+  // (Metric::IDataStore), lay them out in preorder (the order of
+  // dense ids, if any) so that traversals read them sequentially.
+  void
+  clusterMetrics();
+
   // maxDenseId(): returns the maximum id actually used
   uint
   maxDenseId() const
@@ -320,19 +327,15 @@ public:
   ANode(ANodeTy type, ANode* parent, Struct::ACodeNode* strct = NULL)
     : NonUniformDegreeTreeNode(parent),
       Metric::IData(),
-      m_type(type), m_id(s_nextUniqueId), m_strct(strct)
-  {
-    s_nextUniqueId += 2; // cf. HPCRUN_FMT_RetainIdFlag
-  }
+      m_type(type), m_id(nextUniqueId()), m_strct(strct)
+  { }
 
   ANode(ANodeTy type,
 	ANode* parent, Struct::ACodeNode* strct, const Metric::IData& metrics)
     : NonUniformDegreeTreeNode(parent),
       Metric::IData(metrics),
-      m_type(type), m_id(s_nextUniqueId), m_strct(strct)
-  {
-    s_nextUniqueId += 2; // cf. HPCRUN_FMT_RetainIdFlag
-  }
+      m_type(type), m_id(nextUniqueId()), m_strct(strct)
+  { }
 
   virtual ~ANode()
   { }
@@ -341,10 +344,9 @@ public:
   ANode(const ANode& x)
     : NonUniformDegreeTreeNode(NULL),
       Metric::IData(x),
-      m_type(x.m_type), m_id(s_nextUniqueId), m_strct(x.m_strct)
+      m_type(x.m_type), m_id(nextUniqueId()), m_strct(x.m_strct)
   {
     zeroLinks();
-    s_nextUniqueId += 2; // cf. HPCRUN_FMT_RetainIdFlag
   }
 
   // deep copy of internals (but without children)
@@ -355,8 +357,7 @@ public:
       //NonUniformDegreeTreeNode::operator=(x);
       Metric::IData::operator=(x);
       m_type = x.m_type;
-      m_id = s_nextUniqueId;
-      s_nextUniqueId += 2;
+      m_id = nextUniqueId();
       // m_id: skip
       m_strct = x.m_strct;
     }
@@ -517,6 +518,20 @@ public:
   aggregateMetricsExcl(uint mBegId)
   { aggregateMetricsExcl(mBegId, mBegId + 1); }
 
+
+  // makeAggregationMaps: for a subtree with dense ids, records (by
+  // dense id) the nodes into which aggregateMetricsIncl() and
+  // aggregateMetricsExcl() add each node's value, so that metric
+  // values kept outside the CCT can be aggregated the same way.
+  //   inclParent[id]: the node's parent (0 for none)
+  //   exclParent[id], exclFrame[id]: the exclusive targets (0 for none)
+  // Since children have larger dense ids than their parents, applying
+  // the maps in decreasing id order yields a post-order aggregation.
+  void
+  makeAggregationMaps(std::vector<uint>& inclParent,
+		      std::vector<uint>& exclParent,
+		      std::vector<uint>& exclFrame) const;
+
 private:
   //
   // laks 2015.10.21: we don't want accumulate the exclusive cost of 
@@ -526,6 +541,18 @@ private:
   void
   aggregateMetricsExcl(AProcNode* frame, const VMAIntervalSet& ivalset);
 
+  // exclAggregationRole: whether this node is a frame for exclusive
+  // aggregation of its descendents and whether its exclusive value
+  // is passed up to its parent (and frame)
+  void
+  exclAggregationRole(bool& isLogicalProc, bool& isExclSource) const;
+
+  void
+  makeAggregationMaps(const AProcNode* frame,
+		      std::vector<uint>& inclParent,
+		      std::vector<uint>& exclParent,
+		      std::vector<uint>& exclFrame) const;
+
 public:
   // computeMetrics: compute this subtree's Metric::DerivedDesc metric
   //   values for metric ids [mBegId, mEndId)
@@ -679,7 +706,14 @@ protected:
 
 
 private:
-  static uint s_nextUniqueId;
+  // ids step by 2 (cf. HPCRUN_FMT_RetainIdFlag) and are unique across
+  // trees, which may be built concurrently (e.g., profiles read in
+  // parallel by hpcprof-mpi)
+  static uint
+  nextUniqueId()
+  { return s_nextUniqueId.fetch_add(2, std::memory_order_relaxed); }
+
+  static std::atomic<uint> s_nextUniqueId;
   
 protected:
   ANodeTy m_type; // obsolete with typeid(), but hard to replace
@@ -0,0 +1,436 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//    $HeadURL$
+//
+// Purpose:
+//    [The purpose of this file]
+//
+// Description:
+//    [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+//************************* System Include Files ****************************
+
+#include <string>
+using std::string;
+
+#include <vector>
+#include <algorithm>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//*************************** User Include Files ****************************
+
+#include <include/uint.h>
+
+#include "CallPath-MetricDB.hpp"
+
+#include <lib/prof-lean/hpcio.h>
+#include <lib/prof-lean/hpcfmt.h>
+#include <lib/prof-lean/hpcrun-fmt.h>
+
+#include <lib/support/diagnostics.h>
+
+//*************************** Forward Declarations **************************
+
+// MetricDBSet::fetch maps at most this many files at a time
+static const uint FetchWindow = 256;
+
+
+static inline double
+getReal8(const char* p)
+{
+  hpcfmt_byte8_union_t v;
+  v.i8 = hpcio_be8_get(p);
+  return v.r8;
+}
+
+
+//***************************************************************************
+
+namespace Prof {
+namespace CallPath {
+
+
+//***************************************************************************
+// MetricDB
+//***************************************************************************
+
+MetricDB::MetricDB(const string& fnm)
+  : m_name(fnm), m_addr(NULL), m_size(0), m_hdrSz(0), m_numBlocks(0)
+{
+  memset(&m_hdr, 0, sizeof(m_hdr));
+}
+
+
+MetricDB::~MetricDB()
+{
+  close();
+}
+
+
+void
+MetricDB::open()
+{
+  if (m_addr) {
+    return;
+  }
+
+  int fd = ::open(m_name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    DIAG_Throw("error opening metric-db file '" << m_name << "': "
+	       << strerror(errno));
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    DIAG_Throw("error reading metric-db file '" << m_name << "'");
+  }
+  size_t sz = st.st_size;
+
+  void* addr = mmap(NULL, sz, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd); // the mapping keeps the file
+  if (addr == MAP_FAILED) {
+    DIAG_Throw("error mapping metric-db file '" << m_name << "': "
+	       << strerror(errno));
+  }
+
+  // Values are read a few at a time from anywhere in the file; only
+  // prefetch() asks for read-ahead.
+  madvise(addr, sz, MADV_RANDOM);
+
+  // Parse the header with the same code that reads it from a stream
+  hpcmetricDB_fmt_hdr_t hdr;
+  FILE* fs = fmemopen(addr, sz, "r");
+  int ret = (fs) ? hpcmetricDB_fmt_hdr_fread(&hdr, fs) : HPCFMT_ERR;
+  if (fs) {
+    fclose(fs);
+  }
+
+  uint64_t dataSz = 0;
+  if (ret == HPCFMT_OK && hdr.layout == HPCMETRICDB_Layout_Row) {
+    dataSz = (uint64_t)hdr.numNodes * hdr.numMetrics * sizeof(double);
+  }
+  if (ret != HPCFMT_OK || hpcmetricDB_fmt_hdr_size(&hdr) + dataSz > sz) {
+    munmap(addr, sz);
+    DIAG_Throw("error reading metric-db file '" << m_name << "'");
+  }
+
+  m_addr = static_cast<const char*>(addr);
+  m_size = sz;
+  m_hdr = hdr;
+  m_hdrSz = hpcmetricDB_fmt_hdr_size(&hdr);
+  m_numBlocks = hpcmetricDB_fmt_numBlocks(&hdr);
+}
+
+
+void
+MetricDB::close()
+{
+  if (m_addr) {
+    munmap(const_cast<char*>(m_addr), m_size);
+    m_addr = NULL;
+    m_size = 0;
+  }
+}
+
+
+double
+MetricDB::value(uint nodeId, uint mId)
+{
+  double val = 0.0;
+  fetch(mId, nodeId, nodeId + 1, &val);
+  return val;
+}
+
+
+void
+MetricDB::fetch(uint mId, uint nodeBeg, uint nodeEnd, double* vals)
+{
+  open();
+
+  if (mId >= m_hdr.numMetrics) {
+    DIAG_Throw("metric-db file '" << m_name << "' has no metric " << mId);
+  }
+
+  if (nodeBeg == 0 && nodeEnd > 0) {
+    *vals++ = 0.0; // there is no node 0
+    nodeBeg = 1;
+  }
+  uint nodeLast = std::min(nodeEnd, m_hdr.numNodes + 1); // open end
+
+  for (uint nodeId = nodeBeg; nodeId < nodeLast; ) {
+    if (m_hdr.layout == HPCMETRICDB_Layout_Row) {
+      uint64_t rowSz = (uint64_t)m_hdr.numMetrics * sizeof(double);
+      const char* p = m_addr + m_hdrSz + (nodeId - 1) * rowSz
+	+ mId * sizeof(double);
+      for ( ; nodeId < nodeLast; ++nodeId, p += rowSz) {
+	*vals++ = getReal8(p);
+      }
+    }
+    else {
+      uint idx = nodeId - 1;
+      uint blk = idx / m_hdr.blockNodes;
+      uint blkEnd = std::min((blk + 1) * m_hdr.blockNodes, m_hdr.numNodes);
+      uint n = std::min(blkEnd, nodeLast - 1) - idx;
+
+      const char* p = blockAddr(mId, blk);
+      if (p) {
+	p += (idx - blk * m_hdr.blockNodes) * sizeof(double);
+	for (uint i = 0; i < n; ++i, p += sizeof(double)) {
+	  *vals++ = getReal8(p);
+	}
+      }
+      else {
+	std::fill(vals, vals + n, 0.0);
+	vals += n;
+      }
+      nodeId += n;
+    }
+  }
+
+  if (nodeEnd > nodeLast && nodeEnd > nodeBeg) {
+    std::fill(vals, vals + (nodeEnd - std::max(nodeBeg, nodeLast)), 0.0);
+  }
+}
+
+
+void
+MetricDB::fetchRow(uint nodeId, double* vals)
+{
+  open();
+
+  if (nodeId < 1 || nodeId > m_hdr.numNodes) {
+    DIAG_Throw("metric-db file '" << m_name << "' has no node " << nodeId);
+  }
+
+  if (m_hdr.layout == HPCMETRICDB_Layout_Row) {
+    uint64_t rowSz = (uint64_t)m_hdr.numMetrics * sizeof(double);
+    const char* p = m_addr + m_hdrSz + (nodeId - 1) * rowSz;
+    for (uint mId = 0; mId < m_hdr.numMetrics; ++mId, p += sizeof(double)) {
+      vals[mId] = getReal8(p);
+    }
+  }
+  else {
+    for (uint mId = 0; mId < m_hdr.numMetrics; ++mId) {
+      fetch(mId, nodeId, nodeId + 1, &vals[mId]);
+    }
+  }
+}
+
+
+void
+MetricDB::prefetch(uint mId, uint nodeBeg, uint nodeEnd)
+{
+  open();
+
+  nodeBeg = std::max(nodeBeg, 1u);
+  nodeEnd = std::min(nodeEnd, m_hdr.numNodes + 1);
+  if (mId >= m_hdr.numMetrics || nodeBeg >= nodeEnd) {
+    return;
+  }
+
+  if (m_hdr.layout == HPCMETRICDB_Layout_Row) {
+    // Worth it only if consecutive rows share pages
+    uint64_t rowSz = (uint64_t)m_hdr.numMetrics * sizeof(double);
+    if (rowSz < (uint64_t)sysconf(_SC_PAGESIZE)) {
+      const char* beg = m_addr + m_hdrSz + (nodeBeg - 1) * rowSz;
+      adviseWillNeed(beg, beg + (nodeEnd - nodeBeg) * rowSz);
+    }
+    return;
+  }
+
+  // The directory entries of one metric are contiguous, as are the
+  // blocks it stores
+  uint blkBeg = (nodeBeg - 1) / m_hdr.blockNodes;
+  uint blkEnd = (nodeEnd - 2) / m_hdr.blockNodes + 1;
+  const char* dir = m_addr + m_hdrSz
+    - (uint64_t)m_hdr.numMetrics * m_numBlocks * sizeof(uint64_t);
+  const char* dirBeg = dir + ((uint64_t)mId * m_numBlocks + blkBeg) * 8;
+  adviseWillNeed(dirBeg, dirBeg + (blkEnd - blkBeg) * 8);
+
+  for (uint blk = blkBeg; blk < blkEnd; ++blk) {
+    const char* p = blockAddr(mId, blk);
+    if (p) {
+      uint idxBeg = std::max(blk * m_hdr.blockNodes, nodeBeg - 1);
+      uint idxEnd = std::min((blk + 1) * m_hdr.blockNodes, nodeEnd - 1);
+      const char* beg = p + (idxBeg - blk * m_hdr.blockNodes) * sizeof(double);
+      adviseWillNeed(beg, beg + (idxEnd - idxBeg) * sizeof(double));
+    }
+  }
+}
+
+
+void
+MetricDB::prefetchRows(uint nodeBeg, uint nodeEnd)
+{
+  open();
+
+  nodeBeg = std::max(nodeBeg, 1u);
+  nodeEnd = std::min(nodeEnd, m_hdr.numNodes + 1);
+  if (nodeBeg >= nodeEnd) {
+    return;
+  }
+
+  if (m_hdr.layout == HPCMETRICDB_Layout_Row) {
+    uint64_t rowSz = (uint64_t)m_hdr.numMetrics * sizeof(double);
+    const char* beg = m_addr + m_hdrSz + (nodeBeg - 1) * rowSz;
+    adviseWillNeed(beg, beg + (nodeEnd - nodeBeg) * rowSz);
+  }
+  else {
+    for (uint mId = 0; mId < m_hdr.numMetrics; ++mId) {
+      prefetch(mId, nodeBeg, nodeEnd);
+    }
+  }
+}
+
+
+const char*
+MetricDB::blockAddr(uint mId, uint blk) const
+{
+  const char* dir = m_addr + m_hdrSz
+    - (uint64_t)m_hdr.numMetrics * m_numBlocks * sizeof(uint64_t);
+  uint64_t off = hpcio_be8_get(dir + ((uint64_t)mId * m_numBlocks + blk) * 8);
+  if (off == 0) {
+    return NULL;
+  }
+
+  uint blkLen = std::min(m_hdr.blockNodes,
+			 m_hdr.numNodes - blk * m_hdr.blockNodes);
+  if (off < m_hdrSz || off + (uint64_t)blkLen * sizeof(double) > m_size) {
+    DIAG_Throw("error reading metric-db file '" << m_name
+	       << "': bad offset for metric " << mId << ", block " << blk);
+  }
+  return m_addr + off;
+}
+
+
+void
+MetricDB::adviseWillNeed(const char* beg, const char* end) const
+{
+  uintptr_t pageSz = sysconf(_SC_PAGESIZE);
+  uintptr_t b = reinterpret_cast<uintptr_t>(beg) & ~(pageSz - 1);
+  uintptr_t e = reinterpret_cast<uintptr_t>(end);
+  if (e > b) {
+    madvise(reinterpret_cast<void*>(b), e - b, MADV_WILLNEED);
+  }
+}
+
+
+//***************************************************************************
+// MetricDBSet
+//***************************************************************************
+
+MetricDBSet::MetricDBSet()
+{
+}
+
+
+MetricDBSet::MetricDBSet(const std::vector<string>& fnms)
+{
+  for (uint i = 0; i < fnms.size(); ++i) {
+    add(fnms[i]);
+  }
+}
+
+
+MetricDBSet::~MetricDBSet()
+{
+  for (uint i = 0; i < m_dbs.size(); ++i) {
+    delete m_dbs[i];
+  }
+}
+
+
+void
+MetricDBSet::add(const string& fnm)
+{
+  m_dbs.push_back(new MetricDB(fnm));
+}
+
+
+void
+MetricDBSet::fetch(uint mId, uint nodeBeg, uint nodeEnd,
+		   std::vector<double>& vals)
+{
+  uint n = (nodeEnd > nodeBeg) ? (nodeEnd - nodeBeg) : 0;
+  vals.assign((size_t)m_dbs.size() * n, 0.0);
+  if (n == 0) {
+    return;
+  }
+
+  for (uint wBeg = 0; wBeg < m_dbs.size(); wBeg += FetchWindow) {
+    uint wEnd = std::min(wBeg + FetchWindow, (uint)m_dbs.size());
+
+    for (uint i = wBeg; i < wEnd; ++i) {
+      m_dbs[i]->prefetch(mId, nodeBeg, nodeEnd);
+    }
+    for (uint i = wBeg; i < wEnd; ++i) {
+      m_dbs[i]->fetch(mId, nodeBeg, nodeEnd, &vals[(size_t)i * n]);
+      m_dbs[i]->close();
+    }
+  }
+}
+
+
+//***************************************************************************
+
+} // namespace CallPath
+} // namespace Prof
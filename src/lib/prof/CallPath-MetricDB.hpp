@@ -0,0 +1,227 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   [The purpose of this file]
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+#ifndef prof_Prof_CallPath_MetricDB_hpp
+#define prof_Prof_CallPath_MetricDB_hpp
+
+//************************* System Include Files ****************************
+
+#include <string>
+#include <vector>
+
+#include <cstddef>
+#include <stdint.h>
+
+//*************************** User Include Files ****************************
+
+#include <include/uint.h>
+
+#include <lib/prof-lean/hpcrun-fmt.h>
+
+//*************************** Forward Declarations **************************
+
+
+//***************************************************************************
+
+namespace Prof {
+namespace CallPath {
+
+//***************************************************************************
+// MetricDB
+//
+// Read access to one metric-db file, in either the row or the blocked
+// layout (cf. hpcmetricDB_fmt_hdr_t).  The file is mapped into memory
+// when it is first used, and the kernel is told to read ahead only
+// what fetch() is about to touch.  Reading one metric for a range of
+// nodes from a blocked file therefore reads little more than those
+// values.
+//
+// Node ids start at 1; metric ids are positions within the file
+// (0 <= mId < numMetrics()).  All reads throw (DIAG_Throw) if the file
+// cannot be mapped or is not a metric-db.
+//***************************************************************************
+
+class MetricDB {
+public:
+  MetricDB(const std::string& fnm);
+  ~MetricDB();
+
+  const std::string&
+  name() const
+  { return m_name; }
+
+  // open: map the file and read its header (if not already done)
+  void
+  open();
+
+  // close: unmap the file; a later read maps it again
+  void
+  close();
+
+  bool
+  isOpen() const
+  { return (m_addr != NULL); }
+
+  uint
+  numNodes()
+  { open(); return m_hdr.numNodes; }
+
+  uint
+  numMetrics()
+  { open(); return m_hdr.numMetrics; }
+
+  bool
+  isBlocked()
+  { open(); return (m_hdr.layout == HPCMETRICDB_Layout_Blocked); }
+
+  const hpcmetricDB_fmt_hdr_t&
+  hdr()
+  { open(); return m_hdr; }
+
+  double
+  value(uint nodeId, uint mId);
+
+  // fetch: store metric 'mId' of nodes [nodeBeg, nodeEnd) in
+  // vals[0 .. nodeEnd - nodeBeg).  Nodes past numNodes() read as 0.
+  void
+  fetch(uint mId, uint nodeBeg, uint nodeEnd, double* vals);
+
+  // fetchRow: store all metrics of 'nodeId' in vals[0 .. numMetrics())
+  void
+  fetchRow(uint nodeId, double* vals);
+
+  // prefetch: start reading, without waiting, what the same fetch()
+  // would touch
+  void
+  prefetch(uint mId, uint nodeBeg, uint nodeEnd);
+
+  // prefetchRows: likewise, for fetchRow() of nodes [nodeBeg, nodeEnd)
+  void
+  prefetchRows(uint nodeBeg, uint nodeEnd);
+
+private:
+  // address of the first value of block 'blk' of metric 'mId'; NULL
+  // if the block was all zeros
+  const char*
+  blockAddr(uint mId, uint blk) const;
+
+  void
+  adviseWillNeed(const char* beg, const char* end) const;
+
+private:
+  std::string m_name;
+
+  const char* m_addr; // mapping of the whole file
+  size_t m_size;
+
+  hpcmetricDB_fmt_hdr_t m_hdr;
+  uint64_t m_hdrSz;   // offset of the first value (row layout)
+  uint m_numBlocks;   // blocked layout
+};
+
+
+//***************************************************************************
+// MetricDBSet
+//
+// The metric-db files of a database (typically one per thread), read
+// as one (file x node) matrix per metric.  Files are mapped only while
+// a fetch() uses them, a window at a time, so that thousands of files
+// need neither thousands of descriptors nor mappings, and the reads
+// of all files in a window are started before any is waited for.
+//***************************************************************************
+
+class MetricDBSet {
+public:
+  MetricDBSet();
+  MetricDBSet(const std::vector<std::string>& fnms);
+  ~MetricDBSet();
+
+  void
+  add(const std::string& fnm);
+
+  uint
+  size() const
+  { return m_dbs.size(); }
+
+  MetricDB&
+  db(uint i)
+  { return *m_dbs[i]; }
+
+  // fetch: store metric 'mId' of nodes [nodeBeg, nodeEnd) of every
+  // file, so that vals[i * (nodeEnd - nodeBeg) + (nodeId - nodeBeg)]
+  // is the value in file i.
+  void
+  fetch(uint mId, uint nodeBeg, uint nodeEnd, std::vector<double>& vals);
+
+private:
+  MetricDBSet(const MetricDBSet& x);
+  MetricDBSet& operator=(const MetricDBSet& x);
+
+private:
+  std::vector<MetricDB*> m_dbs;
+};
+
+
+//***************************************************************************
+
+} // namespace CallPath
+} // namespace Prof
+
+
+#endif /* prof_Prof_CallPath_MetricDB_hpp */
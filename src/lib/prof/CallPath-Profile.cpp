@@ -71,6 +71,8 @@ using std::dec;
 using std::string;
 
 #include <map>
+#include <unordered_map>
+#include <vector>
 #include <algorithm>
 #include <sstream>
 
@@ -91,6 +93,7 @@ using std::string;
 
 //*************************** User Include Files ****************************
 
+#include <include/hpctoolkit-config.h>
 #include <include/gcc-attr.h>
 #include <include/uint.h>
 
@@ -275,6 +278,16 @@ Profile::merge(Profile& y, int mergeTy, uint mrgFlag)
   y.merge_fixTrace(mrgEffects2);
   delete mrgEffects2;
 
+  // -------------------------------------------------------
+  // take y's trace cpId maps, including the one just made for y's own
+  // trace file: callers typically delete y right after merging
+  // -------------------------------------------------------
+  for (TraceCpIdMaps::iterator it = y.m_traceCpIdMaps.begin();
+       it != y.m_traceCpIdMaps.end(); ++it) {
+    x.m_traceCpIdMaps[it->first].swap(it->second);
+  }
+  y.m_traceCpIdMaps.clear();
+
   return firstMergedMetric;
 }
 
@@ -383,8 +396,6 @@ Profile::merge_fixCCT(const std::vector<LoadMap::MergeEffect>* mrgEffects)
 void
 Profile::merge_fixTrace(const CCT::MergeEffectList* mrgEffects)
 {
-  typedef std::map<uint, uint> UIntToUIntMap;
-
   // early exit for trivial case
   if (m_traceFileName.empty()) {
     return;
@@ -393,121 +404,29 @@ Profile::merge_fixTrace(const CCT::MergeEffectList* mrgEffects)
     return; // rely on Analysis::Util::copyTraceFiles() to copy orig file
   }
 
-  // N.B.: We could build a map of old->new cpIds within
-  // Profile::merge(), but the list of effects is more general and
-  // extensible.  There are no asymptotic problems with building the
-  // following map for local use.
-  UIntToUIntMap cpIdMap;
+  // Record the translation as a dense array indexed by old cpId.
+  // Rewriting the trace file is deferred to
+  // Analysis::Util::copyTraceFiles(), which translates all trace files
+  // at once.
+  uint maxCpId = 0;
   for (CCT::MergeEffectList::const_iterator it = mrgEffects->begin();
        it != mrgEffects->end(); ++it) {
-    const CCT::MergeEffect& effct = *it;
-    cpIdMap.insert(std::make_pair(effct.old_cpId, effct.new_cpId));
+    maxCpId = std::max(maxCpId, it->old_cpId);
   }
 
-  // ------------------------------------------------------------
-  // Rewrite trace file
-  // ------------------------------------------------------------
-  int ret;
-
-  DIAG_MsgIf(0, "Profile::merge_fixTrace: " << m_traceFileName);
-
-  string traceFileNameTmp = m_traceFileName + "." + HPCPROF_TmpFnmSfx;
-
-  char* infsBuf = new char[HPCIO_RWBufferSz];
-  char* outfsBuf = new char[HPCIO_RWBufferSz];
-
-  const string& inFnm = m_traceFileName;
-  FILE* infs = hpcio_fopen_r(inFnm.c_str());
-  if (!infs) {
-    std::string errorString;
-    hpcrun_getFileErrorString(inFnm, errorString);
-    DIAG_EMsg("failed to open trace file " << errorString << "; skip this one."); 
-    return; 
-  }
-
-  ret = setvbuf(infs, infsBuf, _IOFBF, HPCIO_RWBufferSz);
-  DIAG_AssertWarn(ret == 0, inFnm << ": Profile::merge_fixTrace: setvbuf!");
-
-  hpctrace_fmt_hdr_t hdr;
-  ret = hpctrace_fmt_hdr_fread(&hdr, infs);
-  if (ret == HPCFMT_ERR) {
-    std::string errorString;
-    hpcrun_getFileErrorString(inFnm, errorString);
-    DIAG_EMsg("failed reading header from trace measurement file " << errorString << "; skip this one."); 
-    hpcio_fclose(infs);
-    return;
-  }
-
-  const string& outFnm = traceFileNameTmp;
-  FILE* outfs = hpcio_fopen_w(outFnm.c_str(), 1/*overwrite*/);
-  if (!outfs) {
-    if (errno == EDQUOT) {
-      DIAG_EMsg("disk quota exceeded; unable to open trace result file  " << 
-		outFnm << "; aborting.");
-      hpcio_fclose(infs);
-      prof_abort(-1);
-    } else {
-      std::string errorString;
-      hpcrun_getFileErrorString(outFnm, errorString);
-      DIAG_EMsg("failed opening trace result file " << errorString << 
-		"when processing trace measurement file " << inFnm << "; skip this one.");
-      hpcio_fclose(infs);
-      return; 
-    }
+  std::vector<uint>& cpIdMap = m_traceCpIdMaps[m_traceFileName];
+  cpIdMap.resize(maxCpId + 1);
+  for (uint i = 0; i <= maxCpId; ++i) {
+    cpIdMap[i] = i;
   }
-
-  ret = setvbuf(outfs, outfsBuf, _IOFBF, HPCIO_RWBufferSz);
-  DIAG_AssertWarn(ret == 0, outFnm << ": Profile::merge_fixTrace: setvbuf!");
-
-  ret = hpctrace_fmt_hdr_fwrite(hdr.flags, outfs);
-  if (ret == HPCFMT_ERR) goto badwrite;
-
-  while ( !feof(infs) ) {
-    // 1. Read trace record (exit on EOF)
-    hpctrace_fmt_datum_t datum;
-    ret = hpctrace_fmt_datum_fread(&datum, hdr.flags, infs);
-    if (ret == HPCFMT_EOF) {
-      break;
-    } else if (ret == HPCFMT_ERR) {
-      DIAG_EMsg("failed reading a record from trace measurement file " << inFnm << "; skip this one.");
-      hpcio_fclose(infs);
-      hpcio_fclose(outfs);
-      unlink(outFnm.c_str()); // delete incomplete output file
-      return;
-    }
-    
-    // 2. Translate cct id
-    uint cctId_old = datum.cpId;
-    uint cctId_new = datum.cpId;
-    UIntToUIntMap::iterator it = cpIdMap.find(cctId_old);
-    if (it != cpIdMap.end()) {
-      cctId_new = it->second;
-      DIAG_MsgIf(0, "  " << cctId_old << " -> " << cctId_new);
-    }
-    datum.cpId = cctId_new;
-
-    // 3. Write new trace record
-    ret = hpctrace_fmt_datum_fwrite(&datum, hdr.flags, outfs);
-    if (ret == HPCFMT_ERR) goto badwrite;
+  for (CCT::MergeEffectList::const_iterator it = mrgEffects->begin();
+       it != mrgEffects->end(); ++it) {
+    const CCT::MergeEffect& effct = *it;
+    cpIdMap[effct.old_cpId] = effct.new_cpId;
   }
 
-  hpcio_fclose(infs);
-  hpcio_fclose(outfs);
-
-  delete[] infsBuf;
-  delete[] outfsBuf;
-  return;
-
-badwrite:
-  {
-    std::string errorString;
-    hpcrun_getFileErrorString(outFnm, errorString);
-    DIAG_EMsg("failed writing trace result file " << errorString << "; aborting.");
-    hpcio_fclose(infs);
-    hpcio_fclose(outfs);
-    unlink(outFnm.c_str()); // delete incomplete output file
-    prof_abort(-1);
-  }
+  DIAG_MsgIf(0, "Profile::merge_fixTrace: " << m_traceFileName
+	     << ": " << mrgEffects->size() << " ids");
 }
 
 
@@ -960,6 +879,12 @@ static void
 fmt_cct_makeNode(hpcrun_fmt_cct_node_t& n_fmt, const Prof::CCT::ANode& n,
 		 epoch_flags_t flags);
 
+// Profile::fmt_cct_fread() reads CCT node records in chunks of about
+// this many bytes, and decodes chunks of at least
+// CCTDecodeParallelMin records in parallel.
+static const uint64_t CCTReadChunkSz = 4 * 1024 * 1024;
+static const long CCTDecodeParallelMin = 16 * 1024;
+
 
 //***************************************************************************
 
@@ -984,7 +909,7 @@ Profile::make(uint rFlags)
 
 
 Profile*
-Profile::make(const char* fnm, uint rFlags, FILE* outfs)
+Profile::make(const char* fnm, uint rFlags, FILE* outfs, uint64_t* nBytes)
 {
   int ret;
 
@@ -1010,6 +935,11 @@ Profile::make(const char* fnm, uint rFlags, FILE* outfs)
 
   Profile* prof = NULL;
   ret = fmt_fread(prof, fs, rFlags, fnm, fnm, outfs);
+
+  if (nBytes) {
+    long pos = ftell(fs);
+    *nBytes = (pos > 0) ? (uint64_t)pos : 0;
+  }
   
   hpcio_fclose(fs);
 
@@ -1432,6 +1362,11 @@ Profile::fmt_epoch_fread(Profile* &prof, FILE* infs, uint rFlags,
 
   for (uint i = 0; i < num_lm; ++i) {
     string nm = loadmap_tbl.lst[i].name;
+    // profiles may be read concurrently (hpcprof-mpi); the manager
+    // caches what it resolves
+#ifdef ENABLE_OPENMP
+#pragma omp critical (RealPathMgr)
+#endif
     RealPathMgr::singleton().realpath(nm);
 
     LoadMap::LM* lm = new LoadMap::LM(nm);
@@ -1472,14 +1407,12 @@ Profile::fmt_cct_fread(Profile& prof, FILE* infs, uint rFlags,
 		       const metric_tbl_t& metricTbl,
 		       std::string ctxtStr, FILE* outfs)
 {
-  typedef std::map<int, CCT::ANode*> CCTIdToCCTNodeMap;
+  typedef std::unordered_map<int, CCT::ANode*> CCTIdToCCTNodeMap;
 
   DIAG_Assert(infs, "Bad file descriptor!");
   
   CCTIdToCCTNodeMap cctNodeMap;
 
-  int ret = HPCFMT_ERR;
-
   // ------------------------------------------------------------
   // Read number of cct nodes
   // ------------------------------------------------------------
@@ -1508,24 +1441,73 @@ Profile::fmt_cct_fread(Profile& prof, FILE* infs, uint rFlags,
     numMetricsSrc = 0;
   }
 
-  hpcrun_fmt_cct_node_t nodeFmt;
-  nodeFmt.num_metrics = numMetricsSrc;
-  nodeFmt.metrics = (numMetricsSrc > 0) ?
-    (hpcrun_metricVal_t*)alloca(numMetricsSrc * sizeof(hpcrun_metricVal_t))
-    : NULL;
+  cctNodeMap.reserve(numNodes);
+
+  // Fixed-width node records are read in chunks of whole records with
+  // one fread() and each chunk is decoded in a tight loop (in parallel
+  // for large chunks) before building its CCT nodes.  Compact records
+  // have varying sizes and depend on the record before them, so they
+  // are read one at a time.
+  bool isCompact = prof.m_flags.fields.isCompactCCT;
+
+  size_t recSz = hpcrun_fmt_cct_node_sizeof(prof.m_flags, numMetricsSrc);
+  uint64_t chunkNodes = std::max<uint64_t>(1, CCTReadChunkSz / recSz);
+
+  std::vector<char> chunkBuf;
+  std::vector<hpcrun_fmt_cct_node_t> chunkFmt;
+  std::vector<hpcrun_metricVal_t> chunkMetrics;
+
+  hpcrun_fmt_cct_prev_t prev;
+  hpcrun_fmt_cct_prev_init(&prev);
+  if (isCompact) {
+    chunkFmt.resize(1);
+    chunkMetrics.resize(numMetricsSrc);
+    chunkFmt[0].num_metrics = numMetricsSrc;
+    chunkFmt[0].metrics = chunkMetrics.data();
+  }
 
 #if 0
   ExprEval eval;
 #endif
 
-  for (uint i = 0; i < numNodes; ++i) {
+  for (uint64_t i = 0; i < numNodes; ++i) {
     // ----------------------------------------------------------
-    // Read the node
+    // Read and decode the next chunk of nodes
     // ----------------------------------------------------------
-    ret = hpcrun_fmt_cct_node_fread(&nodeFmt, prof.m_flags, infs);
-    if (ret != HPCFMT_OK) {
-      DIAG_Throw("Error reading CCT node " << nodeFmt.id);
+    uint64_t chunkIdx = (isCompact) ? 0 : i % chunkNodes;
+    if (isCompact) {
+      int ret = hpcrun_fmt_cct_node_fread(&chunkFmt[0], prof.m_flags, &prev,
+					  infs);
+      if (ret != HPCFMT_OK) {
+	DIAG_Throw("Error reading CCT node " << i << " of " << numNodes);
+      }
     }
+    else if (chunkIdx == 0) {
+      long n = (long)std::min(chunkNodes, numNodes - i);
+      chunkBuf.resize(n * recSz);
+      chunkFmt.resize(n);
+      chunkMetrics.resize(n * numMetricsSrc);
+
+      if (fread(chunkBuf.data(), recSz, n, infs) != (size_t)n) {
+	DIAG_Throw("Error reading CCT node " << i << " of " << numNodes);
+      }
+
+      const char* buf = chunkBuf.data();
+      hpcrun_fmt_cct_node_t* fmt = chunkFmt.data();
+      hpcrun_metricVal_t* metrics = chunkMetrics.data();
+      epoch_flags_t flags = prof.m_flags;
+
+#ifdef ENABLE_OPENMP
+#pragma omp parallel for if (n >= CCTDecodeParallelMin)
+#endif
+      for (long j = 0; j < n; ++j) {
+	fmt[j].num_metrics = numMetricsSrc;
+	fmt[j].metrics = metrics + j * numMetricsSrc;
+	hpcrun_fmt_cct_node_decode(&fmt[j], flags, buf + j * recSz);
+      }
+    }
+    hpcrun_fmt_cct_node_t& nodeFmt = chunkFmt[chunkIdx];
+
     if (outfs) {
       hpcrun_fmt_cct_node_fprint(&nodeFmt, outfs, prof.m_flags,
 				 &metricTbl, "  ");
@@ -1787,11 +1769,14 @@ Profile::fmt_cct_fwrite(const Profile& prof, FILE* fs, uint wFlags)
   nodeFmt.metrics =
     (hpcrun_metricVal_t*) alloca(numMetrics * sizeof(hpcrun_metricVal_t));
 
+  hpcrun_fmt_cct_prev_t prev;
+  hpcrun_fmt_cct_prev_init(&prev);
+
   for (CCT::ANodeIterator it(prof.cct()->root()); it.Current(); ++it) {
     CCT::ANode* n = it.current();
     fmt_cct_makeNode(nodeFmt, *n, prof.m_flags);
 
-    ret = hpcrun_fmt_cct_node_fwrite(&nodeFmt, prof.m_flags, fs);
+    ret = hpcrun_fmt_cct_node_fwrite(&nodeFmt, prof.m_flags, &prev, fs);
     if (ret != HPCFMT_OK) return HPCFMT_ERR;
   }
 
@@ -2121,3 +2106,67 @@ fmt_cct_makeNode(hpcrun_fmt_cct_node_t& n_fmt, const Prof::CCT::ANode& n,
   }
 }
 
+
+//***************************************************************************
+// unit test
+//***************************************************************************
+
+// #define UNIT_TEST
+
+#ifdef UNIT_TEST
+
+// Merge a profile y whose trace ids conflict with those of x and check
+// that x receives the translation of y's trace file: y's node at ip
+// 0x10 merges with x's and takes x's id; y's node at ip 0x20 is new to
+// x but its id is already taken by x's node at 0x10.
+//
+// build: compile this file with UNIT_TEST defined and link it with
+// libHPCprof, libHPCsupport, libHPCxml and libHPCprof-lean.
+
+static Prof::CCT::Stmt*
+makeStmt(Prof::CCT::ANode* parent, uint cpId, VMA ip)
+{
+  return new Prof::CCT::Stmt(parent, cpId, lush_assoc_info_NULL,
+			     Prof::LoadMap::LMId_NULL, ip, 0, NULL,
+			     Prof::Metric::IData());
+}
+
+
+int
+main(int argc, char** argv)
+{
+  Prof::CallPath::Profile x("x");
+  Prof::CallPath::Profile* y = new Prof::CallPath::Profile("y");
+
+  x.traceFileNameSet().insert("x.hpctrace");
+  makeStmt(x.cct()->root(), 5, 0x10);
+
+  y->traceFileName("y.hpctrace");
+  y->traceFileNameSet().insert("y.hpctrace");
+  makeStmt(y->cct()->root(), 7, 0x10);
+  makeStmt(y->cct()->root(), 5, 0x20);
+
+  x.merge(*y, Prof::CallPath::Profile::Merge_MergeMetricByName,
+	  Prof::CCT::MrgFlg_NormalizeTraceFileY);
+  delete y;
+
+  const Prof::CallPath::Profile::TraceCpIdMaps& maps = x.traceCpIdMaps();
+  Prof::CallPath::Profile::TraceCpIdMaps::const_iterator it =
+    maps.find("y.hpctrace");
+  if (it == maps.end() || it->second.size() <= 7) {
+    std::cout << "failed: no cpId map for y.hpctrace" << std::endl;
+    return 1;
+  }
+
+  const std::vector<uint>& cpIdMap = it->second;
+  if (cpIdMap[7] != 5 || cpIdMap[5] == 5) {
+    std::cout << "failed: 7 -> " << cpIdMap[7] << ", 5 -> " << cpIdMap[5]
+	      << std::endl;
+    return 1;
+  }
+
+  std::cout << "passed" << std::endl;
+  return 0;
+}
+
+#endif
@@ -67,6 +67,7 @@
 
 #include <vector>
 #include <set>
+#include <map>
 #include <string>
 
 
@@ -131,6 +132,27 @@ public:
   traceFileNameSet()
   { return m_traceFileNameSet; }
 
+
+  // the trace file of a profile read from a file (empty once merged)
+  const std::string&
+  traceFileName() const
+  { return m_traceFileName; }
+
+  void
+  traceFileName(const std::string& x)
+  { m_traceFileName = x; }
+
+
+  // For each trace file whose call path ids changed while merging, the
+  // new id of every old id (identity for unchanged ids).  The trace
+  // files themselves are left untouched; the ids are translated when
+  // the files are copied into the database.
+  typedef std::map<std::string, std::vector<uint> > TraceCpIdMaps;
+
+  const TraceCpIdMaps&
+  traceCpIdMaps() const
+  { return m_traceCpIdMaps; }
+
   // enable/disable redundancy of procedure names
   // @param flag: true  -- redundancy is eliminated
   // 		  false -- redundancy is allowed
@@ -280,12 +302,13 @@ public:
   static const char* FmtEpoch_NV_virtualMetrics;
 
 
-  // make: build an empty Profile or build one from profile file 'fnm'
+  // make: build an empty Profile or build one from profile file 'fnm'.
+  // If 'nBytes' is non-null, it receives the number of bytes read.
   static Profile*
   make(uint rFlags);
 
   static Profile*
-  make(const char* fnm, uint rFlags, FILE* outfs);
+  make(const char* fnm, uint rFlags, FILE* outfs, uint64_t* nBytes = NULL);
 
   
   // fmt_*_fread(): Reads the appropriate hpcrun_fmt object from the
@@ -374,6 +397,7 @@ private:
 
   std::string m_traceFileName;   // non-empty, if relevant
   StringSet m_traceFileNameSet;
+  TraceCpIdMaps m_traceCpIdMaps;
   uint64_t m_traceMinTime, m_traceMaxTime;
 
   //typedef std::map<std::string, std::string> StrToStrMap;
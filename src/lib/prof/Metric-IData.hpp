@@ -76,6 +76,8 @@
 
 #include <include/uint.h>
 
+#include "Metric-IDataStore.hpp"
+
 #include <lib/support/diagnostics.h>
 
 
@@ -100,7 +102,7 @@ namespace Metric {
 class IData {
 public:
   
-  typedef std::vector<double> MetricVec;
+  typedef std::vector<double, IDataAllocator<double> > MetricVec;
 
 public:
   // --------------------------------------------------------
@@ -215,6 +217,14 @@ public:
   {
     m_metrics.insert(m_metrics.begin(), numMetrics, 0.0);
   }
+
+  // relocateMetrics: move the metric values to newly allocated
+  // storage (cf. IDataStore clustering)
+  void
+  relocateMetrics()
+  {
+    MetricVec(m_metrics).swap(m_metrics);
+  }
   
   uint
   numMetrics() const
@@ -0,0 +1,282 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//    $HeadURL$
+//
+// Purpose:
+//    [The purpose of this file]
+//
+// Description:
+//    [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+//************************* System Include Files ****************************
+
+#include <string>
+using std::string;
+
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <pthread.h>
+
+//*************************** User Include Files ****************************
+
+#include <include/uint.h>
+
+#include "Metric-IDataStore.hpp"
+
+#include <lib/support/diagnostics.h>
+
+//*************************** Forward Declarations **************************
+
+// Allocations are rounded up to this many bytes
+static const size_t AllocGrain = 16;
+
+// Mappings are made in segments of at least this size
+static const size_t SegmentSz = (64 * 1024 * 1024);
+
+struct Segment {
+  Segment(char* beg_, size_t sz_) : beg(beg_), sz(sz_) { }
+  char*  beg;
+  size_t sz;
+};
+
+static int    s_fd = -1;
+static off_t  s_fileSz = 0;
+
+static std::vector<Segment> s_segments;
+static char* s_cur = NULL; // unused part of the last segment
+static char* s_end = NULL;
+
+// free space, by (rounded) size
+static std::map<size_t, std::vector<char*> > s_freeLists;
+
+static bool s_isClustering = false;
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+static bool
+isMapped(const void* p)
+{
+  const char* x = static_cast<const char*>(p);
+  for (uint i = 0; i < s_segments.size(); ++i) {
+    const Segment& s = s_segments[i];
+    if (s.beg <= x && x < s.beg + s.sz) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+// newSegment: extend the file by at least 'sz' bytes and map the new
+// part.  Returns false on error.
+static bool
+newSegment(size_t sz)
+{
+  size_t pageSz = sysconf(_SC_PAGESIZE);
+  sz = std::max(sz, SegmentSz);
+  sz = ((sz + pageSz - 1) / pageSz) * pageSz;
+
+  if (ftruncate(s_fd, s_fileSz + sz) != 0) {
+    DIAG_EMsg("Metric::IDataStore: could not extend file: "
+	      << strerror(errno));
+    return false;
+  }
+
+  void* addr = mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_SHARED,
+		    s_fd, s_fileSz);
+  if (addr == MAP_FAILED) {
+    DIAG_EMsg("Metric::IDataStore: could not map file: " << strerror(errno));
+    return false;
+  }
+  s_fileSz += sz;
+
+  // keep what is left of the current segment for small requests
+  if (s_cur && s_cur < s_end) {
+    s_freeLists[s_end - s_cur].push_back(s_cur);
+  }
+
+  s_segments.push_back(Segment(static_cast<char*>(addr), sz));
+  s_cur = static_cast<char*>(addr);
+  s_end = s_cur + sz;
+  return true;
+}
+
+
+//***************************************************************************
+
+namespace Prof {
+namespace Metric {
+
+
+//***************************************************************************
+// IDataStore
+//***************************************************************************
+
+bool IDataStore::s_isEnabled = false;
+
+
+bool
+IDataStore::enable(const string& dir)
+{
+  if (s_isEnabled) {
+    return true;
+  }
+
+  string fnm = dir + "/hpcprof-cct-XXXXXX";
+  std::vector<char> buf(fnm.begin(), fnm.end());
+  buf.push_back('\0');
+
+  s_fd = mkstemp(&buf[0]);
+  if (s_fd < 0) {
+    DIAG_EMsg("Metric::IDataStore: could not create a file in '" << dir
+	      << "': " << strerror(errno));
+    return false;
+  }
+  unlink(&buf[0]); // removed when we exit
+
+  s_isEnabled = true;
+  return true;
+}
+
+
+void*
+IDataStore::allocateMapped(size_t sz)
+{
+  sz = std::max(AllocGrain, ((sz + AllocGrain - 1) / AllocGrain) * AllocGrain);
+
+  pthread_mutex_lock(&s_lock);
+
+  char* x = NULL;
+  if (!s_isClustering) {
+    std::map<size_t, std::vector<char*> >::iterator it = s_freeLists.find(sz);
+    if (it != s_freeLists.end() && !it->second.empty()) {
+      x = it->second.back();
+      it->second.pop_back();
+    }
+  }
+
+  if (!x) {
+    if ((size_t)(s_end - s_cur) < sz && !newSegment(sz)) {
+      pthread_mutex_unlock(&s_lock);
+      throw std::bad_alloc();
+    }
+    x = s_cur;
+    s_cur += sz;
+  }
+
+  pthread_mutex_unlock(&s_lock);
+  return x;
+}
+
+
+void
+IDataStore::deallocateMapped(void* p, size_t sz)
+{
+  if (!p) {
+    return;
+  }
+
+  pthread_mutex_lock(&s_lock);
+
+  if (!isMapped(p)) {
+    // allocated before enable()
+    pthread_mutex_unlock(&s_lock);
+    ::operator delete(p);
+    return;
+  }
+
+  sz = std::max(AllocGrain, ((sz + AllocGrain - 1) / AllocGrain) * AllocGrain);
+  s_freeLists[sz].push_back(static_cast<char*>(p));
+
+  pthread_mutex_unlock(&s_lock);
+}
+
+
+void
+IDataStore::beginCluster()
+{
+  pthread_mutex_lock(&s_lock);
+  s_isClustering = true;
+  pthread_mutex_unlock(&s_lock);
+}
+
+
+void
+IDataStore::endCluster()
+{
+  pthread_mutex_lock(&s_lock);
+  s_isClustering = false;
+  pthread_mutex_unlock(&s_lock);
+}
+
+
+uint64_t
+IDataStore::fileSize()
+{
+  return s_fileSz;
+}
+
+
+//***************************************************************************
+
+} // namespace Metric
+} // namespace Prof
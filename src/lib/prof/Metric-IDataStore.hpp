@@ -0,0 +1,226 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   [The purpose of this file]
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+#ifndef prof_Prof_Metric_IDataStore_hpp 
+#define prof_Prof_Metric_IDataStore_hpp
+
+//************************* System Include Files ****************************
+
+#include <string>
+#include <new>
+
+#include <cstddef>
+#include <stdint.h>
+
+//*************************** User Include Files ****************************
+
+#include <include/gcc-attr.h>
+#include <include/uint.h>
+
+//*************************** Forward Declarations **************************
+
+
+//***************************************************************************
+
+namespace Prof {
+namespace Metric {
+
+//***************************************************************************
+// IDataStore
+//
+// Storage for the metric values of Metric::IData.  By default values
+// live on the heap.  Once enable() is called, new values are placed in
+// a file mapped into memory (out-of-core mode), so the kernel can
+// write them back and evict them when a CCT is larger than memory.
+//
+// Clustering: between beginCluster() and endCluster(), freed space is
+// not reused and allocations are contiguous.  Reallocating every
+// node's values in traversal order (cf. CCT::Tree::clusterMetrics())
+// thus gives traversals page-sequential access.
+//***************************************************************************
+
+class IDataStore {
+public:
+
+  // enable: keep all subsequently allocated metric values in an
+  // (unlinked) temporary file in 'dir'.  Returns false on error, in
+  // which case values stay on the heap.
+  static bool
+  enable(const std::string& dir);
+
+  static bool
+  isEnabled()
+  { return s_isEnabled; }
+
+  static void*
+  allocate(size_t sz)
+  {
+    if (!s_isEnabled) {
+      return ::operator new(sz);
+    }
+    return allocateMapped(sz);
+  }
+
+  static void
+  deallocate(void* p, size_t sz)
+  {
+    if (!s_isEnabled) {
+      ::operator delete(p);
+      return;
+    }
+    deallocateMapped(p, sz);
+  }
+
+  static void
+  beginCluster();
+
+  static void
+  endCluster();
+
+  // size of the backing file in bytes (0 if not enabled)
+  static uint64_t
+  fileSize();
+
+private:
+  static void*
+  allocateMapped(size_t sz);
+
+  static void
+  deallocateMapped(void* p, size_t sz);
+
+private:
+  static bool s_isEnabled;
+};
+
+
+//***************************************************************************
+// IDataAllocator
+//
+// A (stateless) std::allocator replacement that uses IDataStore
+//***************************************************************************
+
+template <typename T>
+class IDataAllocator {
+public:
+  typedef T         value_type;
+  typedef T*        pointer;
+  typedef const T*  const_pointer;
+  typedef T&        reference;
+  typedef const T&  const_reference;
+  typedef size_t    size_type;
+  typedef ptrdiff_t difference_type;
+
+  template <typename U>
+  struct rebind { typedef IDataAllocator<U> other; };
+
+  IDataAllocator()
+  { }
+
+  template <typename U>
+  IDataAllocator(const IDataAllocator<U>& GCC_ATTR_UNUSED x)
+  { }
+
+  pointer
+  address(reference x) const
+  { return &x; }
+
+  const_pointer
+  address(const_reference x) const
+  { return &x; }
+
+  pointer
+  allocate(size_type n, const void* GCC_ATTR_UNUSED hint = 0)
+  { return static_cast<pointer>(IDataStore::allocate(n * sizeof(T))); }
+
+  void
+  deallocate(pointer p, size_type n)
+  { IDataStore::deallocate(p, n * sizeof(T)); }
+
+  size_type
+  max_size() const
+  { return size_type(-1) / sizeof(T); }
+
+  void
+  construct(pointer p, const T& x)
+  { new(p) T(x); }
+
+  void
+  destroy(pointer p)
+  { p->~T(); }
+};
+
+
+template <typename T, typename U>
+inline bool
+operator==(const IDataAllocator<T>&, const IDataAllocator<U>&)
+{ return true; }
+
+template <typename T, typename U>
+inline bool
+operator!=(const IDataAllocator<T>&, const IDataAllocator<U>&)
+{ return false; }
+
+
+//***************************************************************************
+
+} // namespace Metric
+} // namespace Prof
+
+
+#endif /* prof_Prof_Metric_IDataStore_hpp */
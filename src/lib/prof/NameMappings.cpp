@@ -52,6 +52,7 @@ const char *GPU_KERNEL  = "<gpu kernel>";
 const char *GPU_TRACE   = "<gpu kernel>";
 
 const char *NO_ACTIVITY = "<no activity>";
+const char *PRUNED      = "<pruned call paths>";
 
 
 //******************************************************************************
@@ -116,11 +117,13 @@ static NameMapping renamingTable[] = {
   { "gpu_op_kernel",       GPU_KERNEL            },
   { "gpu_op_trace",        GPU_TRACE             },
 
-  { "hpcrun_no_activity",  NO_ACTIVITY           }
+  { "hpcrun_no_activity",  NO_ACTIVITY           },
+  { "hpcrun_pruned_call_paths", PRUNED           }
 };
 
 static const char *fakeProcedures[] = {
-  PROGRAM_ROOT, THREAD_ROOT, GUARD_NAME, NO_ACTIVITY, "<partial call paths>"
+  PROGRAM_ROOT, THREAD_ROOT, GUARD_NAME, NO_ACTIVITY, PRUNED,
+  "<partial call paths>"
 };
 
 static NameMappings_t renamingMap;
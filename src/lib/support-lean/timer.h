@@ -166,6 +166,11 @@ time_getTSC()
 
   asm volatile (".byte 0x0f, 0x31" : "=A" (tsc));
 
+#elif defined(__aarch64__)
+
+  // virtual counter: constant frequency, readable from user space
+  asm volatile ("mrs %0, cntvct_el0" : "=r" (tsc));
+
 #elif defined(__powerpc64__)
   
   asm volatile ("mftb %0" : "=r" (tsc) : );
@@ -63,6 +63,11 @@
 
 #include <fnmatch.h>
 
+#if defined(__linux__)
+# include <sys/ioctl.h>
+# include <linux/fs.h> // FICLONE
+#endif
+
 #include <string>
 using std::string;
 
@@ -268,6 +273,48 @@ copy(const char* dst, ...)
 }
 
 
+bool
+link(const char* dst, const char* src)
+{
+  if (::link(src, dst) == 0) {
+    return true;
+  }
+  if (errno == EEXIST && unlink(dst) == 0 && ::link(src, dst) == 0) {
+    return true;
+  }
+  return false;
+}
+
+
+bool
+clone(const char* dst, const char* src)
+{
+#if defined(FICLONE)
+  int srcFd = open(src, O_RDONLY);
+  if (srcFd < 0) {
+    return false;
+  }
+  int dstFd = open(dst, O_WRONLY | O_CREAT | O_TRUNC,
+		   S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if (dstFd < 0) {
+    close(srcFd);
+    return false;
+  }
+
+  bool ok = (ioctl(dstFd, FICLONE, srcFd) == 0);
+
+  close(srcFd);
+  close(dstFd);
+  if (!ok) {
+    unlink(dst);
+  }
+  return ok;
+#else
+  return false;
+#endif
+}
+
+
 void
 move(const char* dst, const char* src)
 {
@@ -350,7 +397,7 @@ mkdir(const char* dir)
     }
 
     int ret = ::mkdir(x.c_str(), mode);
-    if (ret != 0) {
+    if (ret != 0 && !(errno == EEXIST && isDir(x))) { // lost a race: ok
       DIAG_Throw("[FileUtil::mkdir] '" << pathStr << "': Could not mkdir '"
 		 << x << "' (" << strerror(errno) << ")");
     }
@@ -167,6 +167,31 @@ copy(const std::string& dst, const std::string& src)
 }
 
 
+// link: makes 'dst' a hard link to 'src', replacing any existing
+// 'dst'.  Returns false if no link could be made (e.g., the files
+// would be on different file systems).
+extern bool
+link(const char* dst, const char* src);
+
+inline bool
+link(const std::string& dst, const std::string& src)
+{
+  return link(dst.c_str(), src.c_str());
+}
+
+
+// clone: makes 'dst' a copy-on-write copy (reflink) of 'src'.
+// Returns false if the file system cannot do this.
+extern bool
+clone(const char* dst, const char* src);
+
+inline bool
+clone(const std::string& dst, const std::string& src)
+{
+  return clone(dst.c_str(), src.c_str());
+}
+
+
 void
 move(const char* dst, const char* src);
 
@@ -118,6 +118,15 @@ public:
   { delete[] m_packedData; }
 
 
+  // zero: zero all metric values (leaving the header intact)
+  void
+  zero()
+  {
+    memset(m_packedData + m_numHdr, 0,
+	   (m_numNodes * m_numMetrics) * sizeof(double));
+  }
+
+
   // 0 based indexing (row-major layout)
   double
   idx(uint idxNodes, uint idxMetrics) const
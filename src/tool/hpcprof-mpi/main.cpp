@@ -75,6 +75,8 @@ using std::string;
 #include <vector>
 using std::vector;
 
+#include <algorithm>
+
 #include <cstdlib> // getenv()
 #include <cmath>   // ceil()
 #include <climits> // UCHAR_MAX, PATH_MAX
@@ -93,6 +95,7 @@ using std::vector;
 
 #include <lib/binutils/VMAInterval.hpp>
 #include <lib/prof/FileError.hpp>
+#include <lib/prof/Metric-IDataStore.hpp>
 
 #include <lib/prof-lean/hpcrun-fmt.h>
 
@@ -105,6 +108,15 @@ using std::vector;
 
 //*************************** Forward Declarations ***************************
 
+// CCTAggregationMaps: aggregation targets of the canonical CCT, by
+// dense id (cf. Prof::CCT::ANode::makeAggregationMaps())
+struct CCTAggregationMaps {
+  vector<uint> inclParent;
+  vector<uint> exclParent;
+  vector<uint> exclFrame;
+};
+
+
 static int
 realmain(int argc, char* const* argv);
 
@@ -146,16 +158,27 @@ makeSummaryMetrics_Lcl(Prof::CallPath::Profile& profGbl,
 
 static void
 makeThreadMetrics_Lcl(Prof::CallPath::Profile& profGbl,
+		      const CCTAggregationMaps& aggMaps,
 		      const string& profileFile,
 		      const Analysis::Args& args, uint groupId, uint groupMax,
 		      int myRank);
 
+static void
+pullThreadMetrics(Prof::CCT::ANode* x, const Prof::CCT::ANode* y,
+		  const ParallelAnalysis::PackedMetrics& yMetrics,
+		  ParallelAnalysis::PackedMetrics& packedMetrics);
+
+static void
+aggregateThreadMetrics(const CCTAggregationMaps& aggMaps,
+		       const Prof::Metric::Mgr& mMgr,
+		       ParallelAnalysis::PackedMetrics& packedMetrics);
+
 static string
 makeDBFileName(const string& dbDir, uint groupId, const string& profileFile);
 
 static void
-writeMetricsDB(Prof::CallPath::Profile& profGbl, uint mBegId, uint mEndId,
-	       const string& metricDBFnm);
+writeMetricsDB(const ParallelAnalysis::PackedMetrics& packedMetrics,
+	       const string& metricDBFnm, int/*MetricDBLayout*/ layout);
 
 
 static void
@@ -241,6 +264,12 @@ realmain(int argc, char* const* argv)
   args.parse(argc, argv); // may call exit()
 
   RealPathMgr::singleton().searchPaths(args.searchPathStr());
+
+  if (!args.prof_oocDir.empty()) {
+    if (!Prof::Metric::IDataStore::enable(args.prof_oocDir)) {
+      DIAG_Die("could not keep metric values in '" << args.prof_oocDir << "'");
+    }
+  }
   hpcprof_set_abort_timeout();
 
   // -------------------------------------------------------
@@ -360,6 +389,7 @@ realmain(int argc, char* const* argv)
 
   // N.B.: Dense ids are assigned w.r.t. Prof::CCT::...::cmpByStructureInfo()
   profGbl->cct()->makeDensePreorderIds();
+  profGbl->cct()->clusterMetrics();
 
   // -------------------------------------------------------
   // 2a. Create summary metrics for canonical CCT
@@ -428,7 +458,13 @@ realmain(int argc, char* const* argv)
     Analysis::CallPath::makeDatabase(*profGbl, args);
   }
   else {
-    Analysis::Util::copyTraceFiles(args.db_dir, profGbl->traceFileNameSet());
+    string traceContainer;
+    if (args.db_traceContainer) {
+      traceContainer = "experiment-" + StrUtil::toStr(myRank) + "."
+	+ HPCRUN_ContainerFnmSfx;
+    }
+    Analysis::Util::copyTraceFiles(args.db_dir, profGbl->traceFileNameSet(),
+				    profGbl->traceCpIdMaps(), traceContainer);
   }
 
   // -------------------------------------------------------
@@ -663,10 +699,43 @@ makeThreadMetrics(Prof::CallPath::Profile& profGbl,
 		  const vector<uint>& groupIdToGroupSizeMap,
 		  int myRank, int numRanks)
 {
-  for (uint i = 0; i < nArgs.paths->size(); ++i) {
-    string& fnm = (*nArgs.paths)[i];
+  // Thread-level metric values are not staged in the canonical CCT's
+  // nodes but in a per-profile matrix indexed by dense id, which is
+  // aggregated using the canonical CCT's aggregation maps.  This lets
+  // one rank work on several of its thread profiles at once.
+  CCTAggregationMaps aggMaps;
+  if (args.db_makeMetricDB) {
+    uint numNodes = profGbl.cct()->maxDenseId() + 1;
+    aggMaps.inclParent.resize(numNodes, 0);
+    aggMaps.exclParent.resize(numNodes, 0);
+    aggMaps.exclFrame.resize(numNodes, 0);
+    profGbl.cct()->root()->makeAggregationMaps(aggMaps.inclParent,
+					       aggMaps.exclParent,
+					       aggMaps.exclFrame);
+  }
+
+  long numPaths = nArgs.paths->size();
+
+#ifdef ENABLE_OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+  for (long i = 0; i < numPaths; ++i) {
+    const string& fnm = (*nArgs.paths)[i];
     uint groupId = (*nArgs.groupMap)[i];
-    makeThreadMetrics_Lcl(profGbl, fnm, args, groupId, nArgs.groupMax, myRank);
+
+    // N.B.: exceptions may not escape an OpenMP region
+    try {
+      makeThreadMetrics_Lcl(profGbl, aggMaps, fnm, args, groupId,
+			    nArgs.groupMax, myRank);
+    }
+    catch (const Diagnostics::Exception& x) {
+      DIAG_EMsg(x.message());
+      prof_abort(1);
+    }
+    catch (const std::exception& x) {
+      DIAG_EMsg("[std::exception] " << x.what());
+      prof_abort(1);
+    }
   }
 }
 
@@ -875,33 +944,38 @@ makeSummaryMetrics_Lcl(Prof::CallPath::Profile& profGbl,
 // exception: Each thread-level CCT does not have to be a subset of
 // 'profGbl' (the canonical CCT); in other words, 'profGbl' may be
 // pruned.
+//
+// May be called concurrently: overlaying static structure and merging
+// into 'profGbl' update shared state (the canonical CCT's cp-ids and
+// metric and trace tables, lazily built structure maps) and are
+// serialized; reading the profile and aggregating and writing the
+// metric values are not.
 static void
 makeThreadMetrics_Lcl(Prof::CallPath::Profile& profGbl,
+		      const CCTAggregationMaps& aggMaps,
 		      const string& profileFile,
 		      const Analysis::Args& args, uint groupId, uint groupMax,
 		      int myRank)
 {
-  Prof::Metric::Mgr* mMgrGbl = profGbl.metricMgr();
   Prof::CCT::Tree* cctGbl = profGbl.cct();
   Prof::CCT::ANode* cctRootGbl = cctGbl->root();
 
-  // -------------------------------------------------------
-  // read profile file
-  // -------------------------------------------------------
   uint rFlags = (Prof::CallPath::Profile::RFlg_NoMetricSfx
 		 | Prof::CallPath::Profile::RFlg_MakeInclExcl);
   uint rGroupId = (groupMax > 1) ? groupId : 0;
 
-  Prof::CallPath::Profile* prof =
-    Analysis::CallPath::read(profileFile, rGroupId, rFlags);
-
-  // -------------------------------------------------------
-  // merge into canonical CCT
-  // -------------------------------------------------------
   int mergeTy  = Prof::CallPath::Profile::Merge_MergeMetricByName;
   int mergeFlg = (Prof::CCT::MrgFlg_NormalizeTraceFileY
 		  | Prof::CCT::MrgFlg_CCTMergeOnly);
 
+  ParallelAnalysis::PackedMetrics* packedMetrics = NULL;
+
+  // -------------------------------------------------------
+  // read profile file
+  // -------------------------------------------------------
+  Prof::CallPath::Profile* prof =
+    Analysis::CallPath::read(profileFile, rGroupId, rFlags);
+
   // Add *some* structure information to the leaves of 'prof' so that
   // it will be merged successfully with the structured canonical CCT
   // 'profGbl'.
@@ -912,54 +986,164 @@ makeThreadMetrics_Lcl(Prof::CallPath::Profile& profGbl,
   // into 'profGbl' (using CallPath::Profile::merge()), many leaves in
   // 'prof' will not find their corresponding node in 'profGbl' unless
   // corrective measures are taken.
-  prof->structure(profGbl.structure());
-  Analysis::CallPath::noteStaticStructureOnLeaves(*prof);
-  prof->structure(NULL);
+#ifdef ENABLE_OPENMP
+#pragma omp critical (hpcprof_makeThreadMetrics)
+#endif
+  {
+    prof->structure(profGbl.structure());
+    Analysis::CallPath::noteStaticStructureOnLeaves(*prof);
+    prof->structure(NULL);
+  }
 
-  uint mBeg = profGbl.merge(*prof, mergeTy, mergeFlg); // [closed begin
+  // -------------------------------------------------------
+  // set aside the sampled metric values of 'prof' so that merging
+  // leaves the canonical CCT's metric values untouched
+  // -------------------------------------------------------
+  ParallelAnalysis::PackedMetrics* yMetrics = NULL;
 
   if (args.db_makeMetricDB) {
-    uint mEnd = mBeg + prof->metricMgr()->size(); // open end)
+    Prof::CCT::Tree* cct = prof->cct();
+    uint numMetrics = prof->metricMgr()->size();
+
+    uint maxId = cct->makeDensePreorderIds();
+    yMetrics = new ParallelAnalysis::PackedMetrics(maxId + 1, 0, numMetrics,
+						   0, numMetrics);
+    yMetrics->zero();
+
+    for (Prof::CCT::ANodeIterator it(cct->root()); it.Current(); ++it) {
+      Prof::CCT::ANode* n = it.current();
+      for (uint mId = 0; mId < numMetrics && mId < n->numMetrics(); ++mId) {
+	yMetrics->idx(n->id(), mId) = n->metric(mId);
+      }
+      n->clearMetrics();
+    }
+  }
+
+#ifdef ENABLE_OPENMP
+#pragma omp critical (hpcprof_makeThreadMetrics)
+#endif
+  {
+    // -----------------------------------------------------
+    // merge into canonical CCT (normalizes 'prof' and its trace)
+    // -----------------------------------------------------
+    profGbl.merge(*prof, mergeTy, mergeFlg);
+
+    // -----------------------------------------------------
+    // place metric values at the canonical CCT's dense ids
+    // -----------------------------------------------------
+    if (yMetrics) {
+      uint numMetrics = yMetrics->numMetrics();
+      packedMetrics =
+	new ParallelAnalysis::PackedMetrics(cctGbl->maxDenseId() + 1,
+					    0, numMetrics, 0, numMetrics);
+      packedMetrics->zero();
+
+      pullThreadMetrics(cctRootGbl, prof->cct()->root(), *yMetrics,
+			*packedMetrics);
+    }
+  }
+
+  delete yMetrics;
 
+  if (packedMetrics) {
     // -------------------------------------------------------
     // compute local incl/excl sampled metrics
     // -------------------------------------------------------
-
-    VMAIntervalSet ivalsetIncl;
-    VMAIntervalSet ivalsetExcl;
-    
-    for (uint mId = mBeg; mId < mEnd; ++mId) {
-      Prof::Metric::ADesc* m = mMgrGbl->metric(mId);
-      if (m->type() == Prof::Metric::ADesc::TyIncl) {
-	ivalsetIncl.insert(VMAInterval(mId, mId + 1)); // [ )
-      }
-      else if (m->type() == Prof::Metric::ADesc::TyExcl) {
-	ivalsetExcl.insert(VMAInterval(mId, mId + 1)); // [ )
-      }
-    }
-    
-    cctRootGbl->aggregateMetricsIncl(ivalsetIncl);
-    cctRootGbl->aggregateMetricsExcl(ivalsetExcl);
+    aggregateThreadMetrics(aggMaps, *prof->metricMgr(), *packedMetrics);
 
     // -------------------------------------------------------
     // write local sampled metric values into database
     // -------------------------------------------------------
-
     string dbFnm = makeDBFileName(args.db_dir, groupId, profileFile);
-    writeMetricsDB(profGbl, mBeg, mEnd, dbFnm);
+    writeMetricsDB(*packedMetrics, dbFnm, args.db_metricDBLayout);
 
-    // -------------------------------------------------------
-    // reinitialize metric values for next time
-    // -------------------------------------------------------
-    
-    // TODO: see corresponding comments in makeSummaryMetrics_Lcl()
-    cctRootGbl->zeroMetricsDeep(mBeg, mEnd); // cf. FnInitSrc
+    delete packedMetrics;
   }
 
   delete prof;
 }
 
 
+// pullThreadMetrics: Let x be a node of the canonical CCT and y the
+// corresponding node of a (merged) thread-level CCT.  Adds the values
+// 'yMetrics' of y's descendents to 'packedMetrics' at the dense ids of
+// their counterparts in x, matching nodes as CCT::ANode::mergeDeep()
+// does.  Descendents that were pruned from x are dropped.
+static void
+pullThreadMetrics(Prof::CCT::ANode* x, const Prof::CCT::ANode* y,
+		  const ParallelAnalysis::PackedMetrics& yMetrics,
+		  ParallelAnalysis::PackedMetrics& packedMetrics)
+{
+  uint numMetrics = packedMetrics.numMetrics();
+
+  for (Prof::CCT::ANodeChildIterator it(y); it.Current(); ++it) {
+    const Prof::CCT::ANode* y_child = it.current();
+    const Prof::CCT::ADynNode* y_child_dyn =
+      dynamic_cast<const Prof::CCT::ADynNode*>(y_child);
+    if (!y_child_dyn) {
+      continue;
+    }
+
+    Prof::CCT::ADynNode* x_child_dyn = x->findDynChild(*y_child_dyn);
+    if (!x_child_dyn) {
+      continue;
+    }
+
+    uint x_id = x_child_dyn->id(), y_id = y_child->id();
+    for (uint mId = 0; mId < numMetrics; ++mId) {
+      packedMetrics.idx(x_id, mId) += yMetrics.idx(y_id, mId);
+    }
+
+    pullThreadMetrics(x_child_dyn, y_child, yMetrics, packedMetrics);
+  }
+}
+
+
+// aggregateThreadMetrics: the counterpart of
+// CCT::ANode::aggregateMetricsIncl() and aggregateMetricsExcl() for
+// values in 'packedMetrics', whose columns are described by 'mMgr'.
+static void
+aggregateThreadMetrics(const CCTAggregationMaps& aggMaps,
+		       const Prof::Metric::Mgr& mMgr,
+		       ParallelAnalysis::PackedMetrics& packedMetrics)
+{
+  vector<uint> inclIds, exclIds;
+  for (uint mId = 0; mId < packedMetrics.numMetrics(); ++mId) {
+    const Prof::Metric::ADesc* m = mMgr.metric(mId);
+    if (m->type() == Prof::Metric::ADesc::TyIncl) {
+      inclIds.push_back(mId);
+    }
+    else if (m->type() == Prof::Metric::ADesc::TyExcl) {
+      exclIds.push_back(mId);
+    }
+  }
+
+  // children have larger dense ids than their parents
+  for (uint nodeId = packedMetrics.numNodes() - 1; nodeId > 0; --nodeId) {
+    uint parentId = aggMaps.inclParent[nodeId];
+    if (parentId != 0) {
+      for (uint i = 0; i < inclIds.size(); ++i) {
+	uint mId = inclIds[i];
+	packedMetrics.idx(parentId, mId) += packedMetrics.idx(nodeId, mId);
+      }
+    }
+
+    parentId = aggMaps.exclParent[nodeId];
+    if (parentId != 0) {
+      uint frameId = aggMaps.exclFrame[nodeId];
+      for (uint i = 0; i < exclIds.size(); ++i) {
+	uint mId = exclIds[i];
+	double mVal = packedMetrics.idx(nodeId, mId);
+	packedMetrics.idx(parentId, mId) += mVal;
+	if (frameId != 0) {
+	  packedMetrics.idx(frameId, mId) += mVal;
+	}
+      }
+    }
+  }
+}
+
+
 static string
 makeDBFileName(const string& dbDir, uint groupId, const string& profileFile)
 {
@@ -974,23 +1158,11 @@ makeDBFileName(const string& dbDir, uint groupId, const string& profileFile)
 }
 
 
-// [mBegId, mEndId)
+// 'packedMetrics' holds the metric values by dense CCT id
 static void
-writeMetricsDB(Prof::CallPath::Profile& profGbl, uint mBegId, uint mEndId,
-	       const string& metricDBFnm)
+writeMetricsDB(const ParallelAnalysis::PackedMetrics& packedMetrics,
+	       const string& metricDBFnm, int/*MetricDBLayout*/ layout)
 {
-  const Prof::CCT::Tree& cct = *(profGbl.cct());
-
-  // -------------------------------------------------------
-  // pack metrics into dense matrix
-  // -------------------------------------------------------
-  uint maxCCTId = cct.maxDenseId();
-
-  ParallelAnalysis::PackedMetrics packedMetrics(maxCCTId + 1, mBegId, mEndId,
-						mBegId, mEndId);
-
-  ParallelAnalysis::packMetrics(profGbl, packedMetrics);
-
   // -------------------------------------------------------
   // write data
   // -------------------------------------------------------
@@ -1012,24 +1184,74 @@ writeMetricsDB(Prof::CallPath::Profile& profGbl, uint mBegId, uint mEndId,
   // 1. header
   hpcmetricDB_fmt_hdr_t hdr;
   hdr.numNodes = numNodes;
-  hdr.numMetrics = mEndId - mBegId; // [mBegId mEndId)
+  hdr.numMetrics = packedMetrics.numMetrics();
+  hdr.layout = HPCMETRICDB_Layout_Row;
+  hdr.blockNodes = 0;
+  if (layout == Analysis::Args::MetricDBLayout_Blocked) {
+    hdr.layout = HPCMETRICDB_Layout_Blocked;
+    hdr.blockNodes = HPCMETRICDB_FMT_BlockNodes;
+  }
 
   int ret;
   ret = hpcmetricDB_fmt_hdr_fwrite(&hdr, fs);
   if (ret == HPCFMT_ERR) goto badwrite;
 
-  // 2. metric values
-  //    - first row corresponds to node 1.
-  //    - first column corresponds to first sampled metric.
-  // cf. ParallelAnalysis::unpackMetrics: 
+  if (hdr.layout == HPCMETRICDB_Layout_Row) {
+    // 2. metric values
+    //    - first row corresponds to node 1.
+    //    - first column corresponds to first sampled metric.
+    // cf. ParallelAnalysis::unpackMetrics: 
+
+    for (uint nodeId = 1; nodeId < numNodes + 1; ++nodeId) {
+      for (uint mId1 = 0; mId1 < hdr.numMetrics; ++mId1) {
+	double mval = packedMetrics.idx(nodeId, mId1);
+	DIAG_MsgIf(0,  "  " << nodeId << " -> " << mval);
+	ret = hpcfmt_real8_fwrite(mval, fs);
+	if (ret == HPCFMT_ERR) goto badwrite;
+      }
+    }
+  }
+  else {
+    // 2. block directory: file offset of each metric's blocks, 0 for
+    //    blocks that are all zeros (and are not written)
+    uint B = hdr.blockNodes;
+    uint numBlocks = hpcmetricDB_fmt_numBlocks(&hdr);
+    std::vector<uint64_t> blockOff(hdr.numMetrics * numBlocks, 0);
+
+    uint64_t off = hpcmetricDB_fmt_hdr_size(&hdr);
+    for (uint mId1 = 0; mId1 < hdr.numMetrics; ++mId1) {
+      for (uint blk = 0; blk < numBlocks; ++blk) {
+	uint nodeBeg = blk * B + 1;
+	uint nodeEnd = std::min(nodeBeg + B, numNodes + 1);
+	for (uint nodeId = nodeBeg; nodeId < nodeEnd; ++nodeId) {
+	  if (packedMetrics.idx(nodeId, mId1) != 0.0) {
+	    blockOff[mId1 * numBlocks + blk] = off;
+	    off += (nodeEnd - nodeBeg) * sizeof(double);
+	    break;
+	  }
+	}
+      }
+    }
 
-  for (uint nodeId = 1; nodeId < numNodes + 1; ++nodeId) {
-    for (uint mId1 = 0, mId2 = mBegId; mId2 < mEndId; ++mId1, ++mId2) {
-      double mval = packedMetrics.idx(nodeId, mId1);
-      DIAG_MsgIf(0,  "  " << nodeId << " -> " << mval);
-      ret = hpcfmt_real8_fwrite(mval, fs);
+    for (uint i = 0; i < blockOff.size(); ++i) {
+      ret = hpcfmt_int8_fwrite(blockOff[i], fs);
       if (ret == HPCFMT_ERR) goto badwrite;
     }
+
+    // 3. metric values, metric by metric, in the directory's order
+    for (uint mId1 = 0; mId1 < hdr.numMetrics; ++mId1) {
+      for (uint blk = 0; blk < numBlocks; ++blk) {
+	if (blockOff[mId1 * numBlocks + blk] == 0) {
+	  continue;
+	}
+	uint nodeBeg = blk * B + 1;
+	uint nodeEnd = std::min(nodeBeg + B, numNodes + 1);
+	for (uint nodeId = nodeBeg; nodeId < nodeEnd; ++nodeId) {
+	  ret = hpcfmt_real8_fwrite(packedMetrics.idx(nodeId, mId1), fs);
+	  if (ret == HPCFMT_ERR) goto badwrite;
+	}
+      }
+    }
   }
 
   hpcio_fclose(fs);
@@ -77,6 +77,8 @@ using std::string;
 #include <lib/analysis/CallPath.hpp>
 #include <lib/analysis/Util.hpp>
 
+#include <lib/prof/Metric-IDataStore.hpp>
+
 #include <lib/support/diagnostics.h>
 #include <lib/support/RealPathMgr.hpp>
 
@@ -141,6 +143,12 @@ realmain(int argc, char* const* argv)
 
   RealPathMgr::singleton().searchPaths(args.searchPathStr());
 
+  if (!args.prof_oocDir.empty()) {
+    if (!Prof::Metric::IDataStore::enable(args.prof_oocDir)) {
+      DIAG_Die("could not keep metric values in '" << args.prof_oocDir << "'");
+    }
+  }
+
   Analysis::Util::NormalizeProfileArgs_t nArgs =
     Analysis::Util::normalizeProfileArgs(args.profileFiles);
 
@@ -231,6 +239,12 @@ realmain(int argc, char* const* argv)
   }
 
   prof->cct()->makeDensePreorderIds();
+  prof->cct()->clusterMetrics();
+
+  if (Prof::Metric::IDataStore::isEnabled()) {
+    DIAG_Msg(1, "Metric values file: "
+	     << Prof::Metric::IDataStore::fileSize() << " bytes");
+  }
 
   // -------------------------------------------------------
   // 2c. Create thread-level metric DB
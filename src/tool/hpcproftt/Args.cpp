@@ -104,7 +104,17 @@ static const char* usage_details =
 		 "\n"
 		 "Options:\n"
 		 "  -V, --version        Print version information.\n"
-		 "  -h, --help           Print this help.\n";
+		 "  -h, --help           Print this help.\n"
+		 "  -n <ids>, --node-id <ids>\n"
+		 "                       Only print the CCT nodes (or metric-db rows and\n"
+		 "                       trace records) with these ids.  <ids> is a comma\n"
+		 "                       separated list; may be given more than once.\n"
+		 "  -m <ids>, --metric-id <ids>\n"
+		 "                       Only print the metrics with these ids.  <ids> is\n"
+		 "                       as for --node-id.\n"
+		 "\n"
+		 "Profiles are decoded and printed one record at a time, so\n"
+		 "memory use does not grow with the size of the profile.\n";
 
 #define CLP CmdLineParser
 #define CLP_SEPARATOR "!!!"
@@ -116,6 +126,12 @@ CmdLineParser::OptArgDesc Args::optArgs[] = {
      NULL },
   { 'h', "help",            CLP::ARG_NONE, CLP::DUPOPT_CLOB, NULL,
      NULL },
+
+  // Raw dump
+  { 'n', "node-id",         CLP::ARG_REQ,  CLP::DUPOPT_CAT,  CLP_SEPARATOR,
+     NULL },
+  { 'm', "metric-id",       CLP::ARG_REQ,  CLP::DUPOPT_CAT,  CLP_SEPARATOR,
+     NULL },
   CmdLineParser_OptArgDesc_NULL_MACRO // SGI's compiler requires this version
 };
 
@@ -230,6 +246,15 @@ Args::parse(int argc, const char* const argv[])
     }
 
     // FIXME: sanity check that options correspond to mode
+
+    if (parser.isOpt("node-id")) {
+      parseArg_ids(dumpFilter.nodeIds, parser.getOptArg("node-id"),
+		   "--node-id");
+    }
+    if (parser.isOpt("metric-id")) {
+      parseArg_ids(dumpFilter.metricIds, parser.getOptArg("metric-id"),
+		   "--metric-id");
+    }
     
     // Check for required arguments
     uint numArgs = parser.getNumArgs();
@@ -255,6 +280,29 @@ Args::parse(int argc, const char* const argv[])
 }
 
 
+// Parses a CLP_SEPARATOR- and comma-separated list of ids into 'ids'
+void
+Args::parseArg_ids(std::set<uint>& ids, const string& value,
+		   const char* errTag)
+{
+  std::vector<std::string> optVals;
+  StrUtil::tokenize_str(value, CLP_SEPARATOR ",", optVals);
+
+  for (uint i = 0; i < optVals.size(); ++i) {
+    const string& x = optVals[i];
+    if (x.empty()) {
+      continue;
+    }
+    try {
+      ids.insert((uint)StrUtil::toUInt64(x));
+    }
+    catch (const Diagnostics::Exception&) {
+      ARG_Throw(errTag << ": unexpected id '" << x << "'");
+    }
+  }
+}
+
+
 // Cf. lib/analysis/ArgsHPCProf::parseArg_metric()
 void
 Args::parseArg_metric(Args* args, const string& value, const char* errTag)
@@ -65,12 +65,14 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <set>
 
 //*************************** User Include Files ****************************
 
 #include <include/uint.h>
 
 #include <lib/analysis/Args.hpp>
+#include <lib/analysis/Raw.hpp>
 
 #include <lib/support/diagnostics.h>
 #include <lib/support/CmdLineParser.hpp>
@@ -133,6 +135,10 @@ public:
   static void
   parseArg_metric(Args* args, const std::string& opts, const char* errTag);
 
+  static void
+  parseArg_ids(std::set<uint>& ids, const std::string& value,
+	       const char* errTag);
+
 public:
 
   // Object Correlation args
@@ -142,6 +148,9 @@ public:
   bool obj_metricsAsPercents;
   bool obj_showSourceCode;
 
+  // Raw dump args: which CCT nodes and metrics to print (all if empty)
+  Analysis::Raw::Filter dumpFilter;
+
 private:
   void Ctor();
   void setHPCHome(); 
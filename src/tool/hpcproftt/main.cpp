@@ -74,7 +74,8 @@ static int
 realmain(int argc, char* const* argv);
 
 static int
-main_rawData(const std::vector<string>& profileFiles);
+main_rawData(const std::vector<string>& profileFiles,
+	     const Analysis::Raw::Filter& filter);
 
 
 //****************************************************************************
@@ -122,7 +123,7 @@ static int
 realmain(int argc, char* const* argv) 
 {
   Args args(argc, argv);  // exits if error on command line
-  return main_rawData(args.profileFiles); 
+  return main_rawData(args.profileFiles, args.dumpFilter);
 }
 
 
@@ -131,7 +132,8 @@ realmain(int argc, char* const* argv)
 //****************************************************************************
 
 static int
-main_rawData(const std::vector<string>& profileFiles)
+main_rawData(const std::vector<string>& profileFiles,
+	     const Analysis::Raw::Filter& filter)
 {
   std::ostream& os = std::cout;
 
@@ -143,7 +145,7 @@ main_rawData(const std::vector<string>& profileFiles)
     os << fnm << std::endl;
     os << std::setfill('=') << std::setw(77) << "=" << std::endl;
 
-    Analysis::Raw::writeAsText(fnm); // pass os FIXME
+    Analysis::Raw::writeAsText(fnm, filter); // pass os FIXME
   }
   return 0;
 }
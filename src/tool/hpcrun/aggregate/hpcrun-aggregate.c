@@ -0,0 +1,913 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+
+//***************************************************************************
+//
+// File:
+//   hpcrun-aggregate.c
+//
+// Purpose:
+//   Per-node aggregator for hpcrun --aggregate.  Drains the sample
+//   rings of all processes of one measurement on this node, merges
+//   their call paths into one CCT and writes it as a single profile.
+//
+// Description:
+//   Usage: hpcrun-aggregate [-v] -k key -o measurement-dir
+//
+//   The first hpcrun process of the measurement on the node starts the
+//   aggregator (see sample-stream.c) and records its pid in the lock
+//   file.  The aggregator polls HPCSRING_DIR for rings with its key,
+//   drains them, and removes each ring once its producer has closed it
+//   or has died.  Load modules and metrics are merged by name; CCT
+//   nodes are merged by (parent, load module, IP), so each call path
+//   prefix is stored once for the whole node.
+//
+//   When no rings are left for a while, the aggregator removes the
+//   lock and looks once more.  Producers create their ring before they
+//   check the lock, so a ring that appears now belongs to a process
+//   that saw the lock: the aggregator takes the lock back and goes on,
+//   or, if another aggregator was started in the meantime, leaves the
+//   ring to it.  The profile is written to
+//   <measurement-dir>/aggregate/<prog>-aggregate-<hostid>-<pid>.hpcrun.
+//
+//***************************************************************************
+
+//************************* System Include Files ****************************
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+//*************************** User Include Files ****************************
+
+#include <lib/prof-lean/hpcfmt.h>
+#include <lib/prof-lean/hpcrun-fmt.h>
+#include <lib/prof-lean/hpcrun-sample-ring.h>
+
+
+//***************************************************************************
+// type declarations
+//***************************************************************************
+
+// how long to wait for the first ring, and for more rings after the
+// last one is gone
+#define FIRST_RING_WAIT_SEC  60
+#define LINGER_SEC           5
+
+// how often to look for new rings, and how long to sleep when idle
+#define SCAN_INTERVAL_MSEC   100
+#define IDLE_SLEEP_MSEC      2
+
+typedef struct agg_ring_s {
+  char path[PATH_MAX];
+  hpcsring_t ring;
+
+  // producer ids to merged ids (0 or -1: not yet defined)
+  uint16_t *lm_map;
+  uint32_t lm_map_len;
+  int32_t *metric_map;
+  uint32_t metric_map_len;
+} agg_ring_t;
+
+
+typedef struct agg_node_s {
+  uint32_t parent;
+  uint16_t lm_id;
+  bool has_children;
+  uint64_t lm_ip;
+  uint32_t vals;  // first agg_val_t, or 0
+} agg_node_t;
+
+
+typedef struct agg_val_s {
+  uint32_t next;
+  uint32_t metric;
+  hpcrun_metricVal_t val;
+} agg_val_t;
+
+
+//***************************************************************************
+// local variables
+//***************************************************************************
+
+static bool verbose = false;
+static const char *key = NULL;
+static const char *outdir = NULL;
+static char lock_path[PATH_MAX];
+static char prog[HPCSRING_PROG_LEN] = "unknown";
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static agg_ring_t **rings = NULL;
+static size_t n_rings = 0;
+static size_t rings_cap = 0;
+
+// merged load map: ids 1..n_lms
+static char **lm_names = NULL;
+static uint32_t n_lms = 0;
+
+static metric_desc_t *metrics = NULL;
+static uint32_t n_metrics = 0;
+
+// merged CCT: node 0 is the root
+static agg_node_t *nodes = NULL;
+static uint32_t n_nodes = 0;
+static uint32_t nodes_cap = 0;
+
+// (parent, lm id, lm ip) -> node index + 1
+static uint32_t *node_tbl = NULL;
+static uint64_t node_tbl_cap = 0;
+
+// metric values; entry 0 is unused
+static agg_val_t *vals = NULL;
+static uint32_t n_vals = 1;
+static uint32_t vals_cap = 0;
+
+static uint64_t n_seen_rings = 0;
+static uint64_t n_samples = 0;
+static uint64_t n_ring_dropped = 0;
+static uint64_t n_undefined = 0;
+
+
+//***************************************************************************
+// utilities
+//***************************************************************************
+
+static void *
+xrealloc(void *p, size_t size)
+{
+  p = realloc(p, size);
+  if (p == NULL) {
+    fprintf(stderr, "hpcrun-aggregate: out of memory\n");
+    exit(1);
+  }
+  return p;
+}
+
+
+static char *
+xstrdup(const char *s)
+{
+  char *t = strdup(s);
+  if (t == NULL) {
+    fprintf(stderr, "hpcrun-aggregate: out of memory\n");
+    exit(1);
+  }
+  return t;
+}
+
+
+static uint64_t
+time_msec(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+
+static void
+sleep_msec(long msec)
+{
+  struct timespec ts = { msec / 1000, (msec % 1000) * 1000000 };
+  nanosleep(&ts, NULL);
+}
+
+
+static void
+handle_stop(int sig)
+{
+  stop_requested = 1;
+}
+
+
+//***************************************************************************
+// merged load map and metrics
+//***************************************************************************
+
+static uint16_t
+lm_lookup(const char *name)
+{
+  for (uint32_t i = 0; i < n_lms; i++) {
+    if (strcmp(lm_names[i], name) == 0) {
+      return i + 1;
+    }
+  }
+  if (n_lms + 1 >= UINT16_MAX) {
+    return HPCRUN_FMT_LMId_NULL;
+  }
+  lm_names = xrealloc(lm_names, (n_lms + 1) * sizeof(char *));
+  lm_names[n_lms++] = xstrdup(name);
+  return n_lms;
+}
+
+
+static uint32_t
+metric_lookup(const hpcsring_metric_t *m, const char *strs, size_t len)
+{
+  const char *str[4];
+  const char *end = strs + len;
+
+  for (int k = 0; k < 4; k++) {
+    const char *nul = (strs < end) ? memchr(strs, '\0', end - strs) : NULL;
+    str[k] = (nul != NULL) ? strs : "";
+    strs = (nul != NULL) ? nul + 1 : end;
+  }
+
+  for (uint32_t i = 0; i < n_metrics; i++) {
+    if (strcmp(metrics[i].name, str[0]) == 0) {
+      return i;
+    }
+  }
+
+  metrics = xrealloc(metrics, (n_metrics + 1) * sizeof(metric_desc_t));
+  metric_desc_t *d = &metrics[n_metrics];
+  *d = metricDesc_NULL;
+  d->name = xstrdup(str[0]);
+  d->description = xstrdup(str[1]);
+  d->formula = (str[2][0] != '\0') ? xstrdup(str[2]) : NULL;
+  d->format = (str[3][0] != '\0') ? xstrdup(str[3]) : NULL;
+  d->flags.bits_big[0] = m->flags[0];
+  d->flags.bits_big[1] = m->flags[1];
+  d->period = m->period;
+  d->is_frequency_metric = m->is_frequency_metric;
+
+  return n_metrics++;
+}
+
+
+//***************************************************************************
+// merged CCT
+//***************************************************************************
+
+static uint64_t
+node_hash(uint32_t parent, uint16_t lm_id, uint64_t lm_ip)
+{
+  uint64_t h = lm_ip * 0x9e3779b97f4a7c15ULL;
+  h ^= ((uint64_t) parent << 16 | lm_id) * 0xc2b2ae3d27d4eb4fULL;
+  return h ^ (h >> 29);
+}
+
+
+static void
+node_tbl_insert(uint32_t idx)
+{
+  agg_node_t *n = &nodes[idx];
+  uint64_t mask = node_tbl_cap - 1;
+  uint64_t i = node_hash(n->parent, n->lm_id, n->lm_ip) & mask;
+
+  while (node_tbl[i] != 0) {
+    i = (i + 1) & mask;
+  }
+  node_tbl[i] = idx + 1;
+}
+
+
+static void
+node_tbl_grow(void)
+{
+  free(node_tbl);
+  node_tbl_cap = (node_tbl_cap == 0) ? 4096 : 2 * node_tbl_cap;
+  node_tbl = calloc(node_tbl_cap, sizeof(uint32_t));
+  if (node_tbl == NULL) {
+    fprintf(stderr, "hpcrun-aggregate: out of memory\n");
+    exit(1);
+  }
+  // the root (node 0) is never looked up
+  for (uint32_t k = 1; k < n_nodes; k++) {
+    node_tbl_insert(k);
+  }
+}
+
+
+static uint32_t
+node_new(uint32_t parent, uint16_t lm_id, uint64_t lm_ip)
+{
+  if (n_nodes == nodes_cap) {
+    nodes_cap = (nodes_cap == 0) ? 4096 : 2 * nodes_cap;
+    nodes = xrealloc(nodes, nodes_cap * sizeof(agg_node_t));
+  }
+  agg_node_t *n = &nodes[n_nodes];
+  n->parent = parent;
+  n->lm_id = lm_id;
+  n->has_children = false;
+  n->lm_ip = lm_ip;
+  n->vals = 0;
+  return n_nodes++;
+}
+
+
+static uint32_t
+node_child(uint32_t parent, uint16_t lm_id, uint64_t lm_ip)
+{
+  if (2 * (uint64_t) n_nodes >= node_tbl_cap) {
+    node_tbl_grow();
+  }
+
+  uint64_t mask = node_tbl_cap - 1;
+  uint64_t i = node_hash(parent, lm_id, lm_ip) & mask;
+
+  for (; node_tbl[i] != 0; i = (i + 1) & mask) {
+    agg_node_t *n = &nodes[node_tbl[i] - 1];
+    if (n->parent == parent && n->lm_id == lm_id && n->lm_ip == lm_ip) {
+      return node_tbl[i] - 1;
+    }
+  }
+
+  uint32_t idx = node_new(parent, lm_id, lm_ip);
+  nodes[parent].has_children = true;
+  node_tbl[i] = idx + 1;
+  return idx;
+}
+
+
+static void
+node_add_metric(uint32_t idx, uint32_t metric, uint64_t bits)
+{
+  agg_val_t *v;
+  uint32_t k;
+
+  for (k = nodes[idx].vals; k != 0; k = vals[k].next) {
+    if (vals[k].metric == metric) {
+      break;
+    }
+  }
+
+  if (k == 0) {
+    if (n_vals >= vals_cap) {
+      vals_cap = (vals_cap == 0) ? 4096 : 2 * vals_cap;
+      vals = xrealloc(vals, vals_cap * sizeof(agg_val_t));
+    }
+    k = n_vals++;
+    vals[k].metric = metric;
+    vals[k].val = hpcrun_metricVal_ZERO;
+    vals[k].next = nodes[idx].vals;
+    nodes[idx].vals = k;
+  }
+
+  v = &vals[k];
+  if (metrics[metric].flags.fields.valFmt == MetricFlags_ValFmt_Real) {
+    hpcrun_metricVal_t x;
+    x.bits = bits;
+    v->val.r += x.r;
+  }
+  else {
+    v->val.i += bits;
+  }
+}
+
+
+//***************************************************************************
+// rings
+//***************************************************************************
+
+static void
+do_loadmap(agg_ring_t *r, const hpcsring_rec_t *rec)
+{
+  const hpcsring_loadmap_t *lm = (const hpcsring_loadmap_t *) (rec + 1);
+
+  if (rec->len < sizeof(*lm) + 1 || lm->id == 0 || lm->id >= UINT16_MAX) {
+    return;
+  }
+  if (lm->id >= r->lm_map_len) {
+    uint32_t len = lm->id + 64;
+    r->lm_map = xrealloc(r->lm_map, len * sizeof(uint16_t));
+    memset(r->lm_map + r->lm_map_len, 0,
+	   (len - r->lm_map_len) * sizeof(uint16_t));
+    r->lm_map_len = len;
+  }
+
+  char name[PATH_MAX];
+  size_t len = rec->len - sizeof(*lm);
+  if (len >= sizeof(name)) {
+    len = sizeof(name) - 1;
+  }
+  memcpy(name, lm + 1, len);
+  name[len] = '\0';
+
+  r->lm_map[lm->id] = lm_lookup(name);
+}
+
+
+static void
+do_metric(agg_ring_t *r, const hpcsring_rec_t *rec)
+{
+  const hpcsring_metric_t *m = (const hpcsring_metric_t *) (rec + 1);
+
+  if (rec->len < sizeof(*m) || m->id > INT16_MAX) {
+    return;
+  }
+  if (m->id >= r->metric_map_len) {
+    uint32_t len = m->id + 16;
+    r->metric_map = xrealloc(r->metric_map, len * sizeof(int32_t));
+    for (uint32_t k = r->metric_map_len; k < len; k++) {
+      r->metric_map[k] = -1;
+    }
+    r->metric_map_len = len;
+  }
+
+  r->metric_map[m->id] =
+    metric_lookup(m, (const char *) (m + 1), rec->len - sizeof(*m));
+}
+
+
+static void
+do_sample(agg_ring_t *r, const hpcsring_rec_t *rec)
+{
+  const hpcsring_sample_t *s = (const hpcsring_sample_t *) (rec + 1);
+
+  if (rec->len < sizeof(*s)
+      || (rec->len - sizeof(*s)) / sizeof(hpcsring_frame_t) < s->nframes) {
+    n_undefined++;
+    return;
+  }
+  if (s->metric_id >= r->metric_map_len || r->metric_map[s->metric_id] < 0) {
+    n_undefined++;
+    return;
+  }
+
+  const hpcsring_frame_t *frame = (const hpcsring_frame_t *) (s + 1);
+  uint32_t k = 0;
+  uint32_t cur = 0;
+
+  // the producer's own root maps to ours
+  if (s->nframes > 0 && frame[0].lm_id == HPCRUN_FMT_LMId_NULL
+      && frame[0].lm_ip == HPCRUN_FMT_LMIp_NULL) {
+    k = 1;
+  }
+
+  for (; k < s->nframes; k++) {
+    uint16_t lm_id = HPCRUN_FMT_LMId_NULL;
+    if (frame[k].lm_id != HPCRUN_FMT_LMId_NULL) {
+      if (frame[k].lm_id >= r->lm_map_len
+	  || r->lm_map[frame[k].lm_id] == HPCRUN_FMT_LMId_NULL) {
+	n_undefined++;
+	return;
+      }
+      lm_id = r->lm_map[frame[k].lm_id];
+    }
+    cur = node_child(cur, lm_id, frame[k].lm_ip);
+  }
+
+  node_add_metric(cur, r->metric_map[s->metric_id], s->value);
+  n_samples++;
+}
+
+
+// Returns: number of records consumed.
+static size_t
+drain_ring(agg_ring_t *r)
+{
+  const hpcsring_rec_t *rec;
+  size_t n = 0;
+
+  while ((rec = hpcsring_peek(&r->ring)) != NULL) {
+    switch (rec->kind) {
+    case HPCSRING_REC_LOADMAP:
+      do_loadmap(r, rec);
+      break;
+    case HPCSRING_REC_METRIC:
+      do_metric(r, rec);
+      break;
+    case HPCSRING_REC_SAMPLE:
+      do_sample(r, rec);
+      break;
+    default:
+      break;
+    }
+    hpcsring_consume(&r->ring, rec);
+    n++;
+  }
+  return n;
+}
+
+
+static void
+ring_free(agg_ring_t *r)
+{
+  hpcsring_detach(&r->ring);
+  free(r->lm_map);
+  free(r->metric_map);
+  free(r);
+}
+
+
+static bool
+ring_is_known(const char *path)
+{
+  for (size_t i = 0; i < n_rings; i++) {
+    if (strcmp(rings[i]->path, path) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+// Attach the rings of our key that we do not have yet.
+static void
+scan_rings(void)
+{
+  char prefix[PATH_MAX];
+  snprintf(prefix, sizeof(prefix), "%s%s.", HPCSRING_PREFIX, key);
+  size_t prefix_len = strlen(prefix);
+
+  DIR *dir = opendir(HPCSRING_DIR);
+  if (dir == NULL) {
+    return;
+  }
+
+  struct dirent *ent;
+  while ((ent = readdir(dir)) != NULL) {
+    const char *name = ent->d_name;
+    if (strncmp(name, prefix, prefix_len) != 0
+	|| strcmp(name + prefix_len, "lock") == 0) {
+      continue;
+    }
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", HPCSRING_DIR, name);
+    if (ring_is_known(path)) {
+      continue;
+    }
+
+    agg_ring_t *r = calloc(1, sizeof(agg_ring_t));
+    if (r == NULL) {
+      break;
+    }
+    // a ring whose header is not written yet is tried again later
+    if (hpcsring_attach(&r->ring, path) != 0) {
+      free(r);
+      continue;
+    }
+    strncpy(r->path, path, sizeof(r->path) - 1);
+
+    if (n_seen_rings == 0) {
+      strncpy(prog, r->ring.hdr->prog, sizeof(prog) - 1);
+      prog[sizeof(prog) - 1] = '\0';
+      if (prog[0] == '\0') {
+	strcpy(prog, "unknown");
+      }
+    }
+    n_seen_rings++;
+
+    if (n_rings == rings_cap) {
+      rings_cap = (rings_cap == 0) ? 64 : 2 * rings_cap;
+      rings = xrealloc(rings, rings_cap * sizeof(agg_ring_t *));
+    }
+    rings[n_rings++] = r;
+
+    if (verbose) {
+      fprintf(stderr, "hpcrun-aggregate: attached %s\n", path);
+    }
+  }
+  closedir(dir);
+}
+
+
+// Drain every ring once and retire the finished ones.  Returns:
+// number of records consumed.
+static size_t
+poll_rings(void)
+{
+  size_t n = 0;
+
+  for (size_t i = 0; i < n_rings; ) {
+    agg_ring_t *r = rings[i];
+    hpcsring_hdr_t *hdr = r->ring.hdr;
+
+    // check before draining, so that nothing committed before the
+    // close is missed
+    bool done = hpcsring_is_closed(&r->ring)
+      || (kill((pid_t) hdr->pid, 0) != 0 && errno == ESRCH);
+
+    n += drain_ring(r);
+
+    if (done) {
+      n_ring_dropped += atomic_load(&hdr->dropped);
+      if (verbose) {
+	fprintf(stderr, "hpcrun-aggregate: finished %s\n", r->path);
+      }
+      unlink(r->path);
+      ring_free(r);
+      rings[i] = rings[--n_rings];
+    }
+    else {
+      i++;
+    }
+  }
+  return n;
+}
+
+
+//***************************************************************************
+// lock file
+//***************************************************************************
+
+// Returns: true if we (re)created the lock file.
+static bool
+lock_take(void)
+{
+  int fd = open(lock_path, O_WRONLY | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    return false;
+  }
+
+  char buf[32];
+  int len = snprintf(buf, sizeof(buf), "%ld", (long) getpid());
+  bool ok = (write(fd, buf, len) == len);
+  close(fd);
+  return ok;
+}
+
+
+//***************************************************************************
+// profile output
+//***************************************************************************
+
+static int
+write_profile(void)
+{
+  if (n_samples == 0) {
+    return 0;
+  }
+
+  char dir[PATH_MAX];
+  snprintf(dir, sizeof(dir), "%s/aggregate", outdir);
+  if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "hpcrun-aggregate: unable to create %s: %s\n",
+	    dir, strerror(errno));
+    return -1;
+  }
+
+  char hostidStr[32], pidStr[32];
+  snprintf(hostidStr, sizeof(hostidStr), "%lx", gethostid());
+  snprintf(pidStr, sizeof(pidStr), "%ld", (long) getpid());
+
+  char fnm[PATH_MAX];
+  snprintf(fnm, sizeof(fnm), "%s/%s-aggregate-%s-%s.%s", dir, prog,
+	   hostidStr, pidStr, HPCRUN_ProfileFnmSfx);
+
+  FILE *fs = fopen(fnm, "w");
+  if (fs == NULL) {
+    fprintf(stderr, "hpcrun-aggregate: unable to open %s: %s\n",
+	    fnm, strerror(errno));
+    return -1;
+  }
+
+  //
+  // ==== file hdr and epoch hdr =====
+  //
+  hpcrun_fmt_hdr_fwrite(fs,
+			HPCRUN_FMT_NV_prog, prog,
+			HPCRUN_FMT_NV_progPath, prog,
+			HPCRUN_FMT_NV_jobId, "",
+			HPCRUN_FMT_NV_mpiRank, "0",
+			HPCRUN_FMT_NV_tid, "0",
+			HPCRUN_FMT_NV_hostid, hostidStr,
+			HPCRUN_FMT_NV_pid, pidStr,
+			HPCRUN_FMT_NV_traceMinTime, "0",
+			HPCRUN_FMT_NV_traceMaxTime, "0",
+			NULL);
+
+  epoch_flags_t flags;
+  flags.bits = 0;
+  hpcrun_fmt_epochHdr_fwrite(fs, flags, 1,
+			     "TODO:epoch-name", "TODO:epoch-value",
+			     NULL);
+
+  //
+  // == metrics ==
+  //
+  metric_desc_p_tbl_t tbl;
+  tbl.len = n_metrics;
+  tbl.lst = xrealloc(NULL, (n_metrics + 1) * sizeof(metric_desc_t *));
+  for (uint32_t i = 0; i < n_metrics; i++) {
+    tbl.lst[i] = &metrics[i];
+  }
+  hpcfmt_int4_fwrite(n_metrics, fs);
+  hpcrun_fmt_metricTbl_fwrite(&tbl, NULL, fs);
+  free(tbl.lst);
+
+  //
+  // == load map ==
+  //
+  hpcfmt_int4_fwrite(n_lms, fs);
+  for (uint32_t i = 0; i < n_lms; i++) {
+    loadmap_entry_t lm_entry;
+    lm_entry.id = i + 1;
+    lm_entry.name = lm_names[i];
+    lm_entry.flags = 0;
+    hpcrun_fmt_loadmapEntry_fwrite(&lm_entry, fs);
+  }
+
+  //
+  // == cct ==
+  //
+  // Nodes were created after their parents, so writing them in index
+  // order puts every parent first.  Ids are even, as in hpcrun; leaves
+  // are written with a negated id.
+  //
+  hpcfmt_int8_fwrite((uint64_t) n_nodes, fs);
+
+  hpcrun_metricVal_t *mvals =
+    xrealloc(NULL, (n_metrics + 1) * sizeof(hpcrun_metricVal_t));
+  hpcrun_fmt_cct_node_t tmp;
+  hpcrun_fmt_cct_prev_t prev;
+  hpcrun_fmt_cct_node_init(&tmp);
+  hpcrun_fmt_cct_prev_init(&prev);
+  tmp.num_metrics = n_metrics;
+  tmp.metrics = mvals;
+
+  for (uint32_t i = 0; i < n_nodes; i++) {
+    agg_node_t *n = &nodes[i];
+
+    tmp.id = 2 * (i + 1);
+    tmp.id_parent = (i == 0) ? HPCRUN_FMT_CCTNodeId_NULL : 2 * (n->parent + 1);
+    if (!n->has_children) {
+      tmp.id = -tmp.id;
+    }
+    tmp.lm_id = n->lm_id;
+    tmp.lm_ip = n->lm_ip;
+
+    for (uint32_t m = 0; m < n_metrics; m++) {
+      mvals[m] = hpcrun_metricVal_ZERO;
+    }
+    for (uint32_t k = n->vals; k != 0; k = vals[k].next) {
+      mvals[vals[k].metric] = vals[k].val;
+    }
+
+    hpcrun_fmt_cct_node_fwrite(&tmp, flags, &prev, fs);
+  }
+  free(mvals);
+
+  int ret = 0;
+  if (ferror(fs) || fclose(fs) != 0) {
+    fprintf(stderr, "hpcrun-aggregate: error writing %s\n", fnm);
+    ret = -1;
+  }
+
+  if (verbose) {
+    fprintf(stderr, "hpcrun-aggregate: wrote %s (%u nodes)\n", fnm, n_nodes);
+  }
+  return ret;
+}
+
+
+//***************************************************************************
+// main
+//***************************************************************************
+
+static void
+usage(void)
+{
+  fprintf(stderr,
+	  "usage: hpcrun-aggregate [-v] -k key -o measurement-dir\n");
+  exit(1);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  int opt;
+  while ((opt = getopt(argc, argv, "k:o:v")) != -1) {
+    switch (opt) {
+    case 'k':
+      key = optarg;
+      break;
+    case 'o':
+      outdir = optarg;
+      break;
+    case 'v':
+      verbose = true;
+      break;
+    default:
+      usage();
+    }
+  }
+  if (key == NULL || outdir == NULL || optind != argc) {
+    usage();
+  }
+
+  snprintf(lock_path, sizeof(lock_path), "%s/%s%s.lock", HPCSRING_DIR,
+	   HPCSRING_PREFIX, key);
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = handle_stop;
+  sigaction(SIGTERM, &sa, NULL);
+  sigaction(SIGINT, &sa, NULL);
+  sa.sa_handler = SIG_IGN;
+  sigaction(SIGHUP, &sa, NULL);
+
+  node_new(HPCRUN_FMT_CCTNodeId_NULL, HPCRUN_FMT_LMId_NULL,
+	   HPCRUN_FMT_LMIp_NULL);
+
+  uint64_t last_scan = 0;
+  uint64_t last_busy = time_msec();
+
+  while (!stop_requested) {
+    uint64_t now = time_msec();
+    if (now - last_scan >= SCAN_INTERVAL_MSEC) {
+      scan_rings();
+      last_scan = now;
+    }
+
+    if (poll_rings() > 0 || n_rings > 0) {
+      last_busy = now;
+    }
+    if (n_rings > 0) {
+      sleep_msec(IDLE_SLEEP_MSEC);
+      continue;
+    }
+
+    uint64_t wait = (n_seen_rings == 0) ? FIRST_RING_WAIT_SEC : LINGER_SEC;
+    if (now - last_busy < wait * 1000) {
+      sleep_msec(SCAN_INTERVAL_MSEC);
+      continue;
+    }
+
+    // no rings for a while: give up the lock and look once more
+    unlink(lock_path);
+    scan_rings();
+    if (n_rings == 0) {
+      break;
+    }
+    if (!lock_take()) {
+      // another aggregator owns the new rings
+      while (n_rings > 0) {
+	ring_free(rings[--n_rings]);
+      }
+      break;
+    }
+    last_busy = time_msec();
+  }
+
+  if (stop_requested) {
+    poll_rings();
+    unlink(lock_path);
+  }
+
+  if (verbose || n_ring_dropped > 0 || n_undefined > 0) {
+    fprintf(stderr, "hpcrun-aggregate: %"PRIu64" rings, %"PRIu64
+	    " samples, %"PRIu64" dropped by producers, %"PRIu64
+	    " undecodable\n",
+	    n_seen_rings, n_samples, n_ring_dropped, n_undefined);
+  }
+
+  return (write_profile() == 0) ? 0 : 1;
+}
@@ -72,6 +72,7 @@
 #include <string.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <sys/mman.h>
 
 //*************************** User Include Files ****************************
 
@@ -88,6 +89,7 @@
 #include "cct_addr.h"
 #include "cct2metrics.h"
 #include "../memory/hpcrun-malloc.h"
+#include "../memory/mmap.h"
 //#include "../ompt/ompt-interface.h"
 //#include "../memory/hpcrun-malloc.h"
 
@@ -277,6 +279,7 @@ typedef struct {
   hpcfmt_uint_t num_kind_metrics;
   FILE* fs;
   epoch_flags_t flags;
+  hpcrun_fmt_cct_prev_t prev;
   hpcrun_fmt_cct_node_t* tmp_node;
   cct2metrics_t* cct2metrics_map;
 } write_arg_t;
@@ -381,7 +384,7 @@ lwrite(cct_node_t* node, cct_op_arg_t arg, size_t level)
 
   hpcrun_metric_set_dense_copy(tmp->metrics, ms, my_arg->num_metrics);
 #endif
-  hpcrun_fmt_cct_node_fwrite(tmp, flags, my_arg->fs);
+  hpcrun_fmt_cct_node_fwrite(tmp, flags, &my_arg->prev, my_arg->fs);
 }
 
 //
@@ -789,6 +792,8 @@ hpcrun_cct_fwrite(cct2metrics_t* cct2metrics_map, cct_node_t* cct, FILE* fs, epo
     .cct2metrics_map = cct2metrics_map
   };
   
+  hpcrun_fmt_cct_prev_init(&write_arg.prev);
+  
   hpcrun_metricVal_t metrics[num_kind_metrics];
   tmp_node.metrics = &(metrics[0]);
 
@@ -800,6 +805,311 @@ hpcrun_cct_fwrite(cct2metrics_t* cct2metrics_map, cct_node_t* cct, FILE* fs, epo
   return HPCRUN_OK;
 }
 
+//
+// Pruning operation: collapse cold subtrees into per-parent "other" nodes.
+//
+// A child subtree is cold when its share of the thread's metrics (see
+// hpcrun_metric_set_share) is below the threshold.  Its metrics are
+// folded into the parent's "other" child, and its nodes are returned to
+// the cct node freelist.  A subtree is never removed if it contains a
+// node that may be referenced from outside the tree: a node retained for
+// tracing, a dummy node, a placeholder node, or a node on the pinned list.
+//
+// Must be called by the thread that owns the cct (and its cct2metrics
+// map), outside of sample handling.
+//
+typedef struct {
+  cct_addr_t* other;
+  cct_node_t** pinned;
+  int num_pinned;
+  const double* totals;
+  double threshold;
+  size_t num_pruned;
+} prune_arg_t;
+
+static bool
+prune_is_pinned(cct_node_t* node, prune_arg_t* arg)
+{
+  if (hpcrun_cct_retained(node) || hpcrun_cct_is_dummy(node)) return true;
+
+  // placeholders live in the same load module as the "other" node
+  if (node->addr.ip_norm.lm_id == arg->other->ip_norm.lm_id
+      && ! cct_addr_eq(&(node->addr), arg->other)) return true;
+
+  for (int i = 0; i < arg->num_pinned; i++) {
+    if (node == arg->pinned[i]) return true;
+  }
+  return false;
+}
+
+//
+// flatten a splay tree of siblings into a list linked through 'right',
+// in address order (a degenerate but valid splay tree)
+//
+static cct_node_t*
+splay_to_list(cct_node_t* root)
+{
+  cct_node_t** link = &root;
+  while (*link) {
+    cct_node_t* n = *link;
+    if (n->left) {
+      cct_node_t* l = n->left;
+      n->left = l->right;
+      l->right = n;
+      *link = l;
+    }
+    else {
+      link = &(n->right);
+    }
+  }
+  return root;
+}
+
+static void
+l_fold_metrics(cct_node_t* n, cct_op_arg_t arg, size_t level)
+{
+  cct_node_t* other = (cct_node_t*) arg;
+  metric_data_list_t* set = cct2metrics_remove(n);
+  if (! set) return;
+
+  metric_data_list_t* dest = hpcrun_get_metric_data_list(other);
+  if (dest) {
+    hpcrun_metric_set_fold(dest, set);
+    hpcrun_metric_data_list_free(set);
+  }
+  else {
+    cct2metrics_assoc(other, set);
+  }
+}
+
+//
+// merge two sibling lists (linked through 'right') in address order
+//
+static cct_node_t*
+merge_lists(cct_node_t* a, cct_node_t* b)
+{
+  cct_node_t* head = NULL;
+  cct_node_t** tail = &head;
+  while (a && b) {
+    if (cct_addr_lt(&(a->addr), &(b->addr))) {
+      *tail = a;
+      a = a->right;
+    }
+    else {
+      *tail = b;
+      b = b->right;
+    }
+    tail = &((*tail)->right);
+  }
+  *tail = a ? a : b;
+  return head;
+}
+
+//
+// fold the metrics of a cold subtree into 'other' and count its nodes.
+// prune_subtree has turned every sibling set of the subtree into a list
+// (linked through 'right'), so the walk needs no stack: it follows
+// children down and parents back up.
+//
+static void
+prune_fold(cct_node_t* root, cct_node_t* other, prune_arg_t* arg)
+{
+  cct_node_t* n = root;
+  while (n) {
+    l_fold_metrics(n, (cct_op_arg_t) other, 0);
+    arg->num_pruned++;
+    if (n->children) {
+      n = n->children;
+      continue;
+    }
+    while (n != root && n->right == NULL) {
+      n = n->parent;
+    }
+    n = (n == root) ? NULL : n->right;
+  }
+}
+
+//
+// prune_subtree walks the tree depth first with an explicit stack (cct
+// paths can be deep), with one frame per node on the current path.
+//
+typedef struct {
+  cct_node_t* node;
+  cct_node_t* next;       // next child to visit (list through 'right')
+  cct_node_t* kept;       // visited children to keep, in address order
+  cct_node_t* kept_last;
+  cct_node_t* cold;       // visited cold children, in address order
+  cct_node_t* cold_last;
+  double share;           // share of the subtree visited so far
+  bool pinned;            // subtree holds a pinned node
+  bool keep;              // node is kept regardless of its share
+} prune_frame_t;
+
+// each thread keeps its stack across prunes
+static __thread prune_frame_t* prune_stack = NULL;
+static __thread size_t prune_stack_frames = 0;
+
+static bool
+prune_stack_reserve(size_t depth)
+{
+  if (depth < prune_stack_frames) return true;
+
+  size_t frames = prune_stack_frames ? 2 * prune_stack_frames : 1024;
+  prune_frame_t* stack = hpcrun_mmap_anon(frames * sizeof(prune_frame_t));
+  if (stack == NULL) return false;
+
+  if (prune_stack) {
+    memcpy(stack, prune_stack, prune_stack_frames * sizeof(prune_frame_t));
+    munmap(prune_stack, prune_stack_frames * sizeof(prune_frame_t));
+  }
+  prune_stack = stack;
+  prune_stack_frames = frames;
+  return true;
+}
+
+static void
+prune_frame_init(prune_frame_t* f, cct_node_t* node, prune_arg_t* arg,
+		 bool keep)
+{
+  f->node = node;
+  f->next = splay_to_list(node->children);
+  f->kept = f->kept_last = NULL;
+  f->cold = f->cold_last = NULL;
+  f->share =
+    hpcrun_metric_set_share(hpcrun_get_metric_data_list(node), arg->totals);
+  f->pinned = prune_is_pinned(node, arg);
+  f->keep = keep;
+}
+
+static void
+list_append(cct_node_t** head, cct_node_t** last, cct_node_t* n)
+{
+  if (*last) {
+    (*last)->right = n;
+  }
+  else {
+    *head = n;
+  }
+  *last = n;
+}
+
+//
+// all children of the frame's node have been visited.  cold children are
+// folded only if the node itself survives (it is kept, pinned, or hot);
+// otherwise its parent folds the whole subtree.
+//
+static void
+prune_frame_fini(prune_frame_t* f, prune_arg_t* arg)
+{
+  cct_node_t* node = f->node;
+
+  if (! (f->keep || f->pinned || f->share >= arg->threshold)) {
+    node->children = merge_lists(f->kept, f->cold);
+    return;
+  }
+
+  node->children = f->kept;
+  if (f->cold) {
+    cct_node_t* other = hpcrun_cct_insert_addr(node, arg->other);
+    cct_node_t* next;
+    for (cct_node_t* c = f->cold; c; c = next) {
+      next = c->right;
+      c->right = NULL;
+      c->parent = NULL;
+      prune_fold(c, other, arg);
+      hpcrun_cct_node_free(c);
+    }
+  }
+}
+
+//
+// prune the descendants of 'root', which is kept
+//
+static void
+prune_subtree(cct_node_t* root, prune_arg_t* arg)
+{
+  if (! prune_stack_reserve(0)) return;
+
+  size_t depth = 0;
+  prune_frame_init(&prune_stack[0], root, arg, true);
+
+  for (;;) {
+    prune_frame_t* f = &prune_stack[depth];
+    cct_node_t* child = f->next;
+
+    if (child) {
+      f->next = child->right;
+      child->right = NULL;
+      if (prune_stack_reserve(depth + 1)) {
+	depth++;
+	prune_frame_init(&prune_stack[depth], child, arg, false);
+      }
+      else {
+	// no memory for a deeper walk: leave the child's subtree alone
+	f->pinned = true;
+	list_append(&f->kept, &f->kept_last, child);
+      }
+      continue;
+    }
+
+    prune_frame_fini(f, arg);
+    if (depth == 0) break;
+
+    // hand the finished subtree to its parent's frame
+    prune_frame_t* p = &prune_stack[--depth];
+    p->share += f->share;
+    p->pinned = p->pinned || f->pinned;
+    if (! f->pinned && f->share < arg->threshold
+	&& ! cct_addr_eq(&(f->node->addr), arg->other)) {
+      list_append(&p->cold, &p->cold_last, f->node);
+    }
+    else {
+      list_append(&p->kept, &p->kept_last, f->node);
+    }
+  }
+}
+
+static void
+l_prune_child(cct_node_t* n, cct_op_arg_t arg, size_t level)
+{
+  prune_subtree(n, (prune_arg_t*) arg);
+}
+
+size_t
+hpcrun_cct_prune(cct_node_t* cct, cct_addr_t* other, double threshold,
+		 const double* totals, cct_node_t** pinned, int num_pinned)
+{
+  if (! cct) return 0;
+
+  prune_arg_t arg = {
+    .other      = other,
+    .pinned     = pinned,
+    .num_pinned = num_pinned,
+    .totals     = totals,
+    .threshold  = threshold,
+    .num_pruned = 0
+  };
+  // the children of cct are kept; only their descendants are pruned
+  hpcrun_cct_walkset(cct, l_prune_child, (cct_op_arg_t) &arg);
+
+  return arg.num_pruned;
+}
+
+static void
+l_metric_totals(cct_node_t* n, cct_op_arg_t arg, size_t level)
+{
+  hpcrun_metric_set_totals(hpcrun_get_metric_data_list(n), (double*) arg);
+}
+
+//
+// add the metrics of every node in cct to totals (indexed by metric id)
+//
+void
+hpcrun_cct_metric_totals(cct_node_t* cct, double* totals)
+{
+  hpcrun_cct_walk_node_1st(cct, l_metric_totals, totals);
+}
+
 //
 // Utilities
 //
@@ -1091,6 +1401,15 @@ hpcrun_cct_copy_just_addr(cct_node_t *cct)
   return cct ? cct_node_create(&cct->addr, NULL): NULL;
 }
 
+// A thread's creation context must outlive the creating thread's cct,
+// whose nodes are recycled by incremental flushes and pruning.
+cct_node_t*
+hpcrun_cct_copy_path(cct_node_t *cct)
+{
+  return cct ? cct_node_create(&cct->addr, hpcrun_cct_copy_path(cct->parent))
+    : NULL;
+}
+
 void
 hpcrun_cct_set_children(cct_node_t* cct, cct_node_t* children)
 {
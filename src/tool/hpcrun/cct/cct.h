@@ -270,6 +270,15 @@ typedef struct cct2metrics_t cct2metrics_t;
 int hpcrun_cct_fwrite(cct2metrics_t* cct2metrics_map,
                       cct_node_t* cct, FILE* fs, epoch_flags_t flags);
 //
+// Pruning operation: fold cold subtrees below the children of cct into
+// "other" nodes with address 'other'; returns the number of nodes removed.
+// 'totals' holds per-metric totals (see hpcrun_cct_metric_totals).
+//
+extern size_t hpcrun_cct_prune(cct_node_t* cct, cct_addr_t* other,
+			       double threshold, const double* totals,
+			       cct_node_t** pinned, int num_pinned);
+extern void hpcrun_cct_metric_totals(cct_node_t* cct, double* totals);
+//
 // Utilities
 //
 extern size_t hpcrun_cct_num_nodes(cct_node_t* cct, bool count_dummy);
@@ -314,6 +323,8 @@ extern void hpcrun_cct_walkset_merge(cct_node_t* cct, cct_op_merge_t fn, cct_op_
 
 // copy cct node
 cct_node_t* hpcrun_cct_copy_just_addr(cct_node_t *cct);
+// copy the path from the root down to cct, linked by parent pointers only
+cct_node_t* hpcrun_cct_copy_path(cct_node_t *cct);
 void hpcrun_cct_set_children(cct_node_t* cct, cct_node_t* children);
 void hpcrun_cct_set_parent(cct_node_t* cct, cct_node_t* parent);
 
@@ -76,8 +76,7 @@ walk_ctxt_rev(cct_ctxt_t* ctxt, cct_op_t op, cct_op_arg_t arg)
 cct_ctxt_t* 
 copy_thr_ctxt(cct_ctxt_t* thr_ctxt)
 {
-  // MEMORY PROBLEM: if thr_ctxt is reclaimed 
-  // FIXME: if reclamation of a thread context is possible, we would need
-  //        a deep copy here.
+  // no deep copy needed: the context path is already a copy, not part
+  // of the creating thread's (recyclable) cct; see monitor_thread_pre_create
   return thr_ctxt;
 }
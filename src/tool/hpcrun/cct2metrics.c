@@ -92,10 +92,20 @@ splay(cct2metrics_t* map, cct_node_id_t node)
   return map;
 }
 
+// map entries released by cct2metrics_remove, reused by this thread
+// (linked through the 'left' field)
+static __thread cct2metrics_t* free_entries = NULL;
+
 static cct2metrics_t*
 cct2metrics_new(cct_node_id_t node, metric_data_list_t* kind_metrics)
 {
-  cct2metrics_t* rv = hpcrun_malloc(sizeof(cct2metrics_t));
+  cct2metrics_t* rv = free_entries;
+  if (rv) {
+    free_entries = rv->left;
+  }
+  else {
+    rv = hpcrun_malloc(sizeof(cct2metrics_t));
+  }
   rv->node = node;
   rv->kind_metrics = kind_metrics;
   rv->left = rv->right = NULL;
@@ -233,3 +243,68 @@ cct2metrics_assoc(cct_node_id_t node, metric_data_list_t* kind_metrics)
 }
 
 
+//
+// remove the association of a cct node with its metrics (thread local
+// map); returns the node's metric data list, or NULL if it had none.
+// used when a node is pruned from the cct and may later be recycled.
+//
+metric_data_list_t*
+cct2metrics_remove(cct_node_id_t node)
+{
+  cct2metrics_t* map = THREAD_LOCAL_MAP();
+  if (! map) return NULL;
+
+  map = splay(map, node);
+  if (map->node != node) {
+    THREAD_LOCAL_MAP() = map;
+    return NULL;
+  }
+
+  metric_data_list_t* rv = map->kind_metrics;
+  cct2metrics_t* found = map;
+
+  if (map->left == NULL) {
+    map = map->right;
+  }
+  else {
+    map->left = splay(map->left, node);
+    map->left->right = map->right;
+    map = map->left;
+  }
+  THREAD_LOCAL_MAP() = map;
+
+  found->left = free_entries;
+  free_entries = found;
+
+  TMSG(CCT2METRICS, "REMOVE: %p, Metrics: %p", node, rv);
+  return rv;
+}
+
+
+//
+// release every entry of a map without recursion: rotate left children
+// up until the root has none, then release the root and continue with
+// its right subtree.
+//
+void
+hpcrun_cct2metrics_release(cct2metrics_t** map)
+{
+  cct2metrics_t* t = *map;
+  while (t) {
+    if (t->left) {
+      cct2metrics_t* l = t->left;
+      t->left = l->right;
+      l->right = t;
+      t = l;
+    }
+    else {
+      cct2metrics_t* right = t->right;
+      hpcrun_metric_data_list_free(t->kind_metrics);
+      t->left = free_entries;
+      free_entries = t;
+      t = right;
+    }
+  }
+  TMSG(CCT2METRICS, "RELEASE: map %p", *map);
+  *map = NULL;
+}
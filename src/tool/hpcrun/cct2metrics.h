@@ -27,6 +27,12 @@ typedef struct cct2metrics_t cct2metrics_t;
 
 extern void hpcrun_cct2metrics_init(cct2metrics_t** map);
 
+//
+// empty a map, returning its entries and their metric data lists to
+// this thread's free lists (the cct it describes is being discarded)
+//
+extern void hpcrun_cct2metrics_release(cct2metrics_t** map);
+
 // ******** Interface operations **********
 // 
 
@@ -57,6 +63,8 @@ extern metric_data_list_t* hpcrun_move_metric_data_list(cct_node_id_t dest_id, c
 
 extern void cct2metrics_assoc(cct_node_t* node, metric_data_list_t* kind_metrics);
 
+extern metric_data_list_t* cct2metrics_remove(cct_node_id_t node);
+
 //extern cct2metrics_t* cct2metrics_new(cct_node_id_t node, metric_set_t** kind_metrics);
 
 typedef enum {SET, INCR} update_metric_t;
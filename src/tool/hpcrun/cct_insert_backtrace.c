@@ -394,7 +394,9 @@ help_hpcrun_backtrace2cct(cct_bundle_t* bundle, ucontext_t* context,
   // initialize bt
   memset(&bt, 0, sizeof(bt));
 
+  uint64_t start = hpcrun_stats_cycles();
   bool success = hpcrun_generate_backtrace(&bt, context, skipInner);
+  hpcrun_stats_latency_add(NULL, HPCRUN_LATENCY_UNWIND, start);
 
   assert(!success == bt.partial_unwind);
 
@@ -428,10 +430,12 @@ help_hpcrun_backtrace2cct(cct_bundle_t* bundle, ucontext_t* context,
     hpcrun_stats_num_samples_partial_inc();
   }
 
+  start = hpcrun_stats_cycles();
   cct_node_t* n = 
     hpcrun_cct_record_backtrace_w_metric(bundle, bt.partial_unwind, &bt, 
 					 tramp_found,
 					 metricId, metricIncr, data);
+  hpcrun_stats_latency_add(NULL, HPCRUN_LATENCY_CCT_INSERT, start);
 
   if (!ompt_eager_context_p()) {
     // FIXME vi3: a big hack
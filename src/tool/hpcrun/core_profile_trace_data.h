@@ -1,6 +1,7 @@
 #ifndef CORE_PROFILE_TRACE_DATA_H
 #define CORE_PROFILE_TRACE_DATA_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <lib/prof-lean/hpcio-buffer.h>
@@ -8,6 +9,8 @@
 
 #include "epoch.h"
 #include "cct2metrics.h"
+#include "hpcrun_stats.h"
+#include "trace-flusher.h"
 
 enum perf_ksym_e {PERF_UNDEFINED, PERF_AVAILABLE, PERF_UNAVAILABLE} ;
 
@@ -35,8 +38,15 @@ typedef struct core_profile_trace_data_t {
   // IO support
   // ----------------------------------------
   FILE* hpcrun_file;
+  long hpcrun_file_trace_time_offset; // end of padded trace-time nv-pairs
+  uint64_t next_flush_time_us;        // periodic epoch flush deadline
+  uint64_t next_prune_time_us;        // periodic cct prune deadline
+  bool flush_pending;                 // periodic flush due at next safe point
+  bool prune_pending;                 // periodic prune due at next safe point
   void* trace_buffer;
   hpcio_outbuf_t *trace_outbuf;
+  trace_flusher_buf_t *trace_flusher; // set when a flusher thread writes records
+  struct sample_stream_s *sample_stream; // set when samples go to hpcrun-aggregate
 
   // ----------------------------------------
   // Perf support
@@ -44,6 +54,11 @@ typedef struct core_profile_trace_data_t {
 
   metric_aux_info_t *perf_event_info;
 
+  // ----------------------------------------
+  // hpcrun's own overhead, kept across re-initialization
+  // ----------------------------------------
+  hpcrun_stats_thread_t *stats;
+
 } core_profile_trace_data_t;
 
 
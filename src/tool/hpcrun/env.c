@@ -49,9 +49,19 @@ const char* HPCRUN_OPT_LUSH_AGENTS = "HPCRUN_OPT_LUSH_AGENTS";
 
 const char* HPCRUN_OUT_PATH        = "HPCRUN_OUT_PATH";
 const char* HPCRUN_TRACE           = "HPCRUN_TRACE";
+const char* HPCRUN_CONTAINER       = "HPCRUN_CONTAINER";
+const char* HPCRUN_COMPACT_CCT     = "HPCRUN_COMPACT_CCT";
+const char* HPCRUN_TRACE_FLUSHER   = "HPCRUN_TRACE_FLUSHER";
+const char* HPCRUN_AGGREGATE       = "HPCRUN_AGGREGATE";
+const char* HPCRUN_AGGREGATE_CMD   = "HPCRUN_AGGREGATE_CMD";
 
 const char* PAPI_EVENT_LIST        = "PAPI_EVENT_LIST";
 
 const char* HPCRUN_EVENT_LIST      = "HPCRUN_EVENT_LIST";
 const char* HPCRUN_MEMSIZE         = "HPCRUN_MEMSIZE";
 const char* HPCRUN_LOW_MEMSIZE     = "HPCRUN_LOW_MEMSIZE";
+const char* HPCRUN_MEMSTORE_NUMA   = "HPCRUN_MEMSTORE_NUMA";
+const char* HPCRUN_MEMSTORE_HUGEPAGES = "HPCRUN_MEMSTORE_HUGEPAGES";
+const char* HPCRUN_FLUSH_INTERVAL  = "HPCRUN_FLUSH_INTERVAL";
+const char* HPCRUN_PRUNE_THRESHOLD = "HPCRUN_PRUNE_THRESHOLD";
+const char* HPCRUN_PRUNE_INTERVAL  = "HPCRUN_PRUNE_INTERVAL";
@@ -84,9 +84,19 @@ extern const char* HPCRUN_OPT_LUSH_AGENTS;
 extern const char* HPCRUN_OUT_PATH;
 
 extern const char* HPCRUN_TRACE;
+extern const char* HPCRUN_CONTAINER;
+extern const char* HPCRUN_COMPACT_CCT;
+extern const char* HPCRUN_TRACE_FLUSHER;
+extern const char* HPCRUN_AGGREGATE;
+extern const char* HPCRUN_AGGREGATE_CMD;
 
 extern const char* HPCRUN_EVENT_LIST;
 extern const char* HPCRUN_MEMSIZE;
 extern const char* HPCRUN_LOW_MEMSIZE;
+extern const char* HPCRUN_MEMSTORE_NUMA;
+extern const char* HPCRUN_MEMSTORE_HUGEPAGES;
+extern const char* HPCRUN_FLUSH_INTERVAL;
+extern const char* HPCRUN_PRUNE_THRESHOLD;
+extern const char* HPCRUN_PRUNE_INTERVAL;
 
 #endif /* hpcrun_env_h */
@@ -49,17 +49,33 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <inttypes.h>
+#include <sys/time.h>
 
 #include "env.h"
 #include "epoch.h"
 #include "loadmap.h"
 #include "name.h"
 #include "thread_data.h"
+#include "hpcrun_dlfns.h"
 #include "hpcrun_return_codes.h"
 #include "monitor.h"
 #include <trampoline/common/trampoline.h>
 #include <messages/messages.h>
 #include <cct/cct_bundle.h>
+#include "metrics.h"
+#include "hpcrun-placeholders.h"
+#include "cct2metrics.h"
+#include "write_data.h"
+
+//
+// cct pruning policy (see hpcrun_epoch_prune)
+//
+static double prune_threshold = 0.0;    // 0 = pruning disabled
+static uint64_t prune_interval_us = 60 * 1000000UL;
+
+// measurement component that forbids recycling cct nodes, if any
+static const char* recycle_disabled_by = NULL;
 
 void
 hpcrun_reset_epoch(epoch_t* epoch)
@@ -157,3 +173,265 @@ hpcrun_epoch_reset(void)
   hpcrun_reset_epoch(newepoch);
   TMSG(EPOCH_RESET," ==> no new epoch for next sample = %d", newepoch->loadmap == hpcrun_getLoadmap());
 }
+
+
+//
+// cct pruning: bound the size of a long-running thread's cct by
+// periodically folding cold subtrees into "other" nodes
+//
+
+static uint64_t
+prune_time_us(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return ((uint64_t) tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+
+void
+hpcrun_epoch_prune_init(void)
+{
+  char* str = getenv(HPCRUN_PRUNE_THRESHOLD);
+  if (str != NULL) {
+    double threshold = strtod(str, NULL);
+    if (0 < threshold && threshold < 1) {
+      prune_threshold = threshold;
+    }
+    else {
+      EMSG("ignoring %s = %s: threshold must lie in (0, 1)",
+	   HPCRUN_PRUNE_THRESHOLD, str);
+    }
+  }
+
+  str = getenv(HPCRUN_PRUNE_INTERVAL);
+  if (str != NULL) {
+    double sec = strtod(str, NULL);
+    if (sec > 0) {
+      prune_interval_us = (uint64_t) (sec * 1000000);
+    }
+    else {
+      EMSG("ignoring invalid %s: %s", HPCRUN_PRUNE_INTERVAL, str);
+    }
+  }
+
+  if (prune_threshold > 0 && recycle_disabled_by) {
+    EMSG("cct pruning disabled: not supported with %s", recycle_disabled_by);
+  }
+  TMSG(EPOCH, "cct prune threshold = %g, interval = %"PRIu64" us",
+       prune_threshold, prune_interval_us);
+}
+
+
+//
+// Called by measurement components that keep pointers to cct nodes
+// beyond the sample that created them, where a recycled node would be
+// left dangling.
+//
+void
+hpcrun_epoch_recycle_disable(const char* reason)
+{
+  recycle_disabled_by = reason;
+}
+
+
+bool
+hpcrun_epoch_recycle_enabled(void)
+{
+  return recycle_disabled_by == NULL;
+}
+
+
+//
+// Start the thread over with an empty cct after its epochs have been
+// written by an incremental flush.  Unless recycling is disabled, the
+// written trees and their metrics go back to the thread's free lists and
+// the head epoch (with the current loadmap) is reused, so that memory
+// use does not grow with the length of the run.
+//
+// Only called at a safe point (see hpcrun_epoch_safe_point), where the
+// thread holds no node of the written trees.
+//
+void
+hpcrun_epoch_recycle(core_profile_trace_data_t* cptd)
+{
+  if (recycle_disabled_by) {
+    hpcrun_epoch_reset();
+    hpcrun_cct2metrics_init(&(cptd->cct2metrics_map));
+    return;
+  }
+
+  // the trampoline marks a node of the current tree
+  hpcrun_trampoline_remove();
+
+  hpcrun_cct2metrics_release(&(cptd->cct2metrics_map));
+
+  epoch_t* epoch = cptd->epoch;
+  for (epoch_t* e = epoch; e; e = e->next) {
+    cct_bundle_t* cct = &(e->csdata);
+    // writing an epoch attaches its partial unwinds below its tree root
+    if (hpcrun_cct_parent(cct->partial_unw_root) == NULL) {
+      hpcrun_cct_node_free(cct->partial_unw_root);
+    }
+    hpcrun_cct_node_free(cct->unresolved_root);
+    hpcrun_cct_node_free(cct->top);
+  }
+
+  hpcrun_cct_bundle_init(&(epoch->csdata), epoch->csdata_ctxt);
+  hpcrun_reset_epoch(epoch);
+  TMSG(EPOCH_RESET, "recycled cct");
+}
+
+
+//
+// Incremental flushes and pruning write files and recycle cct nodes,
+// which is not safe in a signal handler: a sample only notes that such
+// work is due, and the thread runs it at its next non-handler entry
+// into hpcrun (thread creation, dlopen and dlclose, the I/O overrides),
+// inside a safe region, or at the end of a later sample that
+// interrupted application code (see hpcrun_epoch_async_safe_point).
+//
+void
+hpcrun_epoch_safe_point(void)
+{
+  if (! hpcrun_td_avail()) return;
+
+  core_profile_trace_data_t* cptd = &(TD_GET(core_profile_trace_data));
+  if (cptd->epoch == NULL) return;
+
+  if (cptd->flush_pending) {
+    cptd->flush_pending = false;
+    cptd->prune_pending = false;
+    hpcrun_flush_epochs_recycle(cptd);
+  }
+  else if (cptd->prune_pending) {
+    cptd->prune_pending = false;
+    hpcrun_epoch_prune();
+  }
+}
+
+
+// load modules whose code may hold locks that writing a profile needs
+// (malloc and stdio, the dynamic loader) or that belong to hpcrun
+static const char* epoch_runtime_lm[] = {
+  "libc.", "libc-", "ld-", "ld64.", "libpthread", "libdl", "librt",
+  "libm.", "libm-", "libgcc_s", "libstdc++", "libmonitor", "libhpcrun",
+};
+
+
+static bool
+epoch_pc_in_runtime(void* pc)
+{
+  load_module_t* lm = hpcrun_loadmap_findByAddr(pc, pc);
+  if (lm == NULL || lm->name == NULL) return true;
+
+  const char* base = strrchr(lm->name, '/');
+  base = (base) ? base + 1 : lm->name;
+
+  for (int i = 0; i < sizeof(epoch_runtime_lm) / sizeof(epoch_runtime_lm[0]);
+       i++) {
+    const char* pfx = epoch_runtime_lm[i];
+    if (strncmp(base, pfx, strlen(pfx)) == 0) return true;
+  }
+  return false;
+}
+
+
+//
+// Called by the async sample sources at the end of a sample, after
+// they are done with its cct nodes, so that the periodic work also
+// runs in threads that never enter hpcrun otherwise (e.g., the
+// compute threads of a fixed pool).  The work runs only if the sample
+// interrupted application code ('pc'), not a dlopen or dlclose or a
+// runtime library that may hold a lock the work needs.  Otherwise it
+// stays pending for a later sample or safe point.
+//
+void
+hpcrun_epoch_async_safe_point(void* pc)
+{
+#ifndef HPCRUN_STATIC_LINK
+  if (! hpcrun_td_avail()) return;
+
+  thread_data_t* td = hpcrun_get_thread_data();
+  core_profile_trace_data_t* cptd = &(td->core_profile_trace_data);
+  if (! (cptd->flush_pending || cptd->prune_pending)) return;
+  if (td->inside_dlfcn) return;
+
+  if (! hpcrun_dlopen_read_lock()) return;
+  if (! epoch_pc_in_runtime(pc)) {
+    hpcrun_epoch_safe_point();
+  }
+  hpcrun_dlopen_read_unlock();
+#endif
+}
+
+
+bool
+hpcrun_epoch_prune_enabled(void)
+{
+  return prune_threshold > 0 && recycle_disabled_by == NULL;
+}
+
+
+bool
+hpcrun_epoch_prune_due(core_profile_trace_data_t* cptd)
+{
+  if (! hpcrun_epoch_prune_enabled())
+    return false;
+
+  uint64_t now = prune_time_us();
+  if (cptd->next_prune_time_us == 0) {
+    cptd->next_prune_time_us = now + prune_interval_us;
+    return false;
+  }
+  if (now < cptd->next_prune_time_us)
+    return false;
+
+  cptd->next_prune_time_us = now + prune_interval_us;
+  return true;
+}
+
+
+//
+// Fold the cold subtrees of the current thread's cct into "other"
+// nodes.  A subtree is cold when its share of the thread's metrics
+// (summed over metrics, relative to each metric's total) falls below
+// the threshold.  The children of the tree roots are always kept, so
+// that special nodes (e.g., idle and no-activity) remain valid.
+//
+// Only called at a safe point (see hpcrun_epoch_safe_point), where the
+// thread holds no cct node; in a compute-bound thread, that is usually
+// the end of an async sample (see hpcrun_epoch_async_safe_point).
+//
+void
+hpcrun_epoch_prune(void)
+{
+  thread_data_t* td = hpcrun_get_thread_data();
+  cct_bundle_t* cct = &(td->core_profile_trace_data.epoch->csdata);
+
+  int num_metrics = hpcrun_get_num_kind_metrics();
+  double totals[num_metrics];
+  memset(totals, 0, sizeof(totals));
+  hpcrun_cct_metric_totals(cct->top, totals);
+  hpcrun_cct_metric_totals(cct->partial_unw_root, totals);
+
+  int active = 0;
+  for (int i = 0; i < num_metrics; i++) {
+    if (totals[i] > 0) active++;
+  }
+  if (active == 0) return;
+
+  // the trampoline marks a node of the tree
+  cct_node_t* keep[] = { td->tramp_cct_node };
+
+  placeholder_t* ph = hpcrun_placeholder_get(hpcrun_placeholder_type_pruned);
+  cct_addr_t other = ADDR2(ph->pc_norm.lm_id, ph->pc_norm.lm_ip);
+
+  size_t pruned = 0;
+  double threshold = prune_threshold * active;
+  pruned += hpcrun_cct_prune(cct->top, &other, threshold, totals, keep, 1);
+  pruned += hpcrun_cct_prune(cct->partial_unw_root, &other, threshold, totals,
+			     keep, 1);
+
+  TMSG(EPOCH, "cct prune: %ld nodes folded", pruned);
+}
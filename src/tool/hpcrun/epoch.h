@@ -49,6 +49,8 @@
 
 //************************* System Include Files ****************************
 
+#include <stdbool.h>
+
 //*************************** User Include Files ****************************
 
 #include <cct/cct.h>
@@ -79,4 +81,21 @@ epoch_t* hpcrun_check_for_new_loadmap(epoch_t *);
 void hpcrun_epoch_init(cct_ctxt_t* ctxt);
 void hpcrun_epoch_reset(void);
 
+struct core_profile_trace_data_t;
+
+// cct node recycling (by incremental flushes and pruning)
+void hpcrun_epoch_recycle_disable(const char* reason);
+bool hpcrun_epoch_recycle_enabled(void);
+void hpcrun_epoch_recycle(struct core_profile_trace_data_t* cptd);
+
+// run the periodic work that samples note as due
+void hpcrun_epoch_safe_point(void);
+void hpcrun_epoch_async_safe_point(void* pc);
+
+// cct pruning, controlled by HPCRUN_PRUNE_THRESHOLD/HPCRUN_PRUNE_INTERVAL
+void hpcrun_epoch_prune_init(void);
+bool hpcrun_epoch_prune_enabled(void);
+bool hpcrun_epoch_prune_due(struct core_profile_trace_data_t* cptd);
+void hpcrun_epoch_prune(void);
+
 #endif // EPOCH_H
@@ -97,6 +97,14 @@
 // It would make sense to replace the (hostid, pid, gen) ids with a
 // single random number of some length, again testing with O_EXCL and
 // using a different value if necessary.
+//
+// Container mode (HPCRUN_CONTAINER): instead of one .hpcrun and one
+// .hpctrace file per thread, all threads of the process append their
+// streams to a single "prog-rank-000-hostid-pid-gen.hpccontainer"
+// file (see lib/prof-lean/hpcrun-container.h).  The container is
+// opened early like the trace files and renamed late like the log
+// file; its streams get their final names (the names of the files
+// they replace) when the index is written at the end of the process.
 
 
 //***************************************************************
@@ -128,6 +136,10 @@
 #include "loadmap.h"
 #include "sample_prob.h"
 
+#include <memory/hpcrun-malloc.h>
+
+#include <lib/prof-lean/hpcrun-container.h>
+#include <lib/prof-lean/hpcrun-fmt.h>
 #include <lib/prof-lean/spinlock.h>
 #include <lib/prof-lean/vdso.h>
 #include <lib/prof-lean/crypto-hash.h> // Calculate a hash for vdso
@@ -139,7 +151,10 @@
 //***************************************************************
 
 // directory/progname-rank-thread-hostid-pid-gen.suffix
-#define FILENAME_TEMPLATE  "%s/%s-%06u-%03d-" HOSTID_FORMAT "-%u-%d.%s"
+#define FILENAME_TEMPLATE  "%s/" STREAMNAME_TEMPLATE
+
+// progname-rank-thread-hostid-pid-gen.suffix
+#define STREAMNAME_TEMPLATE  "%s-%06u-%03d-" HOSTID_FORMAT "-%u-%d.%s"
 
 #define FILES_RANDOM_GEN  4
 #define FILES_MAX_GEN     11
@@ -183,6 +198,12 @@ static int log_rename_ret = 0;
 
 static int vdso_written = 0; // for coordination across fork
 
+// container mode: -1 until hpcrun_files_set_directory() decides.
+// After the container is finished, late opens fall back to files.
+static int container_mode = -1;
+static int container_fd = -1;
+static hpccont_writer_t *container = NULL;
+
 char vdso_hash_str[HASH_LENGTH * 2];
 //***************************************************************
 // private operations
@@ -206,6 +227,12 @@ hpcrun_files_init(void)
     log_done = 0;
     log_rename_done = 0;
     log_rename_ret = 0;
+    // a child after fork() starts its own container
+    if (container != NULL) {
+      close(container_fd);
+      container_fd = -1;
+      container = NULL;
+    }
   }
 }
 
@@ -363,6 +390,39 @@ hpcrun_rename_file(int rank, int thread, const char *suffix)
 }
 
 
+// Returns: the process's container, opening it on first use.  Must
+// hold the files lock.
+static hpccont_writer_t *
+hpcrun_files_container(void)
+{
+  if (container == NULL) {
+    container_fd = hpcrun_open_file(0, 0, HPCRUN_ContainerFnmSfx, FILES_EARLY);
+    container = hpccont_writer_attach(container_fd, hpcrun_malloc);
+    if (container == NULL) {
+      hpcrun_abort("hpctoolkit: unable to initialize %s file: %s",
+		   HPCRUN_ContainerFnmSfx, strerror(errno));
+    }
+  }
+  return container;
+}
+
+
+// Final name of a container stream.  Must hold the files lock.
+static int
+hpcrun_container_stream_name(void *arg, int kind, int thread,
+			     char *buf, size_t len)
+{
+  int rank = *(int *) arg;
+  const char *suffix = (kind == HPCCONT_STREAM_TRACE)
+    ? HPCRUN_TraceFnmSfx : HPCRUN_ProfileFnmSfx;
+
+  int ret = snprintf(buf, len, STREAMNAME_TEMPLATE, executable_name,
+		     rank, thread, lateid.host, mypid, lateid.gen, suffix);
+
+  return (ret > 0 && ret < len) ? 0 : -1;
+}
+
+
 //***************************************************************
 // interface operations
 //***************************************************************
@@ -410,6 +470,20 @@ hpcrun_files_set_directory()
   if (!rpath) {
     hpcrun_abort("hpcrun: could not access directory `%s': %s", path, strerror(errno));
   }
+
+  if (container_mode < 0) {
+    char *str = getenv(HPCRUN_CONTAINER);
+    container_mode = (str != NULL && atoi(str) != 0);
+  }
+}
+
+
+// Returns: true if this process writes its profiles and traces into a
+// container rather than into per-thread files.
+int
+hpcrun_files_use_container(void)
+{
+  return container_mode > 0 && hpcrun_sample_prob_active();
 }
 
 
@@ -484,6 +558,75 @@ hpcrun_open_profile_file(int rank, int thread)
 }
 
 
+// Returns: a new trace stream in the process's container, or NULL if
+// the container was already finished (the caller then falls back to
+// hpcrun_open_trace_file).
+hpccont_stream_t *
+hpcrun_open_trace_stream(int thread)
+{
+  hpccont_stream_t *s = NULL;
+
+  spinlock_lock(&files_lock);
+  hpcrun_files_init();
+  if (container_mode > 0) {
+    s = hpccont_stream_open(hpcrun_files_container(), HPCCONT_STREAM_TRACE,
+			    thread);
+  }
+  spinlock_unlock(&files_lock);
+
+  return s;
+}
+
+
+// Returns: a new profile stream in the process's container, or NULL
+// if the container was already finished (the caller then falls back
+// to hpcrun_open_profile_file).
+hpccont_stream_t *
+hpcrun_open_profile_stream(int rank, int thread)
+{
+  hpccont_stream_t *s = NULL;
+
+  spinlock_lock(&files_lock);
+  hpcrun_files_init();
+  if (container_mode > 0) {
+    s = hpccont_stream_open(hpcrun_files_container(), HPCCONT_STREAM_PROFILE,
+			    thread);
+  }
+  spinlock_unlock(&files_lock);
+
+  return s;
+}
+
+
+// Rename the container to its late name and write its index.  Must be
+// called after all threads have written their data; streams of
+// threads that are still running are cut off here.
+//
+// Returns: 0 on success, else -1 on failure.
+int
+hpcrun_close_container(int rank)
+{
+  int ret = 0;
+
+  spinlock_lock(&files_lock);
+  if (container != NULL && mypid == getpid()) {
+    hpcrun_rename_log_file_early(rank);
+    hpcrun_rename_file(rank, 0, HPCRUN_ContainerFnmSfx);
+    ret = hpccont_writer_finish(container, hpcrun_container_stream_name, &rank);
+    if (ret != 0) {
+      EMSG("hpctoolkit: unable to write index of %s file: %s",
+	   HPCRUN_ContainerFnmSfx, strerror(errno));
+    }
+    container_fd = -1;
+    container = NULL;
+  }
+  container_mode = 0;
+  spinlock_unlock(&files_lock);
+
+  return ret;
+}
+
+
 // Note: we use the log file as the lock for the file names, so we
 // need to rename the log file as the first late action.  Since this
 // is out of sequence, we save the return value and return it when the
@@ -47,6 +47,7 @@
 #ifndef files_h
 #define files_h
 
+#include <lib/prof-lean/hpcrun-container.h>
 
 //*****************************************************************************
 // forward declarations
@@ -66,6 +67,12 @@ int hpcrun_open_profile_file(int rank, int thread);
 int hpcrun_rename_log_file(int rank);
 int hpcrun_rename_trace_file(int rank, int thread);
 
+// container mode (HPCRUN_CONTAINER)
+int hpcrun_files_use_container(void);
+hpccont_stream_t *hpcrun_open_trace_stream(int thread);
+hpccont_stream_t *hpcrun_open_profile_stream(int rank, int thread);
+int hpcrun_close_container(int rank);
+
 // storing the hash of the vdso for the current process
 extern char vdso_hash_str[];
 void hpcrun_save_vdso();
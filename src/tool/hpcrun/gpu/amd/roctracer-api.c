@@ -410,6 +410,7 @@ roctracer_buffer_completion_callback
     roctracer_activity_process(record);
     record++;
   }
+  gpu_activity_process_flush();
 }
 
 
@@ -41,10 +41,45 @@
 //
 // ******************************************************* EndRiceCopyright *
 
+//******************************************************************************
+// Description:
+//
+//   an activity channel carries gpu activities from the monitoring thread
+//   (the only producer) to the application thread that owns the channel
+//   (the only consumer). like the correlation maps, the channel relies on
+//   activities being processed by one thread at a time.
+//
+//   the common path is a bounded single-producer/single-consumer ring of
+//   activity slots: the producer copies activities into free slots and
+//   publishes them by advancing head; the consumer drains every published
+//   slot in one pass and releases them by advancing tail. neither side
+//   allocates or executes a read-modify-write atomic. the producer
+//   allocates a channel's ring when it first produces into the channel,
+//   so threads that never receive an activity don't pay for one.
+//
+//   if the consumer falls behind and the ring is full, activities spill
+//   into the original bidirectional channel of individually allocated
+//   items, so no activity is ever dropped.
+//
+//******************************************************************************
+
+
+
+//******************************************************************************
+// system includes
+//******************************************************************************
+
+#include <stdint.h>
+#include <string.h>
+
+
+
 //******************************************************************************
 // local includes
 //******************************************************************************
 
+#include <lib/prof-lean/stdatomic.h>
+
 #include <hpcrun/memory/hpcrun-malloc.h>
 
 #include "gpu-activity.h"
@@ -52,6 +87,7 @@
 #include "gpu-channel-item-allocator.h"
 
 
+
 //******************************************************************************
 // macros
 //******************************************************************************
@@ -81,13 +117,49 @@
 #define gpu_activity_free(channel, item)	\
   channel_item_free(channel, item)
 
+// number of activity slots in a channel's ring; must be a power of 2
+#define GPU_ACTIVITY_CHANNEL_RING_SIZE 1024
+
+#define GPU_ACTIVITY_CHANNEL_RING_MASK (GPU_ACTIVITY_CHANNEL_RING_SIZE - 1)
+
+#define GPU_ACTIVITY_CHANNEL_CACHE_LINE_SZ 64
+
+#define ring_slot(channel, index) \
+  (&(channel)->ring[(index) & GPU_ACTIVITY_CHANNEL_RING_MASK])
+
+
 
 //******************************************************************************
 // type declarations
 //******************************************************************************
 
+// ring indices grow monotonically; a slot index is an index modulo the
+// ring size. each index lives on its own cache line so that the producer
+// and consumer don't false share.
+typedef struct {
+  atomic_ullong value;
+  char pad[GPU_ACTIVITY_CHANNEL_CACHE_LINE_SZ - sizeof(atomic_ullong)];
+} gpu_activity_channel_index_t;
+
+
 typedef struct gpu_activity_channel_t {
+  // overflow channel; must be first so that the channel can be used
+  // with the channel item allocator
   bistack_t bistacks[2];
+
+  // written only by the producer
+  gpu_activity_channel_index_t head;
+
+  // written only by the consumer
+  gpu_activity_channel_index_t tail;
+
+  // producer-private copy of tail, refreshed only when the ring appears full
+  uint64_t tail_cache;
+
+  // GPU_ACTIVITY_CHANNEL_RING_SIZE slots, allocated by the producer.
+  // the consumer reads it only after seeing a head that the producer
+  // published after allocating it
+  gpu_activity_t *ring;
 } gpu_activity_channel_t;
 
 
@@ -119,10 +191,74 @@ gpu_activity_channel_alloc
 
   channel_init(c);
 
+  atomic_init(&c->head.value, 0);
+  atomic_init(&c->tail.value, 0);
+  c->tail_cache = 0;
+  c->ring = NULL;
+
   return c;
 }
 
 
+// return the number of free ring slots visible to the producer
+static uint64_t
+gpu_activity_channel_ring_space
+(
+ gpu_activity_channel_t *channel,
+ uint64_t head,
+ uint64_t wanted
+)
+{
+  uint64_t space = GPU_ACTIVITY_CHANNEL_RING_SIZE - (head - channel->tail_cache);
+
+  if (space < wanted) {
+    // refresh our view of the consumer's progress; acquire ensures that
+    // the consumer is done with the slots it released
+    channel->tail_cache = 
+      atomic_load_explicit(&channel->tail.value, memory_order_acquire);
+    space = GPU_ACTIVITY_CHANNEL_RING_SIZE - (head - channel->tail_cache);
+  }
+
+  return space;
+}
+
+
+static void
+gpu_activity_channel_overflow_produce
+(
+ gpu_activity_channel_t *channel,
+ gpu_activity_t *a
+)
+{
+  gpu_activity_t *channel_activity = gpu_activity_alloc(channel);
+  *channel_activity = *a;
+
+  gpu_context_activity_dump(channel_activity, "PRODUCE");
+
+  channel_push(channel, bichannel_direction_forward, channel_activity);
+}
+
+
+static void
+gpu_activity_channel_overflow_consume
+(
+ gpu_activity_channel_t *channel,
+ gpu_activity_attribute_fn_t aa_fn
+)
+{
+  // steal elements previously enqueued by the producer
+  channel_steal(channel, bichannel_direction_forward);
+
+  // consume all elements enqueued before this function was called
+  for (;;) {
+    gpu_activity_t *a = channel_pop(channel, bichannel_direction_forward);
+    if (!a) break;
+    gpu_activity_consume(a, aa_fn);
+    gpu_activity_free(channel, a);
+  }
+}
+
+
 
 //******************************************************************************
 // interface operations 
@@ -142,6 +278,47 @@ gpu_activity_channel_get
 }
 
 
+void
+gpu_activity_channel_produce_batch
+(
+ gpu_activity_channel_t *channel,
+ gpu_activity_t *a,
+ size_t n
+)
+{
+  if (channel->ring == NULL) {
+    channel->ring = hpcrun_malloc_safe
+      (GPU_ACTIVITY_CHANNEL_RING_SIZE * sizeof(gpu_activity_t));
+  }
+
+  uint64_t head = 
+    atomic_load_explicit(&channel->head.value, memory_order_relaxed);
+
+  // without a ring, every activity spills
+  uint64_t space = (channel->ring) ? 
+    gpu_activity_channel_ring_space(channel, head, n) : 0;
+  size_t nring = (n < space) ? n : space;
+
+  size_t i;
+  for (i = 0; i < nring; i++) {
+    gpu_activity_t *slot = ring_slot(channel, head + i);
+    *slot = a[i];
+    gpu_context_activity_dump(slot, "PRODUCE");
+  }
+
+  if (nring > 0) {
+    // publish all slots filled above at once
+    atomic_store_explicit(&channel->head.value, head + nring, 
+			  memory_order_release);
+  }
+
+  // the ring is full: spill the rest rather than wait for the consumer
+  for (; i < n; i++) {
+    gpu_activity_channel_overflow_produce(channel, &a[i]);
+  }
+}
+
+
 void
 gpu_activity_channel_produce
 (
@@ -149,31 +326,218 @@ gpu_activity_channel_produce
  gpu_activity_t *a
 )
 {
-  gpu_activity_t *channel_activity = gpu_activity_alloc(channel);
-  *channel_activity = *a;
+  gpu_activity_channel_produce_batch(channel, a, 1);
+}
 
-  gpu_context_activity_dump(channel_activity, "PRODUCE");
 
-  channel_push(channel, bichannel_direction_forward, channel_activity);
+void
+gpu_activity_channel_consume
+(
+ gpu_activity_attribute_fn_t aa_fn
+)
+{
+  gpu_activity_channel_t *channel = gpu_activity_channel;
+
+  // nothing can have been produced for a thread without a channel
+  if (channel == NULL) return;
+
+  uint64_t tail = 
+    atomic_load_explicit(&channel->tail.value, memory_order_relaxed);
+
+  // acquire ensures that the contents of published slots are visible
+  uint64_t head = 
+    atomic_load_explicit(&channel->head.value, memory_order_acquire);
+
+  // consume all ring slots published before this function was called
+  uint64_t i;
+  for (i = tail; i != head; i++) {
+    gpu_activity_consume(ring_slot(channel, i), aa_fn);
+  }
+
+  if (head != tail) {
+    // return all consumed slots to the producer at once
+    atomic_store_explicit(&channel->tail.value, head, memory_order_release);
+  }
+
+  gpu_activity_channel_overflow_consume(channel, aa_fn);
+}
+
+
+
+//******************************************************************************
+// unit test
+//******************************************************************************
+
+#define UNIT_TEST 0
+
+#if UNIT_TEST
+
+// a cpu-only stress test: a producer thread plays the role of the
+// monitoring thread and streams synthetic kernel activities, in batches
+// of random size, into the channel of a consumer thread, which plays the
+// role of an application thread. the consumer checks that every activity
+// arrives exactly once and intact.
+//
+// build (from src, with include/hpctoolkit-config.h from a configured tree)
+// after changing UNIT_TEST above to 1:
+//
+//   cc -std=gnu99 -O2 -I. -I./tool -I./tool/hpcrun -I./tool/hpcrun/fnbounds
+//      tool/hpcrun/gpu/gpu-activity-channel.c
+//      tool/hpcrun/gpu/gpu-channel-item-allocator.c
+//      lib/prof-lean/bichannel.c lib/prof-lean/bistack.c
+//      lib/prof-lean/stacks.c -lpthread
+
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define NACTIVITIES (16 * 1024 * 1024)
+#define MAX_BATCH 64
+
+static gpu_activity_channel_t *test_channel;
+
+static atomic_int test_channel_ready;
+
+static uint64_t test_consumed;
+
+static uint64_t test_expected_sum;
+
+
+void *
+hpcrun_malloc_safe
+(
+ size_t s
+)
+{
+  return malloc(s);
 }
 
 
 void
-gpu_activity_channel_consume
+gpu_context_activity_dump
 (
+ gpu_activity_t *activity,
+ const char *context
+)
+{
+}
+
+
+void
+gpu_activity_consume
+(
+ gpu_activity_t *activity,
  gpu_activity_attribute_fn_t aa_fn
 )
 {
-  gpu_activity_channel_t *channel = gpu_activity_channel_get();
+  aa_fn(activity);
+}
 
-  // steal elements previously enqueued by the producer
-  channel_steal(channel, bichannel_direction_forward);
 
-  // consume all elements enqueued before this function was called
-  for (;;) {
-    gpu_activity_t *a = channel_pop(channel, bichannel_direction_forward);
-    if (!a) break;
-    gpu_activity_consume(a, aa_fn);
-    gpu_activity_free(channel, a);
+static void
+test_attribute
+(
+ gpu_activity_t *a
+)
+{
+  gpu_kernel_t *k = &a->details.kernel;
+
+  // activities are checked for integrity rather than order, since
+  // ring and overflow activities may be interleaved
+  assert(a->kind == GPU_ACTIVITY_KERNEL);
+  assert(k->end == k->start + 1);
+  assert(k->correlation_id == (uint32_t) k->start);
+
+  test_expected_sum -= k->start;
+  test_consumed++;
+}
+
+
+static void *
+test_consumer
+(
+ void *arg
+)
+{
+  test_channel = gpu_activity_channel_get();
+  atomic_store(&test_channel_ready, 1);
+
+  while (test_consumed < NACTIVITIES) {
+    gpu_activity_channel_consume(test_attribute);
+  }
+
+  return NULL;
+}
+
+
+static void *
+test_producer
+(
+ void *arg
+)
+{
+  static gpu_activity_t batch[MAX_BATCH];
+  unsigned int seed = 1;
+  uint64_t produced = 0;
+
+  while (!atomic_load(&test_channel_ready));
+
+  while (produced < NACTIVITIES) {
+    size_t n = 1 + rand_r(&seed) % MAX_BATCH;
+    if (n > NACTIVITIES - produced) n = NACTIVITIES - produced;
+
+    size_t i;
+    for (i = 0; i < n; i++, produced++) {
+      memset(&batch[i], 0, sizeof(gpu_activity_t));
+      batch[i].kind = GPU_ACTIVITY_KERNEL;
+      batch[i].details.kernel.start = produced;
+      batch[i].details.kernel.end = produced + 1;
+      batch[i].details.kernel.correlation_id = (uint32_t) produced;
+    }
+
+    gpu_activity_channel_produce_batch(test_channel, batch, n);
   }
+
+  return NULL;
 }
+
+
+int
+main
+(
+ int argc,
+ char **argv
+)
+{
+  pthread_t producer, consumer;
+  struct timespec t0, t1;
+
+  test_expected_sum = ((uint64_t) NACTIVITIES * (NACTIVITIES - 1)) / 2;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  pthread_create(&consumer, NULL, test_consumer, NULL);
+  pthread_create(&producer, NULL, test_producer, NULL);
+
+  pthread_join(producer, NULL);
+  pthread_join(consumer, NULL);
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+
+  printf("consumed %lu activities in %.3f s (%.1f M activities/s)\n",
+	 test_consumed, secs, test_consumed / secs * 1e-6);
+
+  assert(test_consumed == NACTIVITIES);
+  assert(test_expected_sum == 0);
+
+  printf("passed\n");
+
+  return 0;
+}
+
+#endif
@@ -44,6 +44,14 @@
 #ifndef gpu_activity_channel_h
 #define gpu_activity_channel_h
 
+//******************************************************************************
+// system includes
+//******************************************************************************
+
+#include <stddef.h>
+
+
+
 //******************************************************************************
 // local includes
 //******************************************************************************
@@ -82,6 +90,17 @@ gpu_activity_channel_produce
 );
 
 
+// produce n activities into channel, publishing them to the consumer
+// with a single release store when they fit in the channel's ring
+void
+gpu_activity_channel_produce_batch
+(
+ gpu_activity_channel_t *channel,
+ gpu_activity_t *a,
+ size_t n
+);
+
+
 void
 gpu_activity_channel_consume
 (
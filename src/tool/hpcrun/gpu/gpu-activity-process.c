@@ -76,12 +76,60 @@
 
 #include "gpu-print.h"
 
+// number of attributed activities staged for one channel before they
+// are produced into it
+#define GPU_ACTIVITY_BATCH_SIZE 64
+
+
+
+//******************************************************************************
+// local data
+//******************************************************************************
+
+// activities are processed by one thread at a time, so the staging area
+// needs no synchronization. it holds activities for one channel only.
+static gpu_activity_channel_t *batch_channel = NULL;
+
+static gpu_activity_t batch[GPU_ACTIVITY_BATCH_SIZE];
+
+static size_t batch_count = 0;
+
 
 
 //******************************************************************************
 // private operations
 //******************************************************************************
 
+static void
+gpu_activity_batch_flush
+(
+ void
+)
+{
+  if (batch_count > 0) {
+    gpu_activity_channel_produce_batch(batch_channel, batch, batch_count);
+    batch_count = 0;
+  }
+}
+
+
+static void
+gpu_activity_batch_add
+(
+ gpu_activity_channel_t *channel,
+ gpu_activity_t *activity
+)
+{
+  // keep each channel's activities in order
+  if (channel != batch_channel || batch_count == GPU_ACTIVITY_BATCH_SIZE) {
+    gpu_activity_batch_flush();
+    batch_channel = channel;
+  }
+
+  batch[batch_count++] = *activity;
+}
+
+
 
 
 static void
@@ -136,7 +184,7 @@ attribute_activity
   gpu_activity_channel_t *channel = 
     gpu_host_correlation_map_entry_channel_get(hc);
   activity->cct_node = cct_node;
-  gpu_activity_channel_produce(channel, activity);
+  gpu_activity_batch_add(channel, activity);
 }
 
 
@@ -626,3 +674,13 @@ gpu_activity_process
   }
 }
 
+
+void
+gpu_activity_process_flush
+(
+ void
+)
+{
+  gpu_activity_batch_flush();
+}
+
@@ -65,5 +65,14 @@ gpu_activity_process
 );
 
 
+// produce the activities that gpu_activity_process has attributed but
+// not yet handed to their channels. called after processing a buffer.
+void
+gpu_activity_process_flush
+(
+ void
+);
+
+
 
 #endif
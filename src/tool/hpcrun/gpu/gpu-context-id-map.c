@@ -54,7 +54,7 @@
 // local includes
 //******************************************************************************
 
-#include <lib/prof-lean/splay-uint64.h>
+#include <lib/prof-lean/cmap-uint64.h>
 
 #include <hpcrun/messages/messages.h>
 #include <hpcrun/memory/hpcrun-malloc.h>
@@ -69,39 +69,21 @@
 // macros
 //******************************************************************************
 
-#define st_insert				\
-  typed_splay_insert(context_id)
-
-#define st_lookup				\
-  typed_splay_lookup(context_id)
-
-#define st_delete				\
-  typed_splay_delete(context_id)
-
-#define st_forall				\
-  typed_splay_forall(context_id)
-
-#define st_count				\
-  typed_splay_count(context_id)
-
 #define st_alloc(free_list)			\
-  typed_splay_alloc(free_list, typed_splay_node(context_id))
+  typed_splay_alloc(free_list, gpu_context_id_map_entry_t)
 
 #define st_free(free_list, node)		\
   typed_splay_free(free_list, node)
 
-#undef typed_splay_node
-#define typed_splay_node(context_id) gpu_context_id_map_entry_t 
-
-
 
 //******************************************************************************
 // type declarations
 //******************************************************************************
 
 struct gpu_context_id_map_entry_t {
-  struct gpu_context_id_map_entry_t *left;
-  struct gpu_context_id_map_entry_t *right;
+  // free list link; must be first for the splay allocator
+  struct gpu_context_id_map_entry_t *next;
+
   uint64_t context_id;
   uint64_t first_time;
   uint64_t time_offset;
@@ -120,7 +102,7 @@ typedef struct trace_fn_helper_t {
 // local data
 //******************************************************************************
 
-static gpu_context_id_map_entry_t *map_root = NULL;
+static cmap_uint64_t map = CMAP_UINT64_INITIALIZER(hpcrun_malloc_safe);
 static gpu_context_id_map_entry_t *free_list = NULL;
 
 
@@ -129,9 +111,6 @@ static gpu_context_id_map_entry_t *free_list = NULL;
 // private operations
 //******************************************************************************
 
-typed_splay_impl(context_id)
-
-
 static gpu_context_id_map_entry_t *
 gpu_context_id_map_entry_new(uint32_t context_id, uint32_t stream_id)
 {
@@ -147,30 +126,33 @@ gpu_context_id_map_entry_new(uint32_t context_id, uint32_t stream_id)
 }
 
 
-static void
+static gpu_context_id_map_entry_t *
 gpu_context_id_map_insert
 (
  uint32_t context_id,
  uint32_t stream_id
 )
 {
-  gpu_context_id_map_entry_t *entry = st_lookup(&map_root, context_id);
+  gpu_context_id_map_entry_t *entry = cmap_uint64_lookup(&map, context_id);
 
   if (entry == NULL) {
     entry = gpu_context_id_map_entry_new(context_id, stream_id);
-    st_insert(&map_root, entry);
+    cmap_uint64_insert(&map, context_id, entry);
   }
+
+  return entry;
 }
 
 
 static void
 trace_fn_helper
 (
- gpu_context_id_map_entry_t *entry,
- splay_visit_t visit_type,
+ uint64_t context_id,
+ void *value,
  void *arg
 )
 {
+  gpu_context_id_map_entry_t *entry = (gpu_context_id_map_entry_t *) value;
   trace_fn_helper_t *info = (trace_fn_helper_t *) arg;
   gpu_stream_id_map_context_process(&entry->streams, info->fn, info->arg);
 }
@@ -179,11 +161,12 @@ trace_fn_helper
 static void
 signal_context
 (
- gpu_context_id_map_entry_t *entry,
- splay_visit_t visit_type,
+ uint64_t context_id,
+ void *value,
  void *arg
 )
 {
+  gpu_context_id_map_entry_t *entry = (gpu_context_id_map_entry_t *) value;
   gpu_stream_map_signal_all(&entry->streams);
 }
 
@@ -219,7 +202,7 @@ gpu_context_id_map_lookup
  uint32_t context_id
 )
 {
-  gpu_context_id_map_entry_t *result = st_lookup(&map_root, context_id);
+  gpu_context_id_map_entry_t *result = cmap_uint64_lookup(&map, context_id);
 
   TMSG(DEFER_CTXT, "context map lookup: context=0x%lx (record %p)", 
        context_id, result);
@@ -234,8 +217,10 @@ gpu_context_id_map_context_delete
  uint32_t context_id
 )
 {
-  gpu_context_id_map_entry_t *node = st_delete(&map_root, context_id);
-  st_free(&free_list, node);
+  gpu_context_id_map_entry_t *node = cmap_uint64_delete(&map, context_id);
+  if (node) {
+    st_free(&free_list, node);
+  }
 }
 
 
@@ -246,7 +231,7 @@ gpu_context_id_map_stream_delete
  uint32_t stream_id
 )
 {
-  gpu_context_id_map_entry_t *entry = st_lookup(&map_root, context_id);
+  gpu_context_id_map_entry_t *entry = cmap_uint64_lookup(&map, context_id);
   if (entry) {
     gpu_stream_id_map_delete(&(entry->streams), stream_id);
   }
@@ -262,9 +247,10 @@ gpu_context_id_map_stream_process
  gpu_trace_item_t *ti
 )
 {
-  gpu_context_id_map_insert(context_id, stream_id);
-  gpu_context_id_map_adjust_times(map_root, ti);
-  gpu_stream_id_map_stream_process(&(map_root->streams), 
+  gpu_context_id_map_entry_t *entry = 
+    gpu_context_id_map_insert(context_id, stream_id);
+  gpu_context_id_map_adjust_times(entry, ti);
+  gpu_stream_id_map_stream_process(&(entry->streams), 
 				   stream_id, fn, ti);
 }
 
@@ -295,7 +281,7 @@ gpu_context_id_map_device_process
   trace_fn_helper_t info;
   info.fn = fn;
   info.arg = arg;
-  st_forall(map_root, splay_inorder, trace_fn_helper, &info);
+  cmap_uint64_forall(&map, trace_fn_helper, &info);
 }
 
 
@@ -305,6 +291,6 @@ gpu_context_stream_map_signal_all
  void
 )
 {
-  st_forall(map_root, splay_inorder, signal_context, 0);
+  cmap_uint64_forall(&map, signal_context, 0);
 }
 
@@ -54,7 +54,9 @@
 // local includes
 //*****************************************************************************
 
-#include <lib/prof-lean/splay-uint64.h>
+#include <lib/prof-lean/cmap-uint64.h>
+
+#include <hpcrun/memory/hpcrun-malloc.h>
 
 #include "gpu-correlation-id-map.h"
 #include "gpu-splay-allocator.h"
@@ -70,21 +72,6 @@
 #include "gpu-print.h"
 
 
-#define st_insert				\
-  typed_splay_insert(correlation_id)
-
-#define st_lookup				\
-  typed_splay_lookup(correlation_id)
-
-#define st_delete				\
-  typed_splay_delete(correlation_id)
-
-#define st_forall				\
-  typed_splay_forall(correlation_id)
-
-#define st_count				\
-  typed_splay_count(correlation_id)
-
 #define st_alloc(free_list)			\
   typed_splay_alloc(free_list, gpu_correlation_id_map_entry_t)
 
@@ -97,19 +84,17 @@
 // type declarations
 //*****************************************************************************
 
-#undef typed_splay_node
-#define typed_splay_node(correlation_id) gpu_correlation_id_map_entry_t
+struct gpu_correlation_id_map_entry_t {
+  // free list link; must be first for the splay allocator
+  struct gpu_correlation_id_map_entry_t *next;
 
-typedef struct typed_splay_node(correlation_id) {
-  struct typed_splay_node(correlation_id) *left;
-  struct typed_splay_node(correlation_id) *right;
   uint64_t gpu_correlation_id; // key
 
   uint64_t host_correlation_id;
   uint32_t device_id;
   uint64_t start;
   uint64_t end;
-} typed_splay_node(correlation_id); 
+}; 
 
 
 
@@ -119,7 +104,8 @@ typedef struct typed_splay_node(correlation_id) {
 // local data
 //******************************************************************************
 
-static gpu_correlation_id_map_entry_t *map_root = NULL;
+// correlation ids are dense and increasing, which suits an id-indexed map
+static cmap_uint64_t map = CMAP_UINT64_INITIALIZER(hpcrun_malloc_safe);
 
 static gpu_correlation_id_map_entry_t *free_list = NULL;
 
@@ -129,9 +115,6 @@ static gpu_correlation_id_map_entry_t *free_list = NULL;
 // private operations
 //*****************************************************************************
 
-typed_splay_impl(correlation_id)
-
-
 static gpu_correlation_id_map_entry_t *
 gpu_correlation_id_map_entry_alloc()
 {
@@ -169,7 +152,7 @@ gpu_correlation_id_map_lookup
 )
 {
   uint64_t correlation_id = gpu_correlation_id;
-  gpu_correlation_id_map_entry_t *result = st_lookup(&map_root, correlation_id);
+  gpu_correlation_id_map_entry_t *result = cmap_uint64_lookup(&map, correlation_id);
 
   PRINT("correlation_id map lookup: id=0x%lx (record %p)\n", 
        correlation_id, result);
@@ -185,7 +168,7 @@ gpu_correlation_id_map_insert
  uint64_t host_correlation_id
 )
 {
-  if (st_lookup(&map_root, gpu_correlation_id)) { 
+  if (cmap_uint64_lookup(&map, gpu_correlation_id)) { 
     // fatal error: correlation_id already present; a
     // correlation should be inserted only once.
     assert(0);
@@ -193,7 +176,7 @@ gpu_correlation_id_map_insert
     gpu_correlation_id_map_entry_t *entry = 
       gpu_correlation_id_map_entry_new(gpu_correlation_id, host_correlation_id);
 
-    st_insert(&map_root, entry);
+    cmap_uint64_insert(&map, gpu_correlation_id, entry);
 
     PRINT("correlation_id_map insert: correlation_id=0x%lx external_id=%ld (entry=%p)\n", 
 	  gpu_correlation_id, host_correlation_id, entry);
@@ -211,7 +194,7 @@ gpu_correlation_id_map_external_id_replace
 {
   PRINT("correlation_id map replace: id=0x%x\n", gpu_correlation_id);
 
-  gpu_correlation_id_map_entry_t *entry = st_lookup(&map_root, gpu_correlation_id);
+  gpu_correlation_id_map_entry_t *entry = cmap_uint64_lookup(&map, gpu_correlation_id);
   if (entry) {
     entry->host_correlation_id = host_correlation_id;
   }
@@ -224,8 +207,11 @@ gpu_correlation_id_map_delete
  uint32_t gpu_correlation_id
 )
 {
-  gpu_correlation_id_map_entry_t *node = st_delete(&map_root, gpu_correlation_id);
-  st_free(&free_list, node);
+  gpu_correlation_id_map_entry_t *node = 
+    cmap_uint64_delete(&map, gpu_correlation_id);
+  if (node) {
+    st_free(&free_list, node);
+  }
 }
 
 
@@ -241,7 +227,7 @@ gpu_correlation_id_map_kernel_update
   uint64_t correlation_id = gpu_correlation_id;
   PRINT("correlation_id map replace: id=0x%lx\n", correlation_id);
 
-  gpu_correlation_id_map_entry_t *entry = st_lookup(&map_root, correlation_id);
+  gpu_correlation_id_map_entry_t *entry = cmap_uint64_lookup(&map, correlation_id);
   if (entry) {
     entry->device_id = device_id;
     entry->start = start;
@@ -301,5 +287,5 @@ gpu_correlation_id_map_count
  void
 )
 {
-  return st_count(map_root);
+  return cmap_uint64_count(&map);
 }
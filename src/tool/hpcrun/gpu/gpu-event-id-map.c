@@ -53,7 +53,7 @@
 // local includes
 //******************************************************************************
 
-#include <lib/prof-lean/splay-uint64.h>
+#include <lib/prof-lean/cmap-uint64.h>
 
 #include <hpcrun/messages/messages.h>
 #include <hpcrun/memory/hpcrun-malloc.h>
@@ -70,21 +70,6 @@
 
 #include "gpu-print.h"
 
-#define st_insert				\
-  typed_splay_insert(event_id)
-
-#define st_lookup				\
-  typed_splay_lookup(event_id)
-
-#define st_delete				\
-  typed_splay_delete(event_id)
-
-#define st_forall				\
-  typed_splay_forall(event_id)
-
-#define st_count				\
-  typed_splay_count(event_id)
-
 #define st_alloc(free_list)			\
   typed_splay_alloc(free_list, gpu_event_id_map_entry_t)
 
@@ -95,33 +80,28 @@
 //******************************************************************************
 // type declarations
 //******************************************************************************
-#undef typed_splay_node
-#define typed_splay_node(correlation_id) gpu_event_id_map_entry_t
+struct gpu_event_id_map_entry_t { 
+  // free list link; must be first for the splay allocator
+  struct gpu_event_id_map_entry_t *next;
 
-typedef struct typed_splay_node(event_id) { 
-  struct gpu_event_id_map_entry_t *left;
-  struct gpu_event_id_map_entry_t *right;
   uint64_t event_id;
 
   uint32_t context_id;
   uint32_t stream_id;
-} typed_splay_node(event_id); 
+}; 
 
 
 //******************************************************************************
 // local data
 //******************************************************************************
 
-static gpu_event_id_map_entry_t *map_root = NULL;
+static cmap_uint64_t map = CMAP_UINT64_INITIALIZER(hpcrun_malloc_safe);
 static gpu_event_id_map_entry_t *free_list = NULL;
 
 //******************************************************************************
 // private operations
 //******************************************************************************
 
-typed_splay_impl(event_id)
-
-
 static gpu_event_id_map_entry_t *
 gpu_event_id_map_entry_alloc()
 {
@@ -154,7 +134,7 @@ gpu_event_id_map_lookup
  uint32_t event_id
 )
 {
-  gpu_event_id_map_entry_t *result = st_lookup(&map_root, event_id);
+  gpu_event_id_map_entry_t *result = cmap_uint64_lookup(&map, event_id);
 
   TMSG(DEFER_CTXT, "event map lookup: event=0x%lx (record %p)", 
        event_id, result);
@@ -188,7 +168,7 @@ gpu_event_id_map_insert
   } else {
     entry = gpu_event_id_map_entry_new(event_id, context_id, stream_id);
 
-    st_insert(&map_root, entry);
+    cmap_uint64_insert(&map, event_id, entry);
 
     PRINT("event_id_map insert: event_id=0x%lx\n", event_id);
   }
@@ -201,8 +181,10 @@ gpu_event_id_map_delete
  uint32_t event_id
 )
 {
-  gpu_event_id_map_entry_t *node = st_delete(&map_root, event_id);
-  st_free(&free_list, node);
+  gpu_event_id_map_entry_t *node = cmap_uint64_delete(&map, event_id);
+  if (node) {
+    st_free(&free_list, node);
+  }
 }
 
 
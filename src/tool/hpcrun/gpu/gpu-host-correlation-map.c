@@ -54,9 +54,10 @@
 // local includes
 //******************************************************************************
 
-#include <lib/prof-lean/splay-uint64.h>
+#include <lib/prof-lean/cmap-uint64.h>
 
 #include <hpcrun/cct/cct.h>
+#include <hpcrun/memory/hpcrun-malloc.h>
 
 #include "gpu-host-correlation-map.h"
 #include "gpu-op-placeholders.h"
@@ -73,21 +74,6 @@
 #include "gpu-print.h"
 
 
-#define st_insert				\
-  typed_splay_insert(host_correlation)
-
-#define st_lookup				\
-  typed_splay_lookup(host_correlation)
-
-#define st_delete				\
-  typed_splay_delete(host_correlation)
-
-#define st_forall				\
-  typed_splay_forall(host_correlation)
-
-#define st_count				\
-  typed_splay_count(host_correlation)
-
 #define st_alloc(free_list)			\
   typed_splay_alloc(free_list, gpu_host_correlation_map_entry_t)
 
@@ -100,12 +86,9 @@
 // type declarations
 //******************************************************************************
 
-#undef typed_splay_node
-#define typed_splay_node(host_correlation) gpu_host_correlation_map_entry_t
-
-typedef struct typed_splay_node(host_correlation) {
-  struct typed_splay_node(host_correlation) *left;
-  struct typed_splay_node(host_correlation) *right;
+struct gpu_host_correlation_map_entry_t {
+  // free list link; must be first for the splay allocator
+  struct gpu_host_correlation_map_entry_t *next;
 
   uint64_t host_correlation_id; // key
 
@@ -117,7 +100,7 @@ typedef struct typed_splay_node(host_correlation) {
 
   int samples;
   int total_samples;
-} typed_splay_node(host_correlation); 
+}; 
 
 
 
@@ -125,7 +108,8 @@ typedef struct typed_splay_node(host_correlation) {
 // local data
 //******************************************************************************
 
-static gpu_host_correlation_map_entry_t *map_root = NULL;
+// host correlation ids are dense and increasing, which suits an id-indexed map
+static cmap_uint64_t map = CMAP_UINT64_INITIALIZER(hpcrun_malloc_safe);
 
 static gpu_host_correlation_map_entry_t *free_list = NULL;
 
@@ -135,9 +119,6 @@ static gpu_host_correlation_map_entry_t *free_list = NULL;
 // private operations
 //******************************************************************************
 
-typed_splay_impl(host_correlation)
-
-
 static gpu_host_correlation_map_entry_t *
 gpu_host_correlation_map_entry_alloc
 (
@@ -198,7 +179,7 @@ gpu_host_correlation_map_lookup
  uint64_t host_correlation_id
 )
 {
-  gpu_host_correlation_map_entry_t *result = st_lookup(&map_root, host_correlation_id);
+  gpu_host_correlation_map_entry_t *result = cmap_uint64_lookup(&map, host_correlation_id);
 
   PRINT("host_correlation_map lookup: id=0x%lx (entry %p)", host_correlation_id, result);
 
@@ -215,7 +196,7 @@ gpu_host_correlation_map_insert
  gpu_activity_channel_t *activity_channel
 )
 {
-  if (st_lookup(&map_root, host_correlation_id)) { 
+  if (cmap_uint64_lookup(&map, host_correlation_id)) { 
     // fatal error: host_correlation id already present; a
     // correlation should be inserted only once.
     assert(0);
@@ -224,7 +205,7 @@ gpu_host_correlation_map_insert
       gpu_host_correlation_map_entry_new(host_correlation_id, gpu_op_ccts, 
 					 cpu_submit_time, activity_channel);
 
-    st_insert(&map_root, entry);
+    cmap_uint64_insert(&map, host_correlation_id, entry);
 
     PRINT("host_correlation_map insert: correlation_id=0x%lx "
 	 "activity_channel=%p (entry=%p)", 
@@ -245,7 +226,7 @@ gpu_host_correlation_map_samples_increase
   PRINT("correlation_map samples update: correlation_id=0x%lx (update %d)", 
 	host_correlation_id, val);
 
-  gpu_host_correlation_map_entry_t *entry = st_lookup(&map_root, host_correlation_id);
+  gpu_host_correlation_map_entry_t *entry = cmap_uint64_lookup(&map, host_correlation_id);
 
   if (entry) {
     entry->samples += val;
@@ -268,7 +249,7 @@ gpu_host_correlation_map_total_samples_update
   PRINT("correlation_map total samples update: correlation_id=0x%lx (update %d)",
        host_correlation_id, val);
 
-  gpu_host_correlation_map_entry_t *entry = st_lookup(&map_root, host_correlation_id);
+  gpu_host_correlation_map_entry_t *entry = cmap_uint64_lookup(&map, host_correlation_id);
 
   if (entry) {
     entry->total_samples = val;
@@ -285,8 +266,11 @@ gpu_host_correlation_map_delete
  uint64_t host_correlation_id
 )
 {
-  gpu_host_correlation_map_entry_t *node = st_delete(&map_root, host_correlation_id);
-  st_free(&free_list, node);
+  gpu_host_correlation_map_entry_t *node = 
+    cmap_uint64_delete(&map, host_correlation_id);
+  if (node) {
+    st_free(&free_list, node);
+  }
 }
 
 
@@ -348,5 +332,5 @@ gpu_host_correlation_map_count
  void
 )
 {
-  return st_count(map_root);
+  return cmap_uint64_count(&map);
 }
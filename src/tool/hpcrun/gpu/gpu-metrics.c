@@ -50,6 +50,7 @@
 //******************************************************************************
 
 #include <hpcrun/cct2metrics.h>
+#include <hpcrun/epoch.h>
 #include <hpcrun/memory/hpcrun-malloc.h>
 #include <hpcrun/metrics.h>
 #include <hpcrun/safe-sampling.h>
@@ -607,6 +608,8 @@ gpu_metrics_default_enable
  void
 )
 {
+  // gpu operations are attributed to the host cct nodes of their launches
+  hpcrun_epoch_recycle_disable("GPU monitoring");
 
 // Execution time metrics
 #undef CURRENT_METRIC 
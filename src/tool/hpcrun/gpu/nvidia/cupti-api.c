@@ -1167,6 +1167,7 @@ cupti_buffer_completion_callback
         ++processed;
       }
     } while (status);
+    cupti_activity_flush();
     hpcrun_stats_acc_trace_records_add(processed);
 
     size_t dropped;
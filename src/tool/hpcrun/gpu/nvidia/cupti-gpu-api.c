@@ -78,3 +78,13 @@ cupti_activity_process
   cupti_activity_translate(&gpu_activity, cupti_activity); 
   gpu_activity_process(&gpu_activity);
 }
+
+
+void
+cupti_activity_flush
+(
+ void
+)
+{
+  gpu_activity_process_flush();
+}
@@ -72,5 +72,12 @@ cupti_activity_process
 );
 
 
+void
+cupti_activity_flush
+(
+ void
+);
+
+
 
 #endif
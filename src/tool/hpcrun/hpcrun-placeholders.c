@@ -45,6 +45,18 @@ hpcrun_no_activity
 }
 
 
+// parent of call paths folded away by cct pruning
+void
+hpcrun_pruned_call_paths
+(
+ void
+)
+{
+  // this function is not meant to be called
+  assert(0);
+}
+
+
 static void
 hpcrun_default_placeholders_init
 (
@@ -53,6 +65,8 @@ hpcrun_default_placeholders_init
 {
   init_placeholder(&hpcrun_placeholders[hpcrun_placeholder_type_no_activity], 
 		   hpcrun_no_activity);
+  init_placeholder(&hpcrun_placeholders[hpcrun_placeholder_type_pruned], 
+		   hpcrun_pruned_call_paths);
 }
 
 
@@ -21,7 +21,8 @@ typedef struct {
 
 typedef enum hpcrun_placeholder_type_t {
   hpcrun_placeholder_type_no_activity    = 0, 
-  hpcrun_placeholder_type_count          = 1 
+  hpcrun_placeholder_type_pruned         = 1, 
+  hpcrun_placeholder_type_count          = 2 
 } hpcrun_placeholder_type_t;
 
 
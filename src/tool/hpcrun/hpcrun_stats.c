@@ -45,45 +45,164 @@
 // ******************************************************* EndRiceCopyright *
 
 
+//***************************************************************************
+// system include files
+//***************************************************************************
+
+#include <stdio.h>
+#include <string.h>
+
+
+
 //***************************************************************************
 // local include files
 //***************************************************************************
+
+#include "hpcrun_stats.h"
 #include "sample_event.h"
 #include "disabled.h"
 
 #include <memory/hpcrun-malloc.h>
+#include <memory/mmap.h>
 #include <messages/messages.h>
 
 #include <lib/prof-lean/stdatomic.h>
 #include <lib/prof-lean/hpcrun-fmt.h>
+#include <lib/support-lean/timer.h>
 #include <unwind/common/validate_return_addr.h>
 
 
+
+//***************************************************************************
+// type declarations
+//***************************************************************************
+
+#define HPCRUN_STATS_CACHE_LINE 64
+
+typedef enum {
+  STAT_SAMPLES_TOTAL,
+  STAT_SAMPLES_ATTEMPTED,
+  STAT_SAMPLES_BLOCKED_ASYNC,
+  STAT_SAMPLES_BLOCKED_DLOPEN,
+  STAT_SAMPLES_DROPPED,
+  STAT_SAMPLES_SEGV,
+  STAT_SAMPLES_PARTIAL,
+  STAT_SAMPLES_YIELDED,
+  STAT_UNWIND_INTERVALS_TOTAL,
+  STAT_UNWIND_INTERVALS_SUSPICIOUS,
+  STAT_TROLLED,
+  STAT_FRAMES_TOTAL,
+  STAT_TROLLED_FRAMES,
+  STAT_FRAMES_LIBFAIL_TOTAL,
+  STAT_ACC_TRACE_RECORDS,
+  STAT_ACC_TRACE_RECORDS_DROPPED,
+  STAT_ACC_SAMPLES,
+  STAT_ACC_SAMPLES_DROPPED,
+  STAT_TRACE_RECORDS_DROPPED,
+  STAT_STREAM_SAMPLES_DROPPED,
+  STAT_NUM
+} stat_t;
+
+
+// names used in the hpcrun-stats epoch nv-pair
+static const char* stat_names[STAT_NUM] = {
+  "samples",
+  "attempted",
+  "blocked-async",
+  "blocked-dlopen",
+  "dropped",
+  "segv",
+  "partial",
+  "yielded",
+  "intervals",
+  "intervals-suspicious",
+  "trolled",
+  "frames",
+  "frames-trolled",
+  "frames-libfail",
+  "acc-trace-records",
+  "acc-trace-records-dropped",
+  "acc-samples",
+  "acc-samples-dropped",
+  "trace-records-dropped",
+  "stream-samples-dropped",
+};
+
+
+typedef struct latency_hist_t {
+  uint64_t count;
+  uint64_t cycles;
+  uint64_t bucket[HPCRUN_LATENCY_BUCKETS];
+} latency_hist_t;
+
+
+// A block is written only by the thread that owns it (including from
+// that thread's signal handlers), so the counters are plain words,
+// not atomics.  Blocks are cache-line aligned and padded, so threads
+// never write to a shared line.  Blocks are never freed; they stay on
+// the list so the process summary can include threads that exited.
+struct hpcrun_stats_thread_t {
+  long stat[STAT_NUM];
+  latency_hist_t latency[HPCRUN_LATENCY_NUM];
+  struct hpcrun_stats_thread_t *next;
+} __attribute__((aligned(HPCRUN_STATS_CACHE_LINE)));
+
+
+
 //***************************************************************************
 // local variables
 //***************************************************************************
 
-static atomic_long num_samples_total = ATOMIC_VAR_INIT(0);
-static atomic_long num_samples_attempted = ATOMIC_VAR_INIT(0);
-static atomic_long num_samples_blocked_async = ATOMIC_VAR_INIT(0);
-static atomic_long num_samples_blocked_dlopen = ATOMIC_VAR_INIT(0);
-static atomic_long num_samples_dropped = ATOMIC_VAR_INIT(0);
-static atomic_long num_samples_segv = ATOMIC_VAR_INIT(0);
-static atomic_long num_samples_partial = ATOMIC_VAR_INIT(0);
-static atomic_long num_samples_yielded = ATOMIC_VAR_INIT(0);
+static _Atomic(hpcrun_stats_thread_t *) stats_list = ATOMIC_VAR_INIT(NULL);
 
-static atomic_long num_unwind_intervals_total = ATOMIC_VAR_INIT(0);
-static atomic_long num_unwind_intervals_suspicious = ATOMIC_VAR_INIT(0);
+// the block the current thread counts into
+static __thread hpcrun_stats_thread_t *stats_self = NULL;
+
+// counts from threads that do not (yet) have a block
+static atomic_long stats_shared[STAT_NUM];
+
+
+
+//***************************************************************************
+// private operations
+//***************************************************************************
+
+static inline void
+stat_add(stat_t which, long amt)
+{
+  hpcrun_stats_thread_t *self = stats_self;
+
+  if (self != NULL) {
+    self->stat[which] += amt;
+  }
+  else {
+    atomic_fetch_add_explicit(&stats_shared[which], amt, memory_order_relaxed);
+  }
+}
+
+
+static long
+stat_sum(stat_t which)
+{
+  long sum = atomic_load_explicit(&stats_shared[which], memory_order_relaxed);
+
+  hpcrun_stats_thread_t *s =
+    atomic_load_explicit(&stats_list, memory_order_acquire);
+  for (; s != NULL; s = s->next) {
+    sum += s->stat[which];
+  }
+  return sum;
+}
+
+
+static int
+latency_bucket(uint64_t cycles)
+{
+  int b = (cycles > 1) ? 63 - __builtin_clzll(cycles) : 0;
+  return (b < HPCRUN_LATENCY_BUCKETS) ? b : HPCRUN_LATENCY_BUCKETS - 1;
+}
 
-static atomic_long trolled = ATOMIC_VAR_INIT(0);
-static atomic_long frames_total = ATOMIC_VAR_INIT(0);
-static atomic_long trolled_frames = ATOMIC_VAR_INIT(0);
-static atomic_long frames_libfail_total = ATOMIC_VAR_INIT(0);
 
-static atomic_long acc_trace_records = ATOMIC_VAR_INIT(0);
-static atomic_long acc_trace_records_dropped = ATOMIC_VAR_INIT(0);
-static atomic_long acc_samples = ATOMIC_VAR_INIT(0);
-static atomic_long acc_samples_dropped = ATOMIC_VAR_INIT(0);
 
 //***************************************************************************
 // interface operations
@@ -92,25 +211,118 @@ static atomic_long acc_samples_dropped = ATOMIC_VAR_INIT(0);
 void
 hpcrun_stats_reinit(void)
 {
-  atomic_store_explicit(&num_samples_total, 0, memory_order_relaxed);
-  atomic_store_explicit(&num_samples_attempted, 0, memory_order_relaxed);
-  atomic_store_explicit(&num_samples_blocked_async, 0, memory_order_relaxed);
-  atomic_store_explicit(&num_samples_blocked_dlopen, 0, memory_order_relaxed);
-  atomic_store_explicit(&num_samples_segv, 0, memory_order_relaxed);
+  for (int i = 0; i < STAT_NUM; i++) {
+    atomic_store_explicit(&stats_shared[i], 0, memory_order_relaxed);
+  }
+
+  // after fork, the child starts over with the parent's blocks
+  hpcrun_stats_thread_t *s =
+    atomic_load_explicit(&stats_list, memory_order_acquire);
+  for (; s != NULL; s = s->next) {
+    memset(s->stat, 0, sizeof(s->stat));
+    memset(s->latency, 0, sizeof(s->latency));
+  }
+}
 
-  atomic_store_explicit(&num_unwind_intervals_total, 0, memory_order_relaxed);
-  atomic_store_explicit(&num_unwind_intervals_suspicious, 0, memory_order_relaxed);
 
-  atomic_store_explicit(&trolled, 0, memory_order_relaxed);
-  atomic_store_explicit(&frames_total, 0, memory_order_relaxed);
-  atomic_store_explicit(&trolled_frames, 0, memory_order_relaxed);
-  atomic_store_explicit(&frames_libfail_total, 0, memory_order_relaxed);
+//-----------------------------
+// per-thread blocks
+//-----------------------------
 
-  atomic_store_explicit(&acc_trace_records, 0, memory_order_relaxed);
-  atomic_store_explicit(&acc_trace_records_dropped, 0, memory_order_relaxed);
+hpcrun_stats_thread_t *
+hpcrun_stats_thread_new(void)
+{
+  hpcrun_stats_thread_t *stats =
+    hpcrun_mmap_anon(sizeof(hpcrun_stats_thread_t));
+  if (stats == NULL) {
+    return NULL;
+  }
+  memset(stats, 0, sizeof(*stats));
 
-  atomic_store_explicit(&acc_samples, 0, memory_order_relaxed);
-  atomic_store_explicit(&acc_samples_dropped, 0, memory_order_relaxed);
+  hpcrun_stats_thread_t *head =
+    atomic_load_explicit(&stats_list, memory_order_relaxed);
+  do {
+    stats->next = head;
+  } while (!atomic_compare_exchange_weak_explicit(&stats_list, &head,
+						  stats, memory_order_release,
+						  memory_order_relaxed));
+  return stats;
+}
+
+
+void
+hpcrun_stats_thread_bind(hpcrun_stats_thread_t *stats)
+{
+  stats_self = stats;
+}
+
+
+//-----------------------------
+// latencies
+//-----------------------------
+
+uint64_t
+hpcrun_stats_cycles(void)
+{
+  return time_getTSC();
+}
+
+
+void
+hpcrun_stats_latency_add(hpcrun_stats_thread_t *stats, hpcrun_latency_t kind,
+			 uint64_t start)
+{
+  uint64_t cycles = time_getTSC() - start;
+
+  if (stats == NULL) {
+    stats = stats_self;
+    if (stats == NULL) {
+      return;
+    }
+  }
+
+  latency_hist_t *hist = &stats->latency[kind];
+  hist->count++;
+  hist->cycles += cycles;
+  hist->bucket[latency_bucket(cycles)]++;
+}
+
+
+//-----------------------------
+// epoch summary
+//-----------------------------
+
+void
+hpcrun_stats_thread_str(hpcrun_stats_thread_t *stats, char *buf, size_t len)
+{
+  size_t n = 0;
+
+  buf[0] = '\0';
+  for (int i = 0; stats != NULL && i < STAT_NUM && n < len; i++) {
+    n += snprintf(buf + n, len - n, "%s%s=%ld", (i == 0) ? "" : " ",
+		  stat_names[i], stats->stat[i]);
+  }
+}
+
+
+void
+hpcrun_stats_latency_str(hpcrun_stats_thread_t *stats, hpcrun_latency_t kind,
+			 char *buf, size_t len)
+{
+  static const latency_hist_t empty;
+  const latency_hist_t *hist = (stats != NULL) ? &stats->latency[kind] : &empty;
+
+  int last = HPCRUN_LATENCY_BUCKETS - 1;
+  while (last > 0 && hist->bucket[last] == 0) {
+    last--;
+  }
+
+  size_t n = snprintf(buf, len, "count=%"PRIu64" cycles=%"PRIu64" hist=",
+		      hist->count, hist->cycles);
+  for (int b = 0; b <= last && n < len; b++) {
+    n += snprintf(buf + n, len - n, "%s%"PRIu64, (b == 0) ? "" : ",",
+		  hist->bucket[b]);
+  }
 }
 
 
@@ -121,14 +333,14 @@ hpcrun_stats_reinit(void)
 void
 hpcrun_stats_num_samples_total_inc(void)
 {
-  atomic_fetch_add_explicit(&num_samples_total, 1L, memory_order_relaxed);
+  stat_add(STAT_SAMPLES_TOTAL, 1L);
 }
 
 
 long
 hpcrun_stats_num_samples_total(void)
 {
-  return atomic_load_explicit(&num_samples_total, memory_order_relaxed);
+  return stat_sum(STAT_SAMPLES_TOTAL);
 }
 
 
@@ -140,14 +352,14 @@ hpcrun_stats_num_samples_total(void)
 void
 hpcrun_stats_num_samples_attempted_inc(void)
 {
-  atomic_fetch_add_explicit(&num_samples_attempted, 1L, memory_order_relaxed);
+  stat_add(STAT_SAMPLES_ATTEMPTED, 1L);
 }
 
 
 long
 hpcrun_stats_num_samples_attempted(void)
 {
-  return atomic_load_explicit(&num_samples_attempted, memory_order_relaxed);
+  return stat_sum(STAT_SAMPLES_ATTEMPTED);
 }
 
 
@@ -161,15 +373,15 @@ hpcrun_stats_num_samples_attempted(void)
 void
 hpcrun_stats_num_samples_blocked_async_inc(void)
 {
-  atomic_fetch_add_explicit(&num_samples_blocked_async, 1L, memory_order_relaxed);
-  atomic_fetch_add_explicit(&num_samples_total, 1L, memory_order_relaxed);
+  stat_add(STAT_SAMPLES_BLOCKED_ASYNC, 1L);
+  stat_add(STAT_SAMPLES_TOTAL, 1L);
 }
 
 
 long
 hpcrun_stats_num_samples_blocked_async(void)
 {
-  return atomic_load_explicit(&num_samples_blocked_async, memory_order_relaxed);
+  return stat_sum(STAT_SAMPLES_BLOCKED_ASYNC);
 }
 
 
@@ -181,14 +393,14 @@ hpcrun_stats_num_samples_blocked_async(void)
 void
 hpcrun_stats_num_samples_blocked_dlopen_inc(void)
 {
-  atomic_fetch_add_explicit(&num_samples_blocked_dlopen, 1L, memory_order_relaxed);
+  stat_add(STAT_SAMPLES_BLOCKED_DLOPEN, 1L);
 }
 
 
 long
 hpcrun_stats_num_samples_blocked_dlopen(void)
 {
-  return atomic_load_explicit(&num_samples_blocked_dlopen, memory_order_relaxed);
+  return stat_sum(STAT_SAMPLES_BLOCKED_DLOPEN);
 }
 
 
@@ -200,14 +412,14 @@ hpcrun_stats_num_samples_blocked_dlopen(void)
 void
 hpcrun_stats_num_samples_dropped_inc(void)
 {
-  atomic_fetch_add_explicit(&num_samples_dropped, 1L, memory_order_relaxed);
+  stat_add(STAT_SAMPLES_DROPPED, 1L);
 }
 
 
 long
 hpcrun_stats_num_samples_dropped(void)
 {
-  return atomic_load_explicit(&num_samples_dropped, memory_order_relaxed);
+  return stat_sum(STAT_SAMPLES_DROPPED);
 }
 
 
@@ -218,14 +430,14 @@ hpcrun_stats_num_samples_dropped(void)
 void
 hpcrun_stats_acc_samples_add(long value)
 {
-  atomic_fetch_add_explicit(&acc_samples, value, memory_order_relaxed);
+  stat_add(STAT_ACC_SAMPLES, value);
 }
 
 
 long
 hpcrun_stats_acc_samples(void)
 {
-  return atomic_load_explicit(&acc_samples, memory_order_relaxed);
+  return stat_sum(STAT_ACC_SAMPLES);
 }
 
 
@@ -236,14 +448,14 @@ hpcrun_stats_acc_samples(void)
 void
 hpcrun_stats_acc_samples_dropped_add(long value)
 {
-  atomic_fetch_add_explicit(&acc_samples_dropped, value, memory_order_relaxed);
+  stat_add(STAT_ACC_SAMPLES_DROPPED, value);
 }
 
 
 long
 hpcrun_stats_acc_samples_dropped(void)
 {
-  return atomic_load_explicit(&acc_samples_dropped, memory_order_relaxed);
+  return stat_sum(STAT_ACC_SAMPLES_DROPPED);
 }
 
 
@@ -254,14 +466,14 @@ hpcrun_stats_acc_samples_dropped(void)
 void
 hpcrun_stats_acc_trace_records_add(long value)
 {
-  atomic_fetch_add_explicit(&acc_trace_records, value, memory_order_relaxed);
+  stat_add(STAT_ACC_TRACE_RECORDS, value);
 }
 
 
 long
 hpcrun_stats_acc_trace_records(void)
 {
-  return atomic_load_explicit(&acc_trace_records, memory_order_relaxed);
+  return stat_sum(STAT_ACC_TRACE_RECORDS);
 }
 
 
@@ -272,14 +484,50 @@ hpcrun_stats_acc_trace_records(void)
 void
 hpcrun_stats_acc_trace_records_dropped_add(long value)
 {
-  atomic_fetch_add_explicit(&acc_trace_records_dropped, value, memory_order_relaxed);
+  stat_add(STAT_ACC_TRACE_RECORDS_DROPPED, value);
 }
 
 
 long
 hpcrun_stats_acc_trace_records_dropped(void)
 {
-  return atomic_load_explicit(&acc_trace_records_dropped, memory_order_relaxed);
+  return stat_sum(STAT_ACC_TRACE_RECORDS_DROPPED);
+}
+
+
+//-----------------------------
+// trace records dropped
+//-----------------------------
+
+void
+hpcrun_stats_num_trace_records_dropped_inc(void)
+{
+  stat_add(STAT_TRACE_RECORDS_DROPPED, 1L);
+}
+
+
+long
+hpcrun_stats_num_trace_records_dropped(void)
+{
+  return stat_sum(STAT_TRACE_RECORDS_DROPPED);
+}
+
+
+//-----------------------------
+// samples not streamed to the aggregator
+//-----------------------------
+
+void
+hpcrun_stats_num_stream_samples_dropped_inc(void)
+{
+  stat_add(STAT_STREAM_SAMPLES_DROPPED, 1L);
+}
+
+
+long
+hpcrun_stats_num_stream_samples_dropped(void)
+{
+  return stat_sum(STAT_STREAM_SAMPLES_DROPPED);
 }
 
 
@@ -290,13 +538,13 @@ hpcrun_stats_acc_trace_records_dropped(void)
 void
 hpcrun_stats_num_samples_partial_inc(void)
 {
-  atomic_fetch_add_explicit(&num_samples_partial, 1L, memory_order_relaxed);
+  stat_add(STAT_SAMPLES_PARTIAL, 1L);
 }
 
 long
 hpcrun_stats_num_samples_partial(void)
 {
-  return atomic_load_explicit(&num_samples_partial, memory_order_relaxed);
+  return stat_sum(STAT_SAMPLES_PARTIAL);
 }
 
 //-----------------------------
@@ -306,14 +554,14 @@ hpcrun_stats_num_samples_partial(void)
 void
 hpcrun_stats_num_samples_segv_inc(void)
 {
-  atomic_fetch_add_explicit(&num_samples_segv, 1L, memory_order_relaxed);
+  stat_add(STAT_SAMPLES_SEGV, 1L);
 }
 
 
 long
 hpcrun_stats_num_samples_segv(void)
 {
-  return atomic_load_explicit(&num_samples_segv, memory_order_relaxed);
+  return stat_sum(STAT_SAMPLES_SEGV);
 }
 
 
@@ -326,14 +574,14 @@ hpcrun_stats_num_samples_segv(void)
 void
 hpcrun_stats_num_unwind_intervals_total_inc(void)
 {
-  atomic_fetch_add_explicit(&num_unwind_intervals_total, 1L, memory_order_relaxed);
+  stat_add(STAT_UNWIND_INTERVALS_TOTAL, 1L);
 }
 
 
 long
 hpcrun_stats_num_unwind_intervals_total(void)
 {
-  return atomic_load_explicit(&num_unwind_intervals_total, memory_order_relaxed);
+  return stat_sum(STAT_UNWIND_INTERVALS_TOTAL);
 }
 
 
@@ -345,14 +593,14 @@ hpcrun_stats_num_unwind_intervals_total(void)
 void
 hpcrun_stats_num_unwind_intervals_suspicious_inc(void)
 {
-  atomic_fetch_add_explicit(&num_unwind_intervals_suspicious, 1L, memory_order_relaxed);
+  stat_add(STAT_UNWIND_INTERVALS_SUSPICIOUS, 1L);
 }
 
 
 long
 hpcrun_stats_num_unwind_intervals_suspicious(void)
 {
-  return atomic_load_explicit(&num_unwind_intervals_suspicious, memory_order_relaxed);
+  return stat_sum(STAT_UNWIND_INTERVALS_SUSPICIOUS);
 }
 
 //------------------------------------------------------
@@ -362,13 +610,13 @@ hpcrun_stats_num_unwind_intervals_suspicious(void)
 void
 hpcrun_stats_trolled_inc(void)
 {
-  atomic_fetch_add_explicit(&trolled, 1L, memory_order_relaxed);
+  stat_add(STAT_TROLLED, 1L);
 }
 
 long
 hpcrun_stats_trolled(void)
 {
-  return atomic_load_explicit(&trolled, memory_order_relaxed);
+  return stat_sum(STAT_TROLLED);
 }
 
 //------------------------------------------------------
@@ -378,13 +626,13 @@ hpcrun_stats_trolled(void)
 void
 hpcrun_stats_frames_total_inc(long amt)
 {
-  atomic_fetch_add_explicit(&frames_total, amt, memory_order_relaxed);
+  stat_add(STAT_FRAMES_TOTAL, amt);
 }
 
 long
 hpcrun_stats_frames_total(void)
 {
-  return atomic_load_explicit(&frames_total, memory_order_relaxed);
+  return stat_sum(STAT_FRAMES_TOTAL);
 }
 //-------------------------------------------------------
 // number of (unwind) frames where libunwind failed
@@ -393,13 +641,13 @@ hpcrun_stats_frames_total(void)
 void
 hpcrun_stats_frames_libfail_total_inc(long amt)
 {
-  atomic_fetch_add_explicit(&frames_libfail_total, amt, memory_order_relaxed);
+  stat_add(STAT_FRAMES_LIBFAIL_TOTAL, amt);
 }
 
 long
 hpcrun_stats_frames_libfail_total(void)
 {
-  return atomic_load_explicit(&frames_libfail_total, memory_order_relaxed);
+  return stat_sum(STAT_FRAMES_LIBFAIL_TOTAL);
 }
 
 //---------------------------------------------------------------------
@@ -409,13 +657,13 @@ hpcrun_stats_frames_libfail_total(void)
 void
 hpcrun_stats_trolled_frames_inc(long amt)
 {
-  atomic_fetch_add_explicit(&trolled_frames, amt, memory_order_relaxed);
+  stat_add(STAT_TROLLED_FRAMES, amt);
 }
 
 long
 hpcrun_stats_trolled_frames(void)
 {
-  return atomic_load_explicit(&trolled_frames, memory_order_relaxed);
+  return stat_sum(STAT_TROLLED_FRAMES);
 }
 
 //----------------------------
@@ -425,46 +673,83 @@ hpcrun_stats_trolled_frames(void)
 void
 hpcrun_stats_num_samples_yielded_inc(void)
 {
-  atomic_fetch_add_explicit(&num_samples_yielded, 1L, memory_order_relaxed);
+  stat_add(STAT_SAMPLES_YIELDED, 1L);
 }
 
 long
 hpcrun_stats_num_samples_yielded(void)
 {
-  return atomic_load_explicit(&num_samples_yielded, memory_order_relaxed);
+  return stat_sum(STAT_SAMPLES_YIELDED);
 }
 
 //-----------------------------
 // print summary
 //-----------------------------
 
+static void
+latency_summary(hpcrun_latency_t kind, const char *name)
+{
+  latency_hist_t sum;
+  memset(&sum, 0, sizeof(sum));
+
+  hpcrun_stats_thread_t *s =
+    atomic_load_explicit(&stats_list, memory_order_acquire);
+  for (; s != NULL; s = s->next) {
+    sum.count += s->latency[kind].count;
+    sum.cycles += s->latency[kind].cycles;
+    for (int b = 0; b < HPCRUN_LATENCY_BUCKETS; b++) {
+      sum.bucket[b] += s->latency[kind].bucket[b];
+    }
+  }
+  if (sum.count == 0) {
+    return;
+  }
+
+  // approximate median: the lower bound of the bucket holding it
+  uint64_t seen = 0;
+  int median = 0;
+  for (; median < HPCRUN_LATENCY_BUCKETS - 1; median++) {
+    seen += sum.bucket[median];
+    if (2 * seen >= sum.count) break;
+  }
+
+  AMSG("LATENCY %s: count: %"PRIu64", mean cycles: %"PRIu64
+       ", median cycles: >= %"PRIu64,
+       name, sum.count, sum.cycles / sum.count,
+       (median == 0) ? (uint64_t) 0 : ((uint64_t) 1) << median);
+}
+
+
 void
 hpcrun_stats_print_summary(void)
 {
-  long cpu_blocked_async  = atomic_load_explicit(&num_samples_blocked_async, memory_order_relaxed);
-  long cpu_blocked_dlopen = atomic_load_explicit(&num_samples_blocked_dlopen, memory_order_relaxed);
+  long cpu_blocked_async  = stat_sum(STAT_SAMPLES_BLOCKED_ASYNC);
+  long cpu_blocked_dlopen = stat_sum(STAT_SAMPLES_BLOCKED_DLOPEN);
   long cpu_blocked = cpu_blocked_async + cpu_blocked_dlopen;
 
-  long cpu_dropped = atomic_load_explicit(&num_samples_dropped, memory_order_relaxed);
-  long cpu_segv = atomic_load_explicit(&num_samples_segv, memory_order_relaxed);
-  long cpu_valid = atomic_load_explicit(&num_samples_attempted, memory_order_relaxed);
-  long cpu_yielded = atomic_load_explicit(&num_samples_yielded, memory_order_relaxed);
-  long cpu_total = atomic_load_explicit(&num_samples_total, memory_order_relaxed);
+  long cpu_dropped = stat_sum(STAT_SAMPLES_DROPPED);
+  long cpu_segv = stat_sum(STAT_SAMPLES_SEGV);
+  long cpu_valid = stat_sum(STAT_SAMPLES_ATTEMPTED);
+  long cpu_yielded = stat_sum(STAT_SAMPLES_YIELDED);
+  long cpu_total = stat_sum(STAT_SAMPLES_TOTAL);
+
+  long cpu_trolled = stat_sum(STAT_TROLLED);
 
-  long cpu_trolled = atomic_load_explicit(&trolled, memory_order_relaxed);
+  long cpu_frames = stat_sum(STAT_FRAMES_TOTAL);
+  long cpu_frames_trolled = stat_sum(STAT_TROLLED_FRAMES);
+  long cpu_frames_libfail_total = stat_sum(STAT_FRAMES_LIBFAIL_TOTAL);
 
-  long cpu_frames = atomic_load_explicit(&frames_total, memory_order_relaxed);
-  long cpu_frames_trolled = atomic_load_explicit(&trolled_frames, memory_order_relaxed);
-  long cpu_frames_libfail_total = atomic_load_explicit(&frames_libfail_total, memory_order_relaxed);
+  long cpu_intervals_total = stat_sum(STAT_UNWIND_INTERVALS_TOTAL);
+  long cpu_intervals_susp = stat_sum(STAT_UNWIND_INTERVALS_SUSPICIOUS);
 
-  long cpu_intervals_total = atomic_load_explicit(&num_unwind_intervals_total, memory_order_relaxed);
-  long cpu_intervals_susp = atomic_load_explicit(&num_unwind_intervals_suspicious, memory_order_relaxed);
+  long acc_samp = stat_sum(STAT_ACC_SAMPLES);
+  long acc_samp_dropped = stat_sum(STAT_ACC_SAMPLES_DROPPED);
 
-  long acc_samp = atomic_load_explicit(&acc_samples, memory_order_relaxed);
-  long acc_samp_dropped = atomic_load_explicit(&acc_samples_dropped, memory_order_relaxed);
+  long acc_trace = stat_sum(STAT_ACC_TRACE_RECORDS);
+  long acc_trace_dropped = stat_sum(STAT_ACC_TRACE_RECORDS_DROPPED);
 
-  long acc_trace = atomic_load_explicit(&acc_trace_records, memory_order_relaxed);
-  long acc_trace_dropped = atomic_load_explicit(&acc_trace_records_dropped, memory_order_relaxed);
+  long trace_dropped = stat_sum(STAT_TRACE_RECORDS_DROPPED);
+  long stream_dropped = stat_sum(STAT_STREAM_SAMPLES_DROPPED);
 
   hpcrun_memory_summary();
 
@@ -491,6 +776,21 @@ hpcrun_stats_print_summary(void)
        cpu_intervals_total, cpu_intervals_susp
        );
 
+  if (trace_dropped > 0) {
+    AMSG("TRACE: records dropped while the flusher was behind: %ld",
+	 trace_dropped);
+  }
+
+  if (stream_dropped > 0) {
+    AMSG("AGGREGATE: samples not streamed to hpcrun-aggregate: %ld",
+	 stream_dropped);
+  }
+
+  latency_summary(HPCRUN_LATENCY_HANDLER, "handler");
+  latency_summary(HPCRUN_LATENCY_UNWIND, "unwind");
+  latency_summary(HPCRUN_LATENCY_CCT_INSERT, "cct-insert");
+  latency_summary(HPCRUN_LATENCY_TRACE_APPEND, "trace-append");
+
   if (hpcrun_get_disabled()) {
     AMSG("SAMPLING HAS BEEN DISABLED");
   }
@@ -44,6 +44,41 @@
 //
 // ******************************************************* EndRiceCopyright *
 
+#ifndef HPCRUN_STATS_H
+#define HPCRUN_STATS_H
+
+
+//***************************************************************************
+// system include files
+//***************************************************************************
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+
+//***************************************************************************
+// type declarations
+//***************************************************************************
+
+// phases of taking a sample whose latency is recorded
+typedef enum {
+  HPCRUN_LATENCY_HANDLER,       // all of hpcrun_sample_callpath()
+  HPCRUN_LATENCY_UNWIND,        // generating the backtrace
+  HPCRUN_LATENCY_CCT_INSERT,    // recording the backtrace in the cct
+  HPCRUN_LATENCY_TRACE_APPEND,  // appending one trace record
+  HPCRUN_LATENCY_NUM
+} hpcrun_latency_t;
+
+// log2 buckets of cycles; the last one holds everything longer
+#define HPCRUN_LATENCY_BUCKETS 40
+
+// Per-thread counters and latency histograms.  Each thread counts into
+// its own block, and the process-wide values below are sums over all
+// blocks.
+typedef struct hpcrun_stats_thread_t hpcrun_stats_thread_t;
+
+
 
 //***************************************************************************
 // interface operations
@@ -51,6 +86,42 @@
 
 void hpcrun_stats_reinit(void);
 
+//-----------------------------
+// per-thread blocks
+//-----------------------------
+
+// allocate and register a new block, or NULL if out of memory
+hpcrun_stats_thread_t* hpcrun_stats_thread_new(void);
+
+// make 'stats' the block the calling thread counts into.  Until a
+// thread is bound, its counts go to a shared set of atomic counters.
+void hpcrun_stats_thread_bind(hpcrun_stats_thread_t* stats);
+
+
+//-----------------------------
+// latencies
+//-----------------------------
+
+// cheap cycle counter used to time the phases
+uint64_t hpcrun_stats_cycles(void);
+
+// record a phase that began at cycle 'start'.  A NULL 'stats' means
+// the calling thread's block.
+void hpcrun_stats_latency_add(hpcrun_stats_thread_t* stats,
+			      hpcrun_latency_t kind, uint64_t start);
+
+
+//-----------------------------
+// epoch summary
+//-----------------------------
+
+// format a block's counters and one latency histogram as the values of
+// the hpcrun-stats and hpcrun-latency-* epoch nv-pairs (see hpcrun-fmt.h)
+void hpcrun_stats_thread_str(hpcrun_stats_thread_t* stats,
+			     char* buf, size_t len);
+void hpcrun_stats_latency_str(hpcrun_stats_thread_t* stats,
+			      hpcrun_latency_t kind, char* buf, size_t len);
+
 //-----------------------------
 // samples total 
 //-----------------------------
@@ -121,6 +192,22 @@ void hpcrun_stats_acc_trace_records_dropped_add(long value);
 long hpcrun_stats_acc_trace_records_dropped(void);
 
 
+//-----------------------------
+// trace records dropped
+//-----------------------------
+//
+void hpcrun_stats_num_trace_records_dropped_inc(void);
+long hpcrun_stats_num_trace_records_dropped(void);
+
+
+//-----------------------------
+// samples not streamed to the aggregator
+//-----------------------------
+//
+void hpcrun_stats_num_stream_samples_dropped_inc(void);
+long hpcrun_stats_num_stream_samples_dropped(void);
+
+
 //-----------------------------
 // partial unwind samples
 //-----------------------------
@@ -200,3 +287,5 @@ long hpcrun_stats_trolled_frames(void);
 //-----------------------------
 
 void hpcrun_stats_print_summary(void);
+
+#endif // HPCRUN_STATS_H
@@ -94,6 +94,7 @@
 #include "hpcrun_stats.h"
 #include "hpcrun_flag_stacks.h"
 #include "name.h"
+#include "rank.h"
 #include "start-stop.h"
 #include "custom-init.h"
 #include "cct_insert_backtrace.h"
@@ -121,6 +122,7 @@
 #include "thread_finalize.h"
 #include "thread_use.h"
 #include "trace.h"
+#include "sample-stream.h"
 #include "write_data.h"
 #include "sample-sources/itimer.h"
 #include <utilities/token-iter.h>
@@ -434,9 +436,16 @@ hpcrun_init_internal(bool is_child)
   hpcrun_options__init(&opts);
   hpcrun_options__getopts(&opts);
 
+  hpcrun_write_data_init();
+  hpcrun_flush_epochs_init();
+  hpcrun_epoch_prune_init();
+
   hpcrun_trace_init(); // this must go after thread initialization
   hpcrun_trace_open(&(TD_GET(core_profile_trace_data)));
 
+  hpcrun_sample_stream_init();
+  hpcrun_sample_stream_open(&(TD_GET(core_profile_trace_data)));
+
   // Decide whether to retain full single recursion, or collapse recursive calls to
   // first instance of recursive call
   hpcrun_set_retain_recursion_mode(getenv("HPCRUN_RETAIN_RECURSION") != NULL);
@@ -675,6 +684,10 @@ hpcrun_fini_internal()
     // write all threads' profile data and close trace file
     hpcrun_threadMgr_data_fini(hpcrun_get_thread_data());
 
+    // with HPCRUN_CONTAINER, index the streams written above
+    int rank = hpcrun_get_rank();
+    hpcrun_close_container(rank >= 0 ? rank : 0);
+
     fnbounds_fini();
     hpcrun_stats_print_summary();
     messages_fini();
@@ -1076,7 +1089,10 @@ monitor_thread_pre_create(void)
     goto fini;
   }
   
-  cct_node_t* n = hpcrun_gen_thread_ctxt(&context);
+  // the new thread keeps its creation context for its lifetime, while
+  // this thread's cct may be recycled: keep a copy of the path
+  cct_node_t* n = hpcrun_cct_copy_path(hpcrun_gen_thread_ctxt(&context));
+  hpcrun_epoch_safe_point();
 
   TMSG(THREAD,"before lush malloc");
   TMSG(MALLOC," -thread_precreate: lush malloc");
@@ -1107,6 +1123,7 @@ monitor_thread_post_create(void* data)
   hpcrun_safe_enter();
 
   TMSG(THREAD,"post create");
+  hpcrun_epoch_safe_point();
   TMSG(THREAD,"done post create");
 
   hpcrun_safe_exit();
@@ -1627,6 +1644,7 @@ monitor_dlopen(const char *path, int flags, void* handle)
     }
   }
   hpcrun_dlopen(path, flags, handle);
+  hpcrun_epoch_safe_point();
   hpcrun_safe_exit();
 }
 
@@ -1656,6 +1674,7 @@ monitor_post_dlclose(void* handle, int ret)
   }
   hpcrun_safe_enter();
   hpcrun_post_dlclose(handle, ret);
+  hpcrun_epoch_safe_point();
   hpcrun_safe_exit();
 }
 
@@ -51,9 +51,17 @@
 // When memory gets low, we write out an epoch and reclaim the CCT
 // nodes.
 //
+// Arena mode: with HPCRUN_MEMSTORE_NUMA set, each memstore segment is
+// bound (preferred) to the NUMA node of the thread that maps it, so a
+// thread's CCT stays local to where the thread samples.  With
+// HPCRUN_MEMSTORE_HUGEPAGES set to "thp" or "hugetlb", segments are
+// backed by transparent or explicit huge pages, falling back to
+// normal pages when none are available.
+//
 
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 
 #include <errno.h>
@@ -76,14 +84,53 @@
 
 #include <messages/messages.h>
 
+#include <lib/prof-lean/stdatomic.h>
+
 #define DEFAULT_MEMSIZE   (4 * 1024 * 1024)
 #define MIN_LOW_MEMSIZE  (80 * 1024)
 #define DEFAULT_PAGESIZE  4096
+#define HUGE_PAGESIZE     (2 * 1024 * 1024)
+
+// largest NUMA node number that a segment can be bound to
+#define MAX_NUMA_NODES    1024
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED  1
+#endif
+
+enum {
+  HUGEPAGES_NONE = 0,
+  HUGEPAGES_THP,
+  HUGEPAGES_HUGETLB
+};
+
+// Per-thread arena statistics.  A record lives in the thread's first
+// memstore, which is never unmapped, so it survives thread exit and
+// can be reported in the process summary.
+typedef struct hpcrun_arena_stats {
+  struct hpcrun_arena_stats *next;
+  int  thread_id;
+  int  node;             // node of the most recent segment, or -1
+  long num_segments;
+  long total_allocation;
+  long num_huge;         // segments backed by huge pages
+  long num_node_changes; // segments on a different node than the last one
+  long num_bind_failures;
+} hpcrun_arena_stats_t;
+
+// placement of one segment
+typedef struct {
+  int huge;
+  int node;
+  int bind_failed;
+} hpcrun_segment_info_t;
 
 static size_t memsize = DEFAULT_MEMSIZE;
 static size_t low_memsize = MIN_LOW_MEMSIZE;
 static size_t pagesize = DEFAULT_PAGESIZE;
 static int allow_extra_mmap = 1;
+static int numa_local = 0;
+static int hugepages = HUGEPAGES_NONE;
 
 static long num_segments = 0;
 static long total_allocation = 0;
@@ -94,6 +141,8 @@ static long total_non_freeable = 0;
 
 static int out_of_mem_mesg = 0;
 
+static _Atomic(hpcrun_arena_stats_t *) arena_stats_list = ATOMIC_VAR_INIT(NULL);
+
 //------------------------------------------------------------------
 // Internal functions
 //------------------------------------------------------------------
@@ -141,9 +190,27 @@ hpcrun_mem_init(void)
       low_memsize = MIN_LOW_MEMSIZE;
   }
 
+  str = getenv(HPCRUN_MEMSTORE_NUMA);
+  if (str != NULL && atoi(str) != 0) {
+    numa_local = 1;
+  }
+
+  str = getenv(HPCRUN_MEMSTORE_HUGEPAGES);
+  if (str != NULL) {
+    if (strcasecmp(str, "thp") == 0) {
+      hugepages = HUGEPAGES_THP;
+    } else if (strcasecmp(str, "hugetlb") == 0) {
+      hugepages = HUGEPAGES_HUGETLB;
+    } else if (strcasecmp(str, "none") != 0) {
+      EMSG("%s: unknown %s value '%s', using normal pages",
+	   __func__, HPCRUN_MEMSTORE_HUGEPAGES, str);
+    }
+  }
+
   TMSG(MALLOC, "%s: pagesize = %ld, memsize = %ld, "
-       "low memsize = %ld, extra mmap = %d",
-       __func__, pagesize, memsize, low_memsize, allow_extra_mmap);
+       "low memsize = %ld, extra mmap = %d, numa local = %d, hugepages = %d",
+       __func__, pagesize, memsize, low_memsize, allow_extra_mmap,
+       numa_local, hugepages);
   init_done = 1;
 }
 
@@ -154,7 +221,7 @@ hpcrun_mem_init(void)
 // threads running on a system that doesn't allow MAP_ANON.
 //
 static void *
-hpcrun_mmap_anon(size_t size)
+hpcrun_mmap_anon_flags(size_t size, int extra_flags)
 {
   int prot, flags, fd;
   char *str;
@@ -178,21 +245,193 @@ hpcrun_mmap_anon(size_t size)
   }
 #endif
 
-  addr = mmap(NULL, size, prot, flags, fd, 0);
+  addr = mmap(NULL, size, prot, flags | extra_flags, fd, 0);
   if (addr == MAP_FAILED) {
-    str = strerror(errno);
-    EMSG("%s: mmap failed: %s", __func__, str);
+    // a failed huge page request is not an error: the caller falls
+    // back to normal pages
+    if (extra_flags == 0) {
+      str = strerror(errno);
+      EMSG("%s: mmap failed: %s", __func__, str);
+    }
     addr = NULL;
   } else {
     num_segments++;
     total_allocation += size;
   }
 
-  TMSG(MALLOC, "%s: size = %ld, fd = %d, addr = %p",
-       __func__, size, fd, addr);
+  TMSG(MALLOC, "%s: size = %ld, fd = %d, flags = 0x%x, addr = %p",
+       __func__, size, fd, extra_flags, addr);
+  return addr;
+}
+
+static void *
+hpcrun_mmap_anon(size_t size)
+{
+  return hpcrun_mmap_anon_flags(size, 0);
+}
+
+// Map size bytes backed by huge pages, or return NULL.
+static void *
+hpcrun_mmap_huge(size_t size)
+{
+  size_t huge_size = ((size + HUGE_PAGESIZE - 1)/HUGE_PAGESIZE) * HUGE_PAGESIZE;
+  void *addr = NULL;
+
+#if defined(MAP_HUGETLB)
+  if (hugepages == HUGEPAGES_HUGETLB) {
+    addr = hpcrun_mmap_anon_flags(huge_size, MAP_HUGETLB);
+  }
+#endif
+
+#if defined(MADV_HUGEPAGE)
+  if (hugepages == HUGEPAGES_THP) {
+    // over-allocate so that the region can be trimmed to huge page
+    // alignment, which transparent huge pages require
+    void *region = hpcrun_mmap_anon(huge_size + HUGE_PAGESIZE);
+    if (region != NULL) {
+      uintptr_t start = (uintptr_t) region;
+      uintptr_t aligned = (start + HUGE_PAGESIZE - 1) & ~((uintptr_t) HUGE_PAGESIZE - 1);
+      uintptr_t end = start + huge_size + HUGE_PAGESIZE;
+
+      if (aligned > start) {
+	munmap(region, aligned - start);
+      }
+      if (end > aligned + huge_size) {
+	munmap((void *) (aligned + huge_size), end - (aligned + huge_size));
+      }
+      total_allocation -= HUGE_PAGESIZE;
+
+      addr = (void *) aligned;
+      if (madvise(addr, huge_size, MADV_HUGEPAGE) != 0) {
+	TMSG(MALLOC, "%s: madvise(MADV_HUGEPAGE) failed: %s",
+	     __func__, strerror(errno));
+      }
+    }
+  }
+#endif
+
   return addr;
 }
 
+// Return the NUMA node of the cpu we are running on, or -1.
+static int
+hpcrun_current_numa_node(void)
+{
+#if defined(SYS_getcpu)
+  unsigned int cpu, node;
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0) {
+    return node;
+  }
+#endif
+  return -1;
+}
+
+// Prefer the pages of [addr, addr + size) on the given node.  The
+// region must not have been touched yet.
+static int
+hpcrun_bind_numa_node(void *addr, size_t size, int node)
+{
+#if defined(SYS_mbind)
+  unsigned long nodemask[MAX_NUMA_NODES/(8 * sizeof(unsigned long))];
+
+  if (node < 0 || node >= MAX_NUMA_NODES) {
+    return -1;
+  }
+
+  memset(nodemask, 0, sizeof(nodemask));
+  nodemask[node/(8 * sizeof(unsigned long))] |= 
+    1UL << (node % (8 * sizeof(unsigned long)));
+
+  return syscall(SYS_mbind, addr, size, MPOL_PREFERRED, nodemask,
+		 MAX_NUMA_NODES + 1, 0);
+#else
+  return -1;
+#endif
+}
+
+// Map a segment, honoring arena mode, and describe its placement in
+// info.
+//
+// Returns: address of mmap-ed region, else NULL on failure.
+//
+static void *
+hpcrun_mmap_segment(size_t size, hpcrun_segment_info_t *info)
+{
+  void *addr = NULL;
+
+  info->huge = 0;
+  info->node = -1;
+  info->bind_failed = 0;
+
+  if (hugepages != HUGEPAGES_NONE) {
+    addr = hpcrun_mmap_huge(size);
+    info->huge = (addr != NULL);
+  }
+  if (addr == NULL) {
+    addr = hpcrun_mmap_anon(size);
+  }
+  if (addr == NULL) {
+    return NULL;
+  }
+
+  if (numa_local) {
+    info->node = hpcrun_current_numa_node();
+    if (hpcrun_bind_numa_node(addr, size, info->node) != 0) {
+      TMSG(MALLOC, "%s: bind to node %d failed: %s",
+	   __func__, info->node, strerror(errno));
+      info->bind_failed = 1;
+    }
+  }
+
+  TMSG(MALLOC, "%s: size = %ld, addr = %p, huge = %d, node = %d",
+       __func__, size, addr, info->huge, info->node);
+  return addr;
+}
+
+// Carve a stats record for a new thread from the top of its first
+// memstore and link it into the list reported by the summary.
+static void
+hpcrun_arena_stats_new(hpcrun_meminfo_t *mi)
+{
+  size_t size = round_up(sizeof(hpcrun_arena_stats_t));
+  hpcrun_arena_stats_t *stats;
+
+  mi->mi_high -= size;
+  stats = (hpcrun_arena_stats_t *) mi->mi_high;
+  memset(stats, 0, sizeof(*stats));
+  stats->thread_id = -1;
+  stats->node = -1;
+  mi->mi_stats = stats;
+
+  hpcrun_arena_stats_t *head = 
+    atomic_load_explicit(&arena_stats_list, memory_order_relaxed);
+  do {
+    stats->next = head;
+  } while (!atomic_compare_exchange_weak_explicit(&arena_stats_list, &head, 
+						  stats, memory_order_release,
+						  memory_order_relaxed));
+}
+
+static void
+hpcrun_arena_stats_update(hpcrun_arena_stats_t *stats, size_t size,
+			  hpcrun_segment_info_t *info)
+{
+  if (stats == NULL) {
+    return;
+  }
+
+  stats->num_segments++;
+  stats->total_allocation += size;
+  stats->num_huge += info->huge;
+  stats->num_bind_failures += info->bind_failed;
+  if (info->node >= 0) {
+    if (stats->node >= 0 && info->node != stats->node) {
+      stats->num_node_changes++;
+    }
+    stats->node = info->node;
+  }
+}
+
 //------------------------------------------------------------------
 // External functions
 //------------------------------------------------------------------
@@ -219,26 +458,15 @@ hpcrun_memory_reinit(void)
   out_of_mem_mesg = 0;
 }
 
-// Allocate space and init a thread's memstore.
+// Replace a thread's memstore with a new segment.
 // If failure, shutdown sampling and leave old memstore in place.
-void
-hpcrun_make_memstore(hpcrun_meminfo_t *mi, int is_child)
+static void
+hpcrun_make_memstore_segment(hpcrun_meminfo_t *mi)
 {
+  hpcrun_segment_info_t info;
   void *addr;
 
-  hpcrun_mem_init();
-
-  // If in the child after fork(), then continue to use the parent's
-  // memstore if it looks ok, else mmap a new one.  Note: we can't
-  // reset the memstore to empty unless we delete everything that was
-  // created via hpcrun_malloc() (cct, uw_recipe_map, ...).
-  if (is_child && mi->mi_start != NULL
-      && mi->mi_start <= mi->mi_low && mi->mi_low <= mi->mi_high
-      && mi->mi_high <= mi->mi_start + mi->mi_size) {
-    return;
-  }
-
-  addr = hpcrun_mmap_anon(memsize);
+  addr = hpcrun_mmap_segment(memsize, &info);
   if (addr == NULL) {
     if (! out_of_mem_mesg) {
       EMSG("%s: out of memory, shutting down sampling", __func__);
@@ -253,9 +481,45 @@ hpcrun_make_memstore(hpcrun_meminfo_t *mi, int is_child)
   mi->mi_low = mi->mi_start;
   mi->mi_high = mi->mi_start + memsize;
 
+  if (mi->mi_stats == NULL) {
+    hpcrun_arena_stats_new(mi);
+  }
+  hpcrun_arena_stats_update(mi->mi_stats, memsize, &info);
+
   TMSG(MALLOC, "new memstore: [%p, %p)", mi->mi_start, mi->mi_high);
 }
 
+// Allocate space and init a thread's memstore.
+// If failure, shutdown sampling and leave old memstore in place.
+void
+hpcrun_make_memstore(hpcrun_meminfo_t *mi, int is_child)
+{
+  hpcrun_mem_init();
+
+  // If in the child after fork(), then continue to use the parent's
+  // memstore if it looks ok, else mmap a new one.  Note: we can't
+  // reset the memstore to empty unless we delete everything that was
+  // created via hpcrun_malloc() (cct, uw_recipe_map, ...).
+  if (is_child && mi->mi_start != NULL
+      && mi->mi_start <= mi->mi_low && mi->mi_low <= mi->mi_high
+      && mi->mi_high <= mi->mi_start + mi->mi_size) {
+    return;
+  }
+
+  // a new thread starts a new arena stats record
+  mi->mi_stats = NULL;
+
+  hpcrun_make_memstore_segment(mi);
+}
+
+void
+hpcrun_memstore_set_thread_id(hpcrun_meminfo_t *mi, int id)
+{
+  if (mi->mi_stats != NULL) {
+    mi->mi_stats->thread_id = id;
+  }
+}
+
 // Reclaim the freeable CCT memory at the low end.
 void
 hpcrun_reclaim_freeable_mem(void)
@@ -290,7 +554,8 @@ hpcrun_malloc(size_t size)
   // memstore, mmap a separate region for it.
   if (size > memsize/5 && allow_extra_mmap
       && (mi->mi_start == NULL || size > mi->mi_high - mi->mi_low)) {
-    addr = hpcrun_mmap_anon(size);
+    hpcrun_segment_info_t info;
+    addr = hpcrun_mmap_segment(size, &info);
     if (addr == NULL) {
       if (! out_of_mem_mesg) {
 	EMSG("%s: out of memory, shutting down sampling", __func__);
@@ -301,6 +566,9 @@ hpcrun_malloc(size_t size)
       return NULL;
     }
     TMSG(MALLOC, "%s: size = %ld, addr = %p", __func__, size, addr);
+    if (mi->mi_start != NULL) {
+      hpcrun_arena_stats_update(mi->mi_stats, size, &info);
+    }
     total_non_freeable += size;
     return addr;
   }
@@ -310,7 +578,7 @@ hpcrun_malloc(size_t size)
       || mi->mi_high - mi->mi_low < low_memsize
       || mi->mi_high - mi->mi_low < size) {
     if (allow_extra_mmap) {
-      hpcrun_make_memstore(mi, 0);
+      hpcrun_make_memstore_segment(mi);
     } else {
       if (! out_of_mem_mesg) {
 	EMSG("%s: out of memory, shutting down sampling", __func__);
@@ -411,4 +679,24 @@ hpcrun_memory_summary(void)
   AMSG("MEMORY: total freeable: %.1f meg, total non-freeable: %.1f meg, "
        "malloc failures: %ld",
        total_freeable/meg, total_non_freeable/meg, num_failures);
+
+  if (! numa_local && hugepages == HUGEPAGES_NONE) {
+    return;
+  }
+
+  AMSG("MEMORY: arena mode: numa local: %s, huge pages: %s",
+       numa_local ? "yes" : "no",
+       hugepages == HUGEPAGES_THP ? "thp" :
+       hugepages == HUGEPAGES_HUGETLB ? "hugetlb" : "none");
+
+  hpcrun_arena_stats_t *stats = 
+    atomic_load_explicit(&arena_stats_list, memory_order_acquire);
+  for (; stats != NULL; stats = stats->next) {
+    AMSG("MEMORY: thread %d: segments: %ld (huge: %ld), "
+	 "allocation: %.1f meg, node: %d, node changes: %ld, "
+	 "bind failures: %ld",
+	 stats->thread_id, stats->num_segments, stats->num_huge,
+	 stats->total_allocation/meg, stats->node, stats->num_node_changes,
+	 stats->num_bind_failures);
+  }
 }
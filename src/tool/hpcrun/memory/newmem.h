@@ -54,15 +54,19 @@
 #ifndef _HPCRUN_NEWMEM_H_
 #define _HPCRUN_NEWMEM_H_
 
+struct hpcrun_arena_stats;
+
 struct hpcrun_meminfo {
   void *mi_start;
   void *mi_low;
   void *mi_high;
   long  mi_size;
+  struct hpcrun_arena_stats *mi_stats;
 };
 
 typedef struct hpcrun_meminfo hpcrun_meminfo_t;
 
 void hpcrun_make_memstore(hpcrun_meminfo_t *mi, int is_child);
+void hpcrun_memstore_set_thread_id(hpcrun_meminfo_t *mi, int id);
 
 #endif
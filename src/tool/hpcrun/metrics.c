@@ -48,6 +48,7 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <assert.h>
 
@@ -91,6 +92,12 @@ typedef struct metric_desc_list_t {
 // some sample sources will pre-allocate some metrics ...
 static metric_desc_list_t* pre_alloc = NULL;
 
+// metric data lists released by CCT pruning, reused by this thread
+static __thread metric_data_list_t* free_data_lists = NULL;
+
+// bound on the free list search for a list of a given kind
+#define FREE_DATA_LIST_SCAN 16
+
 //
 // To accomodate block sparse representation,
 // use 'kinds' == dense subarrays of metrics
@@ -497,11 +504,35 @@ hpcrun_metric_std_inc(int metric_id, metric_data_list_t* set,
   hpcrun_metric_std(metric_id, set, '+', incr);
 }
 
+//
+// reuse a released metric data list of the given kind, if any
+//
+static metric_data_list_t *
+reuse_metric_data_list(kind_info_t *kind)
+{
+  metric_data_list_t **prev = &free_data_lists;
+  for (int i = 0; *prev != NULL && i < FREE_DATA_LIST_SCAN; i++) {
+    metric_data_list_t *curr = *prev;
+    if (curr->kind == kind) {
+      *prev = curr->next;
+      memset(curr->metrics, 0,
+	     hpcrun_get_num_metrics(kind) * sizeof(hpcrun_metricVal_t));
+      curr->next = NULL;
+      return curr;
+    }
+    prev = &curr->next;
+  }
+  return NULL;
+}
+
 metric_data_list_t *
 hpcrun_new_metric_data_list(int metric_id)
 {
-  metric_data_list_t *curr = hpcrun_malloc(sizeof(metric_data_list_t));
   hpcrun_get_num_kind_metrics();
+  metric_data_list_t *curr = reuse_metric_data_list(metric_data[metric_id].kind);
+  if (curr) return curr;
+
+  curr = hpcrun_malloc(sizeof(metric_data_list_t));
   curr->kind = metric_data[metric_id].kind;
   int n_metrics = hpcrun_get_num_metrics(curr->kind);
   curr->metrics = hpcrun_malloc(n_metrics * sizeof(hpcrun_metricVal_t));
@@ -516,8 +547,11 @@ hpcrun_new_metric_data_list(int metric_id)
 metric_data_list_t *
 hpcrun_new_metric_data_list_kind(kind_info_t *kind)
 {
-  metric_data_list_t *curr = hpcrun_malloc(sizeof(metric_data_list_t));
   hpcrun_get_num_kind_metrics();
+  metric_data_list_t *curr = reuse_metric_data_list(kind);
+  if (curr) return curr;
+
+  curr = hpcrun_malloc(sizeof(metric_data_list_t));
   curr->kind = kind;
   int n_metrics = hpcrun_get_num_metrics(curr->kind);
   curr->metrics = hpcrun_malloc(n_metrics * sizeof(hpcrun_metricVal_t));
@@ -591,3 +625,92 @@ hpcrun_merge_cct_metrics(metric_data_list_t *dest_list, metric_data_list_t *sour
 
   return dest_list;
 }
+
+
+//
+// value of a metric as a double, according to its format
+//
+static double
+metric_value(metric_desc_t *desc, hpcrun_metricVal_t *v)
+{
+  return (desc->flags.fields.valFmt == MetricFlags_ValFmt_Real) ?
+    v->r : (double) v->i;
+}
+
+
+//
+// add the values of 'source' into 'dest', honoring each metric's value
+// format.  kinds missing from 'dest' are appended.
+// pre-condition: dest is not NULL
+//
+void
+hpcrun_metric_set_fold(metric_data_list_t *dest, metric_data_list_t *source)
+{
+  for (metric_data_list_t *src = source; src != NULL; src = src->next) {
+    metric_data_list_t *prev = dest;
+    metric_data_list_t *dst;
+    for (dst = dest; dst != NULL && dst->kind != src->kind;
+	 prev = dst, dst = dst->next);
+    if (dst == NULL) {
+      dst = hpcrun_new_metric_data_list_kind(src->kind);
+      prev->next = dst;
+    }
+    for (metric_desc_list_t *l = src->kind->metric_data; l; l = l->next) {
+      hpcrun_metricVal_t *d = &(dst->metrics[l->id].v1);
+      hpcrun_metricVal_t *s = &(src->metrics[l->id].v1);
+      if (l->val.flags.fields.valFmt == MetricFlags_ValFmt_Real)
+	d->r += s->r;
+      else
+	d->i += s->i;
+    }
+  }
+}
+
+
+//
+// add the values of 'set' to 'totals', indexed by metric id
+//
+void
+hpcrun_metric_set_totals(metric_data_list_t *set, double *totals)
+{
+  for (metric_data_list_t *curr = set; curr != NULL; curr = curr->next) {
+    for (metric_desc_list_t *l = curr->kind->metric_data; l; l = l->next) {
+      totals[l->g_id] += metric_value(&l->val, &(curr->metrics[l->id].v1));
+    }
+  }
+}
+
+
+//
+// sum over metrics of the fraction of each metric's total held by 'set';
+// metrics whose total is zero do not contribute.
+//
+double
+hpcrun_metric_set_share(metric_data_list_t *set, const double *totals)
+{
+  double share = 0.0;
+  for (metric_data_list_t *curr = set; curr != NULL; curr = curr->next) {
+    for (metric_desc_list_t *l = curr->kind->metric_data; l; l = l->next) {
+      if (totals[l->g_id] > 0) {
+	share += metric_value(&l->val, &(curr->metrics[l->id].v1))
+	  / totals[l->g_id];
+      }
+    }
+  }
+  return share;
+}
+
+
+//
+// release a metric data list (all kinds) for reuse by this thread
+//
+void
+hpcrun_metric_data_list_free(metric_data_list_t *set)
+{
+  while (set) {
+    metric_data_list_t *next = set->next;
+    set->next = free_data_lists;
+    free_data_lists = set;
+    set = next;
+  }
+}
@@ -171,4 +171,12 @@ extern void hpcrun_metric_set_dense_copy(cct_metric_data_t* dest,
 
 extern metric_data_list_t *hpcrun_merge_cct_metrics(metric_data_list_t *dest, metric_data_list_t *source);
 
+//
+// support for folding the metrics of pruned CCT nodes
+//
+extern void hpcrun_metric_set_fold(metric_data_list_t *dest, metric_data_list_t *source);
+extern void hpcrun_metric_set_totals(metric_data_list_t *set, double *totals);
+extern double hpcrun_metric_set_share(metric_data_list_t *set, const double *totals);
+extern void hpcrun_metric_data_list_free(metric_data_list_t *set);
+
 #endif // METRICS_H
@@ -66,6 +66,7 @@
 
 #include <lib/prof-lean/spinlock.h>
 
+#include <hpcrun/sample-stream.h>
 #include <hpcrun/trace.h>
 #include <hpcrun/write_data.h>
 
@@ -162,6 +163,7 @@ write_other_td
     // write out a given td
     hpcrun_write_profile_data(&(entry->td->core_profile_trace_data));
     hpcrun_trace_close(&(entry->td->core_profile_trace_data));
+    hpcrun_sample_stream_close(&(entry->td->core_profile_trace_data));
     td->core_profile_trace_data.cct2metrics_map = store_cct2metrics_map;
 
     entry = entry->next;
@@ -44,6 +44,15 @@
 //
 // ******************************************************* EndRiceCopyright *
 
+//*****************************************************************************
+// unit test
+//*****************************************************************************
+
+// 1 builds this file as a standalone benchmark instead (see the end)
+#define UNIT_TEST 0
+
+#if UNIT_TEST == 0
+
 //*****************************************************************************
 // system includes
 //*****************************************************************************
@@ -448,7 +457,6 @@ help_notification_alloc
   ompt_notification_t *notification = hpcrun_ompt_notification_alloc();
   notification->region_data = region_data;
   notification->region_id = region_data->region_id;
-  notification->threads_queue = &threads_queue;
 
   return notification;
 }
@@ -569,11 +577,12 @@ register_to_region
 
   ompt_region_debug_notify_needed(notification);
 
-  // create notification and enqueu to region's queue
-  OMPT_BASE_T_GET_NEXT(notification) = NULL;
+  // hold a reference to the region until its call path is resolved
+  atomic_fetch_add(&region_data->refcnt, 1);
 
-  // register thread to region's wait free queue
-  wfq_enqueue(OMPT_BASE_T_STAR(notification), &region_data->queue);
+  // remember the notification on the thread's pending list
+  OMPT_BASE_T_GET_NEXT(notification) = OMPT_BASE_T_STAR(pending_notifications);
+  pending_notifications = notification;
 
   // increment the number of unresolved regions
   unresolved_cnt++;
@@ -587,7 +596,6 @@ add_notification_to_stack
 {
     ompt_notification_t* notification = help_notification_alloc(region_data);
     notification->region_data = region_data;
-    notification->threads_queue = &threads_queue;
     // push to stack
     push_region_stack(notification, 0, 0);
     return notification;
@@ -687,47 +695,86 @@ hpcrun_cct_insert_path_return_leaf_tmp
     return hpcrun_cct_insert_addr(root, hpcrun_cct_addr(path));
 }
 
-// return one if a notification was processed
-int
-try_resolve_one_region_context
+// one-entry memo of the last call path inserted under the thread root.
+// many short regions launched from the same place publish equal call
+// paths, so a worker usually finds the prefix without walking its tree.
+static __thread cct_node_t *memo_root = NULL;
+static __thread cct_node_t *memo_call_path = NULL;
+static __thread cct_node_t *memo_prefix = NULL;
+
+
+static bool
+same_call_path
 (
- void
+ cct_node_t *a,
+ cct_node_t *b
 )
 {
-  ompt_notification_t *old_head = NULL;
+  for (; a && b; a = hpcrun_cct_parent(a), b = hpcrun_cct_parent(b)) {
+    if (a == b) return true;
+    if (!cct_addr_eq(hpcrun_cct_addr(a), hpcrun_cct_addr(b))) return false;
+  }
+  return a == b;
+}
 
-  old_head = (ompt_notification_t*) 
-    wfq_dequeue_private(&threads_queue, OMPT_BASE_T_STAR_STAR(private_threads_queue));
 
-  if (!old_head) return 0;
+static cct_node_t *
+insert_region_call_path
+(
+ cct_node_t *parent_unresolved_cct,
+ cct_node_t *region_call_path
+)
+{
+  cct_node_t *thread_root = hpcrun_get_thread_epoch()->csdata.thread_root;
 
-  unresolved_cnt--;
+  // for resolving inner region, we should consider all cct nodes from prefix
+  if (parent_unresolved_cct != thread_root) {
+    return hpcrun_cct_insert_path_return_leaf_tmp(parent_unresolved_cct,
+                                                  region_call_path);
+  }
+
+  if (memo_root == thread_root && memo_call_path &&
+      same_call_path(memo_call_path, region_call_path)) {
+    return memo_prefix;
+  }
+
+  // FIXME: why hpcrun_cct_insert_path_return_leaf ignores top cct of the path
+  // when had this condtion, once infinity happen
+  // from initial region, we should remove the first one
+  cct_node_t *prefix =
+    hpcrun_cct_insert_path_return_leaf(parent_unresolved_cct, region_call_path);
+
+  // published call paths are private copies that are never reclaimed,
+  // so it is safe to compare against this one later
+  memo_root = thread_root;
+  memo_call_path = region_call_path;
+  memo_prefix = prefix;
+
+  return prefix;
+}
 
+
+static void
+resolve_one_notification
+(
+ ompt_notification_t *notification
+)
+{
   // region to resolve
-  ompt_region_data_t *region_data = old_head->region_data;
+  ompt_region_data_t *region_data = notification->region_data;
 
-  ompt_region_debug_notify_received(old_head);
+  ompt_region_debug_notify_received(notification);
 
   // ================================== resolving part
-  cct_node_t *unresolved_cct = old_head->unresolved_cct;
+  cct_node_t *unresolved_cct = notification->unresolved_cct;
   cct_node_t *parent_unresolved_cct = hpcrun_cct_parent(unresolved_cct);
 
   if (parent_unresolved_cct == NULL || region_data->call_path == NULL) {
     deferred_resolution_breakpoint();
   } else {
     // prefix should be put between unresolved_cct and parent_unresolved_cct
-    cct_node_t *prefix = NULL;
-    cct_node_t *region_call_path = region_data->call_path;
-
-    // FIXME: why hpcrun_cct_insert_path_return_leaf ignores top cct of the path
-    // when had this condtion, once infinity happen
-    if (parent_unresolved_cct == hpcrun_get_thread_epoch()->csdata.thread_root) {
-      // from initial region, we should remove the first one
-      prefix = hpcrun_cct_insert_path_return_leaf(parent_unresolved_cct, region_call_path);
-    } else {
-      // for resolving inner region, we should consider all cct nodes from prefix
-      prefix = hpcrun_cct_insert_path_return_leaf_tmp(parent_unresolved_cct, region_call_path);
-    }
+    cct_node_t *prefix =
+      insert_region_call_path(parent_unresolved_cct, region_data->call_path);
 
     if (prefix == NULL) {
       deferred_resolution_breakpoint();
@@ -743,18 +790,47 @@ try_resolve_one_region_context
   }
 
   // free notification
-  hpcrun_ompt_notification_free(old_head);
+  hpcrun_ompt_notification_free(notification);
 
-  // check if the notification needs to be forwarded 
-  ompt_notification_t* next = (ompt_notification_t*) wfq_dequeue_public(&region_data->queue);
-  if (next) {
-    wfq_enqueue(OMPT_BASE_T_STAR(next), next->threads_queue);
-  } else {
-    // notify creator of region that region_data can be put in region's freelist
+  // the last thread to let go of the region returns it to its creator
+  if (atomic_fetch_sub(&region_data->refcnt, 1) == 1) {
     hpcrun_ompt_region_free(region_data);
   }
+}
+
+
+// resolve every pending region whose call path has been published.
+// the list is newest first, so inner regions are resolved before the
+// regions that enclose them. return the number of regions resolved.
+// samples push onto the list (register_to_region), so the caller must
+// be inside hpcrun (hpcrun_safe_enter) while the list changes.
+int
+try_resolve_one_region_context
+(
+ void
+)
+{
+  int resolved = 0;
+  ompt_notification_t **link = &pending_notifications;
+
+  while (*link) {
+    ompt_notification_t *notification = *link;
+    ompt_region_data_t *region_data = notification->region_data;
 
-  return 1;
+    if (!atomic_load(&region_data->call_path_published)) {
+      link = (ompt_notification_t **) &OMPT_BASE_T_GET_NEXT(notification);
+      continue;
+    }
+
+    // unlink before resolving; the notification goes back to the freelist
+    *link = (ompt_notification_t *) OMPT_BASE_T_GET_NEXT(notification);
+    unresolved_cnt--;
+
+    resolve_one_notification(notification);
+    resolved++;
+  }
+
+  return resolved;
 }
 
 
@@ -824,7 +900,7 @@ ompt_resolve_region_contexts
     // if all regions resolved, we are done
     if (unresolved_cnt == 0) break; 
 
-    // poll for a notification to resolve a region context
+    // poll for published region call paths
     try_resolve_one_region_context();
 
     // infrequently check for a timeout
@@ -865,9 +941,9 @@ ompt_resolve_region_contexts_poll
 {
   // if there are any unresolved contexts
   if (unresolved_cnt) {
-    // attempt to resolve contexts by consuming any notifications that
-    // are currently pending.
-    while (try_resolve_one_region_context());
+    // attempt to resolve contexts whose call paths have been published
+    // since the last poll.
+    try_resolve_one_region_context();
   };
 }
 
@@ -1426,3 +1502,160 @@ tmp_end_region_resolve
     hpcrun_cct_delete_self(unresolved_cct);
   }
 }
+
+
+
+//*****************************************************************************
+// unit test
+//*****************************************************************************
+
+#else
+
+// a cpu-only benchmark of deferred context resolution: an OpenMP program
+// that runs many short parallel regions of each kind that the code above
+// handles differently, and reports the time per region.
+//
+//   top-level    regions from one call site under the thread root, which
+//                the one-entry memo resolves without walking the cct
+//   two-sites    regions alternating between two call sites, which miss
+//                the memo every time
+//   nested       regions inside a parallel region (reported per outer
+//                region): workers register for both levels, so regions
+//                are released by the last reference of the team
+//   serialized   regions with a team of one, where only the master
+//                holds a reference
+//
+// workers that take a sample inside a region register a pending
+// notification, which they resolve when they poll at the end of their
+// implicit task.  the cost of deferred resolution is the difference
+// between a run under hpcrun and a run without it:
+//
+//   cc -std=gnu99 -O2 -fopenmp -o ompt-defer-bench ompt-defer.c
+//   OMP_NUM_THREADS=8 ./ompt-defer-bench [regions [work]]
+//   OMP_NUM_THREADS=8 hpcrun -e REALTIME@100 ./ompt-defer-bench [...]
+//
+// with an OpenMP runtime that supports OMPT (e.g., LLVM's libomp).
+// 'work' is the number of loop iterations each thread spins in a
+// region; it should make regions long enough for samples to land in
+// them at the chosen period.
+
+
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DEFAULT_REGIONS 20000
+#define DEFAULT_WORK 2000
+
+
+static void
+bench_spin
+(
+ long work
+)
+{
+  volatile long sink = 0;
+  for (long i = 0; i < work; i++) {
+    sink += i;
+  }
+}
+
+
+static void __attribute__((noinline))
+bench_site_a
+(
+ long work
+)
+{
+#pragma omp parallel
+  bench_spin(work);
+}
+
+
+static void __attribute__((noinline))
+bench_site_b
+(
+ long work
+)
+{
+#pragma omp parallel
+  bench_spin(work);
+}
+
+
+static void
+bench_report
+(
+ const char *name,
+ long regions,
+ double start
+)
+{
+  double usec = (omp_get_wtime() - start) * 1e6;
+  printf("%-12s %8ld regions %10.2f us/region\n", name, regions,
+         usec / regions);
+}
+
+
+int
+main
+(
+ int argc,
+ char **argv
+)
+{
+  long regions = (argc > 1) ? atol(argv[1]) : DEFAULT_REGIONS;
+  long work = (argc > 2) ? atol(argv[2]) : DEFAULT_WORK;
+  double start;
+
+  if (regions <= 0 || work < 0) {
+    fprintf(stderr, "usage: %s [regions [work]]\n", argv[0]);
+    return 1;
+  }
+
+  printf("%d threads, %ld iterations of work per thread and region\n",
+         omp_get_max_threads(), work);
+
+  // warm up the runtime's thread pool
+#pragma omp parallel
+  bench_spin(work);
+
+  start = omp_get_wtime();
+  for (long i = 0; i < regions; i++) {
+#pragma omp parallel
+    bench_spin(work);
+  }
+  bench_report("top-level", regions, start);
+
+  start = omp_get_wtime();
+  for (long i = 0; i < regions; i++) {
+    if (i & 1) bench_site_a(work);
+    else bench_site_b(work);
+  }
+  bench_report("two-sites", regions, start);
+
+  int inner = omp_get_max_threads() / 2;
+  if (inner < 1) inner = 1;
+  omp_set_max_active_levels(2);
+
+  start = omp_get_wtime();
+  for (long i = 0; i < regions; i++) {
+#pragma omp parallel num_threads(2)
+    {
+#pragma omp parallel num_threads(inner)
+      bench_spin(work);
+    }
+  }
+  bench_report("nested", regions, start);
+
+  start = omp_get_wtime();
+  for (long i = 0; i < regions; i++) {
+#pragma omp parallel if(0)
+    bench_spin(work);
+  }
+  bench_report("serialized", regions, start);
+
+  return 0;
+}
+
+#endif
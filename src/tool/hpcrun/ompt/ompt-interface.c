@@ -387,7 +387,7 @@ ompt_thread_begin
   ompt_thread_type_set(thread_type);
   undirected_blame_thread_start(&omp_idle_blame_info);
 
-  wfq_init(&threads_queue);
+  pending_notifications = NULL;
 
   registered_regions = NULL;
   unresolved_cnt = 0;
@@ -420,7 +420,11 @@ ompt_idle_begin
 {
   undirected_blame_idle_begin(&omp_idle_blame_info);
   if (!ompt_eager_context_p()) {
+    // samples add to the thread's pending notification list: keep them
+    // out while resolved notifications are unlinked
+    int safe = hpcrun_safe_enter();
     while(try_resolve_one_region_context());
+    if (safe) hpcrun_safe_exit();
   }
 }
 
@@ -626,6 +630,9 @@ ompt_initialize
 
   ompt_initialized = 1;
 
+  // region and task contexts are held across samples
+  hpcrun_epoch_recycle_disable("the OpenMP tools interface");
+
   ompt_init_inquiry_fn_ptrs(lookup);
   ompt_init_placeholders();
 
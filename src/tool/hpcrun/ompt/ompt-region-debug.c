@@ -293,15 +293,10 @@ hpcrun_ompt_region_check
 {
    ompt_region_data_t *e = global_region_list;
    while (e) {
-     printf("region %p region id 0x%lx call_path = %p queue head = %p\n", 
-	    e, e->region_id, e->call_path, atomic_load(&e->queue.head));
-
-     ompt_notification_t *n = (ompt_notification_t *) atomic_load(&e->queue.head);
-     while(n) {
-       printf("   notification %p region %p region_id 0x%lx threads_queue %p unresolved_cct %p next %p\n",
-	      n, n->region_data, n->region_id, n->threads_queue, n->unresolved_cct, n->next.next);
-       n = (ompt_notification_t *) n->next.next;
-     }
+     printf("region %p region id 0x%lx call_path = %p published = %d refcnt = %d\n", 
+	    e, e->region_id, e->call_path, 
+	    (int) atomic_load(&e->call_path_published), atomic_load(&e->refcnt));
+
      e = (ompt_region_data_t *) e->next_region;
    } 
 
@@ -120,7 +120,8 @@ ompt_region_data_new
   e->region_id = region_id;
   e->call_path = call_path;
 
-  wfq_init(&e->queue);
+  atomic_init(&e->refcnt, 1);
+  atomic_init(&e->call_path_published, false);
 
   // parts for freelist
   OMPT_BASE_T_GET_NEXT(e) = NULL;
@@ -186,9 +187,6 @@ ompt_parallel_end_internal
   ompt_region_data_t* region_data = (ompt_region_data_t*)parallel_data->ptr;
 
   if (!ompt_eager_context_p()){
-    // check if there is any thread registered that should be notified that region call path is available
-    ompt_notification_t* to_notify = (ompt_notification_t*) wfq_dequeue_public(&region_data->queue);
-
     region_stack_el_t *stack_el = &region_stack[top_index + 1];
     ompt_notification_t *notification = stack_el->notification;
     if (notification->unresolved_cct) {
@@ -202,7 +200,9 @@ ompt_parallel_end_internal
       ending_region = NULL;
     }
 
-    if (to_notify){
+    // workers register before the implicit barrier at the end of the
+    // region, so the count cannot grow any more at this point
+    if (atomic_load(&region_data->refcnt) > 1) {
       if (region_data->call_path == NULL){
         // FIXME vi3: this is one big hack
         // different function is call for providing callpaths
@@ -218,15 +218,15 @@ ompt_parallel_end_internal
         ending_region = NULL;
       }
 
-      // notify next thread
-      wfq_enqueue(OMPT_BASE_T_STAR(to_notify), to_notify->threads_queue);
-    } else {
-      // if none, you can reuse region
-      // this thread is region creator, so it could add to private region's list
-      // FIXME vi3: check if you are right
+      // publish the call path once; registered workers pick it up
+      // the next time they poll, without being notified one by one
+      atomic_store(&region_data->call_path_published, true);
+    }
+
+    // drop the master's reference. if no worker is waiting, this thread
+    // is the region creator, so it can put the region on its private list
+    if (atomic_fetch_sub(&region_data->refcnt, 1) == 1) {
       ompt_region_release(region_data);
-      // or should use this
-      // wfq_enqueue((ompt_base_t*)region_data, &public_region_freelist);
     }
   }
 
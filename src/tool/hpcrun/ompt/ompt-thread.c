@@ -63,9 +63,7 @@ __thread cct_node_t* cct_not_master_region = NULL;
 
 __thread ompt_trl_el_t* registered_regions = NULL;
 
-//__thread ompt_threads_queue_t threads_queue;
-__thread ompt_wfq_t threads_queue;
-__thread ompt_data_t* private_threads_queue = NULL;
+__thread ompt_notification_t* pending_notifications = NULL;
 
 // freelists
 __thread ompt_notification_t* notification_freelist_head = NULL;
@@ -70,13 +70,9 @@
 // list of regions for which a thread is registered that are not yet resolved
 extern __thread ompt_trl_el_t* registered_regions;
 
-// thread's notifications queueus
-//
-// public thread's notification queue
-extern __thread ompt_wfq_t threads_queue;
-
-// private thread's notification queue
-extern __thread ompt_data_t* private_threads_queue;
+// notifications for regions whose call paths the thread is waiting for,
+// newest first, linked through their next fields
+extern __thread ompt_notification_t* pending_notifications;
 
 // freelists
 
@@ -113,8 +113,13 @@ typedef struct ompt_region_data_s {
   // like inherited class in C++, inheretes from base_t
   ompt_next_t next;
 
-  // region's wait free queue
-  ompt_wfq_t queue;
+  // one reference held by the master until the region ends, plus one
+  // for each worker that still has to resolve against call_path
+  _Atomic(int) refcnt;
+
+  // set by the master once call_path is final; workers read call_path
+  // only after they observe it set
+  _Atomic(bool) call_path_published;
 
   // region's freelist which belongs to thread
   ompt_wfq_t *thread_freelist;
@@ -141,9 +146,6 @@ typedef struct ompt_notification_s{
   // region id
   uint64_t region_id;
 
-  // struct ompt_threads_queue_s *threads_queue;
-  ompt_wfq_t *threads_queue;
-
   // pointer to the cct pseudo node of the region that should be resolve
   cct_node_t* unresolved_cct;
 } ompt_notification_t;
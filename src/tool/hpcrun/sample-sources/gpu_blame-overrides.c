@@ -750,6 +750,11 @@ static inline core_profile_trace_data_t *hpcrun_stream_data_alloc_init(int id) {
     st->trace_min_time_us = 0;
     st->trace_max_time_us = 0;
     st->hpcrun_file  = NULL;
+    st->hpcrun_file_trace_time_offset = 0;
+    st->next_flush_time_us = 0;
+    st->next_prune_time_us = 0;
+    st->flush_pending = false;
+    st->prune_pending = false;
     
     return st;
 }
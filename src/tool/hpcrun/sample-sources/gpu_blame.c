@@ -76,6 +76,7 @@
  *****************************************************************************/
 #include "sample_source_obj.h"
 #include "common.h"
+#include <hpcrun/epoch.h>
 #include <hpcrun/hpcrun_options.h>
 #include <hpcrun/hpcrun_stats.h>
 
@@ -235,6 +236,9 @@ static void METHOD_FN(process_event_list, int lush_metrics)
     bs_entry.fn = dlsym(RTLD_DEFAULT, "gpu_blame_shifter");
     bs_entry.next = 0;
     blame_shift_register(&bs_entry);
+
+    // the overrides hold launch and stream cct nodes across calls
+    hpcrun_epoch_recycle_disable("gpu blame");
 }
 
 static void
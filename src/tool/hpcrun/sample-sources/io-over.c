@@ -94,6 +94,7 @@
  * local include files
  *****************************************************************************/
 
+#include <epoch.h>
 #include <main.h>
 #include <safe-sampling.h>
 #include <sample_event.h>
@@ -178,6 +179,7 @@ MONITOR_EXT_WRAP_NAME(read)(int fd, void *buf, size_t count)
   hpcrun_sample_callpath(&uc, metric_id_read, 
         (hpcrun_metricVal_t) {.i=(ret > 0 ? ret : 0)}, 
         0, 1, NULL);
+  hpcrun_epoch_safe_point();
   hpcrun_safe_exit();
 
   errno = save_errno;
@@ -215,6 +217,7 @@ MONITOR_EXT_WRAP_NAME(write)(int fd, const void *buf, size_t count)
   hpcrun_sample_callpath(&uc, metric_id_write, 
         (hpcrun_metricVal_t) {.i=(ret > 0 ? ret : 0)}, 
         0, 1, NULL);
+  hpcrun_epoch_safe_point();
   hpcrun_safe_exit();
 
   errno = save_errno;
@@ -251,6 +254,7 @@ MONITOR_EXT_WRAP_NAME(fread)(void *ptr, size_t size, size_t count, FILE *stream)
   hpcrun_sample_callpath(&uc, metric_id_read, 
             (hpcrun_metricVal_t) {.i=ret*size}, 
             0, 1, NULL);
+  hpcrun_epoch_safe_point();
   hpcrun_safe_exit();
 
   return ret;
@@ -286,6 +290,7 @@ MONITOR_EXT_WRAP_NAME(fwrite)(const void *ptr, size_t size, size_t count,
   hpcrun_sample_callpath(&uc, metric_id_write, 
             (hpcrun_metricVal_t) {.i=ret*size}, 
             0, 1, NULL);
+  hpcrun_epoch_safe_point();
   hpcrun_safe_exit();
 
   return ret;
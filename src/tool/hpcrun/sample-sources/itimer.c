@@ -91,6 +91,7 @@
 #include <hpcrun/hpcrun_options.h>
 #include <hpcrun/hpcrun_stats.h>
 
+#include <hpcrun/epoch.h>
 #include <hpcrun/metrics.h>
 #include <hpcrun/safe-sampling.h>
 #include <hpcrun/sample_event.h>
@@ -755,6 +756,7 @@ itimer_signal_handler(int sig, siginfo_t* siginfo, void* context)
     hpcrun_restart_timer(self, 1);
   }
 
+  hpcrun_epoch_async_safe_point(pc);
   hpcrun_safe_exit();
 
   HPCTOOLKIT_APPLICATION_ERRNO_RESTORE();
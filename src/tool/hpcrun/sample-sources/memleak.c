@@ -79,6 +79,7 @@
 #include <hpcrun/sample_sources_registered.h>
 #include "simple_oo.h"
 #include <hpcrun/thread_data.h>
+#include <hpcrun/epoch.h>
 
 #include <messages/messages.h>
 #include <utilities/tokenize.h>
@@ -172,6 +173,9 @@ METHOD_FN(process_event_list,int lush_metrics)
   // leak = allocated - freed
   sprintf(buffer, "#%d-#%d", alloc_metric_id, free_metric_id);
   memleak_metric->formula = buffer;
+
+  // allocation contexts are recorded in malloc headers
+  hpcrun_epoch_recycle_disable("MEMLEAK");
 }
 
 static void
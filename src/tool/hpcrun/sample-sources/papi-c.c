@@ -82,6 +82,7 @@
 #include "papi-c-extended-info.h"
 #include "sample-filters.h"
 
+#include <hpcrun/epoch.h>
 #include <hpcrun/hpcrun_options.h>
 #include <hpcrun/hpcrun_stats.h>
 #include <hpcrun/metrics.h>
@@ -946,5 +947,6 @@ papi_event_handler(int event_set, void *pc, long long ovec,
     }
   }
 
+  hpcrun_epoch_async_safe_point(pc);
   hpcrun_safe_exit();
 }
@@ -81,6 +81,7 @@
 #include "sample_source_obj.h"
 #include "common.h"
 
+#include <hpcrun/epoch.h>
 #include <hpcrun/hpcrun_options.h>
 #include <hpcrun/hpcrun_stats.h>
 #include <hpcrun/metrics.h>
@@ -738,5 +739,6 @@ papi_event_handler(int event_set, void *pc, long long ovec,
     }
   }
 
+  hpcrun_epoch_async_safe_point(pc);
   hpcrun_safe_exit();
 }
@@ -56,6 +56,7 @@
 #include <assert.h>
 #include <include/linux_info.h>
 
+#include <hpcrun/epoch.h>
 #include <hpcrun/metrics.h>
 
 #include "kernel_blocking.h"
@@ -256,6 +257,9 @@ register_blocking(kind_info_t *kb_kind, event_info_t *event_desc)
 
   event_desc->attr.context_switch = 1;
   event_desc->attr.sample_id_all = 1;
+
+  // each thread keeps the cct node where it blocked until it resumes
+  hpcrun_epoch_recycle_disable("kernel blocking");
 }
 
 
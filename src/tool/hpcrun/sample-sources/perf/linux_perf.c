@@ -91,6 +91,7 @@
 #include "sample-sources/ss-errno.h"
  
 #include <hpcrun/cct_insert_backtrace.h>
+#include <hpcrun/epoch.h>
 #include <hpcrun/files.h>
 #include <hpcrun/hpcrun_stats.h>
 #include <hpcrun/loadmap.h>
@@ -1173,6 +1174,7 @@ perf_event_handler(
 
   perf_start_all(nevents, event_thread);
 
+  hpcrun_epoch_async_safe_point(pc);
   hpcrun_safe_exit();
 
   HPCTOOLKIT_APPLICATION_ERRNO_RESTORE();
@@ -0,0 +1,543 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+
+//***************************************************************************
+//
+// File:
+//   sample-stream.c
+//
+// Purpose:
+//   Stream samples to the per-node aggregator (hpcrun --aggregate).
+//
+// Description:
+//   The rings of one measurement share a key derived from the
+//   measurement directory.  A lock file with that key records the pid
+//   of the running aggregator; the first process to create it starts
+//   hpcrun-aggregate ($HPCRUN_AGGREGATE_CMD, set by the hpcrun script)
+//   the way the fnbounds server is started, except that the daemon is
+//   detached so that it outlives the process.
+//
+//   Each thread sends the name of a load module or the descriptor of a
+//   metric once, before the first sample that refers to it, and marks
+//   it in a bitmap.  Stream structs are mmap'd, kept on a list and
+//   reused by later threads, never freed.
+//
+//***************************************************************************
+
+//*********************************************************************
+// global includes
+//*********************************************************************
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+
+//*********************************************************************
+// local includes
+//*********************************************************************
+
+#include "monitor.h"
+#include "disabled.h"
+#include "env.h"
+#include "files.h"
+#include "hpcrun_stats.h"
+#include "loadmap.h"
+#include "metrics.h"
+#include "sample_prob.h"
+#include "sample-stream.h"
+
+#include <memory/mmap.h>
+#include <messages/messages.h>
+
+#include <lib/prof-lean/hpcrun-sample-ring.h>
+#include <lib/prof-lean/stdatomic.h>
+
+
+//*********************************************************************
+// type declarations
+//*********************************************************************
+
+// bytes of records per thread
+#define STREAM_RING_SIZE  (4 * 1024 * 1024)
+
+#define STREAM_MAX_LM      65536
+#define STREAM_MAX_METRIC  4096
+
+// seconds an aggregator may take to write its pid into the lock file
+#define STREAM_LAUNCH_TIMEOUT  10
+
+#define BIT_WORDS(n)  ((n) / 64)
+
+struct sample_stream_s {
+  struct sample_stream_s *next;
+  _Atomic(int) attached;
+
+  hpcsring_t ring;
+
+  uint64_t lm_sent[BIT_WORDS(STREAM_MAX_LM)];
+  uint64_t metric_sent[BIT_WORDS(STREAM_MAX_METRIC)];
+};
+
+
+//*********************************************************************
+// local variables
+//*********************************************************************
+
+static bool streaming = false;
+
+// names the rings and the lock file of this measurement
+static char ring_key[32];
+
+// whether this process already looked for (or started) the aggregator
+static bool aggregator_checked = false;
+
+static _Atomic(struct sample_stream_s *) stream_list;
+
+
+//*********************************************************************
+// private operations
+//*********************************************************************
+
+static inline bool
+bit_test(const uint64_t *bits, unsigned i)
+{
+  return (bits[i / 64] >> (i % 64)) & 1;
+}
+
+
+static inline void
+bit_set(uint64_t *bits, unsigned i)
+{
+  bits[i / 64] |= ((uint64_t) 1) << (i % 64);
+}
+
+
+// FNV-1a, printed in hex
+static void
+make_key(const char *str, char *key, size_t len)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+
+  for (const unsigned char *p = (const unsigned char *) str; *p; p++) {
+    h ^= *p;
+    h *= 0x100000001b3ULL;
+  }
+  snprintf(key, len, "%016llx", (unsigned long long) h);
+}
+
+
+static void
+lock_file_name(char *buf, size_t len)
+{
+  snprintf(buf, len, "%s/%s%s.lock", HPCSRING_DIR, HPCSRING_PREFIX, ring_key);
+}
+
+
+// Returns: true if the lock file names a live aggregator, or one that
+// is still starting (no pid yet, and the file is recent).  An empty
+// lock file that is older was left by a launch that died before the
+// aggregator wrote its pid.
+static bool
+lock_is_live(const char *lock)
+{
+  char buf[32];
+  struct stat st;
+  int fd = open(lock, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  ssize_t n = read(fd, buf, sizeof(buf) - 1);
+  int stat_ret = fstat(fd, &st);
+  close(fd);
+  if (n <= 0) {
+    return stat_ret == 0
+      && time(NULL) - st.st_mtime < STREAM_LAUNCH_TIMEOUT;
+  }
+  buf[n] = '\0';
+
+  pid_t pid = (pid_t) atol(buf);
+  return pid > 0 && (kill(pid, 0) == 0 || errno != ESRCH);
+}
+
+
+//
+// Start hpcrun-aggregate unless the lock file says one is running.
+// The child forks again and exits, so the daemon is not our child
+// and is not waited for by the application.  The grandchild writes
+// its pid into the lock file before the exec.
+//
+static void
+launch_aggregator(void)
+{
+  char lock[PATH_MAX];
+  lock_file_name(lock, sizeof(lock));
+
+  int fd = open(lock, O_WRONLY | O_CREAT | O_EXCL, 0600);
+  if (fd < 0 && errno == EEXIST && !lock_is_live(lock)) {
+    // left behind by an aggregator that died
+    unlink(lock);
+    fd = open(lock, O_WRONLY | O_CREAT | O_EXCL, 0600);
+  }
+  if (fd < 0) {
+    TMSG(AGGREGATE, "aggregator already running (%s)", lock);
+    return;
+  }
+
+  char *cmd = getenv(HPCRUN_AGGREGATE_CMD);
+  if (cmd == NULL || cmd[0] == '\0') {
+    EMSG("AGGREGATE ERROR: unable to get %s", HPCRUN_AGGREGATE_CMD);
+    close(fd);
+    unlink(lock);
+    return;
+  }
+
+  pid_t pid = monitor_real_fork();
+  if (pid < 0) {
+    EMSG("AGGREGATE ERROR: aggregator launch failed: fork failed");
+    close(fd);
+    unlink(lock);
+    return;
+  }
+  else if (pid == 0) {
+    //
+    // child process: disable profiling, detach from the session and
+    // exec the aggregator from a grandchild.
+    //
+    hpcrun_set_disabled();
+    setsid();
+
+    pid_t gpid = monitor_real_fork();
+    if (gpid != 0) {
+      _exit(gpid < 0);
+    }
+
+    char pid_str[32];
+    int len = snprintf(pid_str, sizeof(pid_str), "%ld", (long) getpid());
+    if (write(fd, pid_str, len) != len) {
+      _exit(1);
+    }
+    close(fd);
+
+    // dup the hpcrun log file fd onto stdout and stderr.
+    dup2(messages_logfile_fd(), 1);
+    dup2(messages_logfile_fd(), 2);
+
+    char *arglist[10];
+    int j = 0;
+    arglist[j++] = cmd;
+    if (ENABLED(AGGREGATE)) {
+      arglist[j++] = "-v";
+    }
+    arglist[j++] = "-k";
+    arglist[j++] = ring_key;
+    arglist[j++] = "-o";
+    arglist[j++] = (char *) hpcrun_files_output_directory();
+    arglist[j++] = NULL;
+
+    monitor_real_execve(cmd, arglist, environ);
+    err(1, "hpcrun aggregator: exec(%s) failed", cmd);
+  }
+
+  //
+  // parent process: reap the intermediate child.
+  //
+  close(fd);
+  waitpid(pid, NULL, 0);
+  TMSG(AGGREGATE, "launched aggregator %s for key %s", cmd, ring_key);
+}
+
+
+static struct sample_stream_s *
+stream_alloc(void)
+{
+  struct sample_stream_s *s;
+
+  for (s = atomic_load(&stream_list); s; s = s->next) {
+    int expected = 0;
+    if (atomic_compare_exchange_strong(&s->attached, &expected, 1)) {
+      memset(s->lm_sent, 0, sizeof(s->lm_sent));
+      memset(s->metric_sent, 0, sizeof(s->metric_sent));
+      return s;
+    }
+  }
+
+  s = hpcrun_mmap_anon(sizeof(*s));
+  if (s == NULL) {
+    return NULL;
+  }
+  atomic_init(&s->attached, 1);
+
+  struct sample_stream_s *head = atomic_load(&stream_list);
+  do {
+    s->next = head;
+  } while (!atomic_compare_exchange_weak(&stream_list, &head, s));
+
+  return s;
+}
+
+
+// Returns: true if the aggregator knows load module 'id'.
+static bool
+send_loadmap(struct sample_stream_s *s, uint16_t id)
+{
+  if (id == HPCRUN_FMT_LMId_NULL || bit_test(s->lm_sent, id)) {
+    return true;
+  }
+
+  load_module_t *lm = hpcrun_loadmap_findById(id);
+  const char *name = (lm && lm->name) ? lm->name : "";
+  uint32_t name_len = strlen(name) + 1;
+
+  hpcsring_loadmap_t *rec =
+    hpcsring_reserve(&s->ring, HPCSRING_REC_LOADMAP,
+		     sizeof(*rec) + name_len);
+  if (rec == NULL) {
+    return false;
+  }
+  rec->id = id;
+  rec->name_len = name_len;
+  memcpy(rec + 1, name, name_len);
+  hpcsring_commit(&s->ring);
+
+  bit_set(s->lm_sent, id);
+  return true;
+}
+
+
+static char *
+copy_str(char *dst, const char *src)
+{
+  size_t len = strlen(src) + 1;
+  memcpy(dst, src, len);
+  return dst + len;
+}
+
+
+// Returns: true if the aggregator knows metric 'id'.
+static bool
+send_metric(struct sample_stream_s *s, int id)
+{
+  if (id < 0 || id >= STREAM_MAX_METRIC) {
+    return false;
+  }
+  if (bit_test(s->metric_sent, id)) {
+    return true;
+  }
+
+  metric_desc_t *desc = hpcrun_id2metric(id);
+  if (desc == NULL) {
+    return false;
+  }
+
+  const char *name = desc->name ? desc->name : "";
+  const char *descr = desc->description ? desc->description : "";
+  const char *formula = desc->formula ? desc->formula : "";
+  const char *format = desc->format ? desc->format : "";
+  uint32_t len = sizeof(hpcsring_metric_t)
+    + strlen(name) + strlen(descr) + strlen(formula) + strlen(format) + 4;
+
+  hpcsring_metric_t *rec =
+    hpcsring_reserve(&s->ring, HPCSRING_REC_METRIC, len);
+  if (rec == NULL) {
+    return false;
+  }
+  rec->id = id;
+  rec->is_frequency_metric = desc->is_frequency_metric;
+  rec->flags[0] = desc->flags.bits_big[0];
+  rec->flags[1] = desc->flags.bits_big[1];
+  rec->period = desc->period;
+
+  char *p = (char *) (rec + 1);
+  p = copy_str(p, name);
+  p = copy_str(p, descr);
+  p = copy_str(p, formula);
+  copy_str(p, format);
+  hpcsring_commit(&s->ring);
+
+  bit_set(s->metric_sent, id);
+  return true;
+}
+
+
+//*********************************************************************
+// interface operations
+//*********************************************************************
+
+void
+hpcrun_sample_stream_init(void)
+{
+  // forget the parent's streams after fork
+  atomic_store(&stream_list, NULL);
+  aggregator_checked = false;
+
+  streaming = (getenv(HPCRUN_AGGREGATE) != NULL);
+  if (streaming) {
+    make_key(hpcrun_files_output_directory(), ring_key, sizeof(ring_key));
+    TMSG(AGGREGATE, "streaming samples, key %s", ring_key);
+  }
+}
+
+
+bool
+hpcrun_sample_stream_isactive(void)
+{
+  return streaming;
+}
+
+
+void
+hpcrun_sample_stream_open(core_profile_trace_data_t *cptd)
+{
+  cptd->sample_stream = NULL;
+
+  if (!streaming || hpcrun_get_disabled() || !hpcrun_sample_prob_active()) {
+    return;
+  }
+
+  struct sample_stream_s *s = stream_alloc();
+  if (s == NULL) {
+    EMSG("AGGREGATE ERROR: out of memory for the sample stream");
+    return;
+  }
+
+  char path[PATH_MAX];
+  if (hpcsring_name(path, sizeof(path), ring_key, (long) getpid(), cptd->id)
+      || hpcsring_create(&s->ring, path, STREAM_RING_SIZE, (long) getpid(),
+			 cptd->id, hpcrun_files_executable_name()) != 0) {
+    EMSG("AGGREGATE ERROR: unable to create sample ring %s: %s",
+	 path, strerror(errno));
+    atomic_store(&s->attached, 0);
+    return;
+  }
+  cptd->sample_stream = s;
+
+  // The ring exists before we look at the lock file, so an aggregator
+  // that is about to exit for lack of rings will see it (see
+  // hpcrun-aggregate).
+  if (!aggregator_checked) {
+    aggregator_checked = true;
+    launch_aggregator();
+  }
+}
+
+
+void
+hpcrun_sample_stream_append(core_profile_trace_data_t *cptd,
+			    cct_node_t *node, int metric_id,
+			    hpcrun_metricVal_t incr)
+{
+  struct sample_stream_s *s = cptd->sample_stream;
+  if (s == NULL || node == NULL) {
+    return;
+  }
+
+  // Count the frames and make sure the aggregator knows their load
+  // modules.  Dummy nodes are left out, as when the CCT is written.
+  uint32_t nframes = 0;
+  for (cct_node_t *x = node; x; x = hpcrun_cct_parent(x)) {
+    if (hpcrun_cct_is_dummy(x)) {
+      continue;
+    }
+    if (!send_loadmap(s, hpcrun_cct_addr(x)->ip_norm.lm_id)) {
+      goto dropped;
+    }
+    nframes++;
+  }
+  if (!send_metric(s, metric_id)) {
+    goto dropped;
+  }
+
+  hpcsring_sample_t *rec =
+    hpcsring_reserve(&s->ring, HPCSRING_REC_SAMPLE,
+		     sizeof(*rec) + nframes * sizeof(hpcsring_frame_t));
+  if (rec == NULL) {
+    goto dropped;
+  }
+  rec->metric_id = metric_id;
+  rec->nframes = nframes;
+  rec->value = incr.bits;
+
+  // fill in from the leaf end
+  hpcsring_frame_t *frame = (hpcsring_frame_t *) (rec + 1) + nframes;
+  for (cct_node_t *x = node; x; x = hpcrun_cct_parent(x)) {
+    if (hpcrun_cct_is_dummy(x)) {
+      continue;
+    }
+    ip_normalized_t *ip = &hpcrun_cct_addr(x)->ip_norm;
+    frame--;
+    frame->lm_ip = (uint64_t) ip->lm_ip;
+    frame->lm_id = ip->lm_id;
+    frame->unused = 0;
+  }
+  hpcsring_commit(&s->ring);
+  return;
+
+ dropped:
+  hpcrun_stats_num_stream_samples_dropped_inc();
+}
+
+
+void
+hpcrun_sample_stream_close(core_profile_trace_data_t *cptd)
+{
+  struct sample_stream_s *s = cptd->sample_stream;
+  if (s == NULL) {
+    return;
+  }
+  cptd->sample_stream = NULL;
+
+  hpcsring_close(&s->ring);
+  atomic_store(&s->attached, 0);
+}
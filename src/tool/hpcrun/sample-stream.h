@@ -0,0 +1,92 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+
+//***************************************************************************
+//
+// File:
+//   sample-stream.h
+//
+// Purpose:
+//   Stream samples to the per-node aggregator (hpcrun --aggregate).
+//
+// Description:
+//   Each thread writes one compact record per sample (the metric, its
+//   increment and the call path as normalized IPs) into its own
+//   shared-memory ring (see lib/prof-lean/hpcrun-sample-ring.h).  The
+//   hpcrun-aggregate daemon, started by the first process on the node,
+//   drains the rings of all processes, merges the call paths into one
+//   CCT and writes one node-level profile.  The per-thread profiles
+//   are still written, so the two can be compared.
+//
+//***************************************************************************
+
+#ifndef hpcrun_sample_stream_h
+#define hpcrun_sample_stream_h
+
+#include <stdbool.h>
+
+#include "core_profile_trace_data.h"
+
+#include <cct/cct.h>
+#include <lib/prof-lean/hpcrun-fmt.h>
+
+// read HPCRUN_AGGREGATE and name this measurement's rings
+void hpcrun_sample_stream_init(void);
+
+bool hpcrun_sample_stream_isactive(void);
+
+// Create the thread's ring.  The first ring of a process also starts
+// the aggregator, unless one is already running for the measurement.
+void hpcrun_sample_stream_open(core_profile_trace_data_t *cptd);
+
+// Push the path from the root to 'node' and the sample's metric
+// increment.  Safe in signal handlers; drops the sample when the ring
+// is full.
+void hpcrun_sample_stream_append(core_profile_trace_data_t *cptd,
+				 cct_node_t *node, int metric_id,
+				 hpcrun_metricVal_t incr);
+
+void hpcrun_sample_stream_close(core_profile_trace_data_t *cptd);
+
+#endif // hpcrun_sample_stream_h
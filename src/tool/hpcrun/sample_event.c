@@ -64,6 +64,7 @@
 #include "epoch.h"
 #include "thread_data.h"
 #include "trace.h"
+#include "sample-stream.h"
 #include "handling_sample.h"
 #include "unwind.h"
 #include <utilities/arch/context-pc.h>
@@ -167,6 +168,7 @@ hpcrun_sample_callpath(void* context, int metricId,
 		       hpcrun_metricVal_t metricIncr,
 		       int skipInner, int isSync, sampling_info_t *data)
 {
+  uint64_t start = hpcrun_stats_cycles();
 
   sample_val_t ret;
   hpcrun_sample_val_init(&ret);
@@ -307,16 +309,28 @@ hpcrun_sample_callpath(void* context, int metricId,
     TMSG(TRACE, "Appended func_proxy node to trace");
   }
 
+  if (hpcrun_sample_stream_isactive()) {
+    hpcrun_sample_stream_append(&td->core_profile_trace_data, node,
+				metricId, metricIncr);
+  }
+
   hpcrun_clear_handling_sample(td);
   if (TD_GET(mem_low) || ENABLED(FLUSH_EVERY_SAMPLE)) {
     hpcrun_flush_epochs(&(TD_GET(core_profile_trace_data)));
     hpcrun_reclaim_freeable_mem();
   }
+  else if (hpcrun_flush_epochs_due(&(TD_GET(core_profile_trace_data)))) {
+    TD_GET(core_profile_trace_data.flush_pending) = true;
+  }
+  else if (hpcrun_epoch_prune_due(&(TD_GET(core_profile_trace_data)))) {
+    TD_GET(core_profile_trace_data.prune_pending) = true;
+  }
 #ifndef HPCRUN_STATIC_LINK
   hpcrun_dlopen_read_unlock();
 #endif
 
   TMSG(SAMPLE_CALLPATH,"done w sample, return %p", ret.sample_node);
+  hpcrun_stats_latency_add(NULL, HPCRUN_LATENCY_HANDLER, start);
   monitor_unblock_shootdown();
 
   return ret;
@@ -400,6 +414,12 @@ hpcrun_gen_thread_ctxt(void* context)
     hpcrun_flush_epochs(&(TD_GET(core_profile_trace_data)));
     hpcrun_reclaim_freeable_mem();
   }
+  else if (hpcrun_flush_epochs_due(&(TD_GET(core_profile_trace_data)))) {
+    TD_GET(core_profile_trace_data.flush_pending) = true;
+  }
+  else if (hpcrun_epoch_prune_due(&(TD_GET(core_profile_trace_data)))) {
+    TD_GET(core_profile_trace_data.prune_pending) = true;
+  }
 #ifndef HPCRUN_STATIC_LINK
   hpcrun_dlopen_read_unlock();
 #endif
@@ -65,6 +65,7 @@
 
 #include "thread_data.h"
 #include "trace.h"
+#include "hpcrun_stats.h"
 
 #include <lush/lush-pthread.h>
 #include <messages/messages.h>
@@ -117,6 +118,9 @@ hpcrun_set_thread_data(thread_data_t *td)
 {
   TMSG(THREAD_SPECIFIC,"setting td");
   pthread_setspecific(_hpcrun_key, (void *) td);
+
+  // a recycled td brings its stats block, a new one has none yet
+  hpcrun_stats_thread_bind(td ? td->core_profile_trace_data.stats : NULL);
 }
 
 
@@ -241,8 +245,14 @@ core_profile_trace_data_init(core_profile_trace_data_t * cptd, int id, cct_ctxt_
   // IO support
   // ----------------------------------------
   cptd->hpcrun_file  = NULL;
+  cptd->hpcrun_file_trace_time_offset = 0;
+  cptd->next_flush_time_us = 0;
+  cptd->next_prune_time_us = 0;
+  cptd->flush_pending = false;
+  cptd->prune_pending = false;
   cptd->trace_buffer = NULL;
   cptd->trace_outbuf = NULL;
+  cptd->sample_stream = NULL;
 
   // ----------------------------------------
   // perf event support
@@ -269,6 +279,7 @@ void
 hpcrun_thread_data_init(int id, cct_ctxt_t* thr_ctxt, int is_child, size_t n_sources)
 {
   hpcrun_meminfo_t memstore;
+  hpcrun_stats_thread_t *stats;
   thread_data_t* td = hpcrun_get_thread_data();
 
   // ----------------------------------------
@@ -276,13 +287,16 @@ hpcrun_thread_data_init(int id, cct_ctxt_t* thr_ctxt, int is_child, size_t n_sou
   // ----------------------------------------
 
   // Wipe the thread data with a bogus bit pattern, but save the
-  // memstore so we can reuse it in the child after fork.  This must
-  // come first.
+  // memstore so we can reuse it in the child after fork.  The stats
+  // block is kept the same way (thread data starts out zeroed).  This
+  // must come first.
   td->inside_hpcrun = 1;
   memstore = td->memstore;
+  stats = td->core_profile_trace_data.stats;
   memset(td, 0xfe, sizeof(thread_data_t));
   td->inside_hpcrun = 1;
   td->memstore = memstore;
+  td->core_profile_trace_data.stats = stats;
   hpcrun_make_memstore(&td->memstore, is_child);
   td->mem_low = 0;
 
@@ -290,6 +304,15 @@ hpcrun_thread_data_init(int id, cct_ctxt_t* thr_ctxt, int is_child, size_t n_sou
   // normalized thread id (monitor-generated)
   // ----------------------------------------
   core_profile_trace_data_init(&(td->core_profile_trace_data), id, thr_ctxt);
+  hpcrun_memstore_set_thread_id(&td->memstore, id);
+
+  // ----------------------------------------
+  // per-thread overhead counters
+  // ----------------------------------------
+  if (stats == NULL) {
+    td->core_profile_trace_data.stats = hpcrun_stats_thread_new();
+  }
+  hpcrun_stats_thread_bind(td->core_profile_trace_data.stats);
 
   // ----------------------------------------
   // blame shifting support
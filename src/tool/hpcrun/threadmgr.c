@@ -68,6 +68,7 @@
 #include "thread_data.h"
 #include "write_data.h"
 #include "trace.h"
+#include "sample-stream.h"
 #include "sample_sources_all.h"
 
 #include <lib/prof-lean/stdatomic.h>
@@ -164,6 +165,7 @@ allocate_and_init_thread_data(int id, cct_ctxt_t* thr_ctxt)
   // opening trace file
   // ----------------------------------------
   hpcrun_trace_open(&(data->core_profile_trace_data));
+  hpcrun_sample_stream_open(&(data->core_profile_trace_data));
 
   return data;
 }
@@ -173,6 +175,7 @@ finalize_thread_data(core_profile_trace_data_t *current_data)
 {
   hpcrun_write_profile_data( current_data );
   hpcrun_trace_close( current_data );
+  hpcrun_sample_stream_close( current_data );
 }
 
 
@@ -330,6 +333,7 @@ hpcrun_threadMgr_data_put( epoch_t *epoch, thread_data_t *data, int no_separator
 
     hpcrun_write_profile_data( &data->core_profile_trace_data );
     hpcrun_trace_close( &data->core_profile_trace_data );
+    hpcrun_sample_stream_close( &data->core_profile_trace_data );
 
     return;
   }
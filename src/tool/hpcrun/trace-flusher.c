@@ -0,0 +1,356 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   trace-flusher.c
+//
+// Purpose:
+//   Double-buffered trace output, written by a background thread.
+//
+// Description:
+//   Each half of a buffer is in one of four states.  The owning thread
+//   fills the current half (FILLING) and, when it is full, marks it FULL
+//   and switches to the other half, provided that one is FREE.  The
+//   flusher (or the owner, when detaching) claims a FULL half by moving
+//   it to WRITING, writes it, and frees it.  Since a half is only handed
+//   over when the other one is free, at most one half of a buffer is
+//   ever waiting, and records reach the sink in order.
+//
+//   Buffer structs are mmap'd, kept on a list and reused, never freed,
+//   so the flusher can walk the list without locks.  The data halves
+//   belong to the owner and are only touched while a half is claimed.
+//
+//***************************************************************************
+
+//*********************************************************************
+// global includes
+//*********************************************************************
+
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+
+
+//*********************************************************************
+// local includes
+//*********************************************************************
+
+#include "monitor.h"
+#include "hpcrun_stats.h"
+#include "trace-flusher.h"
+
+#include <memory/mmap.h>
+#include <messages/messages.h>
+
+#include <lib/prof-lean/stdatomic.h>
+
+
+//*********************************************************************
+// type declarations
+//*********************************************************************
+
+enum {
+  HALF_FREE,
+  HALF_FILLING,
+  HALF_FULL,
+  HALF_WRITING
+};
+
+struct trace_flusher_buf_s {
+  struct trace_flusher_buf_s *next;
+  _Atomic(int) attached;
+
+  hpcio_outbuf_write_fn_t *write_fn;
+  void *arg;
+
+  char *half[2];
+  size_t half_size;
+  size_t fill[2];
+  _Atomic(int) state[2];
+
+  // owner only
+  int active;
+  long dropped;
+
+  _Atomic(int) error;
+};
+
+
+//*********************************************************************
+// local variables
+//*********************************************************************
+
+// how long the flusher sleeps when it finds nothing to write
+#define FLUSHER_IDLE_NSEC  (2 * 1000 * 1000)
+
+static _Atomic(trace_flusher_buf_t *) buf_list = ATOMIC_VAR_INIT(NULL);
+
+static _Atomic(int) flusher_started = ATOMIC_VAR_INIT(0);
+
+
+//*********************************************************************
+// private operations
+//*********************************************************************
+
+// write one half if it is full.  returns 1 if it wrote, else 0.
+static int
+half_write(trace_flusher_buf_t *b, int h)
+{
+  int expect = HALF_FULL;
+
+  if (!atomic_compare_exchange_strong(&b->state[h], &expect, HALF_WRITING)) {
+    return 0;
+  }
+
+  size_t len = b->fill[h];
+  if (b->write_fn(b->arg, b->half[h], len) != (ssize_t) len) {
+    atomic_store(&b->error, 1);
+  }
+  b->fill[h] = 0;
+  atomic_store_explicit(&b->state[h], HALF_FREE, memory_order_release);
+
+  return 1;
+}
+
+
+// make sure half 'h' is written, by this thread if the flusher has
+// not claimed it yet, and wait until it is free again
+static void
+half_drain(trace_flusher_buf_t *b, int h)
+{
+  struct timespec idle = { 0, FLUSHER_IDLE_NSEC / 4 };
+
+  half_write(b, h);
+  while (atomic_load_explicit(&b->state[h], memory_order_acquire)
+	 != HALF_FREE) {
+    nanosleep(&idle, NULL);
+  }
+}
+
+
+static void *
+flusher_main(void *arg)
+{
+  // the flusher only does I/O; keep sampling signals off this thread
+  sigset_t all;
+  sigfillset(&all);
+  monitor_real_pthread_sigmask(SIG_BLOCK, &all, NULL);
+
+  struct timespec idle = { 0, FLUSHER_IDLE_NSEC };
+
+  for (;;) {
+    int n = 0;
+    trace_flusher_buf_t *b = atomic_load(&buf_list);
+    for (; b != NULL; b = b->next) {
+      if (atomic_load(&b->attached)) {
+	n += half_write(b, 0) + half_write(b, 1);
+      }
+    }
+    if (n == 0) {
+      nanosleep(&idle, NULL);
+    }
+  }
+
+  return NULL;
+}
+
+
+static int
+flusher_start(void)
+{
+  int expect = 0;
+
+  if (!atomic_compare_exchange_strong(&flusher_started, &expect, 1)) {
+    return 0;
+  }
+
+  // the flusher is not an application thread, don't let monitor see it
+  pthread_t thread;
+  monitor_disable_new_threads();
+  int ret = pthread_create(&thread, NULL, flusher_main, NULL);
+  monitor_enable_new_threads();
+
+  if (ret != 0) {
+    EMSG("unable to start the trace flusher thread");
+    atomic_store(&flusher_started, 0);
+    return -1;
+  }
+  pthread_detach(thread);
+
+  return 0;
+}
+
+
+static trace_flusher_buf_t *
+buf_acquire(void)
+{
+  // reuse the struct of a thread that has finished tracing
+  trace_flusher_buf_t *b = atomic_load(&buf_list);
+  for (; b != NULL; b = b->next) {
+    int expect = 0;
+    if (atomic_compare_exchange_strong(&b->attached, &expect, 1)) {
+      return b;
+    }
+  }
+
+  b = hpcrun_mmap_anon(sizeof(trace_flusher_buf_t));
+  if (b == NULL) {
+    return NULL;
+  }
+  memset(b, 0, sizeof(*b));
+  atomic_store(&b->attached, 1);
+
+  trace_flusher_buf_t *head = atomic_load(&buf_list);
+  do {
+    b->next = head;
+  } while (!atomic_compare_exchange_weak(&buf_list, &head, b));
+
+  return b;
+}
+
+
+//*********************************************************************
+// interface operations
+//*********************************************************************
+
+void
+hpcrun_trace_flusher_init(void)
+{
+  // after fork, the child has none of the parent's threads
+  trace_flusher_buf_t *b = atomic_load(&buf_list);
+  for (; b != NULL; b = b->next) {
+    atomic_store(&b->attached, 0);
+  }
+  atomic_store(&flusher_started, 0);
+}
+
+
+trace_flusher_buf_t *
+hpcrun_trace_flusher_attach(hpcio_outbuf_write_fn_t *write_fn, void *arg,
+			    void *buf, size_t size)
+{
+  if (write_fn == NULL || buf == NULL || size < 2) {
+    return NULL;
+  }
+  if (flusher_start() != 0) {
+    return NULL;
+  }
+
+  trace_flusher_buf_t *b = buf_acquire();
+  if (b == NULL) {
+    return NULL;
+  }
+
+  // the flusher ignores the halves until one is marked full
+  b->write_fn = write_fn;
+  b->arg = arg;
+  b->half_size = size / 2;
+  b->half[0] = (char *) buf;
+  b->half[1] = (char *) buf + b->half_size;
+  b->fill[0] = b->fill[1] = 0;
+  b->active = 0;
+  b->dropped = 0;
+  atomic_store(&b->error, 0);
+  atomic_store(&b->state[1], HALF_FREE);
+  atomic_store(&b->state[0], HALF_FILLING);
+
+  return b;
+}
+
+
+int
+hpcrun_trace_flusher_append(trace_flusher_buf_t *b, const void *data,
+			    size_t size)
+{
+  int a = b->active;
+
+  if (size > b->half_size - b->fill[a]) {
+    int other = 1 - a;
+    if (size > b->half_size
+	|| atomic_load_explicit(&b->state[other], memory_order_acquire)
+	   != HALF_FREE) {
+      // the flusher is behind; drop rather than wait
+      b->dropped++;
+      hpcrun_stats_num_trace_records_dropped_inc();
+      return -1;
+    }
+    atomic_store_explicit(&b->state[a], HALF_FULL, memory_order_release);
+    atomic_store_explicit(&b->state[other], HALF_FILLING, memory_order_relaxed);
+    b->active = a = other;
+  }
+
+  memcpy(b->half[a] + b->fill[a], data, size);
+  b->fill[a] += size;
+
+  return 0;
+}
+
+
+int
+hpcrun_trace_flusher_detach(trace_flusher_buf_t *b)
+{
+  int a = b->active;
+
+  // the older half first, then whatever is in the current one
+  half_drain(b, 1 - a);
+  atomic_store_explicit(&b->state[a], HALF_FULL, memory_order_release);
+  half_drain(b, a);
+
+  int ret = atomic_load(&b->error) ? -1 : 0;
+  atomic_store(&b->attached, 0);
+
+  return ret;
+}
+
+
+long
+hpcrun_trace_flusher_dropped(trace_flusher_buf_t *b)
+{
+  return b->dropped;
+}
@@ -0,0 +1,95 @@
+// -*-Mode: C++;-*- // technically C99
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+
+//***************************************************************************
+//
+// File:
+//   trace-flusher.h
+//
+// Purpose:
+//   Double-buffered trace output, written by a background thread.
+//
+// Description:
+//   Each traced thread appends records to one half of its trace buffer.
+//   When that half fills, it is handed to a single process-wide flusher
+//   thread and the other half becomes current.  Appends only copy
+//   memory, so the sample handler never enters the kernel.  If the
+//   flusher has not finished with the other half yet, the record is
+//   dropped and counted instead of blocking the handler.
+//
+//***************************************************************************
+
+#ifndef hpcrun_trace_flusher_h
+#define hpcrun_trace_flusher_h
+
+#include <stddef.h>
+
+#include <lib/prof-lean/hpcio-buffer.h>
+
+typedef struct trace_flusher_buf_s trace_flusher_buf_t;
+
+// forget all buffers and the flusher thread (e.g., in a forked child)
+void hpcrun_trace_flusher_init(void);
+
+// Hand 'buf' (split into two halves) to the flusher.  Full halves are
+// passed whole to 'write_fn', which must take all of the data.
+// Returns NULL if out of memory or the flusher cannot be started.
+trace_flusher_buf_t *
+hpcrun_trace_flusher_attach(hpcio_outbuf_write_fn_t *write_fn, void *arg,
+			    void *buf, size_t size);
+
+// Copy one record into the current half.  Safe in signal handlers.
+// Returns 0, or -1 if the record was dropped.
+int hpcrun_trace_flusher_append(trace_flusher_buf_t *b, const void *data,
+				size_t size);
+
+// Write out everything still buffered, from the calling thread, and
+// release 'b'.  Returns 0 if all of the data was written, else -1.
+int hpcrun_trace_flusher_detach(trace_flusher_buf_t *b);
+
+// number of records 'b' has dropped
+long hpcrun_trace_flusher_dropped(trace_flusher_buf_t *b);
+
+#endif // hpcrun_trace_flusher_h
@@ -48,8 +48,11 @@
 // global includes 
 //*********************************************************************
 
+#include <errno.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <sys/time.h>
+#include <unistd.h>
 #include <assert.h>
 #include <limits.h>
 
@@ -67,8 +70,10 @@
 #include "rank.h"
 #include "string.h"
 #include "trace.h"
+#include "trace-flusher.h"
 #include "thread_data.h"
 #include "sample_prob.h"
+#include "hpcrun_stats.h"
 
 #include <memory/hpcrun-malloc.h>
 #include <messages/messages.h>
@@ -90,6 +95,9 @@
 //*********************************************************************
 
 static void hpcrun_trace_file_validate(int valid, char *op);
+static ssize_t trace_fd_write(void *fd, const void *data, size_t size);
+static ssize_t trace_stream_write(void *stream, const void *data, size_t size);
+static int trace_stream_close(void *stream);
 static inline void hpcrun_trace_append_with_time_real(core_profile_trace_data_t *cptd, unsigned int call_path_id, uint metric_id, uint32_t dLCA, uint64_t nanotime);
 
 
@@ -99,6 +107,10 @@ static inline void hpcrun_trace_append_with_time_real(core_profile_trace_data_t
 
 static int tracing = 0;
 
+// hand full trace buffers to a flusher thread instead of writing them
+// from the sampling thread
+static int use_flusher = 0;
+
 //*********************************************************************
 // interface operations
 //*********************************************************************
@@ -117,6 +129,9 @@ hpcrun_trace_init()
       tracing = 1;
       TMSG(TRACE, "Tracing is ON");
   }
+
+  use_flusher = (getenv(HPCRUN_TRACE_FLUSHER) != NULL);
+  hpcrun_trace_flusher_init();
 }
 
 
@@ -135,16 +150,37 @@ hpcrun_trace_open(core_profile_trace_data_t * cptd)
 	
     TMSG(TRACE, "Hit active portion");
     int fd, ret;
+    hpcio_outbuf_write_fn_t *sink_write;
+    void *sink_arg;
 
     // I think unlocked is ok here (we don't overlap any system
     // locks).  At any rate, locks only protect against threads, they
     // don't help with signal handlers (that's much harder).
-    fd = hpcrun_open_trace_file(cptd->id);
-    hpcrun_trace_file_validate(fd >= 0, "open");
     cptd->trace_buffer = hpcrun_malloc(HPCRUN_TraceBufferSz);
-    ret = hpcio_outbuf_attach(&cptd->trace_outbuf, fd, cptd->trace_buffer,
-			      HPCRUN_TraceBufferSz, HPCIO_OUTBUF_UNLOCKED,
-                              hpcrun_malloc);
+    hpccont_stream_t *stream = NULL;
+    if (hpcrun_files_use_container()) {
+      stream = hpcrun_open_trace_stream(cptd->id);
+    }
+    if (stream != NULL) {
+      // each flush becomes one write to the stream, so container
+      // extents hold whole trace records
+      sink_write = trace_stream_write;
+      sink_arg = stream;
+      ret = hpcio_outbuf_attach_sink(&cptd->trace_outbuf,
+				     trace_stream_write, trace_stream_close,
+				     stream, cptd->trace_buffer,
+				     HPCRUN_TraceBufferSz, HPCIO_OUTBUF_UNLOCKED,
+				     hpcrun_malloc);
+    }
+    else {
+      fd = hpcrun_open_trace_file(cptd->id);
+      hpcrun_trace_file_validate(fd >= 0, "open");
+      sink_write = trace_fd_write;
+      sink_arg = (void *) (intptr_t) fd;
+      ret = hpcio_outbuf_attach(&cptd->trace_outbuf, fd, cptd->trace_buffer,
+				HPCRUN_TraceBufferSz, HPCIO_OUTBUF_UNLOCKED,
+				hpcrun_malloc);
+    }
     hpcrun_trace_file_validate(ret == HPCFMT_OK, "open");
 
     hpctrace_hdr_flags_t flags = hpctrace_hdr_flags_NULL;
@@ -163,6 +199,27 @@ hpcrun_trace_open(core_profile_trace_data_t * cptd)
     
     ret = hpctrace_fmt_hdr_outbuf(flags, cptd->trace_outbuf);
     hpcrun_trace_file_validate(ret == HPCFMT_OK, "write header to");
+
+    cptd->trace_flusher = NULL;
+    if (use_flusher && sink_write == trace_stream_write) {
+      // A container stream must be written by its own thread: extents
+      // come from that thread's memory store, and the container's final
+      // directory walk does not lock out other writers.
+      TMSG(TRACE, "trace flusher not used with a trace container");
+    }
+    else if (use_flusher) {
+      // Write the header now.  The outbuf stays empty from here on, and
+      // the flusher reuses the trace buffer as its two halves.  The
+      // outbuf is kept only to close the file or stream.
+      ret = hpcio_outbuf_flush(cptd->trace_outbuf);
+      hpcrun_trace_file_validate(ret == HPCFMT_OK, "write header to");
+      cptd->trace_flusher =
+	hpcrun_trace_flusher_attach(sink_write, sink_arg, cptd->trace_buffer,
+				    HPCRUN_TraceBufferSz);
+      if (cptd->trace_flusher == NULL) {
+	EMSG("unable to attach trace flusher, writing trace synchronously");
+      }
+    }
   }
   TMSG(TRACE, "Trace open done");
 }
@@ -221,13 +278,25 @@ hpcrun_trace_close(core_profile_trace_data_t * cptd)
   if (tracing && hpcrun_sample_prob_active()) {
 
     TMSG(TRACE, "Trace active close code");
+    if (cptd->trace_flusher != NULL) {
+      if (hpcrun_trace_flusher_detach(cptd->trace_flusher) != 0) {
+	EMSG("unable to write trace records from the flusher");
+      }
+      long dropped = hpcrun_trace_flusher_dropped(cptd->trace_flusher);
+      if (dropped > 0) {
+	EMSG("dropped %ld trace records while the flusher was behind", dropped);
+      }
+      cptd->trace_flusher = NULL;
+    }
+
     int ret = hpcio_outbuf_close(&cptd->trace_outbuf);
     if (ret != HPCFMT_OK) {
       EMSG("unable to flush and close trace file");
     }
 
+    // container streams are named when the container is closed
     int rank = hpcrun_get_rank();
-    if (rank >= 0) {
+    if (rank >= 0 && !hpcrun_files_use_container()) {
       hpcrun_rename_trace_file(rank, cptd->id);
     }
   }
@@ -240,6 +309,8 @@ hpcrun_trace_close(core_profile_trace_data_t * cptd)
 
 static inline void hpcrun_trace_append_with_time_real(core_profile_trace_data_t *cptd, unsigned int call_path_id, uint metric_id, uint32_t dLCA, uint64_t nanotime)
 {
+    uint64_t start = hpcrun_stats_cycles();
+
     if (cptd->trace_min_time_us == 0) {
         cptd->trace_min_time_us = nanotime;
     }
@@ -276,8 +347,55 @@ static inline void hpcrun_trace_append_with_time_real(core_profile_trace_data_t
     HPCTRACE_HDR_FLAGS_SET_BIT(flags, HPCTRACE_HDR_FLAGS_LCA_RECORDED_BIT_POS, false);
 #endif
     
-    int ret = hpctrace_fmt_datum_outbuf(&trace_datum, flags, cptd->trace_outbuf);
-    hpcrun_trace_file_validate(ret == HPCFMT_OK, "append");
+    if (cptd->trace_flusher != NULL) {
+      // never enters the kernel; a record the flusher has no room for is
+      // counted and dropped
+      unsigned char buf[sizeof(hpctrace_fmt_datum_t)];
+      int len = hpctrace_fmt_datum_encode(&trace_datum, flags, buf);
+      hpcrun_trace_flusher_append(cptd->trace_flusher, buf, len);
+    }
+    else {
+      int ret = hpctrace_fmt_datum_outbuf(&trace_datum, flags, cptd->trace_outbuf);
+      hpcrun_trace_file_validate(ret == HPCFMT_OK, "append");
+    }
+
+    hpcrun_stats_latency_add(cptd->stats, HPCRUN_LATENCY_TRACE_APPEND, start);
+}
+
+
+// flusher sink for trace files
+static ssize_t
+trace_fd_write(void *fd, const void *data, size_t size)
+{
+  size_t amt_done = 0;
+
+  while (amt_done < size) {
+    errno = 0;
+    ssize_t ret = write((int) (intptr_t) fd, (const char *) data + amt_done,
+			size - amt_done);
+    if (ret > 0) {
+      amt_done += ret;
+    }
+    else if (!(ret < 0 && errno == EINTR)) {
+      return -1;
+    }
+  }
+  return amt_done;
+}
+
+
+// hpcio_outbuf (and flusher) sink for container streams
+static ssize_t
+trace_stream_write(void *stream, const void *data, size_t size)
+{
+  return hpccont_stream_write((hpccont_stream_t *) stream, data, size);
+}
+
+
+static int
+trace_stream_close(void *stream)
+{
+  return hpccont_stream_close((hpccont_stream_t *) stream);
 }
 
 
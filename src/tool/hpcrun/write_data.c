@@ -50,7 +50,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <setjmp.h>
+#include <sys/time.h>
 
 //*****************************************************************************
 // local includes
@@ -68,6 +70,8 @@
 #include "loadmap.h"
 #include "sample_prob.h"
 #include "cct/cct_bundle.h"
+#include "env.h"
+#include "hpcrun_stats.h"
 
 #include <messages/messages.h>
 
@@ -90,12 +94,70 @@ static epoch_flags_t epoch_flags = {
 
 static const uint64_t default_measurement_granularity = 1;
 
+// period between incremental epoch flushes (0 = only at exit)
+static uint64_t flush_interval_us = 0;
+
+// write CCT nodes in the compact encoding (HPCRUN_COMPACT_CCT)
+static bool compact_cct = false;
+
+// width of the trace time nv-pair values when they must be patched at
+// close: wide enough for any 64-bit integer in base 10
+#define TRACE_TIME_WIDTH 20
+
+// holds an hpcrun-stats or hpcrun-latency-* epoch nv-pair value
+#define STATS_STR_LEN 1024
+
 
 
 //*****************************************************************************
 // local utilities
 //*****************************************************************************
 
+static uint64_t
+time_now_us(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return ((uint64_t) tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+
+// When a profile file is opened before the end of execution (an
+// incremental flush), the trace time range is not yet known.  The
+// header then carries space-padded values of fixed width (the reader's
+// strtoull skips leading blanks) that are overwritten in place when the
+// file is closed.  The trace-max-time pair is the last in the header, so
+// both values lie at fixed distances from the end of the header.
+static void
+patch_trace_times(core_profile_trace_data_t * cptd, FILE* fs)
+{
+  long hdr_end = cptd->hpcrun_file_trace_time_offset;
+  if (hdr_end <= 0)
+    return;
+
+  long max_pos = hdr_end - TRACE_TIME_WIDTH;
+  long min_pos = max_pos - (long) sizeof(uint32_t)
+    - (long) strlen(HPCRUN_FMT_NV_traceMaxTime) - (long) sizeof(uint32_t)
+    - TRACE_TIME_WIDTH;
+
+  char buf[TRACE_TIME_WIDTH + 1];
+
+  fflush(fs);
+  long end = ftell(fs);
+
+  snprintf(buf, sizeof(buf), "%*"PRIu64, TRACE_TIME_WIDTH,
+           cptd->trace_min_time_us);
+  if (fseek(fs, min_pos, SEEK_SET) == 0) {
+    fwrite(buf, 1, TRACE_TIME_WIDTH, fs);
+  }
+  snprintf(buf, sizeof(buf), "%*"PRIu64, TRACE_TIME_WIDTH,
+           cptd->trace_max_time_us);
+  if (fseek(fs, max_pos, SEEK_SET) == 0) {
+    fwrite(buf, 1, TRACE_TIME_WIDTH, fs);
+  }
+  fseek(fs, end, SEEK_SET);
+}
+
 
 //***************************************************************************
 //
@@ -134,7 +196,7 @@ static const uint64_t default_measurement_granularity = 1;
 //***************************************************************************
 
 static FILE *
-lazy_open_data_file(core_profile_trace_data_t * cptd)
+lazy_open_data_file(core_profile_trace_data_t * cptd, bool final)
 {
   FILE* fs = cptd->hpcrun_file;
   if (fs) {
@@ -145,8 +207,18 @@ lazy_open_data_file(core_profile_trace_data_t * cptd)
   if (rank < 0) {
     rank = 0;
   }
-  int fd = hpcrun_open_profile_file(rank, cptd->id);
-  fs = fdopen(fd, "w");
+  hpccont_stream_t *stream = NULL;
+  if (hpcrun_files_use_container()) {
+    stream = hpcrun_open_profile_stream(rank, cptd->id);
+  }
+  if (stream != NULL) {
+    // seekable, so patch_trace_times works as with a file
+    fs = hpccont_stream_fopen_w(stream);
+  }
+  else {
+    int fd = hpcrun_open_profile_file(rank, cptd->id);
+    fs = fdopen(fd, "w");
+  }
   if (fs == NULL) {
     EEMSG("HPCToolkit: %s: unable to open profile file", __func__);
     return NULL;
@@ -176,11 +248,17 @@ lazy_open_data_file(core_profile_trace_data_t * cptd)
   char pidStr[bufSZ];
   snprintf(pidStr, bufSZ, "%u", OSUtil_pid());
 
+  // an incremental flush reserves fixed-width trace times (see
+  // patch_trace_times)
+  int timeWidth = final ? 0 : TRACE_TIME_WIDTH;
+
   char traceMinTimeStr[bufSZ];
-  snprintf(traceMinTimeStr, bufSZ, "%"PRIu64, cptd->trace_min_time_us);
+  snprintf(traceMinTimeStr, bufSZ, "%*"PRIu64, timeWidth,
+           cptd->trace_min_time_us);
 
   char traceMaxTimeStr[bufSZ];
-  snprintf(traceMaxTimeStr, bufSZ, "%"PRIu64, cptd->trace_max_time_us);
+  snprintf(traceMaxTimeStr, bufSZ, "%*"PRIu64, timeWidth,
+           cptd->trace_max_time_us);
 
   //
   // ==== file hdr =====
@@ -199,6 +277,10 @@ lazy_open_data_file(core_profile_trace_data_t * cptd)
 			HPCRUN_FMT_NV_traceMinTime, traceMinTimeStr,
 			HPCRUN_FMT_NV_traceMaxTime, traceMaxTimeStr,
                         NULL);
+
+  if (! final) {
+    cptd->hpcrun_file_trace_time_offset = ftell(fs);
+  }
   return fs;
 }
 
@@ -249,11 +331,30 @@ write_epochs(FILE* fs, core_profile_trace_data_t * cptd, epoch_t* epoch)
 
     epoch_flags.fields.isLogicalUnwind = hpcrun_isLogicalUnwind();
     TMSG(LUSH,"epoch lush flag set to %s", epoch_flags.fields.isLogicalUnwind ? "true" : "false");
+    epoch_flags.fields.isCompactCCT = compact_cct;
     
     TMSG(DATA_WRITE,"epoch flags = %"PRIx64"", epoch_flags.bits);
+
+    // the thread's own overhead so far
+    char statsStr[STATS_STR_LEN];
+    char latStr[HPCRUN_LATENCY_NUM][STATS_STR_LEN];
+    hpcrun_stats_thread_str(cptd->stats, statsStr, STATS_STR_LEN);
+    for (int k = 0; k < HPCRUN_LATENCY_NUM; k++) {
+      hpcrun_stats_latency_str(cptd->stats, k, latStr[k], STATS_STR_LEN);
+    }
+
     hpcrun_fmt_epochHdr_fwrite(fs, epoch_flags,
 			       default_measurement_granularity,
 			       "TODO:epoch-name","TODO:epoch-value",
+			       HPCRUN_FMT_NV_stats, statsStr,
+			       HPCRUN_FMT_NV_latHandler,
+			       latStr[HPCRUN_LATENCY_HANDLER],
+			       HPCRUN_FMT_NV_latUnwind,
+			       latStr[HPCRUN_LATENCY_UNWIND],
+			       HPCRUN_FMT_NV_latCCTInsert,
+			       latStr[HPCRUN_LATENCY_CCT_INSERT],
+			       HPCRUN_FMT_NV_latTraceAppend,
+			       latStr[HPCRUN_LATENCY_TRACE_APPEND],
 			       NULL);
 
     //
@@ -320,14 +421,104 @@ write_epochs(FILE* fs, core_profile_trace_data_t * cptd, epoch_t* epoch)
 
 
 void
-hpcrun_flush_epochs(core_profile_trace_data_t * cptd)
+hpcrun_flush_epochs_init(void)
+{
+  char *str = getenv(HPCRUN_FLUSH_INTERVAL);
+  if (str != NULL) {
+    double sec = strtod(str, NULL);
+    if (sec > 0) {
+      flush_interval_us = (uint64_t) (sec * 1000000);
+    }
+    else {
+      EMSG("ignoring invalid %s: %s", HPCRUN_FLUSH_INTERVAL, str);
+    }
+  }
+  TMSG(DATA_WRITE, "epoch flush interval = %"PRIu64" us", flush_interval_us);
+}
+
+
+void
+hpcrun_write_data_init(void)
 {
-  FILE *fs = lazy_open_data_file(cptd);
+  char *str = getenv(HPCRUN_COMPACT_CCT);
+  compact_cct = (str != NULL && atoi(str) != 0);
+  TMSG(DATA_WRITE, "compact cct records = %d", compact_cct);
+}
+
+
+//
+// Called at the end of a sample, which then leaves the flush to the
+// thread's next safe point (see hpcrun_epoch_safe_point).  Returns true
+// once per flush interval.  The first call only arms the deadline, so
+// that short runs keep writing a single epoch at exit.
+//
+bool
+hpcrun_flush_epochs_due(core_profile_trace_data_t * cptd)
+{
+  if (flush_interval_us == 0)
+    return false;
+
+  uint64_t now = time_now_us();
+  if (cptd->next_flush_time_us == 0) {
+    cptd->next_flush_time_us = now + flush_interval_us;
+    return false;
+  }
+  if (now < cptd->next_flush_time_us)
+    return false;
+
+  cptd->next_flush_time_us = now + flush_interval_us;
+  return true;
+}
+
+
+//
+// Append the current epoch to the profile file.  The reader merges all
+// epochs of a file into a single profile, so the data written here is
+// combined with later flushes and with the final write at exit.
+//
+static bool
+flush_epochs_write(core_profile_trace_data_t * cptd)
+{
+  FILE *fs = lazy_open_data_file(cptd, false);
   if (fs == NULL)
-    return;
+    return false;
 
   write_epochs(fs, cptd, cptd->epoch);
+  fflush(fs);
+  return true;
+}
+
+
+//
+// Flush the epochs and start a new one with an empty CCT (low memory,
+// or flush after every sample).  The flushed CCT is kept, since the
+// sample that triggered the flush may still hold its nodes.
+//
+void
+hpcrun_flush_epochs(core_profile_trace_data_t * cptd)
+{
+  if (! flush_epochs_write(cptd))
+    return;
+
   hpcrun_epoch_reset();
+
+  // metrics of the flushed CCT are no longer reachable: start the new
+  // epoch with an empty map so that its lookups do not pay for them.
+  hpcrun_cct2metrics_init(&(cptd->cct2metrics_map));
+}
+
+
+//
+// Periodic flush (see hpcrun_flush_epochs_due), run at a safe point:
+// the flushed CCT and its metrics are recycled.
+//
+void
+hpcrun_flush_epochs_recycle(core_profile_trace_data_t * cptd)
+{
+  if (! flush_epochs_write(cptd))
+    return;
+
+  hpcrun_epoch_recycle(cptd);
 }
 
 int
@@ -336,11 +527,12 @@ hpcrun_write_profile_data(core_profile_trace_data_t * cptd)
   if(cptd->scale_fn) cptd->scale_fn((void*)cptd);
 
   TMSG(DATA_WRITE,"Writing hpcrun profile data");
-  FILE* fs = lazy_open_data_file(cptd);
+  FILE* fs = lazy_open_data_file(cptd, true);
   if (fs == NULL)
     return HPCRUN_ERR;
 
   write_epochs(fs, cptd, cptd->epoch);
+  patch_trace_times(cptd, fs);
 
   TMSG(DATA_WRITE,"closing file");
   hpcio_fclose(fs);
@@ -47,10 +47,20 @@
 #ifndef WRITE_DATA_H
 #define WRITE_DATA_H
 
+#include <stdbool.h>
+
 #include "epoch.h"
 #include "core_profile_trace_data.h"
 
 extern int hpcrun_write_profile_data(core_profile_trace_data_t * cptd);
+
+// profile encoding options, controlled by HPCRUN_COMPACT_CCT
+extern void hpcrun_write_data_init(void);
 extern void hpcrun_flush_epochs(core_profile_trace_data_t * cptd);
 
+// periodic flushing of epochs, controlled by HPCRUN_FLUSH_INTERVAL
+extern void hpcrun_flush_epochs_init(void);
+extern bool hpcrun_flush_epochs_due(core_profile_trace_data_t * cptd);
+extern void hpcrun_flush_epochs_recycle(core_profile_trace_data_t * cptd);
+
 #endif // WRITE_DATA_H
@@ -71,6 +71,7 @@ using std::string;
 #include <include/hpctoolkit-config.h>
 
 #include "Args.hpp"
+#include "Constants.hpp"
 
 #include <lib/analysis/Util.hpp>
 
@@ -110,8 +111,11 @@ hpctraceviewer client to specify and access any database that hpcserver can read
 Options: General\n\
   -V, --version        Print version information.\n\
   -h, --help           Print this help.\n\
-  -c, --compression    Enables or disables compression (on by default)\n\
-                       Allowed values: on off \n\
+  -c, --compression    Sets how the trace lines are encoded when the viewer\n\
+                           supports it (deflate by default). 'fast' trades\n\
+                           ratio for speed and 'varint' only packs the\n\
+                           numbers, for fast links.\n\
+                       Allowed values: on off deflate fast varint none\n\
   -p, --port           Sets the main communication port (default is 21590)\n\
                            Specifying 0 indicates that an open port should be \n\
                            chosen automatically.\n\
@@ -120,6 +124,18 @@ Options: General\n\
                            indicates that the port will be auto-negotiated with\n\
                            the client. Specifying 1 indicates that the xml will\n\
                            be transferred on the main data port.\n\
+  -t, --threads        Sets the number of threads used to sample and compress\n\
+                           timelines in the single-node server (default is\n\
+                           the number of online processors).\n\
+  -l, --lod            Sets the number of buckets in the finest level of the\n\
+                           trace summary used to answer zoomed-out requests.\n\
+                           The summary is built next to the database on first\n\
+                           use. Specifying 0 (the default) disables it.\n\
+  -m, --connections    Sets the number of viewers that can be connected at\n\
+                           the same time (default is 1). Viewers connect to\n\
+                           the main port, and the server exits once all of\n\
+                           them have disconnected. Only the first viewer\n\
+                           receives the XML on the port given by --xmlport.\n\
 \n\
 ";
 
@@ -149,6 +165,12 @@ CmdLineParser::OptArgDesc Args::optArgs[] = {
      CLP::isOptArg_long },
   {  'x' , "xmlport",       CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
      CLP::isOptArg_long },
+  {  't' , "threads",       CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
+     CLP::isOptArg_long },
+  {  'l' , "lod",       CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
+     CLP::isOptArg_long },
+  {  'm' , "connections",       CLP::ARG_REQ,  CLP::DUPOPT_CLOB, NULL,
+     CLP::isOptArg_long },
   CmdLineParser_OptArgDesc_NULL_MACRO // SGI's compiler requires this version
 };
 
@@ -175,9 +197,12 @@ Args::Args(int argc, const char* const argv[])
 void
 Args::Ctor()
 {
-  compression = true;
+  compression = TraceviewerServer::COMPRESSION_DEFLATE;
   mainPort = DEFAULT_PORT;//21590
   xmlPort = 0;
+  numThreads = 0;
+  lodBuckets = 0;
+  maxConnections = 1;
 }
 
 
@@ -256,7 +281,18 @@ Args::parse(int argc, const char* const argv[])
     // Check for other options: Communication options
     if (parser.isOpt("compression")) {
       const string& arg = parser.getOptArg("compression");
-      compression = CmdLineParser::parseArg_bool(arg, "--compression option");
+      if (arg == "deflate")
+        compression = TraceviewerServer::COMPRESSION_DEFLATE;
+      else if (arg == "fast")
+        compression = TraceviewerServer::COMPRESSION_DEFLATE_FAST;
+      else if (arg == "varint")
+        compression = TraceviewerServer::COMPRESSION_VARINT;
+      else if (arg == "none")
+        compression = TraceviewerServer::COMPRESSION_NONE;
+      else if (CmdLineParser::parseArg_bool(arg, "--compression option"))
+        compression = TraceviewerServer::COMPRESSION_DEFLATE;
+      else
+        compression = TraceviewerServer::COMPRESSION_NONE;
     }
     if (parser.isOpt("port")) {
       const string& arg = parser.getOptArg("port");
@@ -270,6 +306,24 @@ Args::parse(int argc, const char* const argv[])
       if (xmlPort < 1024 && xmlPort > 1)
     	   ARG_ERROR("Ports must be greater than 1024.")
     }
+    if (parser.isOpt("threads")) {
+      const string& arg = parser.getOptArg("threads");
+      numThreads = (int) CmdLineParser::toLong(arg);
+      if (numThreads < 1)
+         ARG_ERROR("The number of threads must be at least 1.")
+    }
+    if (parser.isOpt("lod")) {
+      const string& arg = parser.getOptArg("lod");
+      lodBuckets = (int) CmdLineParser::toLong(arg);
+      if (lodBuckets < 0)
+         ARG_ERROR("The number of summary buckets cannot be negative.")
+    }
+    if (parser.isOpt("connections")) {
+      const string& arg = parser.getOptArg("connections");
+      maxConnections = (int) CmdLineParser::toLong(arg);
+      if (maxConnections < 1)
+         ARG_ERROR("The number of connections must be at least 1.")
+    }
   }
   catch (const CmdLineParser::ParseError& x) {
     ARG_ERROR(x.what());
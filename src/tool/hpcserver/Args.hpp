@@ -112,7 +112,10 @@ public:
   // Parsed Data: optional arguments
   int mainPort;       // default: 21590
   int xmlPort;        // default: 0
-  bool compression;   // default: true
+  int compression;    // default: deflate (a TraceviewerServer::CompressionType)
+  int numThreads;     // default: 0 (number of online processors)
+  int lodBuckets;     // default: 0 (no trace summary)
+  int maxConnections; // default: 1
 
 private:
   void
@@ -60,6 +60,9 @@
 #include "BaseDataFile.hpp"
 #include "Constants.hpp"
 #include "DebugUtils.hpp"
+#include "MergeDataFiles.hpp"
+
+#include <vector>
 
 using namespace std;
 
@@ -69,7 +72,10 @@ namespace TraceviewerServer
 // Global variables
 //-----------------------------------------------------------
 
-
+	pthread_mutex_t BaseDataFile::indexLock = PTHREAD_MUTEX_INITIALIZER;
+	string BaseDataFile::indexedPath;
+	vector<char> BaseDataFile::indexedHeader;
+	vector<FileSegment> BaseDataFile::indexedSegments;
 
 
 	BaseDataFile::BaseDataFile(string _filename, int _headerSize)
@@ -100,11 +106,68 @@ namespace TraceviewerServer
 	}
 
 	/***
-	 * set the data to the specified file
+	 * Size of the data behind path, as it would be if it were one merged file.
+	 * Returns 0 for a directory without trace files.
+	 */
+	FileOffset BaseDataFile::getDataSize(string path)
+	{
+		if (!FileUtils::isDir(path))
+			return FileUtils::getFileSize(path);
+
+		FileOffset size = 0;
+		pthread_mutex_lock(&indexLock);
+		if (indexDirectory(path))
+		{
+			size = indexedHeader.size() + SIZEOF_LONG;//The end of file marker
+			for (unsigned int i = 0; i < indexedSegments.size(); i++)
+				size += indexedSegments[i].size;
+		}
+		pthread_mutex_unlock(&indexLock);
+		return size;
+	}
+
+	/***
+	 * Index the trace files of a database directory, unless it is the
+	 * directory indexed last. DBOpener sizes the data before it is opened,
+	 * and both need the same index, which means listing the directory and
+	 * reading every container's directory. Called with indexLock held.
+	 */
+	bool BaseDataFile::indexDirectory(string path)
+	{
+		if (path == indexedPath)
+			return true;
+
+		indexedPath.clear();
+		indexedHeader.clear();
+		indexedSegments.clear();
+		if (MergeDataFiles::index(path, "*.hpctrace", &indexedHeader, &indexedSegments) == FAIL_NO_DATA)
+			return false;
+		indexedPath = path;
+		return true;
+	}
+
+	/***
+	 * set the data to the specified file. If filename is a database
+	 * directory, its trace files are read in place as if they had been
+	 * merged.
 	 */
 	void BaseDataFile::setData(string filename, int headerSize)
 	{
-		masterBuff = new LargeByteBuffer(filename, headerSize);
+		if (FileUtils::isDir(filename))
+		{
+			pthread_mutex_lock(&indexLock);
+			indexDirectory(filename);
+			masterBuff = new LargeByteBuffer(indexedHeader, indexedSegments, headerSize);
+
+			// the buffer has its own copy: index again if the directory
+			// is opened again, since its trace files may have changed
+			indexedPath.clear();
+			vector<char>().swap(indexedHeader);
+			vector<FileSegment>().swap(indexedSegments);
+			pthread_mutex_unlock(&indexLock);
+		}
+		else
+			masterBuff = new LargeByteBuffer(filename, headerSize);
 
 		FileOffset currentPos = 0;
 		type = masterBuff->getInt(currentPos);
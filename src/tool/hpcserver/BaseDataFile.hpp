@@ -63,6 +63,9 @@
 using namespace std;
 
 #include <string>
+#include <vector>
+
+#include <pthread.h>
 
 #include "FileUtils.hpp" // For FileOffset
 #include "LargeByteBuffer.hpp"
@@ -82,6 +85,7 @@ public:
 	OffsetPair* getOffsets();
 	LargeByteBuffer* getMasterBuffer();
 	void setData(string, int);
+	static FileOffset getDataSize(string);
 
 	bool isMultiProcess();
 	bool isMultiThreading();
@@ -95,6 +99,16 @@ private:
 	int numFiles;
 
 	OffsetPair* offsets;
+
+	// index of the database directory last sized by getDataSize, kept for
+	// setData so that a directory is indexed once when it is opened.
+	// Connections open databases concurrently: hold indexLock while
+	// using the index.
+	static bool indexDirectory(string);
+	static pthread_mutex_t indexLock;
+	static string indexedPath;
+	static vector<char> indexedHeader;
+	static vector<FileSegment> indexedSegments;
 };
 
 } /* namespace TraceviewerServer */
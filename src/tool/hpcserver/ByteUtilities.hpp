@@ -70,6 +70,7 @@ namespace TraceviewerServer
 	class ByteUtilities
 	{
 	public:
+		static const int MAX_VARINT_LENGTH = 10;
 
 		static short readShort(char* buffer)
 		{
@@ -119,6 +120,33 @@ namespace TraceviewerServer
 			buffer[6] = (utoWrite & MASK_1) >> 8;
 			buffer[7] = utoWrite & MASK_0;
 		}
+		//Writes ToWrite zigzag-encoded (so that small negative numbers stay
+		//small) as a base-128 varint, low 7 bits first. Returns the number
+		//of bytes used, which is at most MAX_VARINT_LENGTH.
+		static int writeVarLong(char* buffer, int64_t ToWrite)
+		{
+			uint64_t utoWrite = ((uint64_t) ToWrite << 1) ^ (uint64_t) (ToWrite >> 63);
+			int length = 0;
+			while (utoWrite >= 0x80)
+			{
+				buffer[length++] = (char) ((utoWrite & 0x7F) | 0x80);
+				utoWrite >>= 7;
+			}
+			buffer[length++] = (char) utoWrite;
+			return length;
+		}
+		//The inverse of writeVarLong. The number of bytes read is stored in length.
+		static int64_t readVarLong(char* buffer, int* length)
+		{
+			unsigned char* uBuffer = (unsigned char*) buffer;
+			uint64_t uread = 0;
+			int i = 0;
+			do
+				uread |= ((uint64_t) (uBuffer[i] & 0x7F)) << (7 * i);
+			while (uBuffer[i++] & 0x80);
+			*length = i;
+			return (int64_t) (uread >> 1) ^ -(int64_t) (uread & 1);
+		}
 		static Long convertDoubleToLong(double d)
 		{
 			union { double d; Long l;} dbLgConv;
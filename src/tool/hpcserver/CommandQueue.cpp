@@ -0,0 +1,208 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Reads the commands of a connection ahead of the one being executed.
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+#include "CommandQueue.hpp"
+#include "Constants.hpp"
+#include "DebugUtils.hpp"
+
+#include <iostream>
+
+namespace TraceviewerServer
+{
+	using namespace std;
+
+	CommandQueue::CommandQueue(DataSocketStream* _socket, bool _cancellable)
+	{
+		socket = _socket;
+		cancellable = _cancellable;
+		reading = true;
+		numRead = 0;
+		cancelledBefore = 0;
+
+		pthread_mutex_init(&lock, NULL);
+		pthread_cond_init(&commandRead, NULL);
+		pthread_create(&reader, NULL, readCommands, this);
+	}
+
+	CommandQueue::~CommandQueue()
+	{
+		//The reader stops by itself after DONE, OPEN or an error. If the
+		//connection is being abandoned for some other reason, it has to be
+		//woken up.
+		pthread_mutex_lock(&lock);
+		bool stillReading = reading;
+		pthread_mutex_unlock(&lock);
+		if (stillReading)
+			socket->closeInput();
+
+		pthread_join(reader, NULL);
+		pthread_cond_destroy(&commandRead);
+		pthread_mutex_destroy(&lock);
+	}
+
+	void* CommandQueue::readCommands(void* arg)
+	{
+		CommandQueue* queue = (CommandQueue*) arg;
+		bool done = false;
+		while (!done)
+		{
+			Command command;
+			try
+			{
+				command = queue->readCommand(queue->socket->readInt());
+			}
+			catch (ErrorCode& e)
+			{
+				command.type = 0;
+				command.error = e;
+			}
+
+			pthread_mutex_lock(&queue->lock);
+			command.id = queue->numRead++;
+			switch (command.type)
+			{
+				case DATA:
+					if (queue->cancellable)
+						queue->cancelledBefore = command.id;
+					queue->commands.push_back(command);
+					break;
+				case CNCL:
+					if (queue->cancellable)
+					{
+						DEBUGCOUT(1) << "Data requests cancelled" << endl;
+						queue->cancelledBefore = command.id;
+						break;
+					}
+					//An unknown command for this client
+					queue->commands.push_back(command);
+					done = true;
+					break;
+				case FLTR:
+					queue->commands.push_back(command);
+					break;
+				default:
+					//DONE, OPEN, or something the connection cannot go on after
+					queue->commands.push_back(command);
+					done = true;
+					break;
+			}
+			if (done)
+				queue->reading = false;
+			pthread_cond_signal(&queue->commandRead);
+			pthread_mutex_unlock(&queue->lock);
+		}
+		return NULL;
+	}
+
+	//Reads the parameters of a command whose header has been read
+	Command CommandQueue::readCommand(int type)
+	{
+		Command command;
+		command.type = type;
+		command.error = 0;
+		if (type == DATA)
+		{
+			command.processStart = socket->readInt();
+			command.processEnd = socket->readInt();
+			command.timeStart = socket->readLong();
+			command.timeEnd = socket->readLong();
+			command.verticalResolution = socket->readInt();
+			command.horizontalResolution = socket->readInt();
+		}
+		else if (type == FLTR)
+		{
+			socket->readByte();//Padding
+			command.excludeMatches = socket->readByte();
+			int count = socket->readShort();
+			for (int i = 0; i < count; ++i)
+			{
+				BinaryRepresentationOfFilter filt;
+				filt.processMin = socket->readInt();
+				filt.processMax = socket->readInt();
+				filt.processStride = socket->readInt();
+				filt.threadMin = socket->readInt();
+				filt.threadMax = socket->readInt();
+				filt.threadStride = socket->readInt();
+				command.filters.push_back(filt);
+			}
+		}
+		return command;
+	}
+
+	Command CommandQueue::next()
+	{
+		pthread_mutex_lock(&lock);
+		while (commands.empty())
+			pthread_cond_wait(&commandRead, &lock);
+		Command command = commands.front();
+		commands.pop_front();
+		pthread_mutex_unlock(&lock);
+		return command;
+	}
+
+	//Whether a newer request or a CNCL command has been read since request
+	bool CommandQueue::isCancelled(const Command& request)
+	{
+		pthread_mutex_lock(&lock);
+		bool cancelled = request.id < cancelledBefore;
+		pthread_mutex_unlock(&lock);
+		return cancelled;
+	}
+
+} /* namespace TraceviewerServer */
@@ -0,0 +1,129 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Reads the commands of a connection ahead of the one being executed.
+//
+// Description:
+//   A thread reads each command and its parameters from the socket as soon
+//   as it arrives, so that a new data request can cancel the one that is
+//   still being sent. The connection executes the commands in order.
+//
+//***************************************************************************
+
+#ifndef COMMANDQUEUE_HPP_
+#define COMMANDQUEUE_HPP_
+
+#include "DataSocketStream.hpp"
+#include "Filter.hpp"
+#include "TimeCPID.hpp" //For Time
+
+#include <pthread.h>
+#include <deque>
+#include <vector>
+
+namespace TraceviewerServer
+{
+	using namespace std;
+
+	struct Command
+	{
+		//One of the headers in Constants.hpp, or 0 if the socket failed
+		int type;
+		//The order in which the command was read
+		Long id;
+		//The exception reading the command threw, if type is 0
+		int error;
+
+		//DATA
+		int processStart;
+		int processEnd;
+		Time timeStart;
+		Time timeEnd;
+		int verticalResolution;
+		int horizontalResolution;
+
+		//FLTR
+		bool excludeMatches;
+		vector<BinaryRepresentationOfFilter> filters;
+	};
+
+	class CommandQueue
+	{
+	public:
+		//If cancellable, every DATA or CNCL command cancels the data
+		//requests read before it
+		CommandQueue(DataSocketStream* socket, bool cancellable);
+		virtual ~CommandQueue();
+
+		//Blocks until the next command has been read
+		Command next();
+		bool isCancelled(const Command& request);
+
+	private:
+		static void* readCommands(void* queue);
+		Command readCommand(int type);
+
+		DataSocketStream* socket;
+		bool cancellable;
+
+		pthread_t reader;
+		pthread_mutex_t lock;
+		pthread_cond_t commandRead;
+		deque<Command> commands;
+		bool reading;
+		Long numRead;
+		//Data requests with a smaller id have been cancelled
+		Long cancelledBefore;
+	};
+
+} /* namespace TraceviewerServer */
+#endif /* COMMANDQUEUE_HPP_ */
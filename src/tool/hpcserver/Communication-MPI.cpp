@@ -88,7 +88,7 @@ void Communication::sendParseInfo(Time minBegTime, Time maxEndTime, int headerSi
 
 }
 
-void Communication::sendParseOpenDB(string pathToDB)
+void Communication::sendParseOpenDB(string pathToDB, int compressionType)
 {
 	MPICommunication::CommandMessage cmdPathToDB;
 	cmdPathToDB.command = OPEN;
@@ -99,6 +99,7 @@ void Communication::sendParseOpenDB(string pathToDB)
 	}
 	copy(pathToDB.begin(), pathToDB.end(), cmdPathToDB.ofile.path);
 	cmdPathToDB.ofile.path[pathToDB.size()] = '\0';
+	cmdPathToDB.ofile.compressionType = compressionType;
 
 	COMM_WORLD.Bcast(&cmdPathToDB, sizeof(cmdPathToDB), MPI_PACKED,
 			MPICommunication::SOCKET_SERVER);
@@ -118,12 +119,15 @@ void Communication::sendStartGetData(SpaceTimeDataController* contr, int process
 	COMM_WORLD.Bcast(&toBcast, sizeof(toBcast), MPI_PACKED,
 		MPICommunication::SOCKET_SERVER);
 }
-void Communication::sendEndGetData(DataSocketStream* stream, ProgressBar* prog, SpaceTimeDataController* controller)
+bool Communication::sendEndGetData(DataSocketStream* stream, ProgressBar* prog, SpaceTimeDataController* controller,
+		CommandQueue* commands, const Command& request)
 {
 	int ranksDone = 1;//1 for the MPI rank that deals with the sockets
 	int size = COMM_WORLD.Get_size();
 
 	bool first = false;
+	//The slaves still send every line, but they are no longer passed on
+	bool cancelled = false;
 
 	while (ranksDone < size)
 	{
@@ -136,16 +140,21 @@ void Communication::sendEndGetData(DataSocketStream* stream, ProgressBar* prog,
 				LOGTIMESTAMPEDMSG("First line computed.")
 			}
 
+			char CompressedTraceLine[msg.data.compressedSize];
+			COMM_WORLD.Recv(CompressedTraceLine, msg.data.compressedSize, MPI_BYTE, msg.data.rankID,
+					MPI_ANY_TAG);
+
+			if (!cancelled)
+				cancelled = commands->isCancelled(request);
+			if (cancelled)
+				continue;
+
 			stream->writeInt(msg.data.line);
 			stream->writeInt(msg.data.entries);
 			stream->writeLong(msg.data.begtime); // Begin time
 			stream->writeLong(msg.data.endtime); //End time
 			stream->writeInt(msg.data.compressedSize);
 
-			char CompressedTraceLine[msg.data.compressedSize];
-			COMM_WORLD.Recv(CompressedTraceLine, msg.data.compressedSize, MPI_BYTE, msg.data.rankID,
-					MPI_ANY_TAG);
-
 			stream->writeRawData(CompressedTraceLine, msg.data.compressedSize);
 
 			stream->flush();
@@ -167,6 +176,7 @@ void Communication::sendEndGetData(DataSocketStream* stream, ProgressBar* prog,
 		}
 	}
 	LOGTIMESTAMPEDMSG("All data done.")
+	return !cancelled;
 }
 void Communication::sendStartFilter(int count, bool excludeMatches)
 {
@@ -204,7 +214,15 @@ void Communication::run()
 	int rank;
 	rank = MPI::COMM_WORLD.Get_rank();
 	if (rank == TraceviewerServer::MPICommunication::SOCKET_SERVER)
+	{
+		//The slaves work on one view at a time
+		if (maxConnections > 1)
+		{
+			cerr << "Only one viewer can be connected to the MPI server" << endl;
+			maxConnections = 1;
+		}
 		TraceviewerServer::Server();
+	}
 	else
 		TraceviewerServer::Slave();
 }
@@ -58,6 +58,10 @@
 //***************************************************************************
 
 #include <stdint.h>                     // for uint64_t
+#include <pthread.h>                    // for pthread_create, etc
+#include <unistd.h>                     // for sysconf
+#include <algorithm>                    // for min
+#include <deque>                        // for deque
 #include <iostream>                     // for operator<<, basic_ostream, etc
 #include <string>                       // for string
 #include <vector>                       // for vector, vector<>::iterator
@@ -83,7 +87,7 @@ void Communication::sendParseInfo(uint64_t minBegTime, uint64_t maxEndTime, int
 {//Do nothing
 }
 
-void Communication::sendParseOpenDB(string pathToDB) {}
+void Communication::sendParseOpenDB(string pathToDB, int compressionType) {}
 
 void Communication::sendStartGetData(SpaceTimeDataController* contr, int processStart, int processEnd,
 			Time timeStart, Time timeEnd, int verticalResolution, int horizontalResolution)
@@ -101,47 +105,192 @@ void Communication::sendStartGetData(SpaceTimeDataController* contr, int process
 
 
 }
-void Communication::sendEndGetData(DataSocketStream* stream, ProgressBar* prog, SpaceTimeDataController* controller)
+// A timeline that has been read in and compressed, waiting to be written
+// to the socket.
+struct EncodedLine
 {
-	// TODO: Make this so that the Lines get sent as soon as they are
-	// filled.
+	int line;
+	int numEntries;
+	Time begTime;
+	Time endTime;
+	DataCompressionLayer* compr;
+};
 
-	controller->fillTraces();
-	for (int i = 0; i < controller->tracesLength; i++)
+// Work shared between the sampling threads and the thread writing to the
+// socket. Threads claim the next unclaimed line, and finished lines are
+// queued in the order they complete. Threads stop claiming lines once the
+// request is cancelled.
+struct LineQueue
+{
+	SpaceTimeDataController* controller;
+	CommandQueue* commands;
+	const Command* request;
+	pthread_mutex_t lock;
+	pthread_cond_t lineDone;
+	int nextLine;
+	int numRunning;
+	deque<EncodedLine> done;
+};
+
+static EncodedLine encodeLine(ProcessTimeline* timeline, SpaceTimeDataController* controller)
+{
+	timeline->readInData();
+
+	vector<TimeCPID>& data = *timeline->data->listCPID;
+	DEBUGCOUT(2) << "Sending process timeline with " << data.size() << " entries" << endl;
+
+	EncodedLine out;
+	out.line = timeline->line();
+	out.numEntries = data.size();
+	out.begTime = data[0].timestamp;
+	out.endTime = data[data.size() - 1].timestamp;
+	out.compr = controller->linePool.get(controller->compressionType);
+
+	vector<TimeCPID>::iterator it;
+	Time currentTime = data[0].timestamp;
+	for (it = data.begin(); it != data.end(); ++it)
 	{
+		out.compr->writeInt( (int)(it->timestamp - currentTime));
+		out.compr->writeInt( it->cpid);
+		currentTime = it->timestamp;
+	}
+	out.compr->flush();
+	return out;
+}
+
+static void writeLine(DataSocketStream* stream, EncodedLine& out, LineBufferPool* pool)
+{
+	stream->writeInt( out.line);
+	stream->writeInt( out.numEntries);
+	// Begin time
+	stream->writeLong( out.begTime);
+	//End time
+	stream->writeLong( out.endTime);
 
-		ProcessTimeline* timeline = controller->traces[i];
-		stream->writeInt( timeline->line());
-		vector<TimeCPID> data = *timeline->data->listCPID;
-		stream->writeInt( data.size());
-		// Begin time
-		stream->writeLong( data[0].timestamp);
-		//End time
-		stream->writeLong( data[data.size() - 1].timestamp);
+	int outputBufferLen = out.compr->getOutputLength();
+	char* outputBuffer = (char*)out.compr->getOutputBuffer();
 
-		DataCompressionLayer comprStr;
+	stream->writeInt(outputBufferLen);
 
-		vector<TimeCPID>::iterator it;
-		DEBUGCOUT(2) << "Sending process timeline with " << data.size() << " entries" << endl;
+	stream->writeRawData(outputBuffer, outputBufferLen);
+	pool->put(out.compr);
+}
 
+static void* sampleLines(void* arg)
+{
+	LineQueue* queue = (LineQueue*) arg;
+	SpaceTimeDataController* controller = queue->controller;
+
+	while (true)
+	{
+		pthread_mutex_lock(&queue->lock);
+		int i = queue->nextLine++;
+		pthread_mutex_unlock(&queue->lock);
+		if (i >= controller->tracesLength || queue->commands->isCancelled(*queue->request))
+			break;
 
-		Time currentTime = data[0].timestamp;
-		for (it = data.begin(); it != data.end(); ++it)
+		EncodedLine out = encodeLine(controller->traces[i], controller);
+
+		pthread_mutex_lock(&queue->lock);
+		queue->done.push_back(out);
+		pthread_cond_signal(&queue->lineDone);
+		pthread_mutex_unlock(&queue->lock);
+	}
+
+	pthread_mutex_lock(&queue->lock);
+	queue->numRunning--;
+	pthread_cond_signal(&queue->lineDone);
+	pthread_mutex_unlock(&queue->lock);
+	return NULL;
+}
+
+static int getNumSamplingThreads(int numLines)
+{
+	long n = numThreads;
+	if (n < 1)
+		n = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n < 1)
+		n = 1;
+	return (int) min(n, (long) numLines);
+}
+
+bool Communication::sendEndGetData(DataSocketStream* stream, ProgressBar* prog, SpaceTimeDataController* controller,
+		CommandQueue* commands, const Command& request)
+{
+	controller->createTraces();
+	int numLines = controller->tracesLength;
+	int nThreads = getNumSamplingThreads(numLines);
+
+	if (nThreads <= 1)
+	{
+		for (int i = 0; i < numLines; i++)
 		{
-			comprStr.writeInt( (int)(it->timestamp - currentTime));
-			comprStr.writeInt( it->cpid);
-			currentTime = it->timestamp;
+			if (commands->isCancelled(request))
+			{
+				stream->flush();
+				return false;
+			}
+			EncodedLine out = encodeLine(controller->traces[i], controller);
+			writeLine(stream, out, &controller->linePool);
+			prog->incrementProgress();
 		}
-		comprStr.flush();
-		int outputBufferLen = comprStr.getOutputLength();
-		char* outputBuffer = (char*)comprStr.getOutputBuffer();
+		stream->flush();
+		return true;
+	}
+
+	// Lines are tagged with their line number, so they are sent as soon as
+	// they are ready rather than in order.
+	LineQueue queue;
+	queue.controller = controller;
+	queue.commands = commands;
+	queue.request = &request;
+	queue.nextLine = 0;
+	queue.numRunning = nThreads;
+	pthread_mutex_init(&queue.lock, NULL);
+	pthread_cond_init(&queue.lineDone, NULL);
 
-		stream->writeInt(outputBufferLen);
+	vector<pthread_t> threads(nThreads);
+	for (int t = 0; t < nThreads; t++)
+		pthread_create(&threads[t], NULL, sampleLines, &queue);
 
-		stream->writeRawData(outputBuffer, outputBufferLen);
+	DEBUGCOUT(1) << "Sampling " << numLines << " lines with " << nThreads << " threads" << endl;
+
+	bool cancelled = false;
+	for (int sent = 0; sent < numLines && !cancelled; sent++)
+	{
+		pthread_mutex_lock(&queue.lock);
+		while (queue.done.empty() && queue.numRunning > 0)
+			pthread_cond_wait(&queue.lineDone, &queue.lock);
+		if (queue.done.empty())
+		{//Every thread stopped early
+			pthread_mutex_unlock(&queue.lock);
+			cancelled = true;
+			break;
+		}
+		EncodedLine out = queue.done.front();
+		queue.done.pop_front();
+		pthread_mutex_unlock(&queue.lock);
+
+		if (commands->isCancelled(request))
+		{
+			controller->linePool.put(out.compr);
+			cancelled = true;
+			break;
+		}
+		writeLine(stream, out, &controller->linePool);
 		prog->incrementProgress();
 	}
+
+	for (int t = 0; t < nThreads; t++)
+		pthread_join(threads[t], NULL);
+	//Lines that were finished after the request was cancelled
+	for (deque<EncodedLine>::iterator it = queue.done.begin(); it != queue.done.end(); ++it)
+		controller->linePool.put(it->compr);
+	pthread_cond_destroy(&queue.lineDone);
+	pthread_mutex_destroy(&queue.lock);
+
 	stream->flush();
+	return !cancelled;
 }
 
 void Communication::sendStartFilter(int count, bool excludeMatches)
@@ -64,6 +64,7 @@
 #include <string>
 
 #include "TimeCPID.hpp" //For Time
+#include "CommandQueue.hpp"
 #include "ProgressBar.hpp"
 #include "SpaceTimeDataController.hpp"
 #include "DataSocketStream.hpp"
@@ -81,10 +82,12 @@ class Communication {
 public:
 
 	static void sendParseInfo(Time minBegTime, Time maxEndTime, int headerSize);
-	static void sendParseOpenDB(string pathToDB);
+	static void sendParseOpenDB(string pathToDB, int compressionType);
 	static void sendStartGetData(SpaceTimeDataController* contr, int processStart, int processEnd,
 			Time timeStart, Time timeEnd, int verticalResolution, int horizontalResolution);
-	static void sendEndGetData(DataSocketStream* stream, ProgressBar* prog, SpaceTimeDataController* controller);
+	//Returns false if request was cancelled before all of the lines were sent
+	static bool sendEndGetData(DataSocketStream* stream, ProgressBar* prog, SpaceTimeDataController* controller,
+			CommandQueue* commands, const Command& request);
 	static void sendStartFilter(int count, bool excludeMatches);
 	static void sendFilter(BinaryRepresentationOfFilter filt);
 
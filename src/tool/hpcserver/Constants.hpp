@@ -76,6 +76,8 @@ namespace TraceviewerServer
 
 	static const int DEFAULT_PORT = 21590;
 	static const unsigned int MAX_DB_PATH_LENGTH = 1023;
+	//Sent instead of a line number to end the reply to a cancelled request
+	static const int CANCELLED_LINE = -1;
 
 enum DatabaseType {
 	MULTI_PROCESSES = 1,
@@ -92,10 +94,22 @@ enum Header {
 	NODB = 0x4E4F4442,
 	EXML = 0x45584D4C,
 	FLTR = 0x464C5452,
+	CNCL = 0x434E434C,
 	SLAVE_REPLY = 0x534C5250,
 	SLAVE_DONE = 0x534C444E
 };
 
+//How the samples of each line in a reply to DATA are encoded. The server
+//picks one of the codecs the client says it can decode and sends it in DBOK.
+enum CompressionType {
+	COMPRESSION_NONE = 0,
+	COMPRESSION_DEFLATE = 1,
+	//Deflate at its fastest level, for when the link is faster than zlib
+	COMPRESSION_DEFLATE_FAST = 2,
+	//Each delta timestamp and cpid as a zigzag varint, not compressed further
+	COMPRESSION_VARINT = 3
+};
+
 enum ServerNextAction {
 	CLOSE_SERVER = 0,
 	START_NEW_CONNECTION_IMMEDIATELY=1
@@ -58,6 +58,7 @@
 //***************************************************************************
 #include <cstdio>
 
+#include "BaseDataFile.hpp"
 #include "DBOpener.hpp"
 #include "DebugUtils.hpp"
 #include "MergeDataFiles.hpp"
@@ -77,10 +78,9 @@ namespace TraceviewerServer
 
 	DBOpener::~DBOpener()
 	{
-		//stdcl, which is the only dynamically allocated thing, gets closed later because
+		//The controller, which is the only dynamically allocated thing, gets closed later because
 		//it makes sense to have it persist even after the opener.
 	}
-	SpaceTimeDataController* stdcl;
 	SpaceTimeDataController* DBOpener::openDbAndCreateStdc(string pathToDB)
 	{
 		FileData location;
@@ -93,8 +93,7 @@ namespace TraceviewerServer
 		if (!hasDatabase)
 			return NULL;
 
-		stdcl = new SpaceTimeDataController(ptrLocation);
-		return stdcl;
+		return new SpaceTimeDataController(ptrLocation);
 	}
 	/****
 	 * Check if the directory is correct or not. If it is correct, it returns
@@ -136,29 +135,45 @@ namespace TraceviewerServer
 
 					DEBUGCOUT(2) <<"\tTrying to open "<<outputFile<<endl;
 
-					MergeDataAttribute att = MergeDataFiles::merge(directory, "*.hpctrace",
-							outputFile);
-
-					DEBUGCOUT(2) <<"\tMerge resulted in "<<att<<endl;
-
-					if (att != FAIL_NO_DATA)
+					// A database that has already been merged is read as is.
+					// Otherwise the trace files are read in place: BaseDataFile
+					// indexes the directory and concatenates its trace files
+					// virtually, so nothing is copied.
+					FileOffset traceSize = 0;
+					if (FileUtils::exists(outputFile)
+							&& MergeDataFiles::isMergedFileCorrect(&outputFile))
+					{
+						location->fileTrace = outputFile;
+						traceSize = FileUtils::getFileSize(outputFile);
+					}
+					else if ((traceSize = BaseDataFile::getDataSize(directory)) > 0)
+					{
+						DEBUGCOUT(2) <<"\tReading trace files in place"<<endl;
+						location->fileTrace = directory;
+					}
+					else if (FileUtils::exists(outputFile))
 					{
+						// the file exists but corrupted.
+						cout << "Database file may be corrupted. Continuing" << endl;
 						location->fileTrace = outputFile;
-						if (FileUtils::getFileSize(location->fileTrace) > MIN_TRACE_SIZE)
-						{
-							return true;
-						}
-						else
-						{
-							cerr << "Warning! Trace file " << location->fileTrace << "is too small: "
-									<< FileUtils::getFileSize(location->fileTrace) << " bytes." << endl;
-							return false;
-						}
+						traceSize = FileUtils::getFileSize(outputFile);
 					}
 					else
 					{
 						cerr << "Error: trace file(s) does not exist or fail to open "
 								<< outputFile << endl;
+						return false;
+					}
+
+					if (traceSize > MIN_TRACE_SIZE)
+					{
+						return true;
+					}
+					else
+					{
+						cerr << "Warning! Trace file " << location->fileTrace << "is too small: "
+								<< traceSize << " bytes." << endl;
+						return false;
 					}
 
 				} catch (int err)
@@ -72,9 +72,17 @@ namespace TraceviewerServer
 
 	DataCompressionLayer::DataCompressionLayer()
 	{
+		init(COMPRESSION_DEFLATE, NULL);
+	}
 
-		//See: http://www.zlib.net/zpipe.c
+	DataCompressionLayer::DataCompressionLayer(CompressionType _type)
+	{
+		init(_type, NULL);
+	}
 
+	DataCompressionLayer::DataCompressionLayer(z_stream customCompressor, ProgressBar* _progMonitor)
+	{
+		type = COMPRESSION_DEFLATE;
 		bufferIndex = 0;
 		posInCompBuffer = 0;
 
@@ -82,50 +90,88 @@ namespace TraceviewerServer
 		outBuf = new unsigned char[BUFFER_SIZE];
 		outBufferCurrentSize = BUFFER_SIZE;
 
-		progMonitor = NULL;
-
-		compressor.zalloc = Z_NULL;
-		compressor.zfree = Z_NULL;
-		compressor.opaque = Z_NULL;
-		int ret = deflateInit(&compressor, -1);
-		if (ret != Z_OK)
-			throw ret;
-
+		progMonitor = _progMonitor;
+		compressor = customCompressor;
 	}
 
-	DataCompressionLayer::DataCompressionLayer(z_stream customCompressor, ProgressBar* _progMonitor)
+	void DataCompressionLayer::init(CompressionType _type, ProgressBar* _progMonitor)
 	{
+
+		//See: http://www.zlib.net/zpipe.c
+
+		type = _type;
 		bufferIndex = 0;
 		posInCompBuffer = 0;
 
-		inBuf = new char[BUFFER_SIZE];
+		inBuf = deflating() ? new char[BUFFER_SIZE] : NULL;
 		outBuf = new unsigned char[BUFFER_SIZE];
 		outBufferCurrentSize = BUFFER_SIZE;
 
 		progMonitor = _progMonitor;
-		compressor = customCompressor;
+
+		if (!deflating())
+			return;
+
+		compressor.zalloc = Z_NULL;
+		compressor.zfree = Z_NULL;
+		compressor.opaque = Z_NULL;
+		int level = (type == COMPRESSION_DEFLATE_FAST) ? Z_BEST_SPEED : Z_DEFAULT_COMPRESSION;
+		int ret = deflateInit(&compressor, level);
+		if (ret != Z_OK)
+			throw ret;
+
+	}
+
+	bool DataCompressionLayer::deflating()
+	{
+		return (type == COMPRESSION_DEFLATE) || (type == COMPRESSION_DEFLATE_FAST);
 	}
 
 	void DataCompressionLayer::writeInt(int toWrite)
 	{
-		makeRoom(4);
-		ByteUtilities::writeInt(inBuf + bufferIndex, toWrite);
-		bufferIndex += 4;
-		pInc(4);
+		if (type == COMPRESSION_VARINT)
+		{
+			writeLong(toWrite);
+			return;
+		}
+		ByteUtilities::writeInt(nextWrite(4), toWrite);
+		wrote(4);
 	}
 	void DataCompressionLayer::writeLong(uint64_t toWrite)
 	{
-		makeRoom(8);
-		ByteUtilities::writeLong(inBuf + bufferIndex, toWrite);
-		bufferIndex += 8;
-		pInc(8);
+		if (type == COMPRESSION_VARINT)
+		{
+			char* pos = nextWrite(ByteUtilities::MAX_VARINT_LENGTH);
+			wrote(ByteUtilities::writeVarLong(pos, toWrite));
+			return;
+		}
+		ByteUtilities::writeLong(nextWrite(8), toWrite);
+		wrote(8);
 	}
 	void DataCompressionLayer::writeDouble(double toWrite)
 	{
-		makeRoom(8);
-		ByteUtilities::writeLong(inBuf + bufferIndex, ByteUtilities::convertDoubleToLong(toWrite));
-		bufferIndex += 8;
-		pInc(8);
+		ByteUtilities::writeLong(nextWrite(8), ByteUtilities::convertDoubleToLong(toWrite));
+		wrote(8);
+	}
+	char* DataCompressionLayer::nextWrite(int count)
+	{
+		if (deflating())
+		{
+			makeRoom(count);
+			return inBuf + bufferIndex;
+		}
+		//Nothing left to do to the data, so it goes straight to the output
+		while (outBufferCurrentSize - posInCompBuffer < (unsigned int) count)
+			growOutputBuffer();
+		return (char*) outBuf + posInCompBuffer;
+	}
+	void DataCompressionLayer::wrote(int count)
+	{
+		if (deflating())
+			bufferIndex += count;
+		else
+			posInCompBuffer += count;
+		pInc(count);
 	}
 	void DataCompressionLayer::writeFile(FILE* toWrite)
 	{
@@ -150,6 +196,8 @@ namespace TraceviewerServer
 	}
 	void DataCompressionLayer::softFlush(int flushType)
 	{
+		if (!deflating())
+			return;
 
 		/* run deflate() on input until output buffer not full, finish
 		 compression if all of source has been read in */
@@ -195,6 +243,19 @@ namespace TraceviewerServer
 			progMonitor->incrementProgress(count);
 	}
 
+	void DataCompressionLayer::reset()
+	{
+		bufferIndex = 0;
+		posInCompBuffer = 0;
+		if (deflating())
+			deflateReset(&compressor);
+	}
+
+	CompressionType DataCompressionLayer::getType()
+	{
+		return type;
+	}
+
 	unsigned char* DataCompressionLayer::getOutputBuffer()
 	{
 		return outBuf;
@@ -205,7 +266,8 @@ namespace TraceviewerServer
 	}
 	DataCompressionLayer::~DataCompressionLayer()
 	{
-		deflateEnd(&compressor);
+		if (deflating())
+			deflateEnd(&compressor);
 		delete[] inBuf;
 		delete[] outBuf;
 	}
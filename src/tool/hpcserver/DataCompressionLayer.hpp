@@ -61,6 +61,7 @@
 #include <cstdio>
 
 #include "ProgressBar.hpp"
+#include "Constants.hpp"
 /*
  * CompressingDataSocketLayer.h
  *
@@ -79,6 +80,9 @@ namespace TraceviewerServer
 	{
 	public:
 		DataCompressionLayer();
+		//Encodes with the given codec instead of deflate. writeInt and
+		//writeLong write varints when the codec is COMPRESSION_VARINT.
+		DataCompressionLayer(CompressionType type);
 		//Advanced constructor:
 		DataCompressionLayer(z_stream customCompressor, ProgressBar* progMonitor);
 
@@ -88,6 +92,10 @@ namespace TraceviewerServer
 		void writeDouble(double);
 		void writeFile(FILE*);
 		void flush();
+		//Empties the layer so that it can encode something new, keeping
+		//its buffers and compressor around
+		void reset();
+		CompressionType getType();
 		unsigned char* getOutputBuffer();
 		int getOutputLength();
 
@@ -95,13 +103,19 @@ namespace TraceviewerServer
 		//Checks to make sure there is enough room in the buffer for count
 		//bytes. If there is not, it makes room by flushing the buffer.
 		void makeRoom(int count);
+		//Where the next count bytes go, and then how many were written there
+		char* nextWrite(int count);
+		void wrote(int count);
 		void softFlush(int flushType);
 
 		//Increment the progress bar if it isn't NULL
 		void pInc(unsigned int count);
 
 		void growOutputBuffer();
+		void init(CompressionType type, ProgressBar* progMonitor);
+		bool deflating();
 
+		CompressionType type;
 		unsigned int bufferIndex;
 		z_stream compressor;
 		char* inBuf;
@@ -51,7 +51,7 @@
 //
 // Purpose:
 //   Provides some helpful methods for writing to a file, similar to DataSocketStream.
-//   This is only used by MergeDataFiles and will become obsolete with it soon.
+//   Used to write the trace summary pyramid (TracePyramid).
 //
 // Description:
 //   [The set of functions, macros, etc. defined in the file]
@@ -82,12 +82,20 @@ namespace TraceviewerServer
 
 	DataSocketStream::DataSocketStream()
 	{
-		//Do nothing because this is used when the CompressingDataSocket is constructed, which means we already have a socket constructed that we want to use
+		//Not listening or connected yet. attachSocket sets up the connection.
+		port = 0;
+		socketDesc = -1;
+		unopenedSocketFD = -1;
+		file = NULL;
+		readFile = NULL;
 	}
 
 	DataSocketStream::DataSocketStream(int _Port, bool Accept = true)
 	{
 		port = _Port;
+		socketDesc = -1;
+		file = NULL;
+		readFile = NULL;
 		
 		unopenedSocketFD = socket(PF_INET, SOCK_STREAM, 0);
 		if (unopenedSocketFD == -1)
@@ -124,10 +132,49 @@ namespace TraceviewerServer
 		//accept
 		sockaddr_in client;
 		unsigned int len = sizeof(client);
-		socketDesc = accept(unopenedSocketFD, (sockaddr*) &client, &len);
-		if (socketDesc < 0)
+		SocketFD connection = accept(unopenedSocketFD, (sockaddr*) &client, &len);
+		if (connection < 0)
 			cerr << "Error on accept" << endl;
-		file = fdopen(socketDesc, "r+b"); //read, write, binary
+		attachSocket(connection);
+	}
+
+	//Waits for another connection on the port this stream is listening on.
+	//The returned stream does not listen, so it can be deleted independently
+	//of this one. Returns NULL once stopListening has been called.
+	DataSocketStream* DataSocketStream::acceptConnection()
+	{
+		sockaddr_in client;
+		socklen_t len = sizeof(client);
+		SocketFD connection;
+		do
+			connection = accept(unopenedSocketFD, (sockaddr*) &client, &len);
+		while (connection < 0 && errno == EINTR);
+		if (connection < 0)
+			return NULL;
+		DataSocketStream* stream = new DataSocketStream();
+		stream->port = getPort();
+		stream->attachSocket(connection);
+		return stream;
+	}
+
+	//Wakes up threads waiting in acceptConnection
+	void DataSocketStream::stopListening()
+	{
+		shutdown(unopenedSocketFD, SHUT_RDWR);
+	}
+
+	//Uses a socket that is already connected
+	void DataSocketStream::attachSocket(SocketFD connection)
+	{
+		socketDesc = connection;
+		file = fdopen(socketDesc, "wb");
+		readFile = fdopen(dup(socketDesc), "rb");
+	}
+
+	//Makes reads that are waiting for data, and all later ones, fail
+	void DataSocketStream::closeInput()
+	{
+		shutdown(socketDesc, SHUT_RD);
 	}
 
 	int DataSocketStream::getPort()
@@ -153,10 +200,16 @@ namespace TraceviewerServer
 	
 	DataSocketStream::~DataSocketStream()
 	{
-		fclose(file);
-		shutdown(socketDesc, SHUT_RDWR);
-		close(socketDesc);
-		close(unopenedSocketFD);
+		if (socketDesc >= 0)
+			shutdown(socketDesc, SHUT_RDWR);
+		//Closing the streams closes the socket. Closing it again could close
+		//a connection another thread has just opened.
+		if (readFile != NULL)
+			fclose(readFile);
+		if (file != NULL)
+			fclose(file);
+		if (unopenedSocketFD >= 0)
+			close(unopenedSocketFD);
 	}
 
 	void DataSocketStream::writeInt(int toWrite)
@@ -202,7 +255,7 @@ namespace TraceviewerServer
 	int DataSocketStream::readInt()
 	{
 		char Af[SIZEOF_INT];
-		int err = fread(Af, 1, SIZEOF_INT, file);
+		int err = fread(Af, 1, SIZEOF_INT, readFile);
 		if (err != SIZEOF_INT)
 			throw ERROR_READ_TOO_LITTLE;
 		return ByteUtilities::readInt(Af);
@@ -212,7 +265,7 @@ namespace TraceviewerServer
 	Long DataSocketStream::readLong()
 	{
 		char Af[SIZEOF_LONG];
-		int err = fread(Af, 1, SIZEOF_LONG, file);
+		int err = fread(Af, 1, SIZEOF_LONG, readFile);
 		if (err != SIZEOF_LONG)
 			throw ERROR_READ_TOO_LITTLE;
 		return ByteUtilities::readLong(Af);
@@ -222,7 +275,7 @@ namespace TraceviewerServer
 	short DataSocketStream::readShort()
 	{
 		char Af[SIZEOF_SHORT];
-		int err = fread(Af, 1, SIZEOF_SHORT, file);
+		int err = fread(Af, 1, SIZEOF_SHORT, readFile);
 		if (err != 2)
 			throw ERROR_READ_TOO_LITTLE;
 		return ByteUtilities::readShort(Af);
@@ -230,7 +283,7 @@ namespace TraceviewerServer
 	char DataSocketStream::readByte()
 	{
 		char Af[SIZEOF_BYTE];
-		int err = fread(Af, 1, SIZEOF_BYTE, file);
+		int err = fread(Af, 1, SIZEOF_BYTE, readFile);
 		if (err != 1)
 			throw ERROR_READ_TOO_LITTLE;
 		return Af[0];
@@ -242,7 +295,7 @@ namespace TraceviewerServer
 		short Len = readShort();
 
 		char* Msg = new char[Len + 1];
-		int err = fread(Msg, 1, Len, file);
+		int err = fread(Msg, 1, Len, readFile);
 		if (err != Len)
 			throw ERROR_READ_TOO_LITTLE;
 
@@ -81,7 +81,11 @@ namespace TraceviewerServer
 	public:
 		DataSocketStream(int, bool);
 		void acceptSocket();
+		DataSocketStream* acceptConnection();
+		void stopListening();
 		DataSocketStream();
+		void attachSocket(SocketFD);
+		void closeInput();
 
 		int getPort();
 
@@ -109,7 +113,10 @@ namespace TraceviewerServer
 		SocketFD socketDesc;
 		SocketFD unopenedSocketFD;
 		void checkForErrors(int);
+		//Separate streams, so that one thread can wait for the next command
+		//while another one is writing
 		FILE* file;
+		FILE* readFile;
 	};
 
 } /* namespace TraceviewerServer */
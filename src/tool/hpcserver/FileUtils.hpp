@@ -77,6 +77,15 @@ namespace TraceviewerServer
 	typedef int FileDescriptor;
 	typedef uint64_t FileOffset;
 
+	//A byte range of a file that holds trace data: a whole trace file, or
+	//one extent of a trace stream in a container
+	struct FileSegment
+	{
+		string path;
+		FileOffset offset;
+		FileOffset size;
+	};
+
 	class FileUtils
 	{
 	public:
@@ -109,6 +118,13 @@ namespace TraceviewerServer
 			return (err == 0) && isDir;
 		}
 
+		//Like existsAndIsDir, but quietly
+		static bool isDir(string p)
+		{
+			struct stat DirInfo;
+			return (stat(p.c_str(), &DirInfo) == 0) && S_ISDIR(DirInfo.st_mode);
+		}
+
 		//Uses stat to check if the specified file exists
 		static bool exists(string p)
 		{
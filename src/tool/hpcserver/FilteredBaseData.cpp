@@ -73,6 +73,7 @@ FilteredBaseData::FilteredBaseData(string filename, int _headerSize) {
 	baseDataFile = new BaseDataFile(filename, _headerSize);
 	headerSize = _headerSize;
 	baseOffsets = baseDataFile->getOffsets();
+	pyramid = NULL;
 	//Filters are default, which is allow everything, so this will initialize the vector
 	filter();
 
@@ -126,6 +127,22 @@ int FilteredBaseData::getNumberOfRanks()
 	return rankMapping.size();
 }
 
+int FilteredBaseData::getFileIndex(int pseudoRank)
+{
+	assert((unsigned int)pseudoRank < rankMapping.size());
+	return rankMapping[pseudoRank];
+}
+
+void FilteredBaseData::setPyramid(TracePyramid* _pyramid)
+{
+	pyramid = _pyramid;
+}
+
+TracePyramid* FilteredBaseData::getPyramid()
+{
+	return pyramid;
+}
+
 int* FilteredBaseData::getProcessIDs()
 {
 	return baseDataFile->processIDs;
@@ -71,6 +71,8 @@
 using std::vector;
 namespace TraceviewerServer
 {
+	class TracePyramid;
+
 	class FilteredBaseData {
 	public:
 		FilteredBaseData(string filename, int _headerSize);
@@ -83,6 +85,9 @@ namespace TraceviewerServer
 		int64_t getLong(FileOffset position);
 		int getInt(FileOffset position);
 		int getNumberOfRanks();
+		int getFileIndex(int pseudoRank);
+		void setPyramid(TracePyramid* _pyramid);
+		TracePyramid* getPyramid();
 		int* getProcessIDs();
 		short* getThreadIDs();
 	private:
@@ -96,6 +101,8 @@ namespace TraceviewerServer
 		//pool to the real ranks from the filtered pool.
 		vector<int> rankMapping;
 		int headerSize;
+		//Summary of the unfiltered ranks, if any; not owned
+		TracePyramid* pyramid;
 	};
 
 
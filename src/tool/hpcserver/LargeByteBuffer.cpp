@@ -78,8 +78,6 @@ using namespace std;
 
 namespace TraceviewerServer
 {
-	static FileOffset mmPageSize; //= 1<<23;//1 << 30;
-	FileOffset fileSize;
 	LargeByteBuffer::LargeByteBuffer(string sPath, int headerSize)
 	{
 		//string SPath = Path.string();
@@ -88,7 +86,59 @@ namespace TraceviewerServer
 		int MapProt = PROT_READ;*/
 
 		fileSize = FileUtils::getFileSize(sPath);
+		int MaxPages = setPageSize(headerSize);
 
+		int FullPages = fileSize / mmPageSize;
+		int PartialPageSize = fileSize % mmPageSize;
+		numPages = FullPages + (PartialPageSize == 0 ? 0 : 1);
+		initPages(MaxPages);
+
+		FileDescriptor fd = open(sPath.c_str(), O_RDONLY);
+		addSegment(0, fileSize, fd, "", 0);
+		addPagesToList();
+	}
+
+	/**
+	 * Presents header followed by each of segments as one buffer, as if
+	 * they had been merged into a single file, without copying them.
+	 * header is kept in memory, and every segment is mapped on its own, so
+	 * the pages of a segment start at the beginning of that segment. A
+	 * segment is a whole trace file or an extent of a container stream;
+	 * both start at a page-aligned file offset and at a record boundary.
+	 */
+	LargeByteBuffer::LargeByteBuffer(const vector<char>& _header, const vector<FileSegment>& segments, int headerSize)
+	{
+		header = _header;
+
+		fileSize = header.size();
+		for (unsigned int i = 0; i < segments.size(); i++)
+			fileSize += segments[i].size;
+		//Leave room for the end of file marker of a merged file so that
+		//positions computed from the end of the buffer stay the same.
+		fileSize += SIZEOF_LONG;
+
+		int MaxPages = setPageSize(headerSize);
+
+		numPages = 0;
+		for (unsigned int i = 0; i < segments.size(); i++)
+			numPages += (segments[i].size + mmPageSize - 1) / mmPageSize;
+		initPages(MaxPages);
+
+		FileOffset start = header.size();
+		for (unsigned int i = 0; i < segments.size(); i++)
+		{
+			//The file is only opened while one of its pages is being mapped
+			addSegment(start, segments[i].size, -1, segments[i].path, segments[i].offset);
+			start += segments[i].size;
+		}
+		addPagesToList();
+
+		DEBUGCOUT(1) << "Reading " << segments.size() << " trace segments in place" << endl;
+	}
+
+	//Returns the maximum number of pages that may be mapped at once
+	int LargeByteBuffer::setPageSize(int headerSize)
+	{
 		FileOffset osPageSize = getpagesize();
 		FileOffset pageSizeMultiple = lcm(osPageSize, lcm(headerSize, SIZE_OF_TRACE_RECORD));//The page size must be a multiple of this
 
@@ -106,43 +156,128 @@ namespace TraceviewerServer
 		double MAX_PORTION_OF_RAM_AVAILABLE = 0.60;//Use up to 60%
 		int MaxPages = (int)(ramSizeInBytes * MAX_PORTION_OF_RAM_AVAILABLE/mmPageSize);
 		VersatileMemoryPage::setMaxPages(MaxPages);
+		return MaxPages;
+	}
 
-
-		int FullPages = fileSize / mmPageSize;
-		int PartialPageSize = fileSize % mmPageSize;
-		numPages = FullPages + (PartialPageSize == 0 ? 0 : 1);
+	void LargeByteBuffer::initPages(int MaxPages)
+	{
 		pageManagementList = new LRUList<VersatileMemoryPage>(numPages);
 
-		FileDescriptor fd = open(sPath.c_str(), O_RDONLY);
+		pthread_rwlock_init(&pageLock, NULL);
+		pthread_mutex_init(&lruLock, NULL);
+		canEvict = numPages > MaxPages;
+		mappedPages = new char*[numPages];
+		fill(mappedPages, mappedPages + numPages, (char*)NULL);
+	}
 
-		FileOffset sizeRemaining = fileSize;
+	//Splits the segment of the buffer starting at start, backed by the file
+	//from fileOffset on, into pages
+	void LargeByteBuffer::addSegment(FileOffset start, FileOffset segmentSize,
+			FileDescriptor fd, string path, FileOffset fileOffset)
+	{
+		segmentStarts.push_back(start);
+		segmentFirstPages.push_back(masterBuffer.size());
 
-		for (int i = 0; i < numPages; i++)
+		FileOffset sizeRemaining = segmentSize;
+		for (FileOffset offset = 0; sizeRemaining > 0; offset += mmPageSize)
 		{
 			FileOffset mapping_len = min( mmPageSize, sizeRemaining);
 
-			masterBuffer.push_back(VersatileMemoryPage(mmPageSize*i, mapping_len, fd, pageManagementList));
+			if (path.empty())
+				masterBuffer.push_back(VersatileMemoryPage(fileOffset + offset, mapping_len, fd, pageManagementList));
+			else
+				masterBuffer.push_back(VersatileMemoryPage(fileOffset + offset, mapping_len, path, pageManagementList));
 
 			sizeRemaining -= mapping_len;
+		}
+	}
+
+	//Only called once every page is in masterBuffer, which does not move
+	//its pages after that
+	void LargeByteBuffer::addPagesToList()
+	{
+		for (unsigned int i = 0; i < masterBuffer.size(); i++)
+			masterBuffer[i].addToList();
+	}
+
+	//Finds the page holding pos and the position of pos within that page
+	void LargeByteBuffer::findPage(FileOffset pos, int* Page, int* loc)
+	{
+		int segment = upper_bound(segmentStarts.begin(), segmentStarts.end(), pos)
+				- segmentStarts.begin() - 1;
+		FileOffset relativePos = pos - segmentStarts[segment];
+		*Page = segmentFirstPages[segment] + relativePos / mmPageSize;
+		*loc = relativePos % mmPageSize;
+	}
 
+	//Only used when pages are never evicted
+	char* LargeByteBuffer::getPage(int Page)
+	{
+		char* page = __atomic_load_n(&mappedPages[Page], __ATOMIC_ACQUIRE);
+		if (page == NULL)
+		{
+			pthread_rwlock_wrlock(&pageLock);
+			page = masterBuffer[Page].get();
+			__atomic_store_n(&mappedPages[Page], page, __ATOMIC_RELEASE);
+			pthread_rwlock_unlock(&pageLock);
 		}
+		return page;
+	}
 
+	//Returns the mapping of Page with pageLock held shared, so that the
+	//page stays mapped until the caller releases the lock. A reader that
+	//finds another reader updating the LRU order leaves it as it is.
+	char* LargeByteBuffer::pinPage(int Page)
+	{
+		while (true)
+		{
+			pthread_rwlock_rdlock(&pageLock);
+			char* page = masterBuffer[Page].peek();
+			if (page != NULL)
+			{
+				if (pthread_mutex_trylock(&lruLock) == 0)
+				{
+					masterBuffer[Page].touch();
+					pthread_mutex_unlock(&lruLock);
+				}
+				return page;
+			}
+			pthread_rwlock_unlock(&pageLock);
+
+			//The page may be evicted again before the shared lock is
+			//taken back, hence the loop
+			pthread_rwlock_wrlock(&pageLock);
+			masterBuffer[Page].get();
+			pthread_rwlock_unlock(&pageLock);
+		}
 	}
 
 	int LargeByteBuffer::getInt(FileOffset pos)
 	{
-		int Page = pos / mmPageSize;
-		int loc = pos % mmPageSize;
-		char* p2D = masterBuffer[Page].get() + loc;
-		int val = ByteUtilities::readInt(p2D);
+		if (pos < header.size())
+			return ByteUtilities::readInt(&header[pos]);
+
+		int Page, loc;
+		findPage(pos, &Page, &loc);
+		if (!canEvict)
+			return ByteUtilities::readInt(getPage(Page) + loc);
+
+		int val = ByteUtilities::readInt(pinPage(Page) + loc);
+		pthread_rwlock_unlock(&pageLock);
 		return val;
 	}
 	Long LargeByteBuffer::getLong(FileOffset pos)
 	{
-		int Page = pos / mmPageSize;
-		int loc = pos % mmPageSize;
-		char* p2D = masterBuffer[Page].get() + loc;
-		Long val = ByteUtilities::readLong(p2D);
+		if (pos < header.size())
+			return ByteUtilities::readLong(&header[pos]);
+
+		int Page, loc;
+		findPage(pos, &Page, &loc);
+		if (!canEvict)
+			return ByteUtilities::readLong(getPage(Page) + loc);
+
+		Long val = ByteUtilities::readLong(pinPage(Page) + loc);
+		pthread_rwlock_unlock(&pageLock);
 		return val;
 
 	}
@@ -196,6 +331,9 @@ namespace TraceviewerServer
 	{
 		masterBuffer.clear();
 		delete pageManagementList;
+		delete[] mappedPages;
+		pthread_rwlock_destroy(&pageLock);
+		pthread_mutex_destroy(&lruLock);
 
 	}
 }
@@ -68,6 +68,7 @@
 #include <string>
 #include <vector>
 #include <stdint.h>
+#include <pthread.h>
 
 namespace TraceviewerServer
 {
@@ -76,6 +77,7 @@ namespace TraceviewerServer
 	{
 	public:
 		LargeByteBuffer(std::string, int);
+		LargeByteBuffer(const vector<char>&, const vector<FileSegment>&, int);
 		virtual ~LargeByteBuffer();
 		FileOffset size();
 		Long getLong(FileOffset);
@@ -83,10 +85,41 @@ namespace TraceviewerServer
 	private:
 		static uint64_t lcm(uint64_t, uint64_t);
 		static uint64_t getRamSize();
+		int setPageSize(int);
+		void initPages(int);
+		void addSegment(FileOffset, FileOffset, FileDescriptor, std::string, FileOffset);
+		void addPagesToList();
+		void findPage(FileOffset, int*, int*);
+		char* getPage(int);
+		char* pinPage(int);
+
+		//The start of the buffer that is not backed by a file, if any
+		vector<char> header;
+		//Each file (or container extent) backing the buffer starts a
+		//segment; pages of a segment are consecutive in masterBuffer.
+		vector<FileOffset> segmentStarts;
+		vector<int> segmentFirstPages;
 		vector<VersatileMemoryPage> masterBuffer;
 		int numPages;
+		//Per buffer, as viewers connected at the same time may have opened
+		//different databases
+		FileOffset mmPageSize;
+		FileOffset fileSize;
 		LRUList<VersatileMemoryPage>* pageManagementList;
 
+		//The pages and the LRU list may be touched by several sampling
+		//threads at once. If every page fits in the allowed portion of RAM,
+		//no page is ever unmapped, and a page that has been mapped once is
+		//read through mappedPages without taking the lock. Otherwise a read
+		//of a mapped page holds pageLock shared, so that its page cannot be
+		//evicted under it, and only mapping a page (which may evict
+		//another) holds it exclusively. lruLock orders the LRU updates of
+		//concurrent readers.
+		pthread_rwlock_t pageLock;
+		pthread_mutex_t lruLock;
+		bool canEvict;
+		char** mappedPages;
+
 	};
 
 } /* namespace TraceviewerServer */
@@ -0,0 +1,120 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Hands out the buffers that trace lines are encoded into.
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+#include "LineBufferPool.hpp"
+
+namespace TraceviewerServer
+{
+
+	LineBufferPool::LineBufferPool()
+	{
+		numAllocated = 0;
+		numReused = 0;
+		pthread_mutex_init(&lock, NULL);
+	}
+
+	DataCompressionLayer* LineBufferPool::get(CompressionType type)
+	{
+		pthread_mutex_lock(&lock);
+		for (int i = idle.size() - 1; i >= 0; i--)
+		{
+			if (idle[i]->getType() == type)
+			{
+				DataCompressionLayer* layer = idle[i];
+				idle.erase(idle.begin() + i);
+				numReused++;
+				pthread_mutex_unlock(&lock);
+
+				layer->reset();
+				return layer;
+			}
+		}
+		numAllocated++;
+		pthread_mutex_unlock(&lock);
+
+		return new DataCompressionLayer(type);
+	}
+
+	void LineBufferPool::put(DataCompressionLayer* layer)
+	{
+		pthread_mutex_lock(&lock);
+		if (idle.size() < MAX_IDLE)
+		{
+			idle.push_back(layer);
+			layer = NULL;
+		}
+		pthread_mutex_unlock(&lock);
+		delete layer;
+	}
+
+	int LineBufferPool::getNumAllocated()
+	{
+		return numAllocated;
+	}
+
+	int LineBufferPool::getNumReused()
+	{
+		return numReused;
+	}
+
+	LineBufferPool::~LineBufferPool()
+	{
+		for (unsigned int i = 0; i < idle.size(); i++)
+			delete idle[i];
+		pthread_mutex_destroy(&lock);
+	}
+
+} /* namespace TraceviewerServer */
@@ -0,0 +1,101 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Hands out the buffers that trace lines are encoded into.
+//
+// Description:
+//   Every line of a data request is encoded into its own
+//   DataCompressionLayer, which comes with two buffers and, when deflating,
+//   a zlib stream of a few hundred KB. Lines that have been sent give theirs
+//   back to the pool, so the next lines reuse them instead of allocating.
+//
+//***************************************************************************
+
+#ifndef LINEBUFFERPOOL_HPP_
+#define LINEBUFFERPOOL_HPP_
+
+#include "Constants.hpp"
+#include "DataCompressionLayer.hpp"
+
+#include <pthread.h>
+#include <vector>
+
+namespace TraceviewerServer
+{
+	using namespace std;
+
+	class LineBufferPool
+	{
+	public:
+		LineBufferPool();
+		virtual ~LineBufferPool();
+
+		//An empty layer for the codec, reused if there is one. Safe to call
+		//from several threads.
+		DataCompressionLayer* get(CompressionType type);
+		//Gives back a layer from get once its output has been sent
+		void put(DataCompressionLayer* layer);
+
+		//How many layers get had to allocate, and how many it reused
+		int getNumAllocated();
+		int getNumReused();
+
+	private:
+		//More than this many idle layers are freed, so that a burst of
+		//lines waiting on a slow socket does not pin memory for good
+		static const unsigned int MAX_IDLE = 64;
+
+		vector<DataCompressionLayer*> idle;
+		pthread_mutex_t lock;
+		int numAllocated;
+		int numReused;
+	};
+
+} /* namespace TraceviewerServer */
+#endif /* LINEBUFFERPOOL_HPP_ */
@@ -79,6 +79,7 @@ namespace TraceviewerServer
 		typedef struct
 		{
 			char path[1024];
+			int compressionType;
 		} open_file_command;
 		typedef struct
 		{
@@ -145,11 +146,7 @@ namespace TraceviewerServer
 		typedef struct
 		{
 			ResultMessage* header;
-			bool compressed;
-			union{
-				DataCompressionLayer* compMsg;
-				unsigned char* message;
-			};
+			DataCompressionLayer* compMsg;
 			MPI::Request headerRequest;
 			MPI::Request bodyRequest;
 		} ResultBufferLocations;
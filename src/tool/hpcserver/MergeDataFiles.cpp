@@ -63,86 +63,83 @@
 #include "Constants.hpp"
 #include "FileUtils.hpp"
 #include "DebugUtils.hpp"
-#include "ProgressBar.hpp"
+
+#include <lib/prof-lean/hpcrun-container.h>
+#include <lib/prof-lean/hpcrun-fmt.h>
 
 #include <string>
 #include <algorithm>
+#include <cerrno>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <sstream>
 
 using namespace std;
 typedef int64_t Long;
 namespace TraceviewerServer
 {
-	MergeDataAttribute MergeDataFiles::merge(string directory, string globInputFile,
-			string outputFile)
+	/****
+	 * Build the header and the offset index of a merged file in memory,
+	 * without copying any trace data. The offsets are those the trace files
+	 * would have if they were laid out one after the other right after the
+	 * index, so the original files can be read in place as if they had been
+	 * merged.
+	 *
+	 * @param header
+	 *            (out): the type, the number of files and one
+	 *            (proc-id, thread-id, offset) entry per file
+	 * @param segments
+	 *            (out): the byte ranges holding the trace data, in the order
+	 *            of the index: one per trace file, and one per extent of
+	 *            each trace stream in a container (hpcprof
+	 *            --trace-container)
+	 */
+	MergeDataAttribute MergeDataFiles::index(string directory, string globInputFile,
+			vector<char>* header, vector<FileSegment>* segments)
 	{
 		 int lastDot = globInputFile.find_last_of('.');
 		 string suffix = globInputFile.substr(lastDot);
 
-		DEBUGCOUT(2) << "Checking to see if " << outputFile << " exists" << endl;
-
-
-		if (FileUtils::exists(outputFile))
-		{
-
-			DEBUGCOUT(2) << "Exists" << endl;
-
-			if (isMergedFileCorrect(&outputFile))
-				return SUCCESS_ALREADY_CREATED;
-			// the file exists but corrupted.
-			cout << "Database file may be corrupted. Continuing" << endl;
-			return STATUS_UNKNOWN;
-			//remove(OutputFile.string().c_str());
-		}
-
-		DEBUGCOUT(2) << "Doesn't exist" << endl;
 		// check if the files in glob patterns is correct
-
 		if (!atLeastOneValidFile(directory))
 		{
 			return FAIL_NO_DATA;
 		}
 
-		DataOutputFileStream dos(outputFile.c_str());
-
-		//-----------------------------------------------------
-		// 1. write the header:
-		//  int type (0: unknown, 1: mpi, 2: openmp, 3: hybrid, ...
-		//	int num_files
-		//-----------------------------------------------------
-
-		int type = 0;
-		dos.writeInt(type);
-
 		vector<string> allPaths = FileUtils::getAllFilesInDir(directory);
 		vector<string> filteredFileNames;
+		//Trace streams in containers, named "<container>/<stream>"
+		map<string, vector<FileSegment> > streams;
+		const string containerExt = string(".") + HPCRUN_ContainerFnmSfx;
 		vector<string>::iterator it;
 		for (it = allPaths.begin(); it != allPaths.end(); it++)
 		{
 			string val = *it;
-			if (val.find(".hpctrace") < string::npos)//This is hardcoded, which isn't great but will have to do because GlobInputFile is regex-style ("*.hpctrace")
+			if (val.length() > containerExt.length()
+					&& val.compare(val.length() - containerExt.length(), containerExt.length(), containerExt) == 0)
+				addContainerStreams(val, &filteredFileNames, &streams);
+			else if (val.find(".hpctrace") < string::npos)//This is hardcoded, which isn't great but will have to do because GlobInputFile is regex-style ("*.hpctrace")
 				filteredFileNames.push_back(val);
 		}
 		// on linux, we have to sort the files
 		//To sort them, we need a random access iterator, which means we need to load all of them into a vector
 		sort(filteredFileNames.begin(), filteredFileNames.end());
 
-		dos.writeInt(filteredFileNames.size());
-		const Long num_metric_header = 2 * SIZEOF_INT; // type of app (4 bytes) + num procs (4 bytes)
-		 Long num_metric_index = filteredFileNames.size()
-				* (SIZEOF_LONG + 2 * SIZEOF_INT);
-		FileOffset currentOffset = num_metric_header + num_metric_index;
-
-		int name_format = 0; // FIXME hack:some hpcprof revisions have different format name !!
 		//-----------------------------------------------------
-		// 2. Record the process ID, thread ID and the currentOffset
+		// 1. Record the process ID, thread ID and the currentOffset
 		//   It will also detect if the application is mp, mt, or hybrid
 		//	 no accelator is supported
 		//  for all files:
 		//		int proc-id, int thread-id, long currentOffset
 		//-----------------------------------------------------
+		int type = 0;
+		vector<int> procs, threads;
+		vector<FileOffset> sizes;
+		segments->clear();
+
+		int name_format = 0; // FIXME hack:some hpcprof revisions have different format name !!
 		vector<string>::iterator it2;
 		for (it2 = filteredFileNames.begin(); it2 < filteredFileNames.end(); it2++)
 		{
@@ -169,62 +166,96 @@ namespace TraceviewerServer
 				string Token_To_Parse = tokens[name_format + num_tokens - PROC_POS];
 				proc = atoi(Token_To_Parse.c_str());
 			}
-			dos.writeInt(proc);
 			if (proc != 0)
 				type |= MULTI_PROCESSES;
 			 int Thread = atoi(tokens[name_format + num_tokens - THREAD_POS].c_str());
-			dos.writeInt(Thread);
 			if (Thread != 0)
 				type |= MULTI_THREADING;
-			dos.writeLong(currentOffset);
-			currentOffset += FileUtils::getFileSize(Filename);
-		}
-		//-----------------------------------------------------
-		// 3. Copy all data from the multiple files into one file
-		//-----------------------------------------------------
-		ProgressBar prog("Merging database", filteredFileNames.size());
-		for (it2 = filteredFileNames.begin(); it2 < filteredFileNames.end(); it2++)
-		{
-			string i = *it2;
 
-			ifstream dis(i.c_str(), ios_base::binary | ios_base::in);
-			char data[PAGE_SIZE_GUESS];
-			dis.read(data, PAGE_SIZE_GUESS);
-			int bytesRead = dis.gcount();
-			while (bytesRead > 0)
+			procs.push_back(proc);
+			threads.push_back(Thread);
+			map<string, vector<FileSegment> >::iterator stream = streams.find(Filename);
+			if (stream != streams.end())
+			{
+				FileOffset size = 0;
+				for (unsigned int i = 0; i < stream->second.size(); i++)
+				{
+					size += stream->second[i].size;
+					segments->push_back(stream->second[i]);
+				}
+				sizes.push_back(size);
+			}
+			else
 			{
-				dos.write(data, bytesRead);
-				dis.read(data, PAGE_SIZE_GUESS);
-				bytesRead = dis.gcount();
+				FileSegment file = { Filename, 0, FileUtils::getFileSize(Filename) };
+				sizes.push_back(file.size);
+				segments->push_back(file);
 			}
-			dis.close();
-			prog.incrementProgress();
 		}
-		insertMarker(&dos);
-		dos.close();
-		//-----------------------------------------------------
-		// 4. FIXME: write the type of the application
-		//  	the type of the application is computed in step 2
-		//		Ideally, this step has to be in the beginning !
-		//-----------------------------------------------------
-		//While we don't actually want to do any input operations, adding the input flag prevents the file from being truncated to 0 bytes
-		DataOutputFileStream f(outputFile.c_str(), ios_base::in | ios_base::out | ios_base::binary);
-		f.writeInt(type);
-		f.close();
 
 		//-----------------------------------------------------
-		// 5. remove old files
+		// 2. write the header:
+		//  int type (0: unknown, 1: mpi, 2: openmp, 3: hybrid, ...
+		//	int num_files
+		//  followed by the index
 		//-----------------------------------------------------
-		removeFiles(filteredFileNames);
-		return SUCCESS_MERGED;
-	}
-
+		int numFiles = procs.size();
+		const Long num_metric_header = 2 * SIZEOF_INT; // type of app (4 bytes) + num procs (4 bytes)
+		 Long num_metric_index = numFiles * (SIZEOF_LONG + 2 * SIZEOF_INT);
+		FileOffset currentOffset = num_metric_header + num_metric_index;
 
+		header->resize(num_metric_header + num_metric_index);
+		char* pos = &(*header)[0];
+		ByteUtilities::writeInt(pos, type);
+		pos += SIZEOF_INT;
+		ByteUtilities::writeInt(pos, numFiles);
+		pos += SIZEOF_INT;
+		for (int i = 0; i < numFiles; i++)
+		{
+			ByteUtilities::writeInt(pos, procs[i]);
+			pos += SIZEOF_INT;
+			ByteUtilities::writeInt(pos, threads[i]);
+			pos += SIZEOF_INT;
+			ByteUtilities::writeLong(pos, currentOffset);
+			pos += SIZEOF_LONG;
+			currentOffset += sizes[i];
+		}
+		return SUCCESS_INDEXED;
+	}
 
-	void MergeDataFiles::insertMarker(DataOutputFileStream* dos)
+	/****
+	 * Add the trace streams of a container to names, as
+	 * "<container>/<stream>", and their extents to streams. The extents of
+	 * a stream hold whole trace records, so they can be mapped in place.
+	 */
+	void MergeDataFiles::addContainerStreams(string container, vector<string>* names,
+			map<string, vector<FileSegment> >* streams)
 	{
-		dos->writeLong(MARKER_END_MERGED_FILE);
+		hpccont_t* c = hpccont_open(container.c_str());
+		if (c == NULL)
+		{
+			cerr << "Skipping unreadable or incomplete container " << container
+					<< ": " << strerror(errno) << endl;
+			return;
+		}
+		for (uint32_t i = 0; i < c->n_streams; i++)
+		{
+			hpccont_stream_info_t* stream = &c->streams[i];
+			if (stream->kind != HPCCONT_STREAM_TRACE)
+				continue;
+			string name = FileUtils::combinePaths(container, stream->name);
+			vector<FileSegment>& extents = (*streams)[name];
+			for (uint64_t k = 0; k < stream->n_extents; k++)
+			{
+				FileSegment extent = { container, stream->extents[k].data_off,
+						stream->extents[k].length };
+				extents.push_back(extent);
+			}
+			names->push_back(name);
+		}
+		hpccont_close(c);
 	}
+
 	bool MergeDataFiles::isMergedFileCorrect(string* filename)
 	{
 		ifstream f(filename->c_str(), ios_base::binary | ios_base::in);
@@ -243,17 +274,6 @@ namespace TraceviewerServer
 		f.close();
 		return isCorrect;
 	}
-	bool MergeDataFiles::removeFiles(vector<string> vect)
-	{
-		bool success = true;
-		vector<string>::iterator it;
-		for (it = vect.begin(); it != vect.end(); ++it)
-		{
-			bool thisSuccess = (remove(it->c_str()) == 0);
-			success &= thisSuccess;
-		}
-		return success;
-	}
 	bool MergeDataFiles::atLeastOneValidFile(string dir)
 	{
 		vector<string> FileList = FileUtils::getAllFilesInDir(dir);
@@ -263,13 +283,15 @@ namespace TraceviewerServer
 			string filename = *it;
 
 			unsigned int l = filename.length();
-			//if it ends with ".hpctrace", we are good.
+			//if it ends with ".hpctrace" (or is a container), we are good.
 			string ending = ".hpctrace";
-			if (l < ending.length())
-				continue;
-			string supposedext = filename.substr(l - ending.length());
-
-			if (ending == supposedext)
+			string containerEnding = string(".") + HPCRUN_ContainerFnmSfx;
+			if (l > ending.length() && filename.substr(l - ending.length()) == ending)
+			{
+				return true;
+			}
+			if (l > containerEnding.length()
+					&& filename.substr(l - containerEnding.length()) == containerEnding)
 			{
 				return true;
 			}
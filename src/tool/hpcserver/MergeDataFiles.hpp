@@ -59,7 +59,8 @@
 #ifndef MERGEDATAFILES_H_
 #define MERGEDATAFILES_H_
 
-#include "DataOutputFileStream.hpp"
+#include "FileUtils.hpp"
+#include <map>
 #include <vector>
 #include <string>
 #include <stdint.h>
@@ -70,23 +71,21 @@ namespace TraceviewerServer
 
 	enum MergeDataAttribute
 	{
-		SUCCESS_MERGED, SUCCESS_ALREADY_CREATED, FAIL_NO_DATA, STATUS_UNKNOWN
+		FAIL_NO_DATA, SUCCESS_INDEXED
 	};
 
 	class MergeDataFiles
 	{
 	public:
-		static MergeDataAttribute merge(string, string, string);
+		static MergeDataAttribute index(string, string, vector<char>*, vector<FileSegment>*);
+		static bool isMergedFileCorrect(string*);
 
 		static vector<string> splitString(string, char);
 	private:
 		static const uint64_t MARKER_END_MERGED_FILE = 0xFFFFFFFFDEADF00D;
-		static const int PAGE_SIZE_GUESS = 4096;
 		static const int PROC_POS = 5;
 		static const int THREAD_POS = 4;
-		static void insertMarker(DataOutputFileStream*);
-		static bool isMergedFileCorrect(string*);
-		static bool removeFiles(vector<string>);
+		static void addContainerStreams(string, vector<string>*, map<string, vector<FileSegment> >*);
 		//This was in Util.java in a modified form but is more useful here
 		static bool atLeastOneValidFile(string);
 
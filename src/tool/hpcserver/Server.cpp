@@ -76,6 +76,7 @@
  #include "hpctoolkit.h"
 #endif
 
+#include <pthread.h>
 #include <iostream>
 #include <cstdio>
 #include <zlib.h>
@@ -86,34 +87,141 @@ using namespace std;
 
 namespace TraceviewerServer
 {
-	bool useCompression = true;
+	int preferredCompression = COMPRESSION_DEFLATE;
 	int mainPortNumber = DEFAULT_PORT;
 	int xmlPortNumber = 0;
+	int numThreads = 0;
+	int lodBuckets = 0;
+	int maxConnections = 1;
+
+	//Viewers connected after the first one, which run on their own threads
+	static pthread_mutex_t connectionLock = PTHREAD_MUTEX_INITIALIZER;
+	static pthread_cond_t connectionClosed = PTHREAD_COND_INITIALIZER;
+	static int numConnections = 0;
+	static bool acceptingConnections = true;
 
 	Server::Server()
 	{
-		DataSocketStream* socketptr = NULL;
-		DataSocketStream* xmlSocketPtr = NULL;
+		controller = NULL;
 
 		//Port 21590 is used by vofr-gateway. Do we want to change it?
 		DataSocketStream socket(mainPortNumber, true);
-		socketptr = &socket;
 
-		mainPortNumber = socketptr->getPort();
+		mainPortNumber = socket.getPort();
 		cout << "Received connection" << endl;
 
+		pthread_t acceptor;
+		if (maxConnections > 1)
+		{
+			numConnections = 1;
+			pthread_create(&acceptor, NULL, acceptConnections, &socket);
+		}
+
+		bool failed = false;
+		ErrorCode error = ERROR_STREAM_CLOSED;
+		try
+		{
+			serve(&socket, true);
+		}
+		catch (ErrorCode& e)
+		{
+			failed = true;
+			error = e;
+		}
+
+		if (maxConnections > 1)
+		{
+			//The server keeps running as long as any viewer is connected
+			pthread_mutex_lock(&connectionLock);
+			numConnections--;
+			while (numConnections > 0)
+				pthread_cond_wait(&connectionClosed, &connectionLock);
+			acceptingConnections = false;
+			pthread_mutex_unlock(&connectionLock);
+
+			socket.stopListening();
+			pthread_join(acceptor, NULL);
+		}
+
+		if (failed)
+			throw error;
+	}
+
+	//Serves a viewer that connected while another one was already connected
+	Server::Server(DataSocketStream* socket)
+	{
+		controller = NULL;
+		serve(socket, false);
+	}
+
+	Server::~Server()
+	{
+		delete (controller);
+	}
+
+	void* Server::acceptConnections(void* listener)
+	{
+		DataSocketStream* socket;
+		while ((socket = ((DataSocketStream*) listener)->acceptConnection()) != NULL)
+		{
+			pthread_mutex_lock(&connectionLock);
+			bool accepted = acceptingConnections && numConnections < maxConnections;
+			if (accepted)
+				numConnections++;
+			pthread_mutex_unlock(&connectionLock);
+
+			if (!accepted)
+			{
+				cerr << "Refusing a connection: " << maxConnections
+						<< " viewers are already connected" << endl;
+				delete socket;
+				continue;
+			}
+
+			cout << "Received connection" << endl;
+			pthread_t thread;
+			pthread_create(&thread, NULL, serveConnection, socket);
+			pthread_detach(thread);
+		}
+		return NULL;
+	}
+
+	void* Server::serveConnection(void* socket)
+	{
+		try
+		{
+			Server connection((DataSocketStream*) socket);
+		}
+		catch (ErrorCode& e)
+		{//Only this viewer is affected
+			DEBUGCOUT(1) << "Error on closing connection was " << hex << e << dec << endl;
+		}
+		delete (DataSocketStream*) socket;
+
+		pthread_mutex_lock(&connectionLock);
+		numConnections--;
+		pthread_cond_signal(&connectionClosed);
+		pthread_mutex_unlock(&connectionLock);
+		return NULL;
+	}
+
+	void Server::serve(DataSocketStream* socketptr, bool firstConnection)
+	{
+		DataSocketStream* xmlSocketPtr = NULL;
+
 		int command = socketptr->readInt();
 		if (command == OPEN)
 		{
  			// Laksono 2014.11.11: Somehow the class Args.cpp cannot accept -1 as an integer argument
 	 		// (not sure if this is a feature or it's a bug to confuse between a flag and negative number)
  			// Temporary, we can specify that if the xml port is 1 then it will be the same as the main port
-			if (xmlPortNumber == 1)
-			  xmlPortNumber = mainPortNumber;
+			int xmlPort = (xmlPortNumber == 1) ? mainPortNumber : xmlPortNumber;
 
-			if (xmlPortNumber != mainPortNumber)
+			if (xmlPort != mainPortNumber)
 			{//On a different port. Create another socket.
-			  xmlSocketPtr = new DataSocketStream(xmlPortNumber, false);
+			  //Only the first viewer gets the port that was asked for, as the
+			  //others may be connecting while it is still bound.
+			  xmlSocketPtr = new DataSocketStream(firstConnection ? xmlPort : 0, false);
 			}
 			else
 			{
@@ -128,7 +236,7 @@ namespace TraceviewerServer
 
 			while( runConnection(socketptr, xmlSocketPtr)==START_NEW_CONNECTION_IMMEDIATELY) ;
 
-			if (xmlPortNumber != mainPortNumber)
+			if (xmlSocketPtr != socketptr)
 			{
 			  delete (xmlSocketPtr);
 			}
@@ -140,17 +248,13 @@ namespace TraceviewerServer
 		}
 	}
 
-	Server::~Server()
-	{
-		delete (controller);
-	}
-
 
 	int Server::runConnection(DataSocketStream* socketptr, DataSocketStream* xmlSocket)
 	{
 #ifdef HPCTOOLKIT_PROFILE
 		hpctoolkit_sampling_start();
 #endif
+		delete controller;
 		controller = parseOpenDB(socketptr);
 
 		if (controller == NULL)
@@ -183,18 +287,21 @@ namespace TraceviewerServer
 		// ------------------------------------------------------------------
 		// main loop for a communication session
 		// as long as the client doesn't send OPEN or DONE, we remain in 
-		// in this loop 
+		// in this loop. The commands are read while the previous ones are
+		// executed, so a newer data request can cut the current one short.
 		// ------------------------------------------------------------------
+		CommandQueue commands(socketptr,
+				agreedUponProtocolVersion >= CANCELLABLE_PROTOCOL_VERSION);
 		while (true)
 		{
-			int nextCommand = socketptr->readInt();
-			switch (nextCommand)
+			Command nextCommand = commands.next();
+			switch (nextCommand.type)
 			{
 				case DATA:
 #ifdef HPCTOOLKIT_PROFILE
 					hpctoolkit_sampling_start();
 #endif
-					getAndSendData(socketptr);
+					getAndSendData(socketptr, &commands, nextCommand);
 #ifdef HPCTOOLKIT_PROFILE
 					hpctoolkit_sampling_stop();
 #endif
@@ -203,7 +310,7 @@ namespace TraceviewerServer
 #ifdef HPCTOOLKIT_PROFILE
 					hpctoolkit_sampling_start();
 #endif
-					filter(socketptr);
+					filter(nextCommand);
 #ifdef HPCTOOLKIT_PROFILE
 					hpctoolkit_sampling_stop();
 #endif
@@ -212,6 +319,9 @@ namespace TraceviewerServer
 					return CLOSE_SERVER;
 				case OPEN:
 					return START_NEW_CONNECTION_IMMEDIATELY;
+				case 0:
+					//Reading the command failed
+					throw (ErrorCode) nextCommand.error;
 				default:
 					cerr << "Unknown command received" << endl;
 					return ERROR_UNKNOWN_COMMAND;
@@ -241,12 +351,10 @@ namespace TraceviewerServer
 		int numFiles = controller->getNumRanks();
 		socket->writeInt(numFiles);
 
-		// This is an int so that it is possible to have different compression
-		// algorithms in the future. For now, it is just
+		// One of the CompressionType values the client said it can decode.
+		// Viewers older than COMPRESSION_PROTOCOL_VERSION only get
 		// 0=no compression, 1= normal compression
-		int compressionType;
-		compressionType = useCompression ? 1 : 0;
-		socket->writeInt(compressionType);
+		socket->writeInt(controller->compressionType);
 
 		//Send ValuesX
 		int* rankProcessIds = controller->getValuesXProcessID();
@@ -308,6 +416,7 @@ namespace TraceviewerServer
 	void Server::checkProtocolVersions(DataSocketStream* receiver)
 	{
 		int clientProtocolVersion = receiver->readInt();
+		agreedUponProtocolVersion = clientProtocolVersion;
 
 		if (clientProtocolVersion != SERVER_PROTOCOL_MAX_VERSION)
 			cout << "The client is using protocol version 0x" << hex << clientProtocolVersion<<
@@ -330,19 +439,37 @@ namespace TraceviewerServer
 		checkProtocolVersions(receiver);
 
 		string pathToDB = receiver->readString();
+		//Older viewers only know about deflate
+		int supportedCompression = (1 << COMPRESSION_NONE) | (1 << COMPRESSION_DEFLATE);
+		if (agreedUponProtocolVersion >= COMPRESSION_PROTOCOL_VERSION)
+			supportedCompression = receiver->readInt();
+
 		DBOpener DBO;
 		cout << "Opening database: " << pathToDB << endl;
 		SpaceTimeDataController* controller = DBO.openDbAndCreateStdc(pathToDB);
 
 		if (controller != NULL)
 		{
-			Communication::sendParseOpenDB(pathToDB);
+			controller->compressionType = chooseCompression(supportedCompression);
+			DEBUGCOUT(1) << "Lines will be sent with codec " << controller->compressionType << endl;
+			Communication::sendParseOpenDB(pathToDB, controller->compressionType);
 		}
 
 		return controller;
 
 	}
 
+	CompressionType Server::chooseCompression(int supportedByClient)
+	{
+		if (supportedByClient & (1 << preferredCompression))
+			return (CompressionType) preferredCompression;
+		//Fall back on the codec every viewer has, unless the user asked for none
+		if ((preferredCompression != COMPRESSION_NONE) &&
+				(supportedByClient & (1 << COMPRESSION_DEFLATE)))
+			return COMPRESSION_DEFLATE;
+		return COMPRESSION_NONE;
+	}
+
 	void Server::sendDBOpenFailed(DataSocketStream* socket)
 	{
 		socket->writeInt(NODB);
@@ -352,15 +479,16 @@ namespace TraceviewerServer
 
 
 
-	void Server::getAndSendData(DataSocketStream* stream)
+	void Server::getAndSendData(DataSocketStream* stream, CommandQueue* commands,
+			const Command& request)
 	{
 		LOGTIMESTAMPEDMSG("Front end received data request.")
-		int processStart = stream->readInt();
-		int processEnd = stream->readInt();
-		Time timeStart = stream->readLong();
-		Time timeEnd = stream->readLong();
-		int verticalResolution = stream->readInt();
-		int horizontalResolution = stream->readInt();
+		int processStart = request.processStart;
+		int processEnd = request.processEnd;
+		Time timeStart = request.timeStart;
+		Time timeEnd = request.timeEnd;
+		int verticalResolution = request.verticalResolution;
+		int horizontalResolution = request.horizontalResolution;
 
 		DEBUGCOUT(2) << "Time end: " << timeEnd <<endl;
 
@@ -374,6 +502,17 @@ namespace TraceviewerServer
 					<< endl;
 			throw(ERROR_INVALID_PARAMETERS);
 		}
+
+		//Superseded while it was waiting
+		if (commands->isCancelled(request))
+		{
+			DEBUGCOUT(1) << "Skipping cancelled data request" << endl;
+			stream->writeInt(HERE);
+			stream->writeInt(CANCELLED_LINE);
+			stream->flush();
+			return;
+		}
+
 		Communication::sendStartGetData(controller, processStart, processEnd, timeStart, timeEnd, verticalResolution, horizontalResolution);
 		LOGTIMESTAMPEDMSG("Back end received data request.")
 
@@ -382,25 +521,24 @@ namespace TraceviewerServer
 
 		ProgressBar prog("Computing traces", min(processEnd - processStart, verticalResolution));
 
-		Communication::sendEndGetData(stream, &prog, controller);
-
+		if (!Communication::sendEndGetData(stream, &prog, controller, commands, request))
+		{
+			DEBUGCOUT(1) << "Data request cancelled" << endl;
+			stream->writeInt(CANCELLED_LINE);
+			stream->flush();
+		}
+		DEBUGCOUT(1) << "Line buffers allocated so far: " << controller->linePool.getNumAllocated()
+				<< ", reused: " << controller->linePool.getNumReused() << endl;
 	}
 
-	void Server::filter(DataSocketStream* stream)
+	void Server::filter(const Command& command)
 	{
-		stream->readByte();//Padding
-		bool excludeMatches = stream->readByte();
-		int count = stream->readShort();
-		Communication::sendStartFilter(count, excludeMatches);
-		FilterSet filters(excludeMatches);
+		int count = command.filters.size();
+		Communication::sendStartFilter(count, command.excludeMatches);
+		FilterSet filters(command.excludeMatches);
 		for (int i = 0; i < count; ++i) {
-			BinaryRepresentationOfFilter filt;//This makes the MPI code easier and the non-mpi code about the same
-			filt.processMin = stream->readInt();
-			filt.processMax = stream->readInt();
-			filt.processStride = stream->readInt();
-			filt.threadMin = stream->readInt();
-			filt.threadMax = stream->readInt();
-			filt.threadStride = stream->readInt();
+			//This makes the MPI code easier and the non-mpi code about the same
+			BinaryRepresentationOfFilter filt = command.filters[i];
 			DEBUGCOUT(2) << "Filter proc: " << filt.processMin <<":" << filt.processMax <<":"<<filt.processStride<<",";
 			DEBUGCOUT(2) << "Filter thread: " << filt.threadMax <<":" << filt.threadMax <<":"<<filt.threadStride<<endl;
 
@@ -60,6 +60,7 @@
 #ifndef Server_H_
 #define Server_H_
 
+#include "CommandQueue.hpp"
 #include "DataSocketStream.hpp"
 #include "SpaceTimeDataController.hpp"
 
@@ -67,9 +68,12 @@
 
 namespace TraceviewerServer
 {
-	extern bool useCompression;
+	extern int preferredCompression;
 	extern int mainPortNumber;
 	extern int xmlPortNumber;
+	extern int numThreads;
+	extern int lodBuckets;
+	extern int maxConnections;
 	class Server
 	{
 
@@ -79,22 +83,33 @@ namespace TraceviewerServer
 		static int main(int argc, char *argv[]);
 
 	private:
+		Server(DataSocketStream* socket);
+		void serve(DataSocketStream* socket, bool firstConnection);
+		static void* acceptConnections(void* listener);
+		static void* serveConnection(void* socket);
+
 		int runConnection(DataSocketStream*, DataSocketStream* xmlSocket);
 		void sendDBOpenedSuccessfully(DataSocketStream* socket, DataSocketStream* xmlSocket);
 
 		void parseInfo(DataSocketStream*);
 		SpaceTimeDataController* parseOpenDB(DataSocketStream*);
-		void filter(DataSocketStream*);
-		void getAndSendData(DataSocketStream*);
+		void filter(const Command& command);
+		void getAndSendData(DataSocketStream*, CommandQueue* commands, const Command& request);
 		void sendXML(DataSocketStream*);
 		void sendDBOpenFailed(DataSocketStream*);
 		void checkProtocolVersions(DataSocketStream* receiver);
+		CompressionType chooseCompression(int supportedByClient);
 
 		SpaceTimeDataController* controller;
 
-		//Currently not really used, but pretty necessary for future extensions
 		int agreedUponProtocolVersion;
-		static const int SERVER_PROTOCOL_MAX_VERSION = 0x00010001;
+		static const int SERVER_PROTOCOL_MAX_VERSION = 0x00010003;
+		//The first version in which a new DATA or a CNCL command ends the
+		//reply to the previous request early with CANCELLED_LINE
+		static const int CANCELLABLE_PROTOCOL_VERSION = 0x00010002;
+		//The first version in which OPEN ends with the set of codecs the client
+		//can decode (bit 1 << CompressionType for each)
+		static const int COMPRESSION_PROTOCOL_VERSION = 0x00010003;
 
 	};
 }/* namespace TraceviewerServer */
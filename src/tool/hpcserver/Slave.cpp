@@ -109,6 +109,9 @@ namespace TraceviewerServer
 					{//Set an artificial context to avoid initialization crossing cases
 						DBOpener DBO;
 						controller = DBO.openDbAndCreateStdc(string(Message.ofile.path));
+						if (controller != NULL)
+							controller->compressionType =
+									(CompressionType) Message.ofile.compressionType;
 					}
 					break;
 				case INFO:
@@ -248,7 +251,7 @@ namespace TraceviewerServer
 			}
 			nextTrace->readInData();
 
-			vector<TimeCPID> ActualData = *nextTrace->data->listCPID;
+			vector<TimeCPID>& ActualData = *nextTrace->data->listCPID;
 
 			MPICommunication::ResultBufferLocations* locs = new MPICommunication::ResultBufferLocations;
 
@@ -267,50 +270,21 @@ namespace TraceviewerServer
 
 			int i = 0;
 
-			unsigned char* outputBuffer = NULL;
-			DataCompressionLayer* compr = NULL;
-			int outputBufferLen;
-			if (useCompression)
-			{
-				compr = new DataCompressionLayer();
-
-				locs->compressed = true;
-				locs->compMsg = compr;
+			//Encoded straight into a buffer the send goes out of; it goes back
+			//to the pool once the send completes
+			DataCompressionLayer* compr = controller->linePool.get(controller->compressionType);
+			locs->compMsg = compr;
 
-				Time currentTimestamp = msg->data.begtime;
-				for (i = 0; i < entries; i++)
-				{
-					compr->writeInt((int) (ActualData[i].timestamp - currentTimestamp));
-					compr->writeInt(ActualData[i].cpid);
-					currentTimestamp = ActualData[i].timestamp;
-				}
-				compr->flush();
-				outputBufferLen = compr->getOutputLength();
-				outputBuffer = compr->getOutputBuffer();
-			}
-			else
+			Time currentTimestamp = msg->data.begtime;
+			for (i = 0; i < entries; i++)
 			{
-
-				outputBuffer = new unsigned char[entries*SIZEOF_DELTASAMPLE];
-
-				locs->compressed = false;
-				locs->message = outputBuffer;
-
-				char* ptrToFirstElem = (char*)&(outputBuffer[0]);
-				char* currentPtr = ptrToFirstElem;
-				Time currentTimestamp = msg->data.begtime;
-				for (i = 0; i < entries; i++)
-				{
-					int deltaTimestamp = ActualData[i].timestamp - currentTimestamp;
-					ByteUtilities::writeInt(currentPtr, deltaTimestamp);
-					currentPtr += SIZEOF_INT;
-					ByteUtilities::writeInt(currentPtr, ActualData[i].cpid);
-					currentPtr += SIZEOF_INT;
-				}
-				outputBufferLen = entries*SIZEOF_DELTASAMPLE;
+				compr->writeInt((int) (ActualData[i].timestamp - currentTimestamp));
+				compr->writeInt(ActualData[i].cpid);
+				currentTimestamp = ActualData[i].timestamp;
 			}
-
-
+			compr->flush();
+			int outputBufferLen = compr->getOutputLength();
+			unsigned char* outputBuffer = compr->getOutputBuffer();
 
 			msg->data.compressedSize = outputBufferLen;
 			locs->headerRequest = COMM_WORLD.Isend(msg, sizeof(*msg), MPI_PACKED,
@@ -354,10 +328,7 @@ namespace TraceviewerServer
 			}
 			//Now it is safe to delete everything
 			delete (current->header);
-			if (current->compressed)
-				delete (current->compMsg);
-			else
-				delete (current->message);
+			controller->linePool.put(current->compMsg);
 			delete (current);
 			buffers.pop_front();
 		}
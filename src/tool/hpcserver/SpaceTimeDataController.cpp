@@ -58,6 +58,8 @@
 //***************************************************************************
 #include "SpaceTimeDataController.hpp"
 #include "FileData.hpp"
+#include "Server.hpp"
+#include "TracePyramid.hpp"
 #include <iostream>
 using namespace std;
 namespace TraceviewerServer
@@ -80,6 +82,8 @@ namespace TraceviewerServer
 		experimentXML = locations->fileXML;
 		fileTrace = locations->fileTrace;
 		tracesInitialized = false;
+		pyramid = NULL;
+		compressionType = COMPRESSION_DEFLATE;
 
 	}
 
@@ -92,6 +96,17 @@ namespace TraceviewerServer
 		headerSize = _headerSize;
 		delete dataTrace;
 		dataTrace = new FilteredBaseData(fileTrace, headerSize);
+
+		//The header size is only known now, so this is the earliest the
+		//summary can be checked against (or built from) the trace data.
+		if (lodBuckets > 0)
+		{
+			delete pyramid;
+			string dir = experimentXML.substr(0, experimentXML.find_last_of('/') + 1);
+			pyramid = TracePyramid::load(dir + "experiment.lod", dataTrace,
+					headerSize, lodBuckets);
+			dataTrace->setPyramid(pyramid);
+		}
 	}
 
 	int SpaceTimeDataController::getNumRanks()
@@ -124,24 +139,32 @@ namespace TraceviewerServer
 		traces[NextPtl->line()] = NextPtl;
 	}
 
+	//Creates every timeline of the current view without reading any data,
+	//so that the timelines can then be read in independently of each other.
 	//Don't call if in MPI mode
-	void SpaceTimeDataController::fillTraces()
+	void SpaceTimeDataController::createTraces()
 	{
 		//Traces might be null. resetTraces will fix that.
 		resetTraces();
 
-
-		//Taken straight from TimelineThread
 		ProcessTimeline* nextTrace = getNextTrace();
 		while (nextTrace != NULL)
 		{
-			nextTrace->readInData();
 			addNextTrace(nextTrace);
-
 			nextTrace = getNextTrace();
 		}
 	}
 
+	//Don't call if in MPI mode
+	void SpaceTimeDataController::fillTraces()
+	{
+		createTraces();
+
+		//Taken straight from TimelineThread
+		for (int i = 0; i < tracesLength; i++)
+			traces[i]->readInData();
+	}
+
 	 int* SpaceTimeDataController::getValuesXProcessID()
 	{
 		return dataTrace->getProcessIDs();
@@ -185,6 +208,7 @@ namespace TraceviewerServer
 	{
 		delete attributes;
 		delete dataTrace;
+		delete pyramid;
 
 		//The MPI implementation actually doesn't use the Traces array at all!
 		//It does call getNextTrace, but changedBounds is always true so
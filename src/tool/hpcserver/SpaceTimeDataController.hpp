@@ -64,6 +64,8 @@
 #include "FilteredBaseData.hpp"
 #include "FilterSet.hpp"
 #include "TimeCPID.hpp"
+#include "Constants.hpp"
+#include "LineBufferPool.hpp"
 
 #include <string>
 
@@ -79,6 +81,7 @@ namespace TraceviewerServer
 		void setInfo(Time, Time, int);
 		ProcessTimeline* getNextTrace();
 		void addNextTrace(ProcessTimeline*);
+		void createTraces();
 		void fillTraces();
 		ProcessTimeline* fillTrace(bool);
 		void applyFilters(FilterSet filters);
@@ -92,11 +95,15 @@ namespace TraceviewerServer
 		ImageTraceAttributes* attributes;
 		ProcessTimeline** traces;
 		int tracesLength;
+		//How the lines sent to this viewer are encoded, and what into
+		CompressionType compressionType;
+		LineBufferPool linePool;
 	private:
 		void resetTraces();
 		void deleteTraces();
 
 		FilteredBaseData* dataTrace;
+		TracePyramid* pyramid;
 		int headerSize;
 
 		// The minimum beginning and maximum ending time stamp across all traces (in microseconds).
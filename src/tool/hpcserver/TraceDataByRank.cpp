@@ -58,6 +58,7 @@
 //***************************************************************************
 
 #include "TraceDataByRank.hpp"
+#include "TracePyramid.hpp"
 #include <algorithm>
 #include <cstdlib> // previously: cmath but it causes ambuguity in abs function for gcc 4.4.6
 #include "Constants.hpp"
@@ -83,6 +84,16 @@ namespace TraceviewerServer
 	void TraceDataByRank::getData(Time timeStart, Time timeRange,
 			double pixelLength)
 	{
+		// zoomed out far enough: answer from the summary, if there is one
+		TracePyramid* pyramid = data->getPyramid();
+		if (pyramid != NULL
+				&& pyramid->getSamples(data->getFileIndex(rank), timeStart, timeRange,
+						pixelLength, listCPID))
+		{
+			postProcess();
+			return;
+		}
+
 		// get the start location
 		FileOffset startLoc = findTimeInInterval(timeStart, minloc, maxloc);
 
@@ -93,6 +104,17 @@ namespace TraceviewerServer
 
 		// get the number of records data to display
 		 Long numRec = 1 + getNumberOfRecords(startLoc, endLoc);
+		listCPID->reserve(min(numRec, (Long) numPixelsH) + 2);
+
+		// --------------------------------------------------------------------------------------------------
+		// get the first data if necessary: the leftmost time is still bigger than the lower limit
+		//	similarly, we add to the list. Everything after it is appended in order.
+		// --------------------------------------------------------------------------------------------------
+		if (startLoc > minloc)
+		{
+			 TimeCPID dataFirst = getData(startLoc - SIZE_OF_TRACE_RECORD);
+			addSample(0, dataFirst);
+		}
 
 		// --------------------------------------------------------------------------------------------------
 		// if the data-to-display is fit in the display zone, we don't need to use recursive binary search
@@ -113,7 +135,7 @@ namespace TraceviewerServer
 			// the data is too big: try to fit the "big" data into the display
 
 			//fills in the rest of the data for this process timeline
-			sampleTimeLine(startLoc, endLoc, 0, numPixelsH, 0, pixelLength, timeStart);
+			sampleTimeLine(startLoc, endLoc, 0, numPixelsH, listCPID->size(), pixelLength, timeStart);
 		}
 		// --------------------------------------------------------------------------------------------------
 		// get the last data if necessary: the rightmost time is still less then the upper limit
@@ -124,16 +146,6 @@ namespace TraceviewerServer
 			 TimeCPID dataLast = getData(endLoc);
 			addSample(listCPID->size(), dataLast);
 		}
-
-		// --------------------------------------------------------------------------------------------------
-		// get the first data if necessary: the leftmost time is still bigger than the lower limit
-		//	similarly, we add to the list
-		// --------------------------------------------------------------------------------------------------
-		if (startLoc > minloc)
-		{
-			 TimeCPID dataFirst = getData(startLoc - SIZE_OF_TRACE_RECORD);
-			addSample(0, dataFirst);
-		}
 		postProcess();
 	}
 	/*******************************************************************************************
@@ -143,6 +155,8 @@ namespace TraceviewerServer
 	 * location and the newfound location as endpoints and once with the newfound location
 	 * and the end location as endpoints. Effectively updates times and timeLine by calculating
 	 * the index in which to insert the next data. This way, it keeps times and timeLine sorted.
+	 * The left half is sampled before the middle is added, so the samples are only ever
+	 * appended rather than inserted in the middle of the list.
 	 * @author Reed Landrum and Michael Franco
 	 * @param minLoc The beginning location in the file to bound the search.
 	 * @param maxLoc The end location in the file to bound the search.
@@ -161,10 +175,10 @@ namespace TraceviewerServer
 
 		Long loc = findTimeInInterval((long)(midPixel * pixelLength + startingTime), minLoc,
 				maxLoc);
-		 TimeCPID nextData = getData(loc);
-		addSample(minIndex, nextData);
 		int addedLeft = sampleTimeLine(minLoc, loc, startPixel, midPixel, minIndex,
 				pixelLength, startingTime);
+		 TimeCPID nextData = getData(loc);
+		addSample(minIndex + addedLeft, nextData);
 		int addedRight = sampleTimeLine(loc, maxLoc, midPixel, endPixel,
 				minIndex + addedLeft + 1, pixelLength, startingTime);
 
@@ -291,19 +305,25 @@ namespace TraceviewerServer
 
 	void TraceDataByRank::postProcess()
 	{
-		int len = listCPID->size();
-		for (int i = 0; i < len - 2; i++)
+		// Keeps the first of each run of samples with the same timestamp, except
+		// that a pair at the very end is left alone. Done in one pass rather than
+		// erasing from the middle of the vector.
+		vector<TimeCPID>& list = *listCPID;
+		int len = list.size();
+		int kept = 0; // list[0..kept] are the samples kept so far
+		int next = 1; // the next sample to look at
+		while (next < len - 1)
 		{
-
-			while (i < len - 1 && (*listCPID)[i].timestamp == (*listCPID)[i + 1].timestamp)
-			{
-				vector<TimeCPID>::iterator it = listCPID->begin();
-				it += (i + 1);
-				listCPID->erase(it);
-				len--;
-			}
-
+			while (next < len && list[kept].timestamp == list[next].timestamp)
+				next++;
+			if (next == len)
+				break;
+			list[++kept] = list[next++];
 		}
+		while (next < len)
+			list[++kept] = list[next++];
+		if (len > 0)
+			list.erase(list.begin() + kept + 1, list.end());
 	}
 
 	TraceDataByRank::~TraceDataByRank()
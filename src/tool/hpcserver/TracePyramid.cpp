@@ -0,0 +1,307 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   [The purpose of this file]
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+#include "TracePyramid.hpp"
+#include "ByteUtilities.hpp"
+#include "Constants.hpp"
+#include "DataOutputFileStream.hpp"
+#include "DebugUtils.hpp"
+#include "ProgressBar.hpp"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+using namespace std;
+
+namespace TraceviewerServer
+{
+
+	//Viewers connected to the same server would build it in the same file
+	static pthread_mutex_t buildLock = PTHREAD_MUTEX_INITIALIZER;
+
+	/****
+	 * Opens the summary stored at path. If there is none, or it was made
+	 * for other data or another number of buckets, the summary is rebuilt
+	 * from data and stored at path first.
+	 *
+	 * @return the summary, or NULL if it can neither be read nor built
+	 */
+	TracePyramid* TracePyramid::load(string path, FilteredBaseData* data,
+			int headerSize, int numBuckets)
+	{
+		pthread_mutex_lock(&buildLock);
+		TracePyramid* pyramid = open(path, data, headerSize, numBuckets);
+		pthread_mutex_unlock(&buildLock);
+		return pyramid;
+	}
+
+	TracePyramid* TracePyramid::open(string path, FilteredBaseData* data,
+			int headerSize, int numBuckets)
+	{
+		for (int attempt = 0; attempt < 2; attempt++)
+		{
+			if (FileUtils::exists(path) && FileUtils::getFileSize(path) >= (FileOffset) HEADER_SIZE)
+			{
+				FileOffset size = FileUtils::getFileSize(path);
+				FileDescriptor fd = ::open(path.c_str(), O_RDONLY);
+				if (fd >= 0)
+				{
+					char* map = (char*) mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+					close(fd);
+					if (map != MAP_FAILED)
+					{
+						TracePyramid* pyramid = new TracePyramid(map, size);
+						if (pyramid->matches(data, headerSize, numBuckets))
+							return pyramid;
+						delete pyramid;
+					}
+				}
+			}
+			if (attempt == 0 && !build(path, data, headerSize, numBuckets))
+				break;
+		}
+		cerr << "Could not use the trace summary " << path << endl;
+		return NULL;
+	}
+
+	TracePyramid::TracePyramid(char* _map, FileOffset _mapSize)
+	{
+		map = _map;
+		mapSize = _mapSize;
+
+		char* pos = map + SIZEOF_LONG;
+		numRanks = ByteUtilities::readInt(pos);
+		pos += SIZEOF_INT;
+		numBuckets = ByteUtilities::readInt(pos);
+		pos += SIZEOF_INT;
+		numLevels = ByteUtilities::readInt(pos);
+		pos += SIZEOF_INT;
+		headerSize = ByteUtilities::readInt(pos);
+		pos += SIZEOF_INT;
+		dataEnd = ByteUtilities::readLong(pos);
+		pos += SIZEOF_LONG;
+		origin = ByteUtilities::readLong(pos);
+		pos += SIZEOF_LONG;
+		baseWidth = ByteUtilities::readLong(pos);
+
+		recordsPerRank = 0;
+		if (numBuckets > 0 && numLevels > 0 && numLevels < 64)
+		{
+			for (int level = 0; level < numLevels; level++)
+			{
+				levelStarts.push_back(recordsPerRank);
+				recordsPerRank += getNumBuckets(level);
+			}
+		}
+	}
+
+	bool TracePyramid::matches(FilteredBaseData* data, int _headerSize, int _numBuckets)
+	{
+		uint64_t magic = ByteUtilities::readLong(map);
+		return magic == MAGIC && numBuckets == _numBuckets && headerSize == _headerSize
+				&& recordsPerRank > 0 && baseWidth > 0
+				&& numRanks == data->getNumberOfRanks()
+				&& dataEnd == data->getMaxLoc(numRanks - 1)
+				&& mapSize == (FileOffset) (HEADER_SIZE + numRanks * recordsPerRank * SIZE_OF_TRACE_RECORD);
+	}
+
+	/****
+	 * Builds the summary of data in a temporary file that replaces path
+	 * when it is complete. data must not be filtered.
+	 */
+	bool TracePyramid::build(string path, FilteredBaseData* data,
+			int headerSize, int numBuckets)
+	{
+		int numRanks = data->getNumberOfRanks();
+		if (numRanks < 1 || numBuckets < 1)
+			return false;
+
+		// The summary spans the times of all ranks
+		Time origin = (Time) -1, end = 0;
+		for (int r = 0; r < numRanks; r++)
+		{
+			if (data->getMaxLoc(r) < data->getMinLoc(r))
+				continue;
+			origin = min(origin, (Time) data->getLong(data->getMinLoc(r)));
+			end = max(end, (Time) data->getLong(data->getMaxLoc(r)));
+		}
+		if (origin > end)
+			return false;
+		Time baseWidth = (end - origin) / numBuckets + 1;
+
+		int numLevels = 1;
+		while (((numBuckets - 1) >> (numLevels - 1)) > 0)
+			numLevels++;
+
+		//Every process (MPI rank) building the summary writes its own file
+		char suffix[32];
+		snprintf(suffix, sizeof(suffix), ".tmp.%d", (int) getpid());
+		string tmpPath = path + suffix;
+		DataOutputFileStream out(tmpPath.c_str());
+		if (!out.is_open())
+			return false;
+
+		out.writeLong(MAGIC);
+		out.writeInt(numRanks);
+		out.writeInt(numBuckets);
+		out.writeInt(numLevels);
+		out.writeInt(headerSize);
+		out.writeLong(data->getMaxLoc(numRanks - 1));
+		out.writeLong(origin);
+		out.writeLong(baseWidth);
+
+		ProgressBar prog("Building trace summary", numRanks);
+		vector<TimeCPID> buckets(numBuckets, TimeCPID(0, 0));
+		for (int r = 0; r < numRanks; r++)
+		{
+			FileOffset loc = data->getMinLoc(r);
+			FileOffset maxLoc = data->getMaxLoc(r);
+			fill(buckets.begin(), buckets.end(), TimeCPID(0, 0));
+
+			// The record in effect at the start of each bucket, or the first
+			// record for buckets before the rank started
+			for (int b = 0; b < numBuckets && loc <= maxLoc; b++)
+			{
+				Time start = origin + b * baseWidth;
+				while (loc + SIZE_OF_TRACE_RECORD <= maxLoc
+						&& (Time) data->getLong(loc + SIZE_OF_TRACE_RECORD) <= start)
+					loc += SIZE_OF_TRACE_RECORD;
+				buckets[b] = TimeCPID(data->getLong(loc), data->getInt(loc + SIZEOF_LONG));
+			}
+
+			// A bucket of a level starts where bucket (b << level) of level 0 does
+			for (int level = 0; level < numLevels; level++)
+			{
+				for (int b = 0; (b << level) < numBuckets; b++)
+				{
+					out.writeLong(buckets[b << level].timestamp);
+					out.writeInt(buckets[b << level].cpid);
+				}
+			}
+			prog.incrementProgress();
+		}
+
+		out.close();
+		if (out.fail() || rename(tmpPath.c_str(), path.c_str()) != 0)
+		{
+			remove(tmpPath.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	Long TracePyramid::getNumBuckets(int level)
+	{
+		return ((Long) numBuckets + (1LL << level) - 1) >> level;
+	}
+
+	TimeCPID TracePyramid::getRecord(int file, int level, Long bucket)
+	{
+		char* pos = map + HEADER_SIZE
+				+ (file * recordsPerRank + levelStarts[level] + bucket) * SIZE_OF_TRACE_RECORD;
+		return TimeCPID(ByteUtilities::readLong(pos), ByteUtilities::readInt(pos + SIZEOF_LONG));
+	}
+
+	/****
+	 * Fills samples with one record per pixel of the timeline of file, from
+	 * the level whose buckets are the widest that are not wider than a pixel.
+	 *
+	 * @return false if the pixels are narrower than the finest level, in
+	 *         which case the trace records have to be read
+	 */
+	bool TracePyramid::getSamples(int file, Time timeStart, Time timeRange,
+			double pixelLength, vector<TimeCPID>* samples)
+	{
+		if (file < 0 || file >= numRanks || pixelLength < baseWidth)
+			return false;
+
+		int level = 0;
+		while (level + 1 < numLevels && (double) (baseWidth << (level + 1)) <= pixelLength)
+			level++;
+		Time width = baseWidth << level;
+		Long lastBucket = getNumBuckets(level) - 1;
+
+		DEBUGCOUT(2) << "Sampling rank " << file << " from summary level " << level << endl;
+
+		// One sample per pixel, including the records in effect at both ends
+		// of the interval
+		Long numPixels = (Long) (timeRange / pixelLength) + 1;
+		for (Long i = 0; i <= numPixels; i++)
+		{
+			Time t = timeStart + (Time) (i * pixelLength);
+			Long bucket = (t < origin) ? 0 : min((Long) ((t - origin) / width), lastBucket);
+			TimeCPID record = getRecord(file, level, bucket);
+			if (samples->empty() || samples->back().timestamp != record.timestamp)
+				samples->push_back(record);
+		}
+		return true;
+	}
+
+	TracePyramid::~TracePyramid()
+	{
+		munmap(map, mapSize);
+	}
+
+} /* namespace TraceviewerServer */
@@ -0,0 +1,119 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   A multiresolution summary of the trace data used to answer zoomed-out
+//   requests without reading the trace records.
+//
+// Description:
+//   For every rank, the summary stores the record in effect at the start
+//   of each of a fixed number of equal time buckets spanning the whole
+//   trace (level 0), and of buckets twice as wide at each following level,
+//   up to one bucket covering everything. A request whose pixels are at
+//   least as wide as a level 0 bucket is answered from the level whose
+//   buckets are closest to the pixel width.
+//
+//***************************************************************************
+
+#ifndef TRACEPYRAMID_HPP_
+#define TRACEPYRAMID_HPP_
+
+#include "FilteredBaseData.hpp"
+#include "FileUtils.hpp" //For FileOffset
+#include "TimeCPID.hpp"
+
+#include <string>
+#include <vector>
+
+namespace TraceviewerServer
+{
+
+	class TracePyramid
+	{
+	public:
+		static TracePyramid* load(std::string path, FilteredBaseData* data,
+				int headerSize, int numBuckets);
+		virtual ~TracePyramid();
+
+		bool getSamples(int file, Time timeStart, Time timeRange, double pixelLength,
+				vector<TimeCPID>* samples);
+
+	private:
+		TracePyramid(char* map, FileOffset mapSize);
+		static TracePyramid* open(std::string path, FilteredBaseData* data,
+				int headerSize, int numBuckets);
+		static bool build(std::string path, FilteredBaseData* data,
+				int headerSize, int numBuckets);
+		bool matches(FilteredBaseData* data, int headerSize, int numBuckets);
+		Long getNumBuckets(int level);
+		TimeCPID getRecord(int file, int level, Long bucket);
+
+		char* map;
+		FileOffset mapSize;
+
+		int numRanks;
+		int numBuckets;
+		int numLevels;
+		int headerSize;
+		FileOffset dataEnd;
+		Time origin;
+		Time baseWidth;
+
+		//Position of each level within the records of a rank
+		vector<Long> levelStarts;
+		Long recordsPerRank;
+
+		static const uint64_t MAGIC = 0x48504353564C4F44ULL; //"HPCSVLOD"
+		static const int HEADER_SIZE = 8 + 4 * 4 + 3 * 8;
+	};
+
+} /* namespace TraceviewerServer */
+#endif /* TRACEPYRAMID_HPP_ */
@@ -0,0 +1,164 @@
+// -*-Mode: C++;-*-
+
+// * BeginRiceCopyright *****************************************************
+//
+// $HeadURL$
+// $Id$
+//
+// --------------------------------------------------------------------------
+// Part of HPCToolkit (hpctoolkit.org)
+//
+// Information about sources of support for research and development of
+// HPCToolkit is at 'hpctoolkit.org' and in 'README.Acknowledgments'.
+// --------------------------------------------------------------------------
+//
+// Copyright ((c)) 2002-2020, Rice University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+// * Redistributions of source code must retain the above copyright
+//   notice, this list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+// * Neither the name of Rice University (RICE) nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// This software is provided by RICE and contributors "as is" and any
+// express or implied warranties, including, but not limited to, the
+// implied warranties of merchantability and fitness for a particular
+// purpose are disclaimed. In no event shall RICE or contributors be
+// liable for any direct, indirect, incidental, special, exemplary, or
+// consequential damages (including, but not limited to, procurement of
+// substitute goods or services; loss of use, data, or profits; or
+// business interruption) however caused and on any theory of liability,
+// whether in contract, strict liability, or tort (including negligence
+// or otherwise) arising in any way out of the use of this software, even
+// if advised of the possibility of such damage.
+//
+// ******************************************************* EndRiceCopyright *
+
+//***************************************************************************
+//
+// File:
+//   $HeadURL$
+//
+// Purpose:
+//   Replays command streams from a stand-in client to check which data
+//   requests CommandQueue cancels.
+//
+// Description:
+//   [The set of functions, macros, etc. defined in the file]
+//
+//***************************************************************************
+
+#include "../CommandQueue.hpp"
+#include "../Constants.hpp"
+#include "../DataSocketStream.hpp"
+
+#include <sys/socket.h>
+#include <cassert>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+using namespace TraceviewerServer;
+
+static void writeDataRequest(DataSocketStream* client, int processEnd)
+{
+	client->writeInt(DATA);
+	client->writeInt(0);
+	client->writeInt(processEnd);
+	client->writeLong(0);
+	client->writeLong(1000000);
+	client->writeInt(processEnd);
+	client->writeInt(1000);
+}
+
+//Sends script (DATA requests are given by their processEnd) and returns the
+//commands the server side reads, up to DONE or the end of the stream
+static vector<Command> replay(const vector<int>& script, bool cancellable, bool hangUp,
+		vector<bool>* cancelled)
+{
+	int fds[2];
+	socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+	DataSocketStream client, server;
+	client.attachSocket(fds[0]);
+	server.attachSocket(fds[1]);
+
+	CommandQueue queue(&server, cancellable);
+	for (unsigned int i = 0; i < script.size(); i++)
+	{
+		if (script[i] == FLTR)
+		{
+			char padAndExclude[2] = {0, 1};
+			client.writeInt(FLTR);
+			client.writeRawData(padAndExclude, 2);
+			client.writeShort(0);
+		}
+		else if (script[i] == CNCL || script[i] == DONE)
+			client.writeInt(script[i]);
+		else
+			writeDataRequest(&client, script[i]);
+	}
+	client.flush();
+	if (hangUp)
+		shutdown(fds[0], SHUT_WR);
+
+	vector<Command> commands;
+	do
+		commands.push_back(queue.next());
+	while (commands.back().type != DONE && commands.back().type != 0);
+
+	for (unsigned int i = 0; i < commands.size(); i++)
+		cancelled->push_back(queue.isCancelled(commands[i]));
+	return commands;
+}
+
+void commandQueueTest() {
+	vector<int> script;
+	script.push_back(10);
+	script.push_back(20);
+	script.push_back(FLTR);
+	script.push_back(30);
+	script.push_back(DONE);
+
+	//A newer request cancels the older ones, but not itself
+	vector<bool> cancelled;
+	vector<Command> commands = replay(script, true, false, &cancelled);
+	assert(commands.size() == 5);
+	assert(commands[0].type == DATA && commands[0].processEnd == 10 && cancelled[0]);
+	assert(commands[1].type == DATA && commands[1].processEnd == 20 && cancelled[1]);
+	assert(commands[2].type == FLTR && commands[2].excludeMatches);
+	assert(commands[3].type == DATA && commands[3].processEnd == 30 && !cancelled[3]);
+	assert(commands[4].type == DONE);
+
+	//Clients that cannot handle cancelled replies get every request
+	cancelled.clear();
+	commands = replay(script, false, false, &cancelled);
+	assert(commands.size() == 5);
+	assert(!cancelled[0] && !cancelled[1] && !cancelled[3]);
+
+	//CNCL cancels everything before it and is not passed on
+	script.insert(script.begin() + 4, CNCL);
+	cancelled.clear();
+	commands = replay(script, true, false, &cancelled);
+	assert(commands.size() == 5);
+	assert(commands[3].type == DATA && cancelled[3]);
+
+	//A client that goes away without sending DONE
+	script.pop_back();
+	script.pop_back();
+	cancelled.clear();
+	commands = replay(script, true, true, &cancelled);
+	assert(commands.size() == 5);
+	assert(commands[4].type == 0 && commands[4].error == ERROR_READ_TOO_LITTLE);
+
+	cout << "Command queue verified." << endl;
+}
@@ -59,11 +59,16 @@
 
 #include "../DataCompressionLayer.hpp"
 #include "../ByteUtilities.hpp"
+#include "../Constants.hpp"
+#include "../LineBufferPool.hpp"
+#include "../TimeCPID.hpp"
 
+#include <sys/time.h>
 #include <cstdlib>
 #include <cstdio>
 #include <cassert>
 #include <iostream>
+#include <vector>
 using namespace std;
 
 using namespace TraceviewerServer;
@@ -97,6 +102,144 @@ void compressionTest() {
 	}
 	cout << "Compression correctness verified."<<endl;
 }
+//Samples per line, about what a viewer a couple of thousand pixels wide asks for
+#define BENCHMARK_LINE_LENGTH 2048
+#define BENCHMARK_SAMPLES (1 << 22)
+
+//Reads the records of a trace file, or makes up a timeline that looks like one
+//(regular sampling with jitter, calls that last a while) if there is no file.
+static vector<TimeCPID> loadTimeline(const char* traceFile, int headerSize)
+{
+	vector<TimeCPID> timeline;
+	if (traceFile != NULL)
+	{
+		FILE* in = fopen(traceFile, "rb");
+		if (in == NULL)
+		{
+			cerr << "Could not open " << traceFile << endl;
+			return timeline;
+		}
+		fseek(in, headerSize, SEEK_SET);
+		char record[SIZE_OF_TRACE_RECORD];
+		while (fread(record, 1, SIZE_OF_TRACE_RECORD, in) == SIZE_OF_TRACE_RECORD)
+			timeline.push_back(TimeCPID(ByteUtilities::readLong(record),
+					ByteUtilities::readInt(record + SIZEOF_LONG)));
+		fclose(in);
+		return timeline;
+	}
+
+	srand(1729);
+	Time time = 1000000;
+	int cpid = 1;
+	for (int i = 0; i < BENCHMARK_SAMPLES; i++)
+	{
+		time += 5000 + rand() % 200;
+		if (rand() % 8 == 0)
+			cpid = 1 + rand() % 3000;
+		timeline.push_back(TimeCPID(time, cpid));
+	}
+	return timeline;
+}
+
+static double now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+//Checks that the varint codec gives back what it was given
+static void varintTest()
+{
+	int values[] = {0, 1, -1, 63, -64, 64, 300, -300, 0x7FFFFFFF, (int)0x80000000};
+	int count = sizeof(values) / sizeof(values[0]);
+	DataCompressionLayer compr(COMPRESSION_VARINT);
+	for (int i = 0; i < count; i++)
+		compr.writeInt(values[i]);
+	compr.flush();
+
+	char* pos = (char*) compr.getOutputBuffer();
+	for (int i = 0; i < count; i++)
+	{
+		int length;
+		assert(ByteUtilities::readVarLong(pos, &length) == values[i]);
+		pos += length;
+	}
+	assert(pos == (char*) compr.getOutputBuffer() + compr.getOutputLength());
+	cout << "Varint correctness verified." << endl;
+}
+
+//Checks that a layer coming back out of the pool encodes like a new one
+void lineBufferPoolTest()
+{
+	CompressionType codecs[] = {COMPRESSION_NONE, COMPRESSION_DEFLATE, COMPRESSION_VARINT};
+	for (int c = 0; c < 3; c++)
+	{
+		LineBufferPool pool;
+		vector<unsigned char> first;
+		DataCompressionLayer* previous = NULL;
+		for (int round = 0; round < 2; round++)
+		{
+			DataCompressionLayer* compr = pool.get(codecs[c]);
+			assert(round == 0 || compr == previous);
+			for (int i = 0; i < BUFFER_SIZE; i++)
+				compr->writeInt(i * 7);
+			compr->flush();
+			vector<unsigned char> out(compr->getOutputBuffer(),
+					compr->getOutputBuffer() + compr->getOutputLength());
+			if (round == 0)
+				first = out;
+			else
+				assert(out == first);
+			previous = compr;
+			pool.put(compr);
+		}
+		assert(pool.getNumAllocated() == 1 && pool.getNumReused() == 1);
+	}
+	cout << "Line buffer reuse verified." << endl;
+}
+
+//Encodes a timeline line by line, the way a DATA reply is, with each codec
+//and reports how fast that goes and how much smaller the lines get.
+//Pass a .hpctrace file (and its header size) to use recorded samples.
+void codecBenchmark(const char* traceFile, int headerSize)
+{
+	varintTest();
+
+	vector<TimeCPID> timeline = loadTimeline(traceFile, headerSize);
+	if (timeline.empty())
+		return;
+	const char* names[] = {"none", "deflate", "fast", "varint"};
+	CompressionType codecs[] = {COMPRESSION_NONE, COMPRESSION_DEFLATE,
+			COMPRESSION_DEFLATE_FAST, COMPRESSION_VARINT};
+
+	double rawSize = (double) timeline.size() * SIZEOF_DELTASAMPLE;
+	cout << "Encoding " << timeline.size() << " samples in lines of "
+			<< BENCHMARK_LINE_LENGTH << endl;
+	for (int c = 0; c < 4; c++)
+	{
+		double encodedSize = 0;
+		double start = now();
+		for (unsigned int line = 0; line < timeline.size(); line += BENCHMARK_LINE_LENGTH)
+		{
+			DataCompressionLayer compr(codecs[c]);
+			unsigned int end = min(line + BENCHMARK_LINE_LENGTH, (unsigned int) timeline.size());
+			Time currentTime = timeline[line].timestamp;
+			for (unsigned int i = line; i < end; i++)
+			{
+				compr.writeInt((int) (timeline[i].timestamp - currentTime));
+				compr.writeInt(timeline[i].cpid);
+				currentTime = timeline[i].timestamp;
+			}
+			compr.flush();
+			encodedSize += compr.getOutputLength();
+		}
+		double elapsed = now() - start;
+		printf("%-8s %9.1f MB/s  ratio %5.2f\n", names[c],
+				rawSize / elapsed / (1 << 20), rawSize / encodedSize);
+	}
+}
+
 /* Decompress from file source to file dest until stream ends or EOF.
  * inf() returns Z_OK on success, Z_MEM_ERROR if memory could not be
  * allocated for processing, Z_DATA_ERROR if the deflate data is
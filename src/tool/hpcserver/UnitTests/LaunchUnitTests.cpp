@@ -57,10 +57,15 @@
 //
 //***************************************************************************
 
+#include <cstdlib>
+
 extern void filterTest();
 extern void progBarTest();
 extern void compressionTest();
 extern void lruTest();
+extern void commandQueueTest();
+extern void lineBufferPoolTest();
+extern void codecBenchmark(const char* traceFile, int headerSize);
 
 int main(int argc, char** argv)
 {
@@ -68,5 +73,9 @@ int main(int argc, char** argv)
 	compressionTest();
 	progBarTest();
 	filterTest();
+	commandQueueTest();
+	lineBufferPoolTest();
+	//Optionally: a recorded trace file and its header size
+	codecBenchmark(argc > 1 ? argv[1] : NULL, argc > 2 ? atoi(argv[2]) : 24);
 }
 
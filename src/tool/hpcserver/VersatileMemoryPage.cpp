@@ -63,6 +63,8 @@
 #include <cstring>
 #include <list>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "DebugUtils.hpp"
 #include "VersatileMemoryPage.hpp"
@@ -77,13 +79,33 @@ namespace TraceviewerServer
 		startPoint = _startPoint;
 		size = _size;
 		mostRecentlyUsed = pageManagementList;
-		index = mostRecentlyUsed->addNewUnused(this);
+		index = -1;
 		file = _file;
 		isMapped = false;
 		if (MAX_PAGES_TO_ALLOCATE_AT_ONCE <1)
 			cerr<<"Set max pages before creating any VersatileMemoryPages"<<endl;
 	}
 
+	VersatileMemoryPage::VersatileMemoryPage(FileOffset _startPoint, int _size, string _path, LRUList<VersatileMemoryPage>* pageManagementList)
+	{
+		startPoint = _startPoint;
+		size = _size;
+		mostRecentlyUsed = pageManagementList;
+		index = -1;
+		file = -1;
+		path = _path;
+		isMapped = false;
+		if (MAX_PAGES_TO_ALLOCATE_AT_ONCE <1)
+			cerr<<"Set max pages before creating any VersatileMemoryPages"<<endl;
+	}
+
+	//The list keeps a pointer to the page, so this must only be called once
+	//the page has reached the place where it will stay
+	void VersatileMemoryPage::addToList()
+	{
+		index = mostRecentlyUsed->addNewUnused(this);
+	}
+
 	void VersatileMemoryPage::setMaxPages(int pages)
 	{
 		MAX_PAGES_TO_ALLOCATE_AT_ONCE = pages;
@@ -106,6 +128,16 @@ namespace TraceviewerServer
 		return page;
 	}
 
+	char* VersatileMemoryPage::peek()
+	{
+		return isMapped ? page : NULL;
+	}
+
+	void VersatileMemoryPage::touch()
+	{
+		mostRecentlyUsed->putOnTop(index);
+	}
+
 	void VersatileMemoryPage::mapPage()
 	{
 
@@ -129,12 +161,19 @@ namespace TraceviewerServer
 			toRemove->unmapPage();
 			mostRecentlyUsed->removeLast();
 		}
-		page = (char*)mmap(0, size, MAP_PROT, MAP_FLAGS, file, startPoint);
+		//The mapping stays valid after the file is closed, so a database made
+		//of many trace files does not hold one descriptor per file.
+		FileDescriptor fd = file;
+		if (!path.empty())
+			fd = open(path.c_str(), O_RDONLY);
+		page = (char*)mmap(0, size, MAP_PROT, MAP_FLAGS, fd, startPoint);
+		if (!path.empty() && fd >= 0)
+			close(fd);
 		if (page == MAP_FAILED)
 		{
 			cerr << "Mapping returned error " << strerror(errno) << endl;
 			cerr << "off_t size =" << sizeof(off_t) << "mapping size=" << size << " MapProt=" <<MAP_PROT
-					<< " MapFlags=" << MAP_FLAGS << " fd=" << file << " Start point=" << startPoint << endl;
+					<< " MapFlags=" << MAP_FLAGS << " fd=" << fd << " Start point=" << startPoint << endl;
 			fflush(NULL);
 			exit(-1);
 		}
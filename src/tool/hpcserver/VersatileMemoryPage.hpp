@@ -62,6 +62,7 @@
 
 
 #include <sys/mman.h>
+#include <string>
 #include "FileUtils.hpp" //FileOffset
 #include "LRUList.hpp"
 
@@ -74,9 +75,16 @@ namespace TraceviewerServer
 	public:
 		VersatileMemoryPage();
 		VersatileMemoryPage(FileOffset, int, FileDescriptor, LRUList<VersatileMemoryPage>* pageManagementList);
+		VersatileMemoryPage(FileOffset, int, string, LRUList<VersatileMemoryPage>* pageManagementList);
 		virtual ~VersatileMemoryPage();
 		static void setMaxPages(int);
+		void addToList();
 		char* get();
+		//The mapping if the page is mapped, else NULL. Neither maps the
+		//page nor counts as a use.
+		char* peek();
+		//Counts a use of the page for the LRU order
+		void touch();
 	private:
 		void mapPage();
 		void unmapPage();
@@ -86,6 +94,8 @@ namespace TraceviewerServer
 		char* page;
 		int index;
 		FileDescriptor file;
+		//If not empty, the file is opened only while the page is mapped
+		string path;
 
 		bool isMapped;
 		LRUList<VersatileMemoryPage>* mostRecentlyUsed;
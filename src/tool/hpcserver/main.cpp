@@ -71,9 +71,12 @@ int main(int argc, char *argv[])
 		return 0;
 
 	Args args(argc, argv);
-	TraceviewerServer::useCompression = args.compression;
+	TraceviewerServer::preferredCompression = args.compression;
 	TraceviewerServer::xmlPortNumber = args.xmlPort;
 	TraceviewerServer::mainPortNumber = args.mainPort;
+	TraceviewerServer::numThreads = args.numThreads;
+	TraceviewerServer::lodBuckets = args.lodBuckets;
+	TraceviewerServer::maxConnections = args.maxConnections;
 
 	try
 	{